@@ -15,12 +15,55 @@ sneptile="./tools/Sneptile-0.3.0/Sneptile"
 
 # SC-3000 Tape Support
 tapewave="./tools/SC-TapeWave/tapewave"
+tapecheck="./tools/SC-TapeWave/tapecheck"
+
+# Headless test harness
+harness="./tools/TestRom-Harness/harness"
+bench="./tools/TestRom-Harness/bench"
+
+# Source files making up the ROM
+sources="cursor draw register key_interface lz profile sweep sequence stress main"
+
+# Optional extra compiler flags for the ROM
+rom_flags=""
+timing="compare"
+if [ "${1}" = "--record-timing" ]
+then
+    # Record each ROM's hot-path timing as the baseline that later builds are compared against
+    timing="record"
+elif [ "${1}" = "--check-timing" ]
+then
+    # Compare each ROM's hot-path timing against its baseline, failing if there is none
+    timing="check"
+elif [ "${1}" = "--profile" ]
+then
+    # On-screen frame-time profiler (SMS and Game Gear only)
+    rom_flags="-DPROFILE"
+elif [ "${1}" = "--sweep" ]
+then
+    # Automatic tone-period sweep, for recording and measuring with PSG-Measure
+    rom_flags="-DSWEEP"
+elif [ "${1}" = "--ladder" ]
+then
+    # Automatic attenuation ladder, for recording and measuring with PSG-Measure
+    rom_flags="-DLADDER"
+elif [ "${1}" = "--sequence" ]
+then
+    # Scripted register writes, timed to the scanline
+    rom_flags="-DSEQUENCE"
+elif [ "${1}" = "--stress" ]
+then
+    # Maximum PSG write rate, with the profiler showing the writes per frame on the SMS and Game Gear
+    rom_flags="-DSTRESS -DPROFILE"
+fi
 
 build_sneptile ()
 {
     # Early return if we've already got an up-to-date build
     if [ -e $sneptile \
          -a "./tools/Sneptile-0.3.0/source/main.c" -ot $sneptile \
+         -a "./tools/Sneptile-0.3.0/source/compress.c" -ot $sneptile \
+         -a "./tools/Sneptile-0.3.0/source/dedupe.c" -ot $sneptile \
          -a "./tools/Sneptile-0.3.0/source/sms_vdp.c" -ot $sneptile \
          -a "./tools/Sneptile-0.3.0/source/tms9928a.c" -ot $sneptile ]
     then
@@ -31,6 +74,7 @@ build_sneptile ()
     (
         cd "tools/Sneptile-0.3.0"
         ./build.sh
+        ./test.sh
     )
 }
 
@@ -38,7 +82,11 @@ build_sneptile ()
 build_tapewave ()
 {
     # Early return if we've already got an up-to-date build
-    if [ -e $tapewave -a "./tools/SC-TapeWave/source/main.c" -ot $tapewave ]
+    if [ -e $tapewave -a -e $tapecheck \
+         -a "./tools/SC-TapeWave/source/main.c" -ot $tapewave \
+         -a "./tools/SC-TapeWave/source/turbo_loader.h" -ot $tapewave \
+         -a "./tools/SC-TapeWave/source/tapecheck.c" -ot $tapecheck \
+         -a "./tools/SC-TapeWave/source/turbo_loader.h" -ot $tapecheck ]
     then
         return
     fi
@@ -52,6 +100,87 @@ build_tapewave ()
 }
 
 
+build_harness ()
+{
+    # Early return if we've already got an up-to-date build
+    if [ -e $harness -a -e $bench \
+         -a "./tools/TestRom-Harness/source/bench.c" -ot $bench \
+         -a "./tools/TestRom-Harness/source/input.c" -ot $harness \
+         -a "./tools/TestRom-Harness/source/machine.c" -ot $harness \
+         -a "./tools/TestRom-Harness/source/main.c" -ot $harness \
+         -a "./tools/TestRom-Harness/source/rom.c" -ot $harness \
+         -a "./tools/TestRom-Harness/source/symbols.c" -ot $harness \
+         -a "./tools/TestRom-Harness/source/z80.c" -ot $harness \
+         -a "./tools/PSG-Log/source/psg_log.c" -ot $harness ]
+    then
+        return
+    fi
+
+    echo "Building TestRom-Harness..."
+    (
+        cd "tools/TestRom-Harness"
+        ./build.sh
+    )
+}
+
+
+# Parameter {1} - Linker output (.ihx)
+report_rom_size ()
+{
+    # ihx2sms pads the ROM to a whole bank, so the bytes in the linker output are counted instead
+    rom_size=$(awk '
+        function hex (s,    i, n)
+        {
+            n = 0
+            for (i = 1; i <= length (s); i++)
+            {
+                n = n * 16 + index ("0123456789ABCDEF", toupper (substr (s, i, 1))) - 1
+            }
+            return n
+        }
+        substr ($0, 8, 2) == "00" { total += hex(substr ($0, 2, 2)) }
+        END { print total + 0 }' "${1}")
+    echo "  ROM holds ${rom_size} bytes of code and data"
+}
+
+
+# Parameter {1} - ROM file
+# Parameter {2} - Linker symbol file
+run_harness ()
+{
+    echo ""
+    echo "  Running headless..."
+    ${harness} --frames 600 --symbols "${2}" --values "build/${1%.*}.values" "${1}" "build/${1%.*}.psgl"
+
+    # The Game Gear's elements are laid out differently, so it has its own script
+    script="tools/TestRom-Harness/timing/typical.txt"
+    if [ "${1##*.}" = "gg" ]
+    then
+        script="tools/TestRom-Harness/timing/typical_gg.txt"
+    fi
+    baseline="tools/TestRom-Harness/timing/${1%.*}.baseline"
+
+    # Profiler, sweep, sequence and stress builds run differently by design, so are not compared against the baseline.
+    # A missing baseline only fails the build with --check-timing.
+    echo ""
+    echo "  Timing hot paths..."
+    if [ "${timing}" = "record" ]
+    then
+        ${bench} --input "${script}" --symbols "${2}" --symbols "${2%.*}.cdb" --baseline "${baseline}" --update "${1}"
+    elif [ -n "${rom_flags}" ]
+    then
+        ${bench} --input "${script}" --symbols "${2}" --symbols "${2%.*}.cdb" "${1}"
+    elif [ "${timing}" = "check" -o -e "${baseline}" ]
+    then
+        ${bench} --input "${script}" --symbols "${2}" --symbols "${2%.*}.cdb" --baseline "${baseline}" "${1}"
+    else
+        ${bench} --input "${script}" --symbols "${2}" --symbols "${2%.*}.cdb" "${1}"
+        echo "  Warning: No timing baseline at '${baseline}', so the comparison was skipped."
+        echo "           Run ./build.sh --record-timing to record one."
+    fi
+}
+
+
 # Parameter {1} - 'PAL' or 'NTSC'
 build_sn76489_test_rom_sms ()
 {
@@ -64,7 +193,7 @@ build_sn76489_test_rom_sms ()
         # Index 0 is used for transparency, use dark grey, our background colour.
         # Index 1, 2, and 3, are used for the cursor colour-cycle.
         # Index 4 is used for the selected key colour.
-        $sneptile --output tile_data --palette 0x15 0x01 0x02 0x03 0x33 \
+        $sneptile --compress --dedupe --output tile_data --palette 0x15 0x01 0x02 0x03 0x33 \
             tiles/empty.png \
             tiles/button.png \
             tiles/cursor.png \
@@ -80,20 +209,22 @@ build_sn76489_test_rom_sms ()
 
     mkdir -p build
     echo "  Compiling..."
-    for file in cursor draw register key_interface main
+    for file in ${sources}
     do
         echo "   -> ${file}.c"
-        ${sdcc} -c -mz80 -DTARGET_SMS -DTARGET_${1} --peep-file ${devkitSMS}/SMSlib/src/peep-rules.txt -I ${SMSlib}/src \
+        ${sdcc} -c -mz80 --debug ${rom_flags} -DTARGET_SMS -DTARGET_${1} --peep-file ${devkitSMS}/SMSlib/src/peep-rules.txt -I ${SMSlib}/src \
             -o "build/${file}.rel" "source/${file}.c"
     done
 
     echo ""
     echo "  Linking..."
-    ${sdcc} -o build/SN76489_TestRom_${1}.ihx -mz80 --no-std-crt0 --data-loc 0xC000 ${devkitSMS}/crt0/crt0_sms.rel build/*.rel ${SMSlib}/SMSlib.lib
+    ${sdcc} -o build/SN76489_TestRom_${1}.ihx -mz80 --debug --no-std-crt0 --data-loc 0xC000 ${devkitSMS}/crt0/crt0_sms.rel build/*.rel ${SMSlib}/SMSlib.lib
 
     echo ""
     echo "  Generating ROM..."
     ${ihx2sms} build/SN76489_TestRom_${1}.ihx SN76489_TestRom_${1}.sms
+    report_rom_size build/SN76489_TestRom_${1}.ihx
+    run_harness SN76489_TestRom_${1}.sms build/SN76489_TestRom_${1}.noi
 
     echo ""
     echo "  Done"
@@ -111,7 +242,7 @@ build_sn76489_test_rom_gg ()
         # Index 0 is used for transparency, use dark grey, our background colour.
         # Index 1, 2, and 3, are used for the cursor colour-cycle.
         # Index 4 is used for the selected key colour.
-        $sneptile --output tile_data --palette 0x15 0x01 0x02 0x03 0x33 \
+        $sneptile --compress --dedupe --output tile_data --palette 0x15 0x01 0x02 0x03 0x33 \
             tiles/empty.png \
             tiles/button.png \
             tiles/cursor.png \
@@ -127,20 +258,22 @@ build_sn76489_test_rom_gg ()
 
     mkdir -p build
     echo "  Compiling..."
-    for file in cursor draw register key_interface main
+    for file in ${sources}
     do
         echo "   -> ${file}.c"
-        ${sdcc} -c -mz80 -DTARGET_GG -DTARGET_NTSC --peep-file ${devkitSMS}/SMSlib/src/peep-rules.txt -I ${SMSlib}/src \
+        ${sdcc} -c -mz80 --debug ${rom_flags} -DTARGET_GG -DTARGET_NTSC --peep-file ${devkitSMS}/SMSlib/src/peep-rules.txt -I ${SMSlib}/src \
             -o "build/${file}.rel" "source/${file}.c"
     done
 
     echo ""
     echo "  Linking..."
-    ${sdcc} -o build/SN76489_TestRom.ihx -mz80 --no-std-crt0 --data-loc 0xC000 ${devkitSMS}/crt0/crt0_sms.rel build/*.rel ${SMSlib}/SMSlib_GG.lib
+    ${sdcc} -o build/SN76489_TestRom.ihx -mz80 --debug --no-std-crt0 --data-loc 0xC000 ${devkitSMS}/crt0/crt0_sms.rel build/*.rel ${SMSlib}/SMSlib_GG.lib
 
     echo ""
     echo "  Generating ROM..."
     ${ihx2sms} build/SN76489_TestRom.ihx SN76489_TestRom.gg
+    report_rom_size build/SN76489_TestRom.ihx
+    run_harness SN76489_TestRom.gg build/SN76489_TestRom.noi
 
     echo ""
     echo "  Done"
@@ -158,7 +291,7 @@ build_sn76489_test_rom_sg ()
     (
         # Note, tiles are organized so that similar-coloured files are
         # together, as they can share a mode-0 colour-table entry.
-        $sneptile --mode-0 --output tile_data \
+        $sneptile --mode-0 --compress --output tile_data \
             tiles/empty_tms.png \
             tiles/keys_outline_tms.png \
             tiles/title_tms.png \
@@ -174,19 +307,21 @@ build_sn76489_test_rom_sg ()
 
     mkdir -p build
     echo "  Compiling..."
-    for file in cursor draw register key_interface main
+    for file in ${sources}
     do
         echo "   -> ${file}.c"
-        ${sdcc} -c -mz80 -DTARGET_SG -DTARGET_${1} -I ${SGlib}/src -o "build/${file}.rel" "source/${file}.c"
+        ${sdcc} -c -mz80 --debug ${rom_flags} -DTARGET_SG -DTARGET_${1} -I ${SGlib}/src -o "build/${file}.rel" "source/${file}.c"
     done
 
     echo ""
     echo "  Linking..."
-    ${sdcc} -o build/SN76489_TestRom_${1}.ihx -mz80 --no-std-crt0 --data-loc 0xC000 ${devkitSMS}/crt0/crt0_sg.rel build/*.rel ${SGlib}/SGlib.rel
+    ${sdcc} -o build/SN76489_TestRom_${1}.ihx -mz80 --debug --no-std-crt0 --data-loc 0xC000 ${devkitSMS}/crt0/crt0_sg.rel build/*.rel ${SGlib}/SGlib.rel
 
     echo ""
     echo "  Generating ROM..."
     ${ihx2sms} build/SN76489_TestRom_${1}.ihx SN76489_TestRom_${1}.sg
+    report_rom_size build/SN76489_TestRom_${1}.ihx
+    run_harness SN76489_TestRom_${1}.sg build/SN76489_TestRom_${1}.noi
 
     echo ""
     echo "  Done"
@@ -204,7 +339,7 @@ build_sn76489_test_rom_sc_tape ()
     (
         # Note, tiles are organized so that similar-coloured files are
         # together, as they can share a mode-0 colour-table entry.
-        $sneptile --mode-0 --output tile_data \
+        $sneptile --mode-0 --compress --output tile_data \
             tiles/empty_tms.png \
             tiles/keys_outline_tms.png \
             tiles/title_tms.png \
@@ -220,10 +355,10 @@ build_sn76489_test_rom_sc_tape ()
 
     mkdir -p build
     echo "  Compiling..."
-    for file in cursor draw register key_interface main
+    for file in ${sources}
     do
         echo "   -> ${file}.c"
-        ${sdcc} -c -mz80 -DTARGET_SG -DTARGET_${1} -I ${SGlib}/src -o "build/${file}.rel" "source/${file}.c"
+        ${sdcc} -c -mz80 ${rom_flags} -DTARGET_SG -DTARGET_${1} -I ${SGlib}/src -o "build/${file}.rel" "source/${file}.c"
     done
 
     # Memory layout:
@@ -245,13 +380,27 @@ build_sn76489_test_rom_sc_tape ()
     # For now, just use ihx2sms as we've already got a copy. In the future, another tool may give
     # a better filesize as we don't really want it rounded to the nearest 16k multiple.
     objcopy -Iihex -Obinary build/SN76489_TestRom_${1}_tape.ihx build/SN76489_TestRom_${1}_tape.bin
+
+    # Report the size against the space BASIC IIIa leaves, from the code location up to 0xc800
+    tape_size=$(wc -c < build/SN76489_TestRom_${1}_tape.bin)
+    echo "  Program is ${tape_size} bytes, of $((0xc800 - 0x98a0)) available under BASIC IIIa"
     ${tapewave} "SN76489 TestRom" build/SN76489_TestRom_${1}_tape.bin SN76489_TestRom_${1}.wav
+    ${tapewave} --turbo "SN76489 TestRom" build/SN76489_TestRom_${1}_tape.bin SN76489_TestRom_${1}_turbo.wav
+    ${tapewave} "SN76489 TestRom" build/SN76489_TestRom_${1}_tape.bin SN76489_TestRom_${1}.bit
+
+    echo ""
+    echo "  Checking tape audio..."
+    ${tapecheck} SN76489_TestRom_${1}.wav build/SN76489_TestRom_${1}_check.bin
+    cmp build/SN76489_TestRom_${1}_tape.bin build/SN76489_TestRom_${1}_check.bin
+    ${tapecheck} --turbo SN76489_TestRom_${1}_turbo.wav build/SN76489_TestRom_${1}_turbo_check.bin
+    cmp build/SN76489_TestRom_${1}_tape.bin build/SN76489_TestRom_${1}_turbo_check.bin
 
     echo ""
     echo "  Done"
 }
 
 build_sneptile
+build_harness
 build_sn76489_test_rom_sms PAL
 build_sn76489_test_rom_sms NTSC
 build_sn76489_test_rom_gg
@@ -16,6 +16,15 @@
 #include "cursor.h"
 #include "../tile_data/pattern_index.h"
 
+/* When duplicate patterns have been removed, tile indices used
+ * in the code are looked up in the remap table before use. */
+#ifdef PATTERNS_DEDUPED
+#include "../tile_data/pattern_remap.h"
+#define PATTERN_REMAP(N) pattern_remap [N]
+#else
+#define PATTERN_REMAP(N) (N)
+#endif
+
 /* Target position for the newly selected item */
 static uint8_t target_x = 0;
 static uint8_t target_y = 0;
@@ -61,34 +70,34 @@ static void cursor_draw (void)
 #endif
 
     /* Top corners */
-    SMS_addSprite (x,                y, PATTERN_CURSOR + 0);
-    SMS_addSprite (x + cursor_w - 2, y, PATTERN_CURSOR + 2);
+    SMS_addSprite (x,                y, PATTERN_REMAP (PATTERN_CURSOR + 0));
+    SMS_addSprite (x + cursor_w - 2, y, PATTERN_REMAP (PATTERN_CURSOR + 2));
 
     /* Bottom corners */
-    SMS_addSprite (x,                y + cursor_h - 2, PATTERN_CURSOR + 6);
-    SMS_addSprite (x + cursor_w - 2, y + cursor_h - 2, PATTERN_CURSOR + 8);
+    SMS_addSprite (x,                y + cursor_h - 2, PATTERN_REMAP (PATTERN_CURSOR + 6));
+    SMS_addSprite (x + cursor_w - 2, y + cursor_h - 2, PATTERN_REMAP (PATTERN_CURSOR + 8));
 
 #ifdef TARGET_SG
     /* SG-1000 is limited to four sprites per line. Centre
      * the gap by placing one middle section each on the left and right. */
-    SMS_addSprite (x + 8,             y,                PATTERN_CURSOR + 1);
-    SMS_addSprite (x + cursor_w - 10, y,                PATTERN_CURSOR + 1);
-    SMS_addSprite (x + 8,             y + cursor_h - 2, PATTERN_CURSOR + 7);
-    SMS_addSprite (x + cursor_w - 10, y + cursor_h - 2, PATTERN_CURSOR + 7);
+    SMS_addSprite (x + 8,             y,                PATTERN_REMAP (PATTERN_CURSOR + 1));
+    SMS_addSprite (x + cursor_w - 10, y,                PATTERN_REMAP (PATTERN_CURSOR + 1));
+    SMS_addSprite (x + 8,             y + cursor_h - 2, PATTERN_REMAP (PATTERN_CURSOR + 7));
+    SMS_addSprite (x + cursor_w - 10, y + cursor_h - 2, PATTERN_REMAP (PATTERN_CURSOR + 7));
 #else
     /* Top & bottom edges */
     for (int16_t filler = x + 8; filler < (x + cursor_w - 2); filler += 8)
     {
-        SMS_addSprite (filler, y,                PATTERN_CURSOR + 1);
-        SMS_addSprite (filler, y + cursor_h - 2, PATTERN_CURSOR + 7);
+        SMS_addSprite (filler, y,                PATTERN_REMAP (PATTERN_CURSOR + 1));
+        SMS_addSprite (filler, y + cursor_h - 2, PATTERN_REMAP (PATTERN_CURSOR + 7));
     }
 #endif
 
     /* Left & right edges */
     for (int16_t filler = y + 8; filler < (y + cursor_h - 2); filler += 8)
     {
-        SMS_addSprite (x,                filler, PATTERN_CURSOR + 3);
-        SMS_addSprite (x + cursor_w - 2, filler, PATTERN_CURSOR + 5);
+        SMS_addSprite (x,                filler, PATTERN_REMAP (PATTERN_CURSOR + 3));
+        SMS_addSprite (x + cursor_w - 2, filler, PATTERN_REMAP (PATTERN_CURSOR + 5));
     }
 
     SMS_copySpritestoSAT ();
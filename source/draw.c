@@ -18,6 +18,17 @@ typedef uint16_t pattern_index_t;
 
 #include "../tile_data/pattern_index.h"
 
+/* When duplicate patterns have been removed, tile indices used
+ * in the code are looked up in the remap table before use. The
+ * table is stored here, and shared with cursor.c. */
+#ifdef PATTERNS_DEDUPED
+#define PATTERN_REMAP_DEFINE
+#include "../tile_data/pattern_remap.h"
+#define PATTERN_REMAP(N) pattern_remap [N]
+#else
+#define PATTERN_REMAP(N) (N)
+#endif
+
 #ifdef TARGET_SG
 /* Possibly a compiler bug: We get warnings about overflows in implicit
  * constant conversions. For now, just disable this warning. */
@@ -49,6 +60,8 @@ typedef uint16_t pattern_index_t;
 #define KEYBOARD_Y_END     21
 #endif
 
+#include "keyboard_strips.h"
+
 const pattern_index_t keyboard_upper_inactive [12] = {
     PATTERN_KEYS_INACTIVE + 0, PATTERN_KEYS_INACTIVE + 6, PATTERN_KEYS_INACTIVE + 2, PATTERN_KEYS_INACTIVE + 6,
     PATTERN_KEYS_INACTIVE + 2, PATTERN_KEYS_INACTIVE + 0, PATTERN_KEYS_INACTIVE + 6, PATTERN_KEYS_INACTIVE + 2,
@@ -61,27 +74,125 @@ const pattern_index_t keyboard_lower_inactive [12] = {
     PATTERN_KEYS_INACTIVE + 5, PATTERN_KEYS_INACTIVE + 2, PATTERN_KEYS_INACTIVE + 3, PATTERN_KEYS_INACTIVE + 2
 };
 
-const pattern_index_t keyboard_upper_active [12] = {
-    PATTERN_KEYS_ACTIVE + 0, PATTERN_KEYS_ACTIVE + 6, PATTERN_KEYS_ACTIVE + 2, PATTERN_KEYS_ACTIVE + 6,
-    PATTERN_KEYS_ACTIVE + 2, PATTERN_KEYS_ACTIVE + 0, PATTERN_KEYS_ACTIVE + 6, PATTERN_KEYS_ACTIVE + 2,
-    PATTERN_KEYS_ACTIVE + 6, PATTERN_KEYS_ACTIVE + 2, PATTERN_KEYS_ACTIVE + 6, PATTERN_KEYS_ACTIVE + 2
-};
+/*
+ * Name-table writes made while the display is active are held in this queue,
+ * and written to VRAM in one burst by draw_flush () during the vertical blank.
+ * Each entry is a horizontal run of up to four tiles, needing a single VRAM
+ * address setup.
+ *
+ * The queue is sized for the most runs one frame of the main loop can queue:
+ * Two keyboard keys (10 runs), the four channel buttons (8), three frequencies
+ * (6), and an element along with the mode it deselects (4). The profiler adds
+ * its four readouts (8).
+ */
+#ifdef PROFILE
+#define DRAW_QUEUE_SIZE 36
+#else
+#define DRAW_QUEUE_SIZE 28
+#endif
+#define DRAW_RUN_MAX     4
 
-const pattern_index_t keyboard_mid_active [12] = {
-    PATTERN_KEYS_ACTIVE + 0, PATTERN_KEYS_ACTIVE + 8, PATTERN_KEYS_ACTIVE + 2, PATTERN_KEYS_ACTIVE + 8,
-    PATTERN_KEYS_ACTIVE + 2, PATTERN_KEYS_ACTIVE + 0, PATTERN_KEYS_ACTIVE + 8, PATTERN_KEYS_ACTIVE + 2,
-    PATTERN_KEYS_ACTIVE + 8, PATTERN_KEYS_ACTIVE + 2, PATTERN_KEYS_ACTIVE + 8, PATTERN_KEYS_ACTIVE + 2
-};
+typedef struct draw_run_s {
+    uint8_t x;
+    uint8_t y;
+    uint8_t length;
+    pattern_index_t tiles [DRAW_RUN_MAX];
+} draw_run_t;
 
-const bool key_extends_left [12] = {
-    false, false, true, false, true,
-    false, false, true, false, true, false, true
-};
+static draw_run_t draw_queue [DRAW_QUEUE_SIZE];
+static uint8_t draw_queue_count = 0;
 
-const bool key_extends_right [12] = {
-    true, false, true, false, false,
-    true, false, true, false, true, false, false
-};
+/* Runs dropped because the queue was full. Not static, so that the headless
+ * harness can find it in the linker's symbol file and report it. */
+uint16_t draw_queue_overflows = 0;
+
+
+/*
+ * Write all queued name-table updates to VRAM.
+ * Should be called at the start of the vertical blank.
+ */
+void draw_flush (void)
+{
+    for (uint8_t i = 0; i < draw_queue_count; i++)
+    {
+        const draw_run_t *run = &draw_queue [i];
+        SMS_loadTileMap (run->x, run->y, run->tiles, run->length * sizeof (pattern_index_t));
+    }
+
+    draw_queue_count = 0;
+}
+
+
+/*
+ * Queue a horizontal run of tiles to be written during the next vertical blank.
+ *
+ * If the queue is full, the run is dropped and counted in draw_queue_overflows,
+ * rather than flushing the queue early. SMS_loadTileMap writes faster than the
+ * VDP accepts during the active display, so VRAM is never written outside of
+ * the vertical blank. This should not happen, as the queue is sized for the
+ * worst case, and the harness warns of any overflow.
+ */
+static void draw_queue_run (uint8_t x, uint8_t y, const pattern_index_t *tiles, uint8_t length)
+{
+    if (draw_queue_count == DRAW_QUEUE_SIZE)
+    {
+        draw_queue_overflows++;
+        return;
+    }
+
+    draw_run_t *run = &draw_queue [draw_queue_count++];
+    run->x = x;
+    run->y = y;
+    run->length = length;
+
+    for (uint8_t i = 0; i < length; i++)
+    {
+        run->tiles [i] = PATTERN_REMAP (tiles [i]);
+    }
+}
+
+
+/*
+ * Queue a single tile to be written during the next vertical blank.
+ */
+static void draw_queue_tile (uint8_t x, uint8_t y, pattern_index_t tile)
+{
+    draw_queue_run (x, y, &tile, 1);
+}
+
+
+/*
+ * Write a horizontal run of tiles directly to the name table.
+ * Used while drawing the initial screen, with the display disabled.
+ */
+static void draw_tiles (uint8_t x, uint8_t y, const pattern_index_t *tiles, uint8_t length)
+{
+#ifdef PATTERNS_DEDUPED
+    pattern_index_t remapped [32];
+
+    for (uint8_t i = 0; i < length; i++)
+    {
+        remapped [i] = pattern_remap [tiles [i]];
+    }
+    tiles = remapped;
+#endif
+
+    SMS_loadTileMap (x, y, tiles, length * sizeof (pattern_index_t));
+}
+
+
+#ifdef TARGET_GG
+/*
+ * Write a rectangle of tiles directly to the name table.
+ */
+static void draw_tiles_area (uint8_t x, uint8_t y, const pattern_index_t *tiles, uint8_t width, uint8_t height)
+{
+    for (uint8_t row = 0; row < height; row++)
+    {
+        draw_tiles (x, y + row, &tiles [row * width], width);
+    }
+}
+#endif
 
 
 /*
@@ -94,8 +205,8 @@ void draw_button (uint8_t x, uint8_t y, bool value)
         PATTERN_BUTTON + 4, PATTERN_BUTTON + 5, PATTERN_BUTTON + 6, PATTERN_BUTTON + 7
     };
 
-    SMS_loadTileMap (x, y,     value ? &button [4] : &button [0], 2 * sizeof (pattern_index_t));
-    SMS_loadTileMap (x, y + 1, value ? &button [6] : &button [2], 2 * sizeof (pattern_index_t));
+    draw_queue_run (x, y,     value ? &button [4] : &button [0], 2);
+    draw_queue_run (x, y + 1, value ? &button [6] : &button [2], 2);
 }
 
 
@@ -109,23 +220,23 @@ void draw_footer (void)
         PATTERN_FOOTER_GG + 0, PATTERN_FOOTER_GG + 1, PATTERN_FOOTER_GG + 2,
         PATTERN_FOOTER_GG + 3, PATTERN_FOOTER_GG + 4
     };
-    SMS_loadTileMap (6, 20, name, sizeof (name));
+    draw_tiles (6, 20, name, 5);
 
     const pattern_index_t version [3] = {
         PATTERN_FOOTER_GG + 5, PATTERN_FOOTER_GG + 6, PATTERN_FOOTER_GG + 7,
     };
-    SMS_loadTileMap (23, 20, version, sizeof (version));
+    draw_tiles (23, 20, version, 3);
 #else
     const pattern_index_t name [5] = {
         PATTERN_FOOTER + 0, PATTERN_FOOTER + 1, PATTERN_FOOTER + 2,
         PATTERN_FOOTER + 3, PATTERN_FOOTER + 4
     };
-    SMS_loadTileMap (0, 23, name, sizeof (name));
+    draw_tiles (0, 23, name, 5);
 
     const pattern_index_t version [3] = {
         PATTERN_FOOTER + 5, PATTERN_FOOTER + 6, PATTERN_FOOTER + 7,
     };
-    SMS_loadTileMap (29, 23, version, sizeof (version));
+    draw_tiles (29, 23, version, 3);
 #endif
 }
 
@@ -140,41 +251,41 @@ void draw_keyboard (void)
     for (uint8_t col = KEYBOARD_X_START; col <= KEYBOARD_X_END; col++)
     {
         /* Top outline */
-        SMS_setTileatXY (col, KEYBOARD_Y_START - 1, PATTERN_KEYS_OUTLINE + 0);
+        SMS_setTileatXY (col, KEYBOARD_Y_START - 1, PATTERN_REMAP (PATTERN_KEYS_OUTLINE + 0));
 
 #ifdef TARGET_GG
         /* Top section of keys */
         key_tile = keyboard_upper_inactive [(col - 3) % 12];
-        SMS_setTileatXY (col, 17, key_tile);
-        SMS_setTileatXY (col, 18, key_tile);
+        SMS_setTileatXY (col, 17, PATTERN_REMAP (key_tile));
+        SMS_setTileatXY (col, 18, PATTERN_REMAP (key_tile));
 
         /* Bottom section of keys */
         key_tile = keyboard_lower_inactive [(col - 3) % 12];
-        SMS_setTileatXY (col, 19, key_tile);
+        SMS_setTileatXY (col, 19, PATTERN_REMAP (key_tile));
 #else
         /* Top section of keys */
         key_tile = keyboard_upper_inactive [(col - 2) % 12];
-        SMS_setTileatXY (col, 17, key_tile);
-        SMS_setTileatXY (col, 18, key_tile);
-        SMS_setTileatXY (col, 19, key_tile);
+        SMS_setTileatXY (col, 17, PATTERN_REMAP (key_tile));
+        SMS_setTileatXY (col, 18, PATTERN_REMAP (key_tile));
+        SMS_setTileatXY (col, 19, PATTERN_REMAP (key_tile));
 
         /* Bottom section of keys */
         key_tile = keyboard_lower_inactive [(col - 2) % 12];
-        SMS_setTileatXY (col, 20, key_tile);
-        SMS_setTileatXY (col, 21, key_tile);
+        SMS_setTileatXY (col, 20, PATTERN_REMAP (key_tile));
+        SMS_setTileatXY (col, 21, PATTERN_REMAP (key_tile));
 #endif
 
         /* Bottom outline */
-        SMS_setTileatXY (col, KEYBOARD_Y_END + 1, PATTERN_KEYS_OUTLINE + 1);
+        SMS_setTileatXY (col, KEYBOARD_Y_END + 1, PATTERN_REMAP (PATTERN_KEYS_OUTLINE + 1));
     }
 
     /* Right outline */
-    SMS_setTileatXY (KEYBOARD_X_END + 1, KEYBOARD_Y_START - 1, PATTERN_KEYS_OUTLINE + 2);
+    SMS_setTileatXY (KEYBOARD_X_END + 1, KEYBOARD_Y_START - 1, PATTERN_REMAP (PATTERN_KEYS_OUTLINE + 2));
     for (uint8_t row = KEYBOARD_Y_START; row <= KEYBOARD_Y_END; row++)
     {
-        SMS_setTileatXY (KEYBOARD_X_END + 1, row, PATTERN_KEYS_OUTLINE + 3);
+        SMS_setTileatXY (KEYBOARD_X_END + 1, row, PATTERN_REMAP (PATTERN_KEYS_OUTLINE + 3));
     }
-    SMS_setTileatXY (KEYBOARD_X_END + 1, KEYBOARD_Y_END + 1, PATTERN_KEYS_OUTLINE + 4);
+    SMS_setTileatXY (KEYBOARD_X_END + 1, KEYBOARD_Y_END + 1, PATTERN_REMAP (PATTERN_KEYS_OUTLINE + 4));
 }
 
 
@@ -184,173 +295,37 @@ void draw_keyboard (void)
  */
 void draw_keyboard_update (uint8_t key, bool active)
 {
-    pattern_index_t key_tile;
-
-    /* Top section */
-    if (active)
-    {
-        key_tile = keyboard_upper_active [key % 12];
-    }
-    else
-    {
-        key_tile = keyboard_upper_inactive [key % 12];
-    }
+    const key_strip_t *strip = active ? &key_strips_active [key % 12] : &key_strips_inactive [key % 12];
 
 #ifdef TARGET_GG
 
     /* Note: 1 = C, 5 is our leftmost key, an F. */
 
-    SMS_setTileatXY (key + 3, 17, key_tile);
-
-    /* Mid section */
-    if (active)
+    if (key == KEY_GG_LAST)
     {
-        key_tile = keyboard_mid_active [key % 12];
+        strip = active ? &key_strip_gg_last_active : &key_strip_gg_last_inactive;
     }
-    SMS_setTileatXY (key + 3, 18, key_tile);
+
+    /* Top and mid sections */
+    draw_queue_tile (key + 3, 17, strip->upper);
+    draw_queue_tile (key + 3, 18, strip->mid);
 
     /* Bottom section */
-    if (key_extends_left [key % 12] || key_extends_right [key % 12])
+    if (strip->lower_length)
     {
-        if (active)
-        {
-            /* Special case, as we end on an A on the Game Gear build. */
-            if (key == 21)
-            {
-                SMS_setTileatXY (key + 2, 19, PATTERN_KEYS_ACTIVE + 11);
-                SMS_setTileatXY (key + 3, 19, PATTERN_KEYS_ACTIVE + 2);
-                return;
-            }
-
-            switch (key % 12)
-            {
-                case 0:
-                    SMS_setTileatXY (key + 3, 19, PATTERN_KEYS_ACTIVE + 0);
-                    SMS_setTileatXY (key + 4, 19, PATTERN_KEYS_ACTIVE + 1);
-                    break;
-                case 2:
-                    SMS_setTileatXY (key + 2, 19, PATTERN_KEYS_ACTIVE + 7);
-                    SMS_setTileatXY (key + 3, 19, PATTERN_KEYS_ACTIVE + 2);
-                    SMS_setTileatXY (key + 4, 19, PATTERN_KEYS_ACTIVE + 3);
-                    break;
-                case 4:
-                case 11:
-                    SMS_setTileatXY (key + 2, 19, PATTERN_KEYS_ACTIVE + 9);
-                    SMS_setTileatXY (key + 3, 19, PATTERN_KEYS_ACTIVE + 2);
-                    break;
-                case 5:
-                    SMS_setTileatXY (key + 3, 19, PATTERN_KEYS_ACTIVE + 0);
-                    SMS_setTileatXY (key + 4, 19, PATTERN_KEYS_ACTIVE + 4);
-                    break;
-                case 7:
-                    SMS_setTileatXY (key + 2, 19, PATTERN_KEYS_ACTIVE + 10);
-                    SMS_setTileatXY (key + 3, 19, PATTERN_KEYS_ACTIVE + 2);
-                    SMS_setTileatXY (key + 4, 19, PATTERN_KEYS_ACTIVE + 5);
-                    break;
-                case 9:
-                    SMS_setTileatXY (key + 2, 19, PATTERN_KEYS_ACTIVE + 11);
-                    SMS_setTileatXY (key + 3, 19, PATTERN_KEYS_ACTIVE + 2);
-                    SMS_setTileatXY (key + 4, 19, PATTERN_KEYS_ACTIVE + 3);
-                    break;
-            }
-        }
-        else
-        {
-            uint8_t from = ((key_extends_left  [key % 12]) ? key - 1 : key) + 3;
-            uint8_t to   = ((key_extends_right [key % 12]) ? key + 1 : key) + 3;
-
-            for (uint8_t col = from; col <= to; col++)
-            {
-                /* Special case, as we end on an A on the Game Gear build. */
-                if (col == 24)
-                {
-                    key_tile = PATTERN_KEYS_INACTIVE + 2;
-                    SMS_setTileatXY (col, 19, key_tile);
-                    break;
-                }
-                else
-                {
-                    key_tile = keyboard_lower_inactive [(col - 3) % 12];
-                }
-                SMS_setTileatXY (col, 19, key_tile);
-            }
-        }
+        draw_queue_run (key + 3 + strip->lower_offset, 19, strip->lower, strip->lower_length);
     }
 #else
-    SMS_setTileatXY (key + 2, 17, key_tile);
-    SMS_setTileatXY (key + 2, 18, key_tile);
-
-    /* Mid section */
-    if (active)
-    {
-        key_tile = keyboard_mid_active [key % 12];
-    }
-    SMS_setTileatXY (key + 2, 19, key_tile);
+    /* Top and mid sections */
+    draw_queue_tile (key + 2, 17, strip->upper);
+    draw_queue_tile (key + 2, 18, strip->upper);
+    draw_queue_tile (key + 2, 19, strip->mid);
 
     /* Bottom section */
-    if (key_extends_left [key % 12] || key_extends_right [key % 12])
+    if (strip->lower_length)
     {
-        if (active)
-        {
-            switch (key % 12)
-            {
-                case 0:
-                    SMS_setTileatXY (key + 2, 20, PATTERN_KEYS_ACTIVE + 0);
-                    SMS_setTileatXY (key + 2, 21, PATTERN_KEYS_ACTIVE + 0);
-                    SMS_setTileatXY (key + 3, 20, PATTERN_KEYS_ACTIVE + 1);
-                    SMS_setTileatXY (key + 3, 21, PATTERN_KEYS_ACTIVE + 1);
-                    break;
-                case 2:
-                    SMS_setTileatXY (key + 1, 20, PATTERN_KEYS_ACTIVE + 7);
-                    SMS_setTileatXY (key + 1, 21, PATTERN_KEYS_ACTIVE + 7);
-                    SMS_setTileatXY (key + 2, 20, PATTERN_KEYS_ACTIVE + 2);
-                    SMS_setTileatXY (key + 2, 21, PATTERN_KEYS_ACTIVE + 2);
-                    SMS_setTileatXY (key + 3, 20, PATTERN_KEYS_ACTIVE + 3);
-                    SMS_setTileatXY (key + 3, 21, PATTERN_KEYS_ACTIVE + 3);
-                    break;
-                case 4:
-                case 11:
-                    SMS_setTileatXY (key + 1, 20, PATTERN_KEYS_ACTIVE + 9);
-                    SMS_setTileatXY (key + 1, 21, PATTERN_KEYS_ACTIVE + 9);
-                    SMS_setTileatXY (key + 2, 20, PATTERN_KEYS_ACTIVE + 2);
-                    SMS_setTileatXY (key + 2, 21, PATTERN_KEYS_ACTIVE + 2);
-                    break;
-                case 5:
-                    SMS_setTileatXY (key + 2, 20, PATTERN_KEYS_ACTIVE + 0);
-                    SMS_setTileatXY (key + 2, 21, PATTERN_KEYS_ACTIVE + 0);
-                    SMS_setTileatXY (key + 3, 20, PATTERN_KEYS_ACTIVE + 4);
-                    SMS_setTileatXY (key + 3, 21, PATTERN_KEYS_ACTIVE + 4);
-                    break;
-                case 7:
-                    SMS_setTileatXY (key + 1, 20, PATTERN_KEYS_ACTIVE + 10);
-                    SMS_setTileatXY (key + 1, 21, PATTERN_KEYS_ACTIVE + 10);
-                    SMS_setTileatXY (key + 2, 20, PATTERN_KEYS_ACTIVE + 2);
-                    SMS_setTileatXY (key + 2, 21, PATTERN_KEYS_ACTIVE + 2);
-                    SMS_setTileatXY (key + 3, 20, PATTERN_KEYS_ACTIVE + 5);
-                    SMS_setTileatXY (key + 3, 21, PATTERN_KEYS_ACTIVE + 5);
-                    break;
-                case 9:
-                    SMS_setTileatXY (key + 1, 20, PATTERN_KEYS_ACTIVE + 11);
-                    SMS_setTileatXY (key + 1, 21, PATTERN_KEYS_ACTIVE + 11);
-                    SMS_setTileatXY (key + 2, 20, PATTERN_KEYS_ACTIVE + 2);
-                    SMS_setTileatXY (key + 2, 21, PATTERN_KEYS_ACTIVE + 2);
-                    SMS_setTileatXY (key + 3, 20, PATTERN_KEYS_ACTIVE + 3);
-                    SMS_setTileatXY (key + 3, 21, PATTERN_KEYS_ACTIVE + 3);
-                    break;
-            }
-        }
-        else
-        {
-            uint8_t from = ((key_extends_left  [key % 12]) ? key - 1 : key) + 2;
-            uint8_t to   = ((key_extends_right [key % 12]) ? key + 1 : key) + 2;
-
-            for (uint8_t col = from; col <= to; col++)
-            {
-                key_tile = keyboard_lower_inactive [(col - 2) % 12];
-                SMS_setTileatXY (col, 20, key_tile);
-                SMS_setTileatXY (col, 21, key_tile);
-            }
-        }
+        draw_queue_run (key + 2 + strip->lower_offset, 20, strip->lower, strip->lower_length);
+        draw_queue_run (key + 2 + strip->lower_offset, 21, strip->lower, strip->lower_length);
     }
 #endif
 }
@@ -365,53 +340,53 @@ void draw_labels (void)
     /* Volume */
     const pattern_index_t volume [] = { PATTERN_LABELS_GG + 0, PATTERN_LABELS_GG + 1, PATTERN_LABELS_GG + 2, PATTERN_LABELS_GG + 3 };
     const pattern_index_t volume_last [] = { PATTERN_LABELS_GG + 0, PATTERN_LABELS_GG + 1, PATTERN_LABELS_GG + 29, PATTERN_LABELS_GG + 30 };
-    SMS_loadTileMapArea (6,  7, volume, 4, 1);
-    SMS_loadTileMapArea (6, 10, volume, 4, 1);
-    SMS_loadTileMapArea (6, 13, volume, 4, 1);
-    SMS_loadTileMapArea (6, 16, volume_last, 4, 1);
+    draw_tiles_area (6,  7, volume, 4, 1);
+    draw_tiles_area (6, 10, volume, 4, 1);
+    draw_tiles_area (6, 13, volume, 4, 1);
+    draw_tiles_area (6, 16, volume_last, 4, 1);
 
     /* Keys / Const */
     const pattern_index_t keys_const [] = {
         PATTERN_LABELS_GG + 4, PATTERN_LABELS_GG + 5, PATTERN_EMPTY, PATTERN_LABELS_GG + 8,
         PATTERN_LABELS_GG + 9, PATTERN_LABELS_GG + 10
     };
-    SMS_loadTileMapArea (12,  5, keys_const, 3, 2);
-    SMS_loadTileMapArea (12,  8, keys_const, 3, 2);
-    SMS_loadTileMapArea (12, 11, keys_const, 3, 2);
-    SMS_loadTileMapArea (12, 14, keys_const, 3, 2);
+    draw_tiles_area (12,  5, keys_const, 3, 2);
+    draw_tiles_area (12,  8, keys_const, 3, 2);
+    draw_tiles_area (12, 11, keys_const, 3, 2);
+    draw_tiles_area (12, 14, keys_const, 3, 2);
 
     /* Frequency */
     const pattern_index_t frequency [] = {
         PATTERN_LABELS_GG + 11, PATTERN_LABELS_GG + 12, PATTERN_LABELS_GG + 13, PATTERN_LABELS_GG + 14,
         PATTERN_LABELS_GG + 15, PATTERN_LABELS_GG + 16
     };
-    SMS_loadTileMapArea (14,  7, frequency, 6, 1);
-    SMS_loadTileMapArea (14, 10, frequency, 6, 1);
-    SMS_loadTileMapArea (14, 13, frequency, 6, 1);
+    draw_tiles_area (14,  7, frequency, 6, 1);
+    draw_tiles_area (14, 10, frequency, 6, 1);
+    draw_tiles_area (14, 13, frequency, 6, 1);
 
     /* Noise Control */
     const pattern_index_t noise_control [] = {
         PATTERN_LABELS_GG + 23, PATTERN_LABELS_GG + 24, PATTERN_LABELS_GG + 25, PATTERN_LABELS_GG + 26,
         PATTERN_LABELS_GG + 27, PATTERN_LABELS_GG + 28
     };
-    SMS_loadTileMapArea (14, 16, noise_control, 6, 1);
+    draw_tiles_area (14, 16, noise_control, 6, 1);
 
     /* Stereo Control */
     const pattern_index_t stereo [] = { PATTERN_LABELS_GG + 6, PATTERN_LABELS_GG + 7 };
-    SMS_loadTileMapArea (22,  5, stereo, 1, 2);
-    SMS_loadTileMapArea (22,  8, stereo, 1, 2);
-    SMS_loadTileMapArea (22, 11, stereo, 1, 2);
-    SMS_loadTileMapArea (22, 14, stereo, 1, 2);
+    draw_tiles_area (22,  5, stereo, 1, 2);
+    draw_tiles_area (22,  8, stereo, 1, 2);
+    draw_tiles_area (22, 11, stereo, 1, 2);
+    draw_tiles_area (22, 14, stereo, 1, 2);
 
     /* Buttons */
     const pattern_index_t tone_1_button [] = { PATTERN_LABELS_GG + 17, PATTERN_LABELS_GG + 18, PATTERN_LABELS_GG + 19, PATTERN_LABELS_GG + 20 };
     const pattern_index_t tone_2_button [] = { PATTERN_LABELS_GG + 17, PATTERN_LABELS_GG + 18, PATTERN_LABELS_GG + 19, PATTERN_LABELS_GG + 21 };
     const pattern_index_t tone_3_button [] = { PATTERN_LABELS_GG + 17, PATTERN_LABELS_GG + 18, PATTERN_LABELS_GG + 19, PATTERN_LABELS_GG + 22 };
     const pattern_index_t noise_button []  = { PATTERN_LABELS_GG + 31, PATTERN_LABELS_GG + 32, PATTERN_LABELS_GG + 33, PATTERN_LABELS_GG + 34 };
-    SMS_loadTileMapArea (22,  7, tone_1_button, 4, 1);
-    SMS_loadTileMapArea (22, 10, tone_2_button, 4, 1);
-    SMS_loadTileMapArea (22, 13, tone_3_button, 4, 1);
-    SMS_loadTileMapArea (22, 16, noise_button,  4, 1);
+    draw_tiles_area (22,  7, tone_1_button, 4, 1);
+    draw_tiles_area (22, 10, tone_2_button, 4, 1);
+    draw_tiles_area (22, 13, tone_3_button, 4, 1);
+    draw_tiles_area (22, 16, noise_button,  4, 1);
 #else
     /* Tone configuration */
     const pattern_index_t tone_channel_settings [] = {
@@ -421,9 +396,9 @@ void draw_labels (void)
         PATTERN_LABELS + 12, PATTERN_LABELS + 13, PATTERN_LABELS + 14, PATTERN_LABELS + 15,
         PATTERN_LABELS + 16
     };
-    SMS_loadTileMap (5,  5, tone_channel_settings, sizeof (tone_channel_settings));
-    SMS_loadTileMap (5,  8, tone_channel_settings, sizeof (tone_channel_settings));
-    SMS_loadTileMap (5, 11, tone_channel_settings, sizeof (tone_channel_settings));
+    draw_tiles (5,  5, tone_channel_settings, 17);
+    draw_tiles (5,  8, tone_channel_settings, 17);
+    draw_tiles (5, 11, tone_channel_settings, 17);
 
     /* Noise configuration */
     const pattern_index_t noise_channel_settings [] = {
@@ -433,17 +408,17 @@ void draw_labels (void)
         PATTERN_LABELS + 18, PATTERN_LABELS + 19, PATTERN_LABELS + 20, PATTERN_LABELS + 21,
         PATTERN_LABELS + 22
     };
-    SMS_loadTileMap (5, 14, noise_channel_settings, sizeof (noise_channel_settings));
+    draw_tiles (5, 14, noise_channel_settings, 17);
 
     /* Buttons */
     const pattern_index_t tone_1_button [] = { PATTERN_LABELS + 23, PATTERN_LABELS + 24, PATTERN_LABELS + 25 };
     const pattern_index_t tone_2_button [] = { PATTERN_LABELS + 23, PATTERN_LABELS + 24, PATTERN_LABELS + 26 };
     const pattern_index_t tone_3_button [] = { PATTERN_LABELS + 23, PATTERN_LABELS + 24, PATTERN_LABELS + 27 };
     const pattern_index_t noise_button []  = { PATTERN_LABELS + 28, PATTERN_LABELS + 29, PATTERN_LABELS + 30 };
-    SMS_loadTileMap (26,  3, tone_1_button, sizeof (tone_1_button));
-    SMS_loadTileMap (26,  6, tone_2_button, sizeof (tone_2_button));
-    SMS_loadTileMap (26,  9, tone_3_button, sizeof (tone_3_button));
-    SMS_loadTileMap (26, 12, noise_button,  sizeof (noise_button));
+    draw_tiles (26,  3, tone_1_button, 3);
+    draw_tiles (26,  6, tone_2_button, 3);
+    draw_tiles (26,  9, tone_3_button, 3);
+    draw_tiles (26, 12, noise_button,  3);
 #endif
 }
 
@@ -456,14 +431,7 @@ void draw_led (uint8_t x, uint8_t y, bool value)
     const pattern_index_t led_on  [2] = { PATTERN_LED + 2, PATTERN_LED + 3 };
     const pattern_index_t led_off [2] = { PATTERN_LED + 0, PATTERN_LED + 1 };
 
-    if (value)
-    {
-        SMS_loadTileMap (x, y, led_on, sizeof (led_on));
-    }
-    else
-    {
-        SMS_loadTileMap (x, y, led_off, sizeof (led_off));
-    }
+    draw_queue_run (x, y, value ? led_on : led_off, 2);
 }
 
 
@@ -496,10 +464,10 @@ void draw_title (void)
     };
 
 #ifdef TARGET_GG
-    SMS_loadTileMapArea (10, 3, title, 12, 2);
+    draw_tiles_area (10, 3, title, 12, 2);
 #else
-    SMS_loadTileMap (10, 0, &title [ 0], 12 * sizeof (pattern_index_t));
-    SMS_loadTileMap (10, 1, &title [12], 12 * sizeof (pattern_index_t));
+    draw_tiles (10, 0, &title [ 0], 12);
+    draw_tiles (10, 1, &title [12], 12);
 #endif
 }
 
@@ -509,8 +477,16 @@ void draw_title (void)
  */
 void draw_value (uint8_t x, uint8_t y, uint8_t value)
 {
-    uint8_t digit_1 = value / 10;
-    uint8_t digit_2 = value % 10;
+    uint8_t digit_1 = 0;
+    uint8_t digit_2 = value;
+
+    /* The Z80 has no divide instruction, and values shown here are small,
+     * so split off the tens digit by repeated subtraction. */
+    while (digit_2 >= 10)
+    {
+        digit_1++;
+        digit_2 -= 10;
+    }
 
     /* Don't show leading zeros */
     if (digit_1 == 0)
@@ -518,13 +494,62 @@ void draw_value (uint8_t x, uint8_t y, uint8_t value)
         digit_1 = 10;
     }
 
-    /* First digit */
-    SMS_setTileatXY (x, y,     PATTERN_DIGITS + digit_1);
-    SMS_setTileatXY (x, y + 1, PATTERN_DIGITS + digit_1 + 11);
+    pattern_index_t upper [2] = { PATTERN_DIGITS + digit_1,      PATTERN_DIGITS + digit_2 };
+    pattern_index_t lower [2] = { PATTERN_DIGITS + digit_1 + 11, PATTERN_DIGITS + digit_2 + 11 };
+
+    draw_queue_run (x, y,     upper, 2);
+    draw_queue_run (x, y + 1, lower, 2);
+}
+
+
+/*
+ * Convert a value to four packed BCD digits, showing values above 9999 as 9999.
+ *
+ * Uses the shift-and-add-3 (double dabble) method, to avoid the software
+ * 16-bit division and modulo that sdcc would otherwise call for each digit.
+ */
+static uint16_t draw_to_bcd (uint16_t value)
+{
+    uint16_t bcd = 0;
+
+    if (value > 9999)
+    {
+        value = 9999;
+    }
+
+    /* Align the most significant of the fourteen bits with bit 15 */
+    value <<= 2;
+
+    for (uint8_t i = 0; i < 14; i++)
+    {
+        /* Any digit of five or more will overflow when doubled, so add
+         * three to carry it into the next digit. */
+        if ((bcd & 0x000f) >= 0x0005)
+        {
+            bcd += 0x0003;
+        }
+        if ((bcd & 0x00f0) >= 0x0050)
+        {
+            bcd += 0x0030;
+        }
+        if ((bcd & 0x0f00) >= 0x0500)
+        {
+            bcd += 0x0300;
+        }
+        if ((bcd & 0xf000) >= 0x5000)
+        {
+            bcd += 0x3000;
+        }
+
+        bcd <<= 1;
+        if (value & 0x8000)
+        {
+            bcd |= 0x0001;
+        }
+        value <<= 1;
+    }
 
-    /* Second digit */
-    SMS_setTileatXY (x + 1, y,     PATTERN_DIGITS + digit_2);
-    SMS_setTileatXY (x + 1, y + 1, PATTERN_DIGITS + digit_2 + 11);
+    return bcd;
 }
 
 
@@ -533,10 +558,11 @@ void draw_value (uint8_t x, uint8_t y, uint8_t value)
  */
 void draw_value_wide (uint8_t x, uint8_t y, uint16_t value)
 {
-    uint8_t digit_1 = value / 1000;
-    uint8_t digit_2 = (value % 1000) / 100;
-    uint8_t digit_3 = (value % 100) / 10;
-    uint8_t digit_4 = value % 10;
+    uint16_t bcd = draw_to_bcd (value);
+    uint8_t digit_1 = (bcd >> 12);
+    uint8_t digit_2 = (bcd >>  8) & 0x0f;
+    uint8_t digit_3 = (bcd >>  4) & 0x0f;
+    uint8_t digit_4 =  bcd        & 0x0f;
 
     /* Don't show leading zeros */
     if (digit_1 == 0)
@@ -554,19 +580,15 @@ void draw_value_wide (uint8_t x, uint8_t y, uint16_t value)
         }
     }
 
-    /* First digit */
-    SMS_setTileatXY (x, y,     PATTERN_DIGITS + digit_1);
-    SMS_setTileatXY (x, y + 1, PATTERN_DIGITS + digit_1 + 11);
-
-    /* Second digit */
-    SMS_setTileatXY (x + 1, y,     PATTERN_DIGITS + digit_2);
-    SMS_setTileatXY (x + 1, y + 1, PATTERN_DIGITS + digit_2 + 11);
-
-    /* Third digit */
-    SMS_setTileatXY (x + 2, y,     PATTERN_DIGITS + digit_3);
-    SMS_setTileatXY (x + 2, y + 1, PATTERN_DIGITS + digit_3 + 11);
+    pattern_index_t upper [4] = {
+        PATTERN_DIGITS + digit_1, PATTERN_DIGITS + digit_2,
+        PATTERN_DIGITS + digit_3, PATTERN_DIGITS + digit_4
+    };
+    pattern_index_t lower [4] = {
+        PATTERN_DIGITS + digit_1 + 11, PATTERN_DIGITS + digit_2 + 11,
+        PATTERN_DIGITS + digit_3 + 11, PATTERN_DIGITS + digit_4 + 11
+    };
 
-    /* Fourth digit */
-    SMS_setTileatXY (x + 3, y,     PATTERN_DIGITS + digit_4);
-    SMS_setTileatXY (x + 3, y + 1, PATTERN_DIGITS + digit_4 + 11);
+    draw_queue_run (x, y,     upper, 4);
+    draw_queue_run (x, y + 1, lower, 4);
 }
@@ -6,6 +6,9 @@
 /* Draw a button indicator. */
 void draw_button (uint8_t x, uint8_t y, bool value);
 
+/* Write all queued name-table updates to VRAM. */
+void draw_flush (void);
+
 /* Draw the footer banner at the bottom of the screen. */
 void draw_footer (void);
 
@@ -19,6 +19,8 @@ extern uint16_t *element_values_ptr;
  * To allow the use of momentary buttons and a keyboard interface, the configured
  * attenuation is stored here, rather than written directly to the register on the
  * chip. The value is only written to the register during key-down events.
+ *
+ * Channels 0 to 2 are the tone channels, and channel 3 is the noise channel.
  */
 
 channel_state_t channel_state [4] = {
@@ -30,316 +32,66 @@ channel_state_t channel_state [4] = {
 
 
 /*
- * Update tone channel 0 volume to simulate a key register.
- */
-static void key_set_ch0_key (bool value)
-{
-    channel_state [0].key_on = value;
-    register_write_ch0_volume (value ? channel_state [0].volume : 0x0f);
-}
-
-
-/*
- * Update tone channel 0 volume.
- */
-void key_set_ch0_volume (uint16_t value)
-{
-    channel_state [0].volume = value & 0x0f;
-
-    if (channel_state [0].key_on)
-    {
-        register_write_ch0_volume (value & 0x0f);
-    }
-}
-
-
-/*
- * Set tone channel 0 to keyboard-mode.
- */
-void key_set_ch0_mode_keyboard (uint16_t value)
-{
-    if (value)
-    {
-        channel_state [0].mode = MODE_KEYBOARD;
-        key_set_ch0_key (false);
-    }
-    else
-    {
-        channel_state [0].mode = MODE_DEFAULT;
-        key_set_ch0_key (false);
-    }
-}
-
-
-/*
- * Set tone channel 0 to constant-mode.
- */
-void key_set_ch0_mode_constant (uint16_t value)
-{
-    if (value)
-    {
-        channel_state [0].mode = MODE_CONSTANT;
-        key_set_ch0_key (true);
-    }
-    else
-    {
-        channel_state [0].mode = MODE_DEFAULT;
-        key_set_ch0_key (false);
-    }
-}
-
-
-/*
- * Update tone channel 0 frequency.
- */
-void key_set_ch0_frequency (uint16_t value)
-{
-    register_write_ch0_frequency (value);
-}
-
-
-/*
- * Set tone channel 0 momentary button.
- */
-void key_set_ch0_button (uint16_t value)
-{
-    if (channel_state [0].mode != MODE_CONSTANT)
-    {
-        key_set_ch0_key (value);
-    }
-}
-
-
-/*
- * Update tone channel 1 volume to simulate a key register.
- */
-void key_set_ch1_key (uint16_t value)
-{
-    channel_state [1].key_on = value;
-    register_write_ch1_volume (value ? channel_state [1].volume : 0x0f);
-}
-
-
-/*
- * Update tone channel 1 volume.
- */
-void key_set_ch1_volume (uint16_t value)
-{
-    channel_state [1].volume = value & 0x0f;
-
-    if (channel_state [1].key_on)
-    {
-        register_write_ch1_volume (value & 0x0f);
-    }
-}
-
-
-/*
- * Set tone channel 1 to keyboard-mode.
- */
-void key_set_ch1_mode_keyboard (uint16_t value)
-{
-    if (value)
-    {
-        channel_state [1].mode = MODE_KEYBOARD;
-        key_set_ch1_key (false);
-    }
-    else
-    {
-        channel_state [1].mode = MODE_DEFAULT;
-        key_set_ch1_key (false);
-    }
-}
-
-
-/*
- * Set tone channel 1 to constant-mode.
+ * Update a channel's volume to simulate a key register.
  */
-void key_set_ch1_mode_constant (uint16_t value)
+static void key_set_key (uint8_t channel, bool value)
 {
-    if (value)
-    {
-        channel_state [1].mode = MODE_CONSTANT;
-        key_set_ch1_key (true);
-    }
-    else
-    {
-        channel_state [1].mode = MODE_DEFAULT;
-        key_set_ch1_key (false);
-    }
-}
-
-
-/*
- * Update tone channel 1 frequency.
- */
-void key_set_ch1_frequency (uint16_t value)
-{
-    register_write_ch1_frequency (value);
-}
-
-
-/*
- * Set tone channel 1 momentary button.
- */
-void key_set_ch1_button (uint16_t value)
-{
-    if (channel_state [1].mode != MODE_CONSTANT)
-    {
-        key_set_ch1_key (value);
-    }
-}
-
-
-/*
- * Update tone channel 2 key.
- */
-void key_set_ch2_key (uint16_t value)
-{
-    channel_state [2].key_on = value;
-    register_write_ch2_volume (value ? channel_state [2].volume : 0x0f);
+    channel_state [channel].key_on = value;
+    register_write_volume (channel, value ? channel_state [channel].volume : 0x0f);
 }
 
 
 /*
- * Update tone channel 2 volume.
+ * Update a channel's volume.
  */
-void key_set_ch2_volume (uint16_t value)
+void key_set_volume (uint8_t channel, uint16_t value)
 {
-    channel_state [2].volume = value & 0x0f;
+    channel_state [channel].volume = value & 0x0f;
 
-    if (channel_state [2].key_on)
+    if (channel_state [channel].key_on)
     {
-        register_write_ch2_volume (value & 0x0f);
+        register_write_volume (channel, value & 0x0f);
     }
 }
 
 
 /*
- * Set tone channel 2 to keyboard-mode.
+ * Set a channel to keyboard-mode.
  */
-void key_set_ch2_mode_keyboard (uint16_t value)
+void key_set_mode_keyboard (uint8_t channel, uint16_t value)
 {
-    if (value)
-    {
-        channel_state [2].mode = MODE_KEYBOARD;
-        key_set_ch2_key (false);
-    }
-    else
-    {
-        channel_state [2].mode = MODE_DEFAULT;
-        key_set_ch2_key (false);
-    }
-}
-
-
-/*
- * Set tone channel 2 to constant-mode.
- */
-void key_set_ch2_mode_constant (uint16_t value)
-{
-    if (value)
-    {
-        channel_state [2].mode = MODE_CONSTANT;
-        key_set_ch2_key (true);
-    }
-    else
-    {
-        channel_state [2].mode = MODE_DEFAULT;
-        key_set_ch2_key (false);
-    }
+    channel_state [channel].mode = value ? MODE_KEYBOARD : MODE_DEFAULT;
+    key_set_key (channel, false);
 }
 
 
 /*
- * Update tone channel 2 frequency.
+ * Set a channel to constant-mode.
  */
-void key_set_ch2_frequency (uint16_t value)
+void key_set_mode_constant (uint8_t channel, uint16_t value)
 {
-    register_write_ch2_frequency (value);
+    channel_state [channel].mode = value ? MODE_CONSTANT : MODE_DEFAULT;
+    key_set_key (channel, value);
 }
 
 
 /*
- * Set tone channel 2 momentary button.
+ * Update a tone channel's frequency.
  */
-void key_set_ch2_button (uint16_t value)
+void key_set_frequency (uint8_t channel, uint16_t value)
 {
-    if (channel_state [2].mode != MODE_CONSTANT)
-    {
-        key_set_ch2_key (value);
-    }
-}
-
-
-/*
- * Update noise channel key.
- */
-void key_set_noise_key (uint16_t value)
-{
-    channel_state [3].key_on = value;
-    register_write_noise_volume (value ? channel_state [3].volume : 0x0f);
-}
-
-
-/*
- * Update noise channel volume.
- */
-void key_set_noise_volume (uint16_t value)
-{
-    channel_state [3].volume = value & 0x0f;
-
-    if (channel_state [3].key_on)
-    {
-        register_write_noise_volume (value & 0x0f);
-    }
-}
-
-
-/*
- * Set noise channel to keyboard-mode.
- */
-void key_set_noise_mode_keyboard (uint16_t value)
-{
-    if (value)
-    {
-        channel_state [3].mode = MODE_KEYBOARD;
-        key_set_noise_key (false);
-    }
-    else
-    {
-        channel_state [3].mode = MODE_DEFAULT;
-        key_set_noise_key (false);
-    }
-}
-
-
-/*
- * Set noise channel to constant-mode.
- */
-void key_set_noise_mode_constant (uint16_t value)
-{
-    if (value)
-    {
-        channel_state [3].mode = MODE_CONSTANT;
-        key_set_noise_key (true);
-    }
-    else
-    {
-        channel_state [3].mode = MODE_DEFAULT;
-        key_set_noise_key (false);
-    }
+    register_write_frequency (channel, value);
 }
 
 
 /*
- * Set noise channel momentary button.
+ * Set a channel's momentary button.
  */
-void key_set_noise_button (uint16_t value)
+void key_set_button (uint8_t channel, uint16_t value)
 {
-    if (channel_state [3].mode != MODE_CONSTANT)
+    if (channel_state [channel].mode != MODE_CONSTANT)
     {
-        key_set_noise_key (value);
+        key_set_key (channel, value);
     }
 }
 
@@ -347,7 +99,8 @@ void key_set_noise_button (uint16_t value)
 /*
  * Update noise control register.
  */
-void key_set_noise_control (uint16_t value)
+void key_set_noise_control (uint8_t channel, uint16_t value)
 {
+    (void) channel;
     register_write_noise_control (value);
 }
@@ -0,0 +1,69 @@
+/*
+ * SN76489 Test ROM
+ * Joppy Furr 2024
+ */
+
+/*
+ * Precomputed tiles for redrawing a single key on the keyboard.
+ *
+ * Each key is drawn as a column of single tiles for the upper section, and for
+ * white keys, a horizontal run of up to three tiles for the lower section. The
+ * lower run also covers the neighbouring columns that a white key extends into
+ * beneath the black keys. Every row can then be written with a single VRAM
+ * address setup.
+ *
+ * The keyboard repeats every 12 keys, so the tables are indexed by (key % 12),
+ * with 0 being a C.
+ */
+
+typedef struct key_strip_s {
+    pattern_index_t upper;
+    pattern_index_t mid;
+    int8_t lower_offset;    /* Column of the first lower tile, relative to the key */
+    uint8_t lower_length;   /* Zero for black keys, which have no lower section */
+    pattern_index_t lower [3];
+} key_strip_t;
+
+#define KEY_WHITE(S, UPPER, OFFSET, LENGTH, L0, L1, L2) \
+    { .upper = S + UPPER, .mid = S + UPPER, .lower_offset = OFFSET, .lower_length = LENGTH, \
+      .lower = { S + L0, S + L1, S + L2 } }
+
+#define KEY_BLACK(S, UPPER, MID) \
+    { .upper = S + UPPER, .mid = S + MID, .lower_offset = 0, .lower_length = 0 }
+
+static const key_strip_t key_strips_inactive [12] = {
+    KEY_WHITE (PATTERN_KEYS_INACTIVE, 0,  0, 2, 0, 1, 0),   /* C  */
+    KEY_BLACK (PATTERN_KEYS_INACTIVE, 6, 6),                /* C# */
+    KEY_WHITE (PATTERN_KEYS_INACTIVE, 2, -1, 3, 1, 2, 3),   /* D  */
+    KEY_BLACK (PATTERN_KEYS_INACTIVE, 6, 6),                /* D# */
+    KEY_WHITE (PATTERN_KEYS_INACTIVE, 2, -1, 2, 3, 2, 0),   /* E  */
+    KEY_WHITE (PATTERN_KEYS_INACTIVE, 0,  0, 2, 0, 4, 0),   /* F  */
+    KEY_BLACK (PATTERN_KEYS_INACTIVE, 6, 6),                /* F# */
+    KEY_WHITE (PATTERN_KEYS_INACTIVE, 2, -1, 3, 4, 2, 5),   /* G  */
+    KEY_BLACK (PATTERN_KEYS_INACTIVE, 6, 6),                /* G# */
+    KEY_WHITE (PATTERN_KEYS_INACTIVE, 2, -1, 3, 5, 2, 3),   /* A  */
+    KEY_BLACK (PATTERN_KEYS_INACTIVE, 6, 6),                /* A# */
+    KEY_WHITE (PATTERN_KEYS_INACTIVE, 2, -1, 2, 3, 2, 0)    /* B  */
+};
+
+static const key_strip_t key_strips_active [12] = {
+    KEY_WHITE (PATTERN_KEYS_ACTIVE, 0,  0, 2,  0, 1, 0),    /* C  */
+    KEY_BLACK (PATTERN_KEYS_ACTIVE, 6, 8),                  /* C# */
+    KEY_WHITE (PATTERN_KEYS_ACTIVE, 2, -1, 3,  7, 2, 3),    /* D  */
+    KEY_BLACK (PATTERN_KEYS_ACTIVE, 6, 8),                  /* D# */
+    KEY_WHITE (PATTERN_KEYS_ACTIVE, 2, -1, 2,  9, 2, 0),    /* E  */
+    KEY_WHITE (PATTERN_KEYS_ACTIVE, 0,  0, 2,  0, 4, 0),    /* F  */
+    KEY_BLACK (PATTERN_KEYS_ACTIVE, 6, 8),                  /* F# */
+    KEY_WHITE (PATTERN_KEYS_ACTIVE, 2, -1, 3, 10, 2, 5),    /* G  */
+    KEY_BLACK (PATTERN_KEYS_ACTIVE, 6, 8),                  /* G# */
+    KEY_WHITE (PATTERN_KEYS_ACTIVE, 2, -1, 3, 11, 2, 3),    /* A  */
+    KEY_BLACK (PATTERN_KEYS_ACTIVE, 6, 8),                  /* A# */
+    KEY_WHITE (PATTERN_KEYS_ACTIVE, 2, -1, 2,  9, 2, 0)     /* B  */
+};
+
+#ifdef TARGET_GG
+/* Special case, as we end on an A on the Game Gear build. */
+#define KEY_GG_LAST 21
+static const key_strip_t key_strip_gg_last_inactive = KEY_WHITE (PATTERN_KEYS_INACTIVE, 2, -1, 2,  5, 2, 0);
+static const key_strip_t key_strip_gg_last_active   = KEY_WHITE (PATTERN_KEYS_ACTIVE,   2, -1, 2, 11, 2, 0);
+#endif
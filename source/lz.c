@@ -0,0 +1,97 @@
+/*
+ * SN76489 Test ROM
+ * Joppy Furr 2024
+ *
+ * Decompressor for pattern data generated by Sneptile's --compress option.
+ *
+ * The format is a byte-oriented LZ77 variant:
+ *
+ *  0x00 - 0x7f: Literal run, copy the next (token + 1) bytes to the output.
+ *  0x80       : End of stream.
+ *  0x81 - 0xff: Match, followed by a distance byte. Copy (token & 0x7f) + 2 bytes,
+ *               starting from (distance + 1) bytes back in the output.
+ *
+ * Matches never reach back more than 256 bytes, so the output is produced in
+ * blocks of 256 bytes into a window in RAM, which doubles as the history for
+ * matches. Each block can then be copied to VRAM before the next is produced.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "lz.h"
+
+#define LZ_END 0x80
+
+uint8_t lz_window [256];
+
+/* Decoder state, kept between blocks as runs may cross a block boundary */
+static const uint8_t *lz_src = NULL;
+static uint8_t lz_literals = 0;
+static uint8_t lz_match = 0;
+static uint8_t lz_distance = 0;
+static uint8_t lz_pos = 0;
+static bool lz_done = true;
+
+
+/*
+ * Begin decompressing a stream.
+ */
+void lz_start (const uint8_t *src)
+{
+    lz_src = src;
+    lz_literals = 0;
+    lz_match = 0;
+    lz_pos = 0;
+    lz_done = false;
+}
+
+
+/*
+ * Decompress the next block of up to 256 bytes into lz_window.
+ * Returns the number of bytes produced, which is zero once the stream has ended.
+ */
+uint16_t lz_fill (void)
+{
+    uint16_t count = 0;
+
+    while (count < 256 && !lz_done)
+    {
+        if (lz_literals)
+        {
+            lz_window [lz_pos] = *lz_src++;
+            lz_literals--;
+        }
+        else if (lz_match)
+        {
+            /* Eight-bit wrap-around gives the position within the window */
+            lz_window [lz_pos] = lz_window [(uint8_t) (lz_pos - lz_distance - 1)];
+            lz_match--;
+        }
+        else
+        {
+            uint8_t token = *lz_src++;
+
+            if (token == LZ_END)
+            {
+                lz_done = true;
+            }
+            else if (token & 0x80)
+            {
+                lz_match = (token & 0x7f) + 2;
+                lz_distance = *lz_src++;
+            }
+            else
+            {
+                lz_literals = token + 1;
+            }
+            continue;
+        }
+
+        lz_pos++;
+        count++;
+    }
+
+    return count;
+}
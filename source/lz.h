@@ -0,0 +1,13 @@
+/*
+ * SN76489 Test ROM
+ * Joppy Furr 2024
+ */
+
+/* Window holding the most recently decompressed block */
+extern uint8_t lz_window [256];
+
+/* Begin decompressing a stream. */
+void lz_start (const uint8_t *src);
+
+/* Decompress the next block of up to 256 bytes into lz_window. */
+uint16_t lz_fill (void);
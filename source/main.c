@@ -28,10 +28,18 @@ __sfr __at 0xbf vdp_control_port;
 #include "register.h"
 #include "key_interface.h"
 #include "gui_elements.h"
+#include "lz.h"
+#include "profile.h"
+#include "sweep.h"
+#include "sequence.h"
+#include "stress.h"
 
 
 typedef struct gui_state_s {
 
+    /* Kept first, so that host tools can find the values at the address of gui_state. */
+    uint16_t element_values [ELEMENT_COUNT];
+
     const gui_element_t *gui;
     element_id_t current_element;
     uint8_t keyboard_key;
@@ -40,15 +48,17 @@ typedef struct gui_state_s {
     bool keyboard_update;
     bool element_update;
 
-    uint16_t element_values [ELEMENT_COUNT];
-
 } gui_state_t;
 
 gui_state_t gui_state = { .gui = psg_gui, .current_element = ELEMENT_CH0_VOLUME };
 
 static const uint16_t value_defaults [ELEMENT_COUNT] = {
     [ELEMENT_CH0_VOLUME] = 0,
+#if defined (SWEEP) || defined (LADDER) || defined (STRESS)
+    [ELEMENT_CH0_MODE_KEYBOARD] = 0,    /* Channel 0 is played by the sweep or stress test */
+#else
     [ELEMENT_CH0_MODE_KEYBOARD] = 1,
+#endif
     [ELEMENT_CH0_MODE_CONSTANT] = 0,
     [ELEMENT_CH0_BUTTON] = 0,
     [ELEMENT_CH1_VOLUME] = 0,
@@ -86,6 +96,14 @@ static const uint16_t value_defaults [ELEMENT_COUNT] = {
 };
 
 
+/* Channels 0 and 1 belong to the stress test, so their elements cannot be changed from the GUI */
+#ifdef STRESS
+#define element_locked(element) ((element)->type != TYPE_KEYBOARD && (element)->channel < 2)
+#else
+#define element_locked(element) false
+#endif
+
+
 /*
  * Frequency values for keyboard notes, from C3 to E5.
  */
@@ -129,11 +147,118 @@ static void element_update (const gui_element_t *element, uint16_t value)
 
     if (element->callback)
     {
-        element->callback (value);
+        element->callback (element->channel, value);
     }
 }
 
 
+#if defined (SWEEP) || defined (LADDER)
+/*
+ * Set an element's value, as if it had been changed from the GUI.
+ */
+static void element_set (element_id_t id, uint16_t value)
+{
+    gui_state.element_values [id] = value;
+    element_update (&gui_state.gui [id], value);
+}
+
+
+/*
+ * Run one frame of the measurement sweep. Changes are made through the GUI
+ * elements, so that the screen shows the sweep's progress. A tone channel
+ * plays each step, and the noise channel plays the marker between steps.
+ *
+ * Returns true while the sweep is running.
+ */
+static bool sweep_frame (void)
+{
+    static bool running = true;
+    sweep_event_t event;
+    uint8_t offset;
+
+    if (!running)
+    {
+        return false;
+    }
+
+    event = sweep_tick ();
+    if (event == SWEEP_EVENT_NONE)
+    {
+        return true;
+    }
+
+#ifdef LADDER
+    /* Each tone channel takes sixteen steps, one for each attenuation */
+    offset = (sweep_step () >> 4) * ELEMENTS_PER_CHANNEL;
+#else
+    offset = 0;
+#endif
+
+    /* Silence the outgoing sound before starting the next */
+    if (event != SWEEP_EVENT_MARKER)
+    {
+        element_set (ELEMENT_NOISE_MODE_CONSTANT, false);
+    }
+    if (event == SWEEP_EVENT_STEP)
+    {
+#ifdef LADDER
+        if ((sweep_step () & 0x0f) == 0)
+        {
+            element_set (offset + ELEMENT_CH0_FREQUENCY, LADDER_PERIOD);
+        }
+        element_set (offset + ELEMENT_CH0_VOLUME, sweep_step () & 0x0f);
+#else
+        element_set (ELEMENT_CH0_FREQUENCY, sweep_step ());
+#endif
+    }
+    if (event != SWEEP_EVENT_END)
+    {
+        element_set (offset + ELEMENT_CH0_MODE_CONSTANT, event == SWEEP_EVENT_STEP);
+    }
+    if (event == SWEEP_EVENT_MARKER)
+    {
+        element_set (ELEMENT_NOISE_MODE_CONSTANT, true);
+    }
+
+#ifdef LADDER
+    /* Leave the channels at full volume, ready for use */
+    if (event == SWEEP_EVENT_END)
+    {
+        element_set (ELEMENT_CH0_VOLUME, 0);
+        element_set (ELEMENT_CH1_VOLUME, 0);
+        element_set (ELEMENT_CH2_VOLUME, 0);
+    }
+#endif
+
+    running = (event != SWEEP_EVENT_END);
+    return true;
+}
+#endif
+
+
+#ifdef SEQUENCE
+/*
+ * Play the register-write sequence, then restore the registers it wrote to
+ * from the GUI elements.
+ */
+static void sequence_run (void)
+{
+    sequence_play ();
+    register_forget ();
+
+    for (uint8_t i = ELEMENT_CH0_VOLUME; i < ELEMENT_KEYBOARD; i++)
+    {
+        const gui_element_t *element = &gui_state.gui [i];
+
+        if (element->callback)
+        {
+            element->callback (element->channel, gui_state.element_values [i]);
+        }
+    }
+}
+#endif
+
+
 /*
  * Move the cursor to select a different GUI element.
  */
@@ -245,7 +370,7 @@ static void element_navigate (uint16_t key_pressed)
 
             /* "BUTTON" elements turn off when unselected. Note that
              * our pointer, 'element', still points at the previous element */
-            if (element->type == TYPE_BUTTON)
+            if (element->type == TYPE_BUTTON && !element_locked (element))
             {
                 gui_state.element_values [element_was] = 0;
                 element_update (element, 0);
@@ -265,6 +390,11 @@ static void element_input (uint16_t key_pressed, int16_t key_released)
     const gui_element_t *element = &gui_state.gui [gui_state.current_element];
     uint16_t *value = &gui_state.element_values [gui_state.current_element];
 
+    if (element_locked (element))
+    {
+        return;
+    }
+
     if (element->type == TYPE_VALUE || element->type == TYPE_VALUE_WIDE)
     {
         if (key_pressed == PORT_A_KEY_1 && *value > 0)
@@ -303,9 +433,59 @@ static void element_input (uint16_t key_pressed, int16_t key_released)
 }
 
 
+/*
+ * Ring of input events raised by the frame interrupt, to be applied by the
+ * main loop. The interrupt is the only writer of event_ring_head, and the
+ * main loop is the only writer of event_ring_tail. As single-byte accesses
+ * are atomic on the Z80, no further locking is needed.
+ */
+#define EVENT_RING_SIZE 8
+#define EVENT_RING_MASK (EVENT_RING_SIZE - 1)
+
+static uint8_t event_ring [EVENT_RING_SIZE];
+static volatile uint8_t event_ring_head = 0;
+static volatile uint8_t event_ring_tail = 0;
+
+
+/*
+ * Add an event to the ring. Called from the frame interrupt.
+ * If the ring is full, the event is dropped.
+ */
+static void event_push (uint8_t key)
+{
+    uint8_t head = event_ring_head;
+    uint8_t next = (head + 1) & EVENT_RING_MASK;
+
+    if (next != event_ring_tail)
+    {
+        event_ring [head] = key;
+        event_ring_head = next;
+    }
+}
+
+
+/*
+ * Apply any events raised by the frame interrupt. Called from the main loop.
+ */
+static void event_drain (void)
+{
+    uint8_t tail = event_ring_tail;
+
+    while (tail != event_ring_head)
+    {
+        element_input (event_ring [tail], 0);
+        tail = (tail + 1) & EVENT_RING_MASK;
+        event_ring_tail = tail;
+    }
+}
+
+
 /*
  * When changing element values, repeat the button press if held down.
  * Start repeating at 500 ms. Repeat 30 times per second.
+ *
+ * This runs from the frame interrupt, so rather than changing the element
+ * value directly, the repeated key is passed to the main loop as an event.
  */
 static void key_repeat (void)
 {
@@ -335,7 +515,7 @@ static void key_repeat (void)
         {
             if (++repeat_timer & 0x01) /* Every second frame for 30 repeats per second */
             {
-                element_input (key_status, 0);
+                event_push (key_status);
             }
         }
         else
@@ -376,6 +556,55 @@ static void frame_interrupt (void)
     cursor_tick ();
 
     key_repeat ();
+
+    profile_isr_exit ();
+}
+
+
+/* The SG-1000 copies the cursor into the sprite pattern table
+ * as a single run, so it cannot have its patterns deduplicated. */
+#if defined (TARGET_SG) && defined (PATTERNS_DEDUPED)
+#error "Pattern deduplication is not supported on the SG-1000"
+#endif
+
+/*
+ * Load the pattern data into VRAM, decompressing it if needed.
+ */
+static void load_patterns (void)
+{
+#ifdef PATTERNS_COMPRESSED
+    uint16_t offset = 0;
+    uint16_t count;
+
+    lz_start (patterns_compressed);
+
+    while ((count = lz_fill ()) != 0)
+    {
+#ifdef TARGET_SG
+        SG_loadTilePatterns (lz_window, offset >> 3, count);
+
+        /* The cursor patterns are also needed in the sprite pattern table */
+#define CURSOR_FROM (PATTERN_CURSOR_TMS * 8)
+#define CURSOR_TO   (CURSOR_FROM + 72)
+        if (offset < CURSOR_TO && offset + count > CURSOR_FROM)
+        {
+            uint16_t start = (offset > CURSOR_FROM) ? offset : CURSOR_FROM;
+            uint16_t end = (offset + count < CURSOR_TO) ? offset + count : CURSOR_TO;
+            SG_loadSpritePatterns (&lz_window [start - offset], (start - CURSOR_FROM) >> 3, end - start);
+        }
+#else
+        SMS_loadTiles (lz_window, offset >> 5, count);
+#endif
+        offset += count;
+    }
+#else
+#ifdef TARGET_SG
+    SG_loadTilePatterns (patterns, 0, sizeof (patterns));
+    SG_loadSpritePatterns (&patterns [PATTERN_CURSOR_TMS * 2], 0, 72);
+#else
+    SMS_loadTiles (patterns, 0, sizeof (patterns));
+#endif
+#endif
 }
 
 
@@ -393,9 +622,8 @@ void main (void)
     vdp_control_port = 0x00; /* Pattern table at 0x0000 */
     vdp_control_port = 0x84;
 
-    SG_loadTilePatterns (patterns, 0, sizeof (patterns));
+    load_patterns ();
     SG_loadTileColours (colour_table, 0, sizeof (colour_table));
-    SG_loadSpritePatterns (&patterns [PATTERN_CURSOR_TMS * 2], 0, 72);
     SG_setBackdropColor (12);                       /* Dark green */
 #elif defined (TARGET_SMS)
     SMS_loadBGPalette (palette);
@@ -405,7 +633,7 @@ void main (void)
     SMS_setSpritePaletteColor (3, RGB (3, 1, 1));   /* Light Red */
     SMS_setBGPaletteColor (4, RGB (2, 2, 3));       /* Light Lavender */
     SMS_setBackdropColor (0);
-    SMS_loadTiles (patterns, 0, sizeof (patterns));
+    load_patterns ();
     SMS_useFirstHalfTilesforSprites (true);
 #elif defined (TARGET_GG)
     GG_loadBGPalette (palette);
@@ -415,7 +643,7 @@ void main (void)
     GG_setSpritePaletteColor (3, RGB (15, 4, 4));   /* Light Red */
     GG_setBGPaletteColor (4, RGB (12, 12,  15));    /* Light Lavender */
     SMS_setBackdropColor (0);
-    SMS_loadTiles (patterns, 0, sizeof (patterns));
+    load_patterns ();
     SMS_useFirstHalfTilesforSprites (true);
 #endif
 
@@ -436,11 +664,13 @@ void main (void)
 
         if (element->callback)
         {
-            element->callback (value);
+            element->callback (element->channel, value);
         }
     }
 
-    /* Draw the GUI elements with their current values */
+    /* Draw the GUI elements with their current values. The display is
+     * still off, so the queue is written out after each element, rather
+     * than being left to fill. */
     for (uint8_t i = ELEMENT_CH0_VOLUME; i <= ELEMENT_NOISE_BUTTON; i++)
     {
         const gui_element_t *element = &gui_state.gui [i];
@@ -462,6 +692,7 @@ void main (void)
         {
             draw_button (element->x, element->y, value);
         }
+        draw_flush ();
     }
     draw_keyboard ();
     draw_labels ();
@@ -476,20 +707,45 @@ void main (void)
     SMS_setFrameInterruptHandler (frame_interrupt);
 #endif
 
+    draw_flush ();
     SMS_displayOn ();
 
+#ifdef SEQUENCE
+    /* The sequence has the chip to itself while it plays, so input is ignored */
+    sequence_run ();
+#endif
+
     /* Main loop */
     while (true)
     {
         SMS_waitForVBlank ();
+        profile_loop_start ();
+        draw_flush ();
 #ifdef TARGET_SG
         frame_interrupt ();
 #endif
 
+#ifdef STRESS
+        /* Back-to-back writes to channels 0 and 1, with the rest of the loop running as normal */
+        stress_frame ();
+#endif
+
+#if defined (SWEEP) || defined (LADDER)
+        /* The sweep has the channels to itself while it runs, so input is ignored */
+        if (sweep_frame ())
+        {
+            profile_loop_end ();
+            continue;
+        }
+#endif
+
         uint16_t key_pressed = SMS_getKeysPressed ();
         uint16_t key_released = SMS_getKeysReleased ();
         uint16_t key_status = SMS_getKeysStatus ();
 
+        /* Key-repeat events from the frame interrupt */
+        event_drain ();
+
         /* Navigation */
         if (key_pressed & PORT_A_DPAD_MASK)
         {
@@ -607,50 +863,27 @@ void main (void)
             uint16_t value = gui_state.element_values [gui_state.current_element];
 
             /* Special cases: Elements that affect other elements, such as changing mode. */
-            if (gui_state.current_element == ELEMENT_CH0_MODE_KEYBOARD && value)
-            {
-                gui_state.element_values [ELEMENT_CH0_MODE_CONSTANT] = false;
-                element_update (&gui_state.gui [ELEMENT_CH0_MODE_CONSTANT], false);
-            }
-            else if (gui_state.current_element == ELEMENT_CH0_MODE_CONSTANT && value)
-            {
-                gui_state.element_values [ELEMENT_CH0_MODE_KEYBOARD] = false;
-                element_update (&gui_state.gui [ELEMENT_CH0_MODE_KEYBOARD], false);
-            }
-            else if (gui_state.current_element == ELEMENT_CH1_MODE_KEYBOARD && value)
-            {
-                gui_state.element_values [ELEMENT_CH1_MODE_CONSTANT] = false;
-                element_update (&gui_state.gui [ELEMENT_CH1_MODE_CONSTANT], false);
-            }
-            else if (gui_state.current_element == ELEMENT_CH1_MODE_CONSTANT && value)
+            if (value)
             {
-                gui_state.element_values [ELEMENT_CH1_MODE_KEYBOARD] = false;
-                element_update (&gui_state.gui [ELEMENT_CH1_MODE_KEYBOARD], false);
-            }
-            else if (gui_state.current_element == ELEMENT_CH2_MODE_KEYBOARD && value)
-            {
-                gui_state.element_values [ELEMENT_CH2_MODE_CONSTANT] = false;
-                element_update (&gui_state.gui [ELEMENT_CH2_MODE_CONSTANT], false);
-            }
-            else if (gui_state.current_element == ELEMENT_CH2_MODE_CONSTANT && value)
-            {
-                gui_state.element_values [ELEMENT_CH2_MODE_KEYBOARD] = false;
-                element_update (&gui_state.gui [ELEMENT_CH2_MODE_KEYBOARD], false);
-            }
-            else if (gui_state.current_element == ELEMENT_NOISE_MODE_KEYBOARD && value)
-            {
-                gui_state.element_values [ELEMENT_NOISE_MODE_CONSTANT] = false;
-                element_update (&gui_state.gui [ELEMENT_NOISE_MODE_CONSTANT], false);
-            }
-            else if (gui_state.current_element == ELEMENT_NOISE_MODE_CONSTANT && value)
-            {
-                gui_state.element_values [ELEMENT_NOISE_MODE_KEYBOARD] = false;
-                element_update (&gui_state.gui [ELEMENT_NOISE_MODE_KEYBOARD], false);
+                element_id_t channel_base = element->channel * ELEMENTS_PER_CHANNEL;
+
+                if (gui_state.current_element == channel_base + ELEMENT_CH0_MODE_KEYBOARD)
+                {
+                    gui_state.element_values [channel_base + ELEMENT_CH0_MODE_CONSTANT] = false;
+                    element_update (&gui_state.gui [channel_base + ELEMENT_CH0_MODE_CONSTANT], false);
+                }
+                else if (gui_state.current_element == channel_base + ELEMENT_CH0_MODE_CONSTANT)
+                {
+                    gui_state.element_values [channel_base + ELEMENT_CH0_MODE_KEYBOARD] = false;
+                    element_update (&gui_state.gui [channel_base + ELEMENT_CH0_MODE_KEYBOARD], false);
+                }
             }
 
             element_update (element, value);
             gui_state.element_update = false;
         }
+
+        profile_loop_end ();
     }
 }
 
@@ -0,0 +1,218 @@
+/*
+ * SN76489 Test ROM
+ * Joppy Furr 2024
+ *
+ * Frame-time profiler, enabled by building with -DPROFILE.
+ *
+ * The V-counter is sampled as the frame interrupt exits, and at the end of
+ * each main-loop iteration. The number of scanlines used since the start of
+ * the vertical blank is shown in the top corners of the screen, along with
+ * the running maximum.
+ *
+ * Stress builds also show the PSG writes per frame, counting both the stress
+ * test's and the GUI's, averaged over sixteen frames, between the title and
+ * the frame interrupt's readout. The Game Gear has no room there, so shows it
+ * over the middle of the title.
+ *
+ * The TMS9918 used by the SG-1000 has no V-counter, so the profiler is only
+ * available for the SMS and Game Gear builds.
+ */
+
+#if defined (PROFILE) && !defined (TARGET_SG)
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "SMSlib.h"
+
+#include "draw.h"
+#include "profile.h"
+
+__sfr __at 0x7e vdp_vcount_port;
+
+/* Scanlines in a frame, and the line on which the vertical blank starts. */
+#ifdef TARGET_PAL
+#define PROFILE_FRAME_LINES 313
+#else
+#define PROFILE_FRAME_LINES 262
+#endif
+#define PROFILE_VBLANK_LINE 192
+
+/* So that it fits in eight bits, the V-counter jumps back part-way through
+ * the vertical blank. The values from PROFILE_VCOUNT_JUMP_TO up to
+ * PROFILE_VCOUNT_JUMP_FROM are seen twice in each frame. */
+#ifdef TARGET_PAL
+#define PROFILE_VCOUNT_JUMP_FROM    0xf2
+#define PROFILE_VCOUNT_JUMP_TO      0xba
+#else
+#define PROFILE_VCOUNT_JUMP_FROM    0xda
+#define PROFILE_VCOUNT_JUMP_TO      0xd5
+#endif
+#define PROFILE_VCOUNT_SKIPPED      (PROFILE_VCOUNT_JUMP_FROM + 1 - PROFILE_VCOUNT_JUMP_TO)
+
+/* Positions of the on-screen readouts */
+#ifdef TARGET_GG
+#define PROFILE_LOOP_MAX_X   6
+#define PROFILE_WRITES_X    14
+#define PROFILE_ISR_MAX_X   22
+#define PROFILE_Y            3
+#else
+#define PROFILE_LOOP_X       0
+#define PROFILE_LOOP_MAX_X   5
+#define PROFILE_WRITES_X    23
+#define PROFILE_ISR_MAX_X   28
+#define PROFILE_Y            0
+#endif
+
+/* Frames over which the writes per frame are averaged */
+#define PROFILE_WRITES_FRAMES   16
+
+static volatile uint8_t profile_frame = 0;
+static uint8_t loop_start_frame = 0;
+static uint8_t loop_start_lines = 0;
+
+static uint8_t loop_lines = 0;
+static uint8_t loop_lines_max = 0;
+static volatile uint8_t isr_lines_max = 0;
+static uint8_t isr_lines_drawn = 0;
+
+#ifdef STRESS
+static uint16_t writes_count = 0;
+static uint8_t writes_frame = 0;
+static uint16_t writes_drawn = 0;
+#endif
+
+
+/*
+ * Read the number of scanlines since the start of the vertical blank.
+ *
+ * The V-counter is first translated into a line number. Where its value is
+ * seen twice in the frame, the earlier line is taken, unless that would be
+ * before a reading already taken in the same frame, given as 'since'. The
+ * later line is then the only one possible.
+ *
+ * This leaves readings from the second pass that are above 'since' taken as
+ * the first pass, which under-reports them by the lines skipped: up to six
+ * on NTSC, and 57 on PAL, where the values from 0xc0 to 0xf2 are both in the
+ * vertical blank.
+ */
+static uint8_t profile_lines (uint8_t since)
+{
+    uint8_t vcount = vdp_vcount_port;
+    uint16_t line = vcount;
+
+    if (vcount > PROFILE_VCOUNT_JUMP_FROM)
+    {
+        line += PROFILE_VCOUNT_SKIPPED;
+    }
+    else if (vcount >= PROFILE_VCOUNT_JUMP_TO && line < PROFILE_VBLANK_LINE + since)
+    {
+        line += PROFILE_VCOUNT_SKIPPED;
+    }
+    else if (vcount < PROFILE_VBLANK_LINE)
+    {
+        /* Wrapped around into the active display of the next frame */
+        line += PROFILE_FRAME_LINES;
+    }
+
+    line -= PROFILE_VBLANK_LINE;
+    return (line > 0xff) ? 0xff : line;
+}
+
+
+/*
+ * Mark the start of a main-loop iteration.
+ */
+void profile_loop_start (void)
+{
+    loop_start_frame = profile_frame;
+    loop_start_lines = profile_lines (0);
+}
+
+
+/*
+ * Sample the V-counter at the end of a main-loop iteration.
+ *
+ * If a frame interrupt has occurred since the iteration started, the main
+ * loop has overrun its frame, and the reading is saturated to 255.
+ */
+void profile_loop_end (void)
+{
+    uint8_t lines = profile_lines (loop_start_lines);
+
+    if (profile_frame != loop_start_frame)
+    {
+        lines = 0xff;
+    }
+
+#ifndef TARGET_GG
+    if (lines != loop_lines)
+    {
+        draw_value_wide (PROFILE_LOOP_X, PROFILE_Y, lines);
+    }
+#endif
+    loop_lines = lines;
+
+    if (lines > loop_lines_max)
+    {
+        loop_lines_max = lines;
+        draw_value_wide (PROFILE_LOOP_MAX_X, PROFILE_Y, lines);
+    }
+
+    if (isr_lines_max != isr_lines_drawn)
+    {
+        isr_lines_drawn = isr_lines_max;
+        draw_value_wide (PROFILE_ISR_MAX_X, PROFILE_Y, isr_lines_drawn);
+    }
+
+#ifdef STRESS
+    /* Frames that the main loop overran are counted, so a loop that only
+     * keeps up with every other frame shows half the writes per frame. */
+    uint8_t frames = profile_frame - writes_frame;
+    if (frames >= PROFILE_WRITES_FRAMES)
+    {
+        uint16_t writes = writes_count / frames;
+
+        writes_count = 0;
+        writes_frame += frames;
+
+        if (writes != writes_drawn)
+        {
+            writes_drawn = writes;
+            draw_value_wide (PROFILE_WRITES_X, PROFILE_Y, writes);
+        }
+    }
+#endif
+}
+
+
+#ifdef STRESS
+/*
+ * Add to the count of PSG writes, shown as writes per frame.
+ */
+void profile_writes (uint16_t writes)
+{
+    writes_count += writes;
+}
+#endif
+
+
+/*
+ * Sample the V-counter as the frame interrupt exits.
+ *
+ * Called from interrupt context, so the new maximum is only recorded here
+ * and drawn from the main loop by profile_loop_end ().
+ */
+void profile_isr_exit (void)
+{
+    uint8_t lines = profile_lines (0);
+
+    profile_frame++;
+
+    if (lines > isr_lines_max)
+    {
+        isr_lines_max = lines;
+    }
+}
+
+#endif
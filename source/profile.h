@@ -0,0 +1,27 @@
+/*
+ * SN76489 Test ROM
+ * Joppy Furr 2024
+ */
+
+/* The profiler relies on the V-counter, which the SG-1000 does not have. */
+#if defined (PROFILE) && !defined (TARGET_SG)
+/* Mark the start of a main-loop iteration. */
+void profile_loop_start (void);
+
+/* Sample the V-counter at the end of a main-loop iteration. */
+void profile_loop_end (void);
+
+/* Sample the V-counter as the frame interrupt exits. */
+void profile_isr_exit (void);
+#else
+#define profile_loop_start()
+#define profile_loop_end()
+#define profile_isr_exit()
+#endif
+
+#if defined (PROFILE) && defined (STRESS) && !defined (TARGET_SG)
+/* Add to the count of PSG writes, shown as writes per frame. */
+void profile_writes (uint16_t writes);
+#else
+#define profile_writes(writes)
+#endif
@@ -3,12 +3,27 @@
  * Joppy Furr 2024
  */
 
+#include <stdbool.h>
 #include <stdint.h>
+
+#include "profile.h"
+
 __sfr __at 0x06 gg_stereo_port;
 __sfr __at 0x40 sn76489_port;
 
+/*
+ * Shadow copies of the eight SN76489 registers, indexed by the register
+ * number in the latch byte. These are used to skip writes that would not
+ * change the register's value. Each starts out holding a value that can
+ * never be written, so that the first write always reaches the chip.
+ */
+static uint16_t register_shadow [8] = {
+    0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff
+};
+
 #ifdef TARGET_GG
 static uint8_t gg_stereo_reg;
+static bool gg_stereo_written = false;
 #endif
 
 
@@ -18,63 +33,70 @@ static uint8_t gg_stereo_reg;
 static void register_write (uint16_t value)
 {
     sn76489_port = value;
+    profile_writes (1);
 }
 
 
 /*
- * Write the frequency for tone channel 0.
+ * Write a 10-bit tone register, skipping the write if the value is unchanged.
+ *
+ * The latch byte on its own updates the low four bits of the register, so the
+ * data byte is only sent if the upper six bits have changed.
  */
-void register_write_ch0_frequency (uint16_t value)
+static void register_write_tone (uint8_t reg, uint16_t value)
 {
-    register_write (0x80 | 0x00 | (value & 0x0f));
-    register_write ((value >> 4) & 0x3f);
-}
+    uint16_t previous = register_shadow [reg];
 
+    value &= 0x03ff;
 
-/*
- * Write the attenuation for tone channel 0.
- */
-void register_write_ch0_volume (uint16_t value)
-{
-    register_write (0x80 | 0x10 | (value & 0x0f));
-}
+    if (value == previous)
+    {
+        return;
+    }
+    register_shadow [reg] = value;
 
+    register_write (0x80 | (reg << 4) | (value & 0x0f));
 
-/*
- * Write the frequency for tone channel 1.
- */
-void register_write_ch1_frequency (uint16_t value)
-{
-    register_write (0x80 | 0x20 | (value & 0x0f));
-    register_write ((value >> 4) & 0x3f);
+    if ((value ^ previous) & 0x03f0)
+    {
+        register_write ((value >> 4) & 0x3f);
+    }
 }
 
 
 /*
- * Write the attenuation for tone channel 1.
+ * Write a 4-bit register, skipping the write if the value is unchanged.
  */
-void register_write_ch1_volume (uint16_t value)
+static void register_write_nibble (uint8_t reg, uint16_t value)
 {
-    register_write (0x80 | 0x30 | (value & 0x0f));
+    value &= 0x0f;
+
+    if (value == register_shadow [reg])
+    {
+        return;
+    }
+    register_shadow [reg] = value;
+
+    register_write (0x80 | (reg << 4) | value);
 }
 
 
 /*
- * Write the frequency for tone channel 2.
+ * Write the frequency for a tone channel.
+ * Each channel's tone register is followed by its attenuation register.
  */
-void register_write_ch2_frequency (uint16_t value)
+void register_write_frequency (uint8_t channel, uint16_t value)
 {
-    register_write (0x80 | 0x40 | (value & 0x0f));
-    register_write ((value >> 4) & 0x3f);
+    register_write_tone (channel << 1, value);
 }
 
 
 /*
- * Write the attenuation for tone channel 2.
+ * Write the attenuation for a channel.
  */
-void register_write_ch2_volume (uint16_t value)
+void register_write_volume (uint8_t channel, uint16_t value)
 {
-    register_write (0x80 | 0x50 | (value & 0x0f));
+    register_write_nibble ((channel << 1) | 1, value);
 }
 
 
@@ -83,104 +105,67 @@ void register_write_ch2_volume (uint16_t value)
  */
 void register_write_noise_control (uint16_t value)
 {
-    register_write (0x80 | 0x60 | (value & 0x0f));
+    register_write_nibble (6, value);
 }
 
 
+#ifdef SEQUENCE
 /*
- * Write the attenuation for the noise channel.
+ * Forget the shadow copies, after the registers have been written without
+ * them, so that the next write to each register reaches the chip.
  */
-void register_write_noise_volume (uint16_t value)
+void register_forget (void)
 {
-    register_write (0x80 | 0x70 | (value & 0x0f));
-}
-
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        register_shadow [i] = 0xffff;
+    }
 
 #ifdef TARGET_GG
-/*
- * Write the Game Gear stereo register bit for channel-0 right.
- */
-void register_write_ch0_stereo_right (uint16_t value)
-{
-    gg_stereo_reg &= 0xfe;
-    gg_stereo_reg |= value & 0x01;
-    gg_stereo_port = gg_stereo_reg;
-}
-
-
-/*
- * Write the Game Gear stereo register bit for channel-1 right.
- */
-void register_write_ch1_stereo_right (uint16_t value)
-{
-    gg_stereo_reg &= 0xfd;
-    gg_stereo_reg |= (value << 1) & 0x02;
-    gg_stereo_port = gg_stereo_reg;
-}
-
-
-/*
- * Write the Game Gear stereo register bit for channel-2 right.
- */
-void register_write_ch2_stereo_right (uint16_t value)
-{
-    gg_stereo_reg &= 0xfb;
-    gg_stereo_reg |= (value << 2) & 0x04;
-    gg_stereo_port = gg_stereo_reg;
+    gg_stereo_written = false;
+#endif
 }
+#endif
 
 
-/*
- * Write the Game Gear stereo register bit for noise-right.
- */
-void register_write_noise_stereo_right (uint16_t value)
-{
-    gg_stereo_reg &= 0xf7;
-    gg_stereo_reg |= (value << 3) & 0x08;
-    gg_stereo_port = gg_stereo_reg;
-}
+#ifdef TARGET_GG
+/* Game Gear stereo register bits for each channel */
+static const uint8_t stereo_right_bit [4] = { 0x01, 0x02, 0x04, 0x08 };
+static const uint8_t stereo_left_bit  [4] = { 0x10, 0x20, 0x40, 0x80 };
 
 
 /*
- * Write the Game Gear stereo register bit for channel-0 left.
+ * Write the Game Gear stereo register, skipping the write if the value is unchanged.
  */
-void register_write_ch0_stereo_left (uint16_t value)
+static void register_write_stereo (uint8_t value)
 {
-    gg_stereo_reg &= 0xef;
-    gg_stereo_reg |= (value << 4) & 0x10;
-    gg_stereo_port = gg_stereo_reg;
-}
-
+    if (gg_stereo_written && value == gg_stereo_reg)
+    {
+        return;
+    }
+    gg_stereo_reg = value;
+    gg_stereo_written = true;
 
-/*
- * Write the Game Gear stereo register bit for channel-1 left.
- */
-void register_write_ch1_stereo_left (uint16_t value)
-{
-    gg_stereo_reg &= 0xdf;
-    gg_stereo_reg |= (value << 5) & 0x20;
-    gg_stereo_port = gg_stereo_reg;
+    gg_stereo_port = value;
 }
 
 
 /*
- * Write the Game Gear stereo register bit for channel-2 left.
+ * Write the Game Gear stereo register bit for a channel's right output.
  */
-void register_write_ch2_stereo_left (uint16_t value)
+void register_write_stereo_right (uint8_t channel, uint16_t value)
 {
-    gg_stereo_reg &= 0xbf;
-    gg_stereo_reg |= (value << 6) & 0x40;
-    gg_stereo_port = gg_stereo_reg;
+    uint8_t bit = stereo_right_bit [channel];
+    register_write_stereo (value ? (gg_stereo_reg | bit) : (gg_stereo_reg & ~bit));
 }
 
 
 /*
- * Write the Game Gear stereo register bit for noise-left.
+ * Write the Game Gear stereo register bit for a channel's left output.
  */
-void register_write_noise_stereo_left (uint16_t value)
+void register_write_stereo_left (uint8_t channel, uint16_t value)
 {
-    gg_stereo_reg &= 0x7f;
-    gg_stereo_reg |= (value << 7) & 0x80;
-    gg_stereo_port = gg_stereo_reg;
+    uint8_t bit = stereo_left_bit [channel];
+    register_write_stereo (value ? (gg_stereo_reg | bit) : (gg_stereo_reg & ~bit));
 }
 #endif
@@ -0,0 +1,262 @@
+/*
+ * SN76489 Test ROM
+ * Joppy Furr 2024
+ *
+ * Register-write sequencer, enabled by building with -DSEQUENCE.
+ *
+ * A table of events is played once at power-on. Each event writes a value to
+ * a port, a number of scanlines after the event before it, so that tests can
+ * time their writes more finely than the main loop's once per frame.
+ *
+ * The sequence is played with interrupts disabled, as the SMSlib interrupt
+ * handler takes longer than a scanline, and a line interrupt on every line
+ * would lose some of them.
+ *
+ * On the SMS and Game Gear, the player is a hand-written loop that polls the
+ * V-counter, and counts the lines it has moved on by. Lines taken up by the
+ * writes themselves are counted in the next wait, so events never drift, and
+ * each write lands a fraction of a line after its line starts.
+ *
+ * The TMS9918 used by the SG-1000 has no V-counter, so each line is instead
+ * timed with a delay loop of 228 cycles. Each write adds the time taken to
+ * make it, a fraction of a line, to the events after it.
+ */
+
+#ifdef SEQUENCE
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef TARGET_SG
+#include "SGlib.h"
+#else
+#include "SMSlib.h"
+#endif
+
+#include "sequence.h"
+
+#ifdef TARGET_SG
+__sfr __at 0x40 sequence_psg_port;
+#else
+__sfr __at 0x7e sequence_vcount_port;
+#endif
+
+/* Scanlines in a frame */
+#ifdef TARGET_PAL
+#define SEQUENCE_FRAME_LINES    313
+#else
+#define SEQUENCE_FRAME_LINES    262
+#endif
+
+/* So that it fits in eight bits, the V-counter jumps back part-way through
+ * the vertical blank, from 0xf2 to 0xba on PAL, or 0xda to 0xd5 on NTSC.
+ * The jump skips back over this many values. */
+#ifdef TARGET_PAL
+#define SEQUENCE_VCOUNT_SKIPPED     57
+#else
+#define SEQUENCE_VCOUNT_SKIPPED     6
+#endif
+
+#define PSG(delay, value)       { (delay), SEQUENCE_PORT_PSG, (value) }
+#define END(delay)              { (delay), SEQUENCE_PORT_END, 0 }
+
+/* Sixteen noise control writes, each the given number of lines after the last */
+#define NOISE_RESETS(lines)     PSG (lines, 0xe4), PSG (lines, 0xe4), PSG (lines, 0xe4), PSG (lines, 0xe4), \
+                                PSG (lines, 0xe4), PSG (lines, 0xe4), PSG (lines, 0xe4), PSG (lines, 0xe4), \
+                                PSG (lines, 0xe4), PSG (lines, 0xe4), PSG (lines, 0xe4), PSG (lines, 0xe4), \
+                                PSG (lines, 0xe4), PSG (lines, 0xe4), PSG (lines, 0xe4), PSG (lines, 0xe4)
+
+/* Each test is separated from the next by half a second of silence */
+#define GAP                     (30 * SEQUENCE_FRAME_LINES)
+#define HOLD                    (4 * SEQUENCE_FRAME_LINES)
+
+static const sequence_event_t sequence_tests [] = {
+
+    /* Silence every channel */
+    PSG (0, 0x9f), PSG (0, 0xbf), PSG (0, 0xdf), PSG (0, 0xff),
+
+    /* Latch-then-data gaps. Channel 0 plays period 0x0f0. The latch byte
+     * changes it to 0x0ff, and the data byte to 0x03f after the gap. */
+    PSG (GAP, 0x80), PSG (0, 0x0f), PSG (0, 0x90),
+    PSG (HOLD, 0x8f), PSG (0,  0x03), PSG (HOLD, 0x80), PSG (0, 0x0f),
+    PSG (HOLD, 0x8f), PSG (1,  0x03), PSG (HOLD, 0x80), PSG (0, 0x0f),
+    PSG (HOLD, 0x8f), PSG (4,  0x03), PSG (HOLD, 0x80), PSG (0, 0x0f),
+    PSG (HOLD, 0x8f), PSG (16, 0x03), PSG (HOLD, 0x80), PSG (0, 0x0f),
+    PSG (HOLD, 0x8f), PSG (64, 0x03), PSG (HOLD, 0x9f),
+
+    /* Mid-period writes. Channel 1 plays period 0x3ff, whose output changes
+     * about every 72 lines, and is changed to 0x040 at a range of times
+     * after it starts. Whether the new period takes effect at once or at the
+     * end of the current half-cycle shows in the time to the next edge. */
+    PSG (GAP, 0xaf), PSG (0, 0x3f), PSG (0, 0xb0), PSG (9,  0xa0), PSG (0, 0x04), PSG (HOLD, 0xbf),
+    PSG (GAP, 0xaf), PSG (0, 0x3f), PSG (0, 0xb0), PSG (27, 0xa0), PSG (0, 0x04), PSG (HOLD, 0xbf),
+    PSG (GAP, 0xaf), PSG (0, 0x3f), PSG (0, 0xb0), PSG (45, 0xa0), PSG (0, 0x04), PSG (HOLD, 0xbf),
+    PSG (GAP, 0xaf), PSG (0, 0x3f), PSG (0, 0xb0), PSG (63, 0xa0), PSG (0, 0x04), PSG (HOLD, 0xbf),
+
+    /* Noise reset on control-register write. White noise at the fastest
+     * shift rate is restarted every 2, 8 and 32 lines, which repeats its
+     * first bits at that rate if each write resets the LFSR. */
+    PSG (GAP, 0xe4), PSG (0, 0xf0), NOISE_RESETS (2),
+    PSG (HOLD, 0xff), PSG (GAP, 0xe4), PSG (0, 0xf0), NOISE_RESETS (8),
+    PSG (HOLD, 0xff), PSG (GAP, 0xe4), PSG (0, 0xf0), NOISE_RESETS (32),
+    PSG (HOLD, 0xff),
+
+    END (GAP)
+};
+
+#ifdef TARGET_SG
+static const sequence_event_t *sequence_next = NULL;
+static uint16_t sequence_wait = 0;
+
+
+/*
+ * Make the writes that are due, up until the next event with a delay.
+ */
+static void sequence_play_due (void)
+{
+    const sequence_event_t *event = sequence_next;
+
+    do
+    {
+        if (event->port == SEQUENCE_PORT_END)
+        {
+            event = NULL;
+            break;
+        }
+        else if (event->port == SEQUENCE_PORT_PSG)
+        {
+            sequence_psg_port = event->value;
+        }
+
+        event++;
+    } while (event->delay == 0);
+
+    sequence_next = event;
+    if (event != NULL)
+    {
+        sequence_wait = event->delay;
+    }
+}
+
+
+/* Lines for sequence_delay to wait, kept in memory for the delay loop to read */
+static uint16_t sequence_delay_lines;
+
+
+/*
+ * Wait for sequence_delay_lines scanlines, of 228 cycles each.
+ */
+static void sequence_delay (void) __naked
+{
+    __asm
+        ld de, (_sequence_delay_lines)
+        ld a, d
+        or a, e
+        ret z
+    1$:
+        ld b, #14       ; 7 + 177 cycles
+    2$:
+        djnz 2$
+        nop             ; 18 cycles of padding
+        ld c, #0
+        ld c, #0
+        dec de          ; 26 cycles to count the line
+        ld a, d
+        or a, e
+        jr nz, 1$
+        ret
+    __endasm;
+}
+
+
+/*
+ * Play the whole sequence, with interrupts disabled.
+ */
+void sequence_play (void)
+{
+    __asm__ ("di");
+
+    sequence_next = sequence_tests;
+    sequence_wait = sequence_tests [0].delay;
+
+    while (sequence_next != NULL)
+    {
+        sequence_delay_lines = sequence_wait;
+        sequence_delay ();
+        sequence_play_due ();
+    }
+
+    __asm__ ("ei");
+}
+#else
+/*
+ * Play the whole sequence, with interrupts disabled.
+ *
+ * Each event's delay is added to the lines left to wait, and the V-counter
+ * is polled, taking the lines it has moved on by, until none are left. The
+ * count goes negative when the writes themselves take more than the delay,
+ * so that the lines are taken from the next wait.
+ *
+ * The poll takes 27 cycles, and each write is made 120 to 200 cycles after
+ * its line starts. A write with no delay follows the one before it after
+ * 191 cycles.
+ */
+void sequence_play (void) __naked
+{
+    __asm
+        push ix
+        di
+        ld ix, #_sequence_tests
+        in a, (_sequence_vcount_port)
+        ld h, a         ; the V-counter as last read
+        ld de, #0       ; lines left to wait
+    1$:
+        ld a, e
+        add a, 0 (ix)
+        ld e, a
+        ld a, d
+        adc a, 1 (ix)
+        ld d, a
+        ld c, 2 (ix)    ; the port, and the value to write to it
+        ld b, 3 (ix)
+    2$:
+        bit 7, d
+        jr nz, 5$
+        ld a, d
+        or a, e
+        jr z, 5$
+    3$:
+        in a, (_sequence_vcount_port)
+        cp a, h
+        jr z, 3$
+        ld l, a
+        sub a, h        ; lines since the last read
+        ld h, l
+        jp p, 4$
+        add a, #SEQUENCE_VCOUNT_SKIPPED     ; the V-counter jumped back
+    4$:
+        ld l, a
+        ld a, e
+        sub a, l
+        ld e, a
+        jr nc, 2$
+        dec d
+        jr 2$
+    5$:
+        ld a, c
+        or a, a
+        jr z, 6$
+        out (c), b
+        ld bc, #4
+        add ix, bc
+        jr 1$
+    6$:
+        ei
+        pop ix
+        ret
+    __endasm;
+}
+#endif
+
+#endif
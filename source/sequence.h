@@ -0,0 +1,22 @@
+/*
+ * SN76489 Test ROM
+ * Joppy Furr 2024
+ */
+
+#ifdef SEQUENCE
+/* Ports an event can write to, or the end of the sequence */
+#define SEQUENCE_PORT_END       0x00
+#define SEQUENCE_PORT_STEREO    0x06
+#define SEQUENCE_PORT_PSG       0x40
+
+/* A write to a port, made a number of scanlines after the event before it. */
+typedef struct sequence_event_s {
+    uint16_t delay;
+    uint8_t port;
+    uint8_t value;
+} sequence_event_t;
+
+/* Play the whole sequence, with interrupts disabled. */
+void sequence_play (void);
+#endif
+
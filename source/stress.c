@@ -0,0 +1,152 @@
+/*
+ * SN76489 Test ROM
+ * Joppy Furr 2024
+ *
+ * PSG write-rate stress test, enabled by building with -DSTRESS.
+ *
+ * Each frame, the PSG is written from a table with unrolled OUTI
+ * instructions, for a fixed number of scanlines. OUTI takes 16 cycles a
+ * write. An unrolled OUT (C), r takes 12, and OUT (n), A 11, but both can
+ * only repeat values already held in registers, and loading each value first
+ * costs more than OUTI saves. With the loop's 27 cycles for each group of 32,
+ * and 24 more to go back to the start of the table after every eight, the
+ * rate is 4336 cycles for 256 writes, about 211,000 writes a second, or 13.5
+ * a scanline.
+ *
+ * The rest of the main loop runs as normal, but channels 0 and 1 belong to
+ * the stress test, and cannot be changed from the GUI. The writes play a sine
+ * wave as PCM through channel 0's attenuation, with its tone held by a period
+ * of one, and after every third sample, change the low bits of channel 1's
+ * period. The sine plays at about 826 Hz, and channel 1 warbles between
+ * periods 0x100 and 0x10f several thousand times a second.
+ *
+ * Hardware plays both as written. An emulator that applies writes a
+ * scanline or a frame at a time loses the sine, and holds channel 1 at the
+ * last period written.
+ *
+ * Only the Sega chips hold the output for a period of one. The discrete
+ * SN76489 in the SG-1000 and SC-3000 instead toggles it at about 112 kHz, so
+ * the sine is carried on that tone, at around half the level.
+ */
+
+#ifdef STRESS
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "profile.h"
+#include "stress.h"
+
+__sfr __at 0x40 stress_psg_port;
+
+/* Writes made by each pass through the table: three samples of the sine on
+ * channel 0's attenuation, then a latch byte for channel 1's period. */
+static const uint8_t stress_pattern [256] = {
+    0x93, 0x93, 0x93, 0xa0, 0x93, 0x92, 0x92, 0xa1, 0x92, 0x92, 0x92, 0xa2, 0x92, 0x92, 0x92, 0xa3,
+    0x92, 0x92, 0x91, 0xa4, 0x91, 0x91, 0x91, 0xa5, 0x91, 0x91, 0x91, 0xa6, 0x91, 0x91, 0x91, 0xa7,
+    0x91, 0x91, 0x91, 0xa8, 0x91, 0x90, 0x90, 0xa9, 0x90, 0x90, 0x90, 0xaa, 0x90, 0x90, 0x90, 0xab,
+    0x90, 0x90, 0x90, 0xac, 0x90, 0x90, 0x90, 0xad, 0x90, 0x90, 0x90, 0xae, 0x90, 0x90, 0x90, 0xaf,
+    0x90, 0x90, 0x90, 0xa0, 0x90, 0x90, 0x90, 0xa1, 0x90, 0x90, 0x90, 0xa2, 0x90, 0x90, 0x90, 0xa3,
+    0x90, 0x90, 0x90, 0xa4, 0x90, 0x90, 0x90, 0xa5, 0x90, 0x90, 0x90, 0xa6, 0x91, 0x91, 0x91, 0xa7,
+    0x91, 0x91, 0x91, 0xa8, 0x91, 0x91, 0x91, 0xa9, 0x91, 0x91, 0x91, 0xaa, 0x91, 0x91, 0x92, 0xab,
+    0x92, 0x92, 0x92, 0xac, 0x92, 0x92, 0x92, 0xad, 0x92, 0x92, 0x92, 0xae, 0x93, 0x93, 0x93, 0xaf,
+    0x93, 0x93, 0x93, 0xa0, 0x93, 0x94, 0x94, 0xa1, 0x94, 0x94, 0x94, 0xa2, 0x94, 0x95, 0x95, 0xa3,
+    0x95, 0x95, 0x96, 0xa4, 0x96, 0x96, 0x96, 0xa5, 0x97, 0x97, 0x97, 0xa6, 0x97, 0x98, 0x98, 0xa7,
+    0x98, 0x99, 0x99, 0xa8, 0x99, 0x9a, 0x9a, 0xa9, 0x9b, 0x9b, 0x9c, 0xaa, 0x9c, 0x9d, 0x9e, 0xab,
+    0x9e, 0x9f, 0x9f, 0xac, 0x9f, 0x9f, 0x9f, 0xad, 0x9f, 0x9f, 0x9f, 0xae, 0x9f, 0x9f, 0x9f, 0xaf,
+    0x9f, 0x9f, 0x9f, 0xa0, 0x9f, 0x9f, 0x9f, 0xa1, 0x9f, 0x9f, 0x9f, 0xa2, 0x9f, 0x9f, 0x9f, 0xa3,
+    0x9e, 0x9e, 0x9d, 0xa4, 0x9c, 0x9c, 0x9b, 0xa5, 0x9b, 0x9a, 0x9a, 0xa6, 0x99, 0x99, 0x99, 0xa7,
+    0x98, 0x98, 0x98, 0xa8, 0x97, 0x97, 0x97, 0xa9, 0x97, 0x96, 0x96, 0xaa, 0x96, 0x96, 0x95, 0xab,
+    0x95, 0x95, 0x95, 0xac, 0x94, 0x94, 0x94, 0xad, 0x94, 0x94, 0x94, 0xae, 0x93, 0x93, 0x93, 0xaf
+};
+
+/* Groups of 32 writes for stress_burst to make, kept in memory for it to read */
+static uint8_t stress_groups;
+
+
+/*
+ * Write stress_groups groups of 32 bytes from the pattern to the PSG,
+ * going back to the start of the pattern after every eight.
+ */
+static void stress_burst (void) __naked
+{
+    __asm
+        ld a, (_stress_groups)
+        ld e, a
+        ld d, #8
+        ld c, #0x40
+        ld hl, #_stress_pattern
+    1$:
+        outi
+        outi
+        outi
+        outi
+        outi
+        outi
+        outi
+        outi
+        outi
+        outi
+        outi
+        outi
+        outi
+        outi
+        outi
+        outi
+        outi
+        outi
+        outi
+        outi
+        outi
+        outi
+        outi
+        outi
+        outi
+        outi
+        outi
+        outi
+        outi
+        outi
+        outi
+        outi
+        dec e           ; 27 cycles to count the group
+        jr z, 2$
+        dec d
+        jr nz, 1$
+        ld hl, #_stress_pattern
+        ld d, #8
+        jr 1$
+    2$:
+        ret
+    __endasm;
+}
+
+
+/*
+ * Run one frame of the stress test, starting it on the first call.
+ */
+void stress_frame (void)
+{
+    static bool started = false;
+
+    if (!started)
+    {
+        started = true;
+
+        /* Channel 0 held by a period of one, and channel 1 at period 0x100 and -8 dB */
+        stress_psg_port = 0x81;
+        stress_psg_port = 0x00;
+        stress_psg_port = 0xa0;
+        stress_psg_port = 0x10;
+        stress_psg_port = 0xb4;
+        profile_writes (5);
+    }
+
+    stress_groups = STRESS_GROUPS;
+    stress_burst ();
+
+    /* The burst only returns once every group is written */
+    profile_writes ((uint16_t) stress_groups * 32);
+}
+
+#endif
@@ -0,0 +1,15 @@
+/*
+ * SN76489 Test ROM
+ * Joppy Furr 2024
+ */
+
+#ifdef STRESS
+/* Scanlines of back-to-back writes each frame. Each group of 32 writes takes
+ * 539 cycles, going back to the start of the table after every eight groups
+ * takes another 24, and a scanline is 228 cycles. */
+#define STRESS_LINES            128
+#define STRESS_GROUPS           ((STRESS_LINES * 228 * 8) / (539 * 8 + 24))
+
+/* Run one frame of the stress test, starting it on the first call. */
+void stress_frame (void);
+#endif
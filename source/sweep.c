@@ -0,0 +1,90 @@
+/*
+ * SN76489 Test ROM
+ * Joppy Furr 2024
+ *
+ * Measurement sweeps, enabled by building with -DSWEEP or -DLADDER.
+ *
+ * With SWEEP, channel 0 is stepped through every tone period from 0 to 1023.
+ * With LADDER, each tone channel in turn is stepped through every attenuation
+ * from 0 to 15. Each step is held for a fixed number of frames. Between steps,
+ * the noise channel plays a short marker, which the host-side analysers use
+ * to find the steps in a recording. A longer marker plays before the first step.
+ *
+ * The schedule is counted in frames, so a PAL console takes longer to run
+ * the sweep than an NTSC console.
+ */
+
+#if defined (SWEEP) || defined (LADDER)
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sweep.h"
+
+typedef enum sweep_phase_e {
+    SWEEP_PHASE_START = 0,
+    SWEEP_PHASE_PREAMBLE,
+    SWEEP_PHASE_HOLD,
+    SWEEP_PHASE_MARKER,
+    SWEEP_PHASE_DONE
+} sweep_phase_t;
+
+static sweep_phase_t sweep_phase = SWEEP_PHASE_START;
+static uint8_t sweep_frames = 0;
+static uint16_t sweep_value = 0;
+
+
+/*
+ * Advance the sweep by one frame.
+ *
+ * An event is returned on the first frame of each phase, after which the
+ * phase is held for its remaining frames.
+ */
+sweep_event_t sweep_tick (void)
+{
+    if (sweep_frames != 0)
+    {
+        sweep_frames--;
+        return SWEEP_EVENT_NONE;
+    }
+
+    switch (sweep_phase)
+    {
+        case SWEEP_PHASE_START:
+            sweep_phase = SWEEP_PHASE_PREAMBLE;
+            sweep_frames = SWEEP_PREAMBLE_FRAMES - 1;
+            return SWEEP_EVENT_MARKER;
+
+        case SWEEP_PHASE_MARKER:
+            if (++sweep_value == SWEEP_STEPS)
+            {
+                sweep_phase = SWEEP_PHASE_DONE;
+                return SWEEP_EVENT_END;
+            }
+            /* Fall through */
+
+        case SWEEP_PHASE_PREAMBLE:
+            sweep_phase = SWEEP_PHASE_HOLD;
+            sweep_frames = SWEEP_HOLD_FRAMES - 1;
+            return SWEEP_EVENT_STEP;
+
+        case SWEEP_PHASE_HOLD:
+            sweep_phase = SWEEP_PHASE_MARKER;
+            sweep_frames = SWEEP_MARKER_FRAMES - 1;
+            return SWEEP_EVENT_MARKER;
+
+        default:
+            return SWEEP_EVENT_NONE;
+    }
+}
+
+
+/*
+ * Get the number of the current step.
+ */
+uint16_t sweep_step (void)
+{
+    return sweep_value;
+}
+
+#endif
@@ -0,0 +1,35 @@
+/*
+ * SN76489 Test ROM
+ * Joppy Furr 2024
+ */
+
+#if defined (SWEEP) || defined (LADDER)
+/* Length of each part of the sweep, in frames. The host-side analysers,
+ * tools/PSG-Measure, expect these same values. */
+#define SWEEP_PREAMBLE_FRAMES   120
+#define SWEEP_HOLD_FRAMES       15
+#define SWEEP_MARKER_FRAMES     5
+
+#ifdef LADDER
+/* Attenuation from 0 to 15 on each tone channel in turn, at a fixed period */
+#define SWEEP_STEPS             48
+#define LADDER_PERIOD           254
+#else
+/* Tone periods from 0 to 1023 on channel 0 */
+#define SWEEP_STEPS             1024
+#endif
+
+/* Changes for the main loop to make to the channels. */
+typedef enum sweep_event_e {
+    SWEEP_EVENT_NONE = 0,
+    SWEEP_EVENT_MARKER,     /* Stop the tone and start the marker */
+    SWEEP_EVENT_STEP,       /* Stop the marker and start the tone, for the step from sweep_step () */
+    SWEEP_EVENT_END         /* Stop the marker, the sweep has finished */
+} sweep_event_t;
+
+/* Advance the sweep by one frame. */
+sweep_event_t sweep_tick (void);
+
+/* Get the number of the current step. */
+uint16_t sweep_step (void);
+#endif
@@ -0,0 +1,9 @@
+#!/bin/sh
+
+CC=gcc
+CFLAGS="-std=c11 -O2 -Wall -Werror -pthread"
+
+common="source/render.c source/wav.c ../PSG-Log/source/psg_log.c ../SN76489-Model/source/sn76489.c"
+
+$CC $CFLAGS source/main.c source/dsp.c $common -lm -o psgvariants
+$CC $CFLAGS source/align.c source/dsp.c $common -lm -o psgalign
@@ -0,0 +1,633 @@
+/*
+ * PSG-Compare
+ * A tool to align a recording from hardware with the reference render of the
+ * same PSG log, and report how they differ over time.
+ *
+ * JoppyFurr 2024
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../PSG-Log/source/psg_log.h"
+#include "../../SN76489-Model/source/sn76489.h"
+#include "dsp.h"
+#include "render.h"
+#include "wav.h"
+
+#ifndef M_PI
+#define M_PI                3.14159265358979323846
+#endif
+
+#define DEFAULT_SEGMENT_MS  1000
+#define DEFAULT_MAX_LAG_MS  5000
+#define DEFAULT_WINDOW_S    30
+
+/* Each segment is re-aligned within this distance of the last, to follow clock drift */
+#define SEGMENT_LAG_MS      20
+
+#define SPECTRUM_SIZE_MAX   4096
+#define SPECTRUM_SIZE_MIN   256
+#define ENVELOPE_MS         10
+
+/* Levels below this are treated as silence */
+#define SILENCE_DB          -80.0
+
+/* Spectral bins more than this far below a segment's strongest bin are not compared */
+#define SPECTRUM_RANGE_DB   60.0
+
+typedef struct signal_s {
+    float *samples;
+    uint64_t count;
+    uint32_t sample_rate;
+} signal_t;
+
+/* Buffers reused by every segment */
+typedef struct analysis_s {
+    uint32_t sample_rate;
+    uint32_t segment;
+    uint32_t segment_lag;
+    fft_t lag_fft;
+    float *lag_re;
+    float *lag_im;
+    fft_t spectrum_fft;
+    float *window;
+    float *spectrum_re;
+    float *spectrum_im;
+    float *power_capture;
+    float *power_reference;
+    uint32_t envelope;
+} analysis_t;
+
+/* Differences found in one segment */
+typedef struct segment_result_s {
+    int64_t offset;
+    bool silent;
+    double level_capture;
+    double level_reference;
+    double envelope;
+    double residual;
+    double spectral;
+    double peak_capture;
+    double peak_reference;
+} segment_result_t;
+
+
+/*
+ * Convert a power to decibels, with a floor for silence.
+ */
+static double power_db (double power)
+{
+    return (power > 0.0) ? fmax (10.0 * log10 (power), SILENCE_DB * 2) : SILENCE_DB * 2;
+}
+
+
+/*
+ * Load a wave file as a mono signal.
+ * Returns -1 on error.
+ */
+static int signal_load_wav (signal_t *signal, const char *filename)
+{
+    wav_t wav;
+
+    if (wav_read (&wav, filename) == -1)
+    {
+        return -1;
+    }
+
+    signal->samples = malloc ((wav.frames + 1) * sizeof (float));
+    if (signal->samples == NULL)
+    {
+        fprintf (stderr, "Error: Failed to allocate memory for '%s'.\n", filename);
+        wav_free (&wav);
+        return -1;
+    }
+
+    dsp_downmix (wav.samples, wav.channels, wav.frames, signal->samples);
+    signal->count = wav.frames;
+    signal->sample_rate = wav.sample_rate;
+    wav_free (&wav);
+
+    return 0;
+}
+
+
+/*
+ * Render a log as a mono signal.
+ * Returns -1 on error.
+ */
+static int signal_render (signal_t *signal, const char *filename, const variant_t *variant, uint32_t sample_rate)
+{
+    psg_log_map_t map;
+    wav_t wav = { .channels = 2, .sample_rate = sample_rate };
+
+    if (psg_log_map (&map, filename) == -1)
+    {
+        fprintf (stderr, "Failed to open input file '%s'.\n", filename);
+        return -1;
+    }
+
+    int result = render_log (&map, variant, sample_rate, &wav.samples, &wav.frames);
+    psg_log_unmap (&map);
+    if (result == -1)
+    {
+        return -1;
+    }
+
+    signal->samples = malloc ((wav.frames + 1) * sizeof (float));
+    if (signal->samples == NULL)
+    {
+        fprintf (stderr, "Error: Failed to allocate memory for the render.\n");
+        wav_free (&wav);
+        return -1;
+    }
+
+    dsp_downmix (wav.samples, wav.channels, wav.frames, signal->samples);
+    signal->count = wav.frames;
+    signal->sample_rate = sample_rate;
+    wav_free (&wav);
+
+    return 0;
+}
+
+
+/*
+ * Remove any DC offset, as recordings from hardware often have one.
+ */
+static void signal_remove_dc (signal_t *signal)
+{
+    if (signal->count > 0)
+    {
+        float mean = dsp_sum (signal->samples, signal->count) / signal->count;
+        dsp_scale (signal->samples, signal->samples, 1.0f, -mean, signal->count);
+    }
+}
+
+
+/*
+ * Allocate the buffers used to analyse each segment.
+ * Returns -1 on error.
+ */
+static int analysis_init (analysis_t *analysis, uint32_t sample_rate, uint32_t segment)
+{
+    memset (analysis, 0, sizeof (analysis_t));
+
+    analysis->sample_rate = sample_rate;
+    analysis->segment = segment;
+    analysis->segment_lag = (uint64_t) sample_rate * SEGMENT_LAG_MS / 1000;
+    analysis->envelope = (uint64_t) sample_rate * ENVELOPE_MS / 1000;
+    if (analysis->envelope == 0)
+    {
+        analysis->envelope = 1;
+    }
+
+    /* Spectra are averaged over overlapping frames, which must fit within the segment */
+    uint32_t spectrum_size = SPECTRUM_SIZE_MAX;
+    while (spectrum_size > SPECTRUM_SIZE_MIN && spectrum_size > segment)
+    {
+        spectrum_size >>= 1;
+    }
+
+    if (fft_init (&analysis->lag_fft, fft_size_for ((uint64_t) segment + 4 * analysis->segment_lag)) == -1 ||
+        fft_init (&analysis->spectrum_fft, spectrum_size) == -1)
+    {
+        return -1;
+    }
+
+    analysis->lag_re = malloc (analysis->lag_fft.size * sizeof (float));
+    analysis->lag_im = malloc (analysis->lag_fft.size * sizeof (float));
+    analysis->window = malloc (spectrum_size * sizeof (float));
+    analysis->spectrum_re = malloc (spectrum_size * sizeof (float));
+    analysis->spectrum_im = malloc (spectrum_size * sizeof (float));
+    analysis->power_capture = malloc (spectrum_size * sizeof (float));
+    analysis->power_reference = malloc (spectrum_size * sizeof (float));
+
+    if (analysis->lag_re == NULL || analysis->lag_im == NULL || analysis->window == NULL ||
+        analysis->spectrum_re == NULL || analysis->spectrum_im == NULL ||
+        analysis->power_capture == NULL || analysis->power_reference == NULL)
+    {
+        return -1;
+    }
+
+    /* Hann window */
+    for (uint32_t i = 0; i < spectrum_size; i++)
+    {
+        analysis->window [i] = 0.5 - 0.5 * cos (2.0 * M_PI * i / spectrum_size);
+    }
+
+    return 0;
+}
+
+
+/*
+ * Free the analysis buffers.
+ */
+static void analysis_free (analysis_t *analysis)
+{
+    fft_free (&analysis->lag_fft);
+    fft_free (&analysis->spectrum_fft);
+    free (analysis->lag_re);
+    free (analysis->lag_im);
+    free (analysis->window);
+    free (analysis->spectrum_re);
+    free (analysis->spectrum_im);
+    free (analysis->power_capture);
+    free (analysis->power_reference);
+}
+
+
+/*
+ * Average the power spectrum over half-overlapping frames of a segment.
+ */
+static void analysis_spectrum (analysis_t *analysis, const float *samples, uint32_t count, float *power)
+{
+    uint32_t size = analysis->spectrum_fft.size;
+
+    memset (power, 0, size * sizeof (float));
+
+    for (uint32_t start = 0; start + size <= count; start += size / 2)
+    {
+        dsp_multiply (analysis->spectrum_re, &samples [start], analysis->window, size);
+        memset (analysis->spectrum_im, 0, size * sizeof (float));
+        fft_forward (&analysis->spectrum_fft, analysis->spectrum_re, analysis->spectrum_im);
+        dsp_power_accumulate (power, analysis->spectrum_re, analysis->spectrum_im, size / 2 + 1);
+    }
+}
+
+
+/*
+ * Compare the power spectra of the capture and reference.
+ * Gives the RMS difference in dB over the bins that are not near silence, and each spectrum's strongest frequency.
+ */
+static void analysis_compare_spectra (analysis_t *analysis, segment_result_t *result)
+{
+    uint32_t bins = analysis->spectrum_fft.size / 2 + 1;
+    const float *capture = analysis->power_capture;
+    const float *reference = analysis->power_reference;
+    uint32_t peak_capture = 0;
+    uint32_t peak_reference = 0;
+
+    for (uint32_t bin = 1; bin < bins; bin++)
+    {
+        if (capture [bin] > capture [peak_capture])
+        {
+            peak_capture = bin;
+        }
+        if (reference [bin] > reference [peak_reference])
+        {
+            peak_reference = bin;
+        }
+    }
+
+    double strongest = fmax (capture [peak_capture], reference [peak_reference]);
+    double floor = strongest * pow (10.0, -SPECTRUM_RANGE_DB / 10.0);
+    double sum = 0.0;
+    uint32_t compared = 0;
+
+    for (uint32_t bin = 0; bin < bins; bin++)
+    {
+        if (capture [bin] > floor || reference [bin] > floor)
+        {
+            double difference = 10.0 * log10 ((capture [bin] + floor) / (reference [bin] + floor));
+            sum += difference * difference;
+            compared++;
+        }
+    }
+
+    result->spectral = (compared > 0) ? sqrt (sum / compared) : 0.0;
+    result->peak_capture = (double) peak_capture * analysis->sample_rate / analysis->spectrum_fft.size;
+    result->peak_reference = (double) peak_reference * analysis->sample_rate / analysis->spectrum_fft.size;
+}
+
+
+/*
+ * Find the RMS difference in dB between the short-term levels of the capture and reference.
+ */
+static double analysis_envelope (analysis_t *analysis, const float *capture, const float *reference, uint32_t count)
+{
+    uint32_t block = analysis->envelope;
+    double sum = 0.0;
+    uint32_t blocks = 0;
+
+    for (uint32_t start = 0; start + block <= count; start += block)
+    {
+        double level_capture = power_db (dsp_dot (&capture [start], &capture [start], block) / block);
+        double level_reference = power_db (dsp_dot (&reference [start], &reference [start], block) / block);
+
+        /* Blocks where both are silent have no envelope to compare */
+        if (level_capture > SILENCE_DB || level_reference > SILENCE_DB)
+        {
+            double difference = fmax (level_capture, SILENCE_DB) - fmax (level_reference, SILENCE_DB);
+            sum += difference * difference;
+            blocks++;
+        }
+    }
+
+    return (blocks > 0) ? sqrt (sum / blocks) : 0.0;
+}
+
+
+/*
+ * Re-align one segment of the reference with the capture, searching near the previous segment's offset.
+ * The correlation must have the same polarity as the coarse alignment. Returns the segment's start in the capture.
+ */
+static int64_t analysis_align (analysis_t *analysis, const signal_t *capture, const signal_t *reference,
+                               uint64_t position, uint32_t count, int64_t lag, double polarity, int64_t *offset)
+{
+    const float *ref = &reference->samples [position];
+    int64_t search = (int64_t) position + lag + *offset - analysis->segment_lag;
+
+    /* Silent segments have nothing to align to, so keep the previous offset */
+    if (power_db (dsp_dot (ref, ref, count) / count) > SILENCE_DB && search >= 0 &&
+        search + count + 2 * analysis->segment_lag <= capture->count)
+    {
+        double peak;
+        int64_t found = dsp_cross_correlate (&analysis->lag_fft, analysis->lag_re, analysis->lag_im,
+                                             &capture->samples [search], count + 2 * analysis->segment_lag,
+                                             ref, count, 2 * analysis->segment_lag, &peak);
+        if (found >= 0 && peak * polarity > 0.0)
+        {
+            *offset += found - analysis->segment_lag;
+        }
+    }
+
+    int64_t start = (int64_t) position + lag + *offset;
+    if (start < 0 || start + count > capture->count)
+    {
+        start = (int64_t) position + lag;
+    }
+
+    return start;
+}
+
+
+/*
+ * Compare one aligned segment of the reference with the capture.
+ */
+static void analysis_segment (analysis_t *analysis, const float *cap, const float *ref, uint32_t count,
+                              segment_result_t *result)
+{
+    double capture_power = dsp_dot (cap, cap, count);
+    double reference_power = dsp_dot (ref, ref, count);
+    double cross = dsp_dot (cap, ref, count);
+    double difference_power = capture_power - 2.0 * cross + reference_power;
+
+    result->level_capture = power_db (capture_power / count);
+    result->level_reference = power_db (reference_power / count);
+    result->silent = result->level_capture <= SILENCE_DB && result->level_reference <= SILENCE_DB;
+    result->residual = power_db (fmax (difference_power, 0.0)) - power_db (reference_power);
+    result->envelope = analysis_envelope (analysis, cap, ref, count);
+
+    if (!result->silent)
+    {
+        analysis_spectrum (analysis, cap, count, analysis->power_capture);
+        analysis_spectrum (analysis, ref, count, analysis->power_reference);
+        analysis_compare_spectra (analysis, result);
+    }
+}
+
+
+int main (int argc, char **argv)
+{
+    const char *capture_filename = NULL;
+    const char *reference_filename = NULL;
+    const char *variant_name = "sms";
+    uint32_t segment_ms = DEFAULT_SEGMENT_MS;
+    uint32_t max_lag_ms = DEFAULT_MAX_LAG_MS;
+    uint32_t window_s = DEFAULT_WINDOW_S;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp (argv [i], "--variant") == 0 && i + 1 < argc)
+        {
+            variant_name = argv [++i];
+        }
+        else if (strcmp (argv [i], "--segment") == 0 && i + 1 < argc)
+        {
+            segment_ms = strtoul (argv [++i], NULL, 10);
+        }
+        else if (strcmp (argv [i], "--max-lag") == 0 && i + 1 < argc)
+        {
+            max_lag_ms = strtoul (argv [++i], NULL, 10);
+        }
+        else if (strcmp (argv [i], "--window") == 0 && i + 1 < argc)
+        {
+            window_s = strtoul (argv [++i], NULL, 10);
+        }
+        else if (capture_filename == NULL && argv [i][0] != '-')
+        {
+            capture_filename = argv [i];
+        }
+        else if (reference_filename == NULL && argv [i][0] != '-')
+        {
+            reference_filename = argv [i];
+        }
+        else
+        {
+            reference_filename = NULL;
+            break;
+        }
+    }
+
+    if (capture_filename == NULL || reference_filename == NULL || segment_ms == 0 || window_s == 0)
+    {
+        fprintf (stderr, "Usage: %s [--variant <name>] [--segment <ms>] [--max-lag <ms>] [--window <s>]\n"
+                         "        <capture.wav> <reference.wav|reference.psgl>\n", argv [0]);
+        return EXIT_FAILURE;
+    }
+
+    const variant_t *variant = variant_find (variant_name);
+    if (variant == NULL)
+    {
+        fprintf (stderr, "Error: Unknown variant '%s'.\n", variant_name);
+        return EXIT_FAILURE;
+    }
+
+    signal_t capture = { 0 };
+    signal_t reference = { 0 };
+
+    if (signal_load_wav (&capture, capture_filename) == -1)
+    {
+        return EXIT_FAILURE;
+    }
+
+    /* A log is rendered at the capture's sample rate */
+    size_t length = strlen (reference_filename);
+    int result;
+    if (length > 5 && strcmp (&reference_filename [length - 5], ".psgl") == 0)
+    {
+        result = signal_render (&reference, reference_filename, variant, capture.sample_rate);
+    }
+    else
+    {
+        result = signal_load_wav (&reference, reference_filename);
+        if (result == 0 && reference.sample_rate != capture.sample_rate)
+        {
+            fprintf (stderr, "Error: The reference is at %u Hz, but the capture is at %u Hz.\n",
+                     reference.sample_rate, capture.sample_rate);
+            result = -1;
+        }
+    }
+    if (result == -1)
+    {
+        free (capture.samples);
+        free (reference.samples);
+        return EXIT_FAILURE;
+    }
+
+    signal_remove_dc (&capture);
+    signal_remove_dc (&reference);
+
+    uint32_t sample_rate = capture.sample_rate;
+    uint32_t max_lag = (uint64_t) sample_rate * max_lag_ms / 1000;
+    uint32_t segment = (uint64_t) sample_rate * segment_ms / 1000;
+    uint64_t window = (uint64_t) sample_rate * window_s;
+
+    /* Coarse alignment, from the cross-correlation of the start of each */
+    double peak = 0.0;
+    int64_t lag = 0;
+    if (dsp_align (capture.samples, capture.count, reference.samples, reference.count, window, max_lag, &lag, &peak) == -1)
+    {
+        fprintf (stderr, "Error: Failed to allocate memory for alignment.\n");
+        free (capture.samples);
+        free (reference.samples);
+        return EXIT_FAILURE;
+    }
+
+    /* The span of the reference that the capture covers */
+    uint64_t reference_start = (lag < 0) ? -lag : 0;
+    uint64_t reference_end = (capture.count - lag < reference.count) ? capture.count - lag : reference.count;
+
+    if (peak == 0.0 || reference_end <= reference_start)
+    {
+        fprintf (stderr, "Error: Could not align the capture with the reference.\n");
+        free (capture.samples);
+        free (reference.samples);
+        return EXIT_FAILURE;
+    }
+
+    analysis_t analysis = { 0 };
+    uint64_t segment_count = (segment > 0) ? (reference_end - reference_start) / segment : 0;
+    int64_t *starts = malloc ((segment_count + 1) * sizeof (int64_t));
+    if (starts == NULL || analysis_init (&analysis, sample_rate, segment) == -1)
+    {
+        fprintf (stderr, "Error: Failed to allocate memory for analysis.\n");
+        analysis_free (&analysis);
+        free (starts);
+        free (capture.samples);
+        free (reference.samples);
+        return EXIT_FAILURE;
+    }
+
+    /* Align each segment, following any drift between the capture's clock and the model's */
+    int64_t offset = 0;
+    double cross = 0.0;
+    double capture_power = 0.0;
+    double reference_power = 0.0;
+    for (uint64_t i = 0; i < segment_count; i++)
+    {
+        uint64_t position = reference_start + i * segment;
+        const float *ref = &reference.samples [position];
+
+        starts [i] = analysis_align (&analysis, &capture, &reference, position, segment, lag, peak, &offset);
+        cross += dsp_dot (&capture.samples [starts [i]], ref, segment);
+        capture_power += dsp_dot (&capture.samples [starts [i]], &capture.samples [starts [i]], segment);
+        reference_power += dsp_dot (ref, ref, segment);
+    }
+
+    if (reference_power == 0.0)
+    {
+        fprintf (stderr, "Error: The reference is silent, or shorter than a segment.\n");
+        analysis_free (&analysis);
+        free (starts);
+        free (capture.samples);
+        free (reference.samples);
+        return EXIT_FAILURE;
+    }
+
+    /* Least-squares gain, applied to the reference so that levels are compared at the capture's scale */
+    double gain = cross / reference_power;
+    dsp_scale (reference.samples, reference.samples, gain, 0.0f, reference.count);
+
+    printf ("Capture:     %s, %.3f s at %u Hz\n", capture_filename, (double) capture.count / sample_rate, sample_rate);
+    printf ("Reference:   %s, %.3f s", reference_filename, (double) reference.count / sample_rate);
+    if (length > 5 && strcmp (&reference_filename [length - 5], ".psgl") == 0)
+    {
+        printf (", rendered as '%s'", variant->name);
+    }
+    printf ("\n");
+    printf ("Offset:      %+lld samples (%+.3f ms), the capture starting %s\n", (long long) lag,
+            1000.0 * lag / sample_rate, (lag >= 0) ? "before the reference" : "after the reference");
+    printf ("Gain:        %.2f dB%s\n", 20.0 * log10 (fabs (gain)), (gain < 0.0) ? ", polarity inverted" : "");
+    printf ("Correlation: %.4f over %.3f s\n", fabs (cross) / sqrt (capture_power * reference_power),
+            (double) segment_count * segment / sample_rate);
+    printf ("\n");
+
+    printf ("%9s %10s %9s %9s %9s %9s %9s %9s  %s\n", "Time", "Drift", "Capture", "Reference", "Level",
+            "Envelope", "Residual", "Spectral", "Peak frequency (capture / reference)");
+
+    double worst_envelope = 0.0;
+    double worst_spectral = 0.0;
+    double worst_envelope_time = 0.0;
+    double worst_spectral_time = 0.0;
+    uint32_t compared = 0;
+
+    for (uint64_t i = 0; i < segment_count; i++)
+    {
+        uint64_t position = reference_start + i * segment;
+        double time = (double) position / sample_rate;
+        segment_result_t result;
+
+        analysis_segment (&analysis, &capture.samples [starts [i]], &reference.samples [position], segment, &result);
+
+        printf ("%7.3f s %+7.3f ms", time, 1000.0 * (starts [i] - (int64_t) position - lag) / sample_rate);
+        if (result.silent)
+        {
+            printf ("    silent\n");
+            continue;
+        }
+
+        printf (" %6.1f dB %6.1f dB %+6.1f dB %6.1f dB %6.1f dB %6.1f dB  %.1f Hz / %.1f Hz\n",
+                result.level_capture, result.level_reference, result.level_capture - result.level_reference,
+                result.envelope, result.residual, result.spectral, result.peak_capture, result.peak_reference);
+
+        if (result.envelope > worst_envelope)
+        {
+            worst_envelope = result.envelope;
+            worst_envelope_time = time;
+        }
+        if (result.spectral > worst_spectral)
+        {
+            worst_spectral = result.spectral;
+            worst_spectral_time = time;
+        }
+        compared++;
+    }
+
+    printf ("\n");
+    if (compared > 0)
+    {
+        printf ("Worst envelope difference: %.1f dB at %.3f s\n", worst_envelope, worst_envelope_time);
+        printf ("Worst spectral difference: %.1f dB at %.3f s\n", worst_spectral, worst_spectral_time);
+    }
+    if (segment_count > 1)
+    {
+        double span = (double) (segment_count - 1) * segment;
+        int64_t drift = (starts [segment_count - 1] - (int64_t) (segment_count - 1) * segment) - starts [0];
+        printf ("Clock drift: %+.1f ppm, the capture running %s\n", 1e6 * drift / span, (drift > 0) ? "slow" : "fast");
+    }
+
+    analysis_free (&analysis);
+    free (starts);
+    free (capture.samples);
+    free (reference.samples);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,481 @@
+/*
+ * PSG-Compare
+ * FFT and signal kernels, vectorised four floats at a time.
+ *
+ * JoppyFurr 2024
+ *
+ * The kernels use GCC's vector extensions, which compile to SSE on x86 and
+ * NEON on ARM without needing intrinsics for each. Loads and stores go through
+ * memcpy, so buffers need no particular alignment.
+ *
+ * The FFT is an iterative radix-2 decimation-in-time transform. Real and
+ * imaginary parts are kept in separate arrays, so that each butterfly stage
+ * from a half-size of four upwards works on four adjacent butterflies at once.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dsp.h"
+
+#ifndef M_PI
+#define M_PI            3.14159265358979323846
+#endif
+
+typedef float v4f __attribute__ ((vector_size (16)));
+
+/* Sums are gathered in floats over blocks of this many samples, then added as doubles */
+#define SUM_BLOCK       4096
+
+
+/*
+ * Load four floats.
+ */
+static inline v4f load4 (const float *source)
+{
+    v4f value;
+    memcpy (&value, source, sizeof (v4f));
+    return value;
+}
+
+
+/*
+ * Store four floats.
+ */
+static inline void store4 (float *dest, v4f value)
+{
+    memcpy (dest, &value, sizeof (v4f));
+}
+
+
+/*
+ * Add the four lanes of a vector.
+ */
+static inline double sum4 (v4f value)
+{
+    return (double) value [0] + value [1] + value [2] + value [3];
+}
+
+
+/*
+ * Smallest power of two that is at least the given count, and at least 8.
+ */
+uint32_t fft_size_for (uint64_t count)
+{
+    uint64_t size = 8;
+
+    while (size < count)
+    {
+        size <<= 1;
+    }
+
+    return (size > UINT32_MAX) ? 0 : size;
+}
+
+
+/*
+ * Prepare an FFT of the given size, which must be a power of two, at least 8.
+ * Returns -1 on error.
+ */
+int fft_init (fft_t *fft, uint32_t size)
+{
+    uint32_t bits = 0;
+
+    memset (fft, 0, sizeof (fft_t));
+
+    if (size < 8 || (size & (size - 1)) != 0)
+    {
+        return -1;
+    }
+
+    while ((1u << bits) < size)
+    {
+        bits++;
+    }
+
+    fft->size = size;
+    fft->reverse = malloc (size * sizeof (uint32_t));
+    fft->twiddle_re = malloc (size * sizeof (float));
+    fft->twiddle_im = malloc (size * sizeof (float));
+
+    if (fft->reverse == NULL || fft->twiddle_re == NULL || fft->twiddle_im == NULL)
+    {
+        fft_free (fft);
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < size; i++)
+    {
+        uint32_t reversed = 0;
+
+        for (uint32_t bit = 0; bit < bits; bit++)
+        {
+            reversed |= ((i >> bit) & 1) << (bits - 1 - bit);
+        }
+        fft->reverse [i] = reversed;
+    }
+
+    /* Twiddles are calculated in double, so that the largest sizes stay accurate */
+    for (uint32_t half = 1; half < size; half <<= 1)
+    {
+        for (uint32_t k = 0; k < half; k++)
+        {
+            double angle = -M_PI * k / half;
+            fft->twiddle_re [half + k] = cos (angle);
+            fft->twiddle_im [half + k] = sin (angle);
+        }
+    }
+
+    return 0;
+}
+
+
+/*
+ * Forward transform, in place.
+ */
+void fft_forward (const fft_t *fft, float *re, float *im)
+{
+    uint32_t size = fft->size;
+
+    for (uint32_t i = 0; i < size; i++)
+    {
+        uint32_t j = fft->reverse [i];
+        if (j > i)
+        {
+            float swap = re [i]; re [i] = re [j]; re [j] = swap;
+            swap = im [i]; im [i] = im [j]; im [j] = swap;
+        }
+    }
+
+    /* Half-sizes of one and two, with trivial twiddles */
+    for (uint32_t start = 0; start < size; start += 4)
+    {
+        float *r = &re [start];
+        float *m = &im [start];
+
+        float r0 = r [0] + r [1], m0 = m [0] + m [1];
+        float r1 = r [0] - r [1], m1 = m [0] - m [1];
+        float r2 = r [2] + r [3], m2 = m [2] + m [3];
+        float r3 = r [2] - r [3], m3 = m [2] - m [3];
+
+        /* The second butterfly's twiddle is -i */
+        r [0] = r0 + r2; m [0] = m0 + m2;
+        r [2] = r0 - r2; m [2] = m0 - m2;
+        r [1] = r1 + m3; m [1] = m1 - r3;
+        r [3] = r1 - m3; m [3] = m1 + r3;
+    }
+
+    for (uint32_t half = 4; half < size; half <<= 1)
+    {
+        const float *twiddle_re = &fft->twiddle_re [half];
+        const float *twiddle_im = &fft->twiddle_im [half];
+
+        for (uint32_t start = 0; start < size; start += half * 2)
+        {
+            float *a_re = &re [start];
+            float *a_im = &im [start];
+            float *b_re = &re [start + half];
+            float *b_im = &im [start + half];
+
+            for (uint32_t k = 0; k < half; k += 4)
+            {
+                v4f w_re = load4 (&twiddle_re [k]);
+                v4f w_im = load4 (&twiddle_im [k]);
+                v4f x_re = load4 (&b_re [k]);
+                v4f x_im = load4 (&b_im [k]);
+                v4f t_re = x_re * w_re - x_im * w_im;
+                v4f t_im = x_re * w_im + x_im * w_re;
+                v4f y_re = load4 (&a_re [k]);
+                v4f y_im = load4 (&a_im [k]);
+
+                store4 (&a_re [k], y_re + t_re);
+                store4 (&a_im [k], y_im + t_im);
+                store4 (&b_re [k], y_re - t_re);
+                store4 (&b_im [k], y_im - t_im);
+            }
+        }
+    }
+}
+
+
+/*
+ * Inverse transform, in place, scaled by 1 / size.
+ * Swapping the real and imaginary parts turns the forward transform into the inverse.
+ */
+void fft_inverse (const fft_t *fft, float *re, float *im)
+{
+    fft_forward (fft, im, re);
+
+    dsp_scale (re, re, 1.0f / fft->size, 0.0f, fft->size);
+    dsp_scale (im, im, 1.0f / fft->size, 0.0f, fft->size);
+}
+
+
+/*
+ * Free the FFT's tables.
+ */
+void fft_free (fft_t *fft)
+{
+    free (fft->reverse);
+    free (fft->twiddle_re);
+    free (fft->twiddle_im);
+
+    fft->reverse = NULL;
+    fft->twiddle_re = NULL;
+    fft->twiddle_im = NULL;
+    fft->size = 0;
+}
+
+
+/*
+ * Mix interleaved 16-bit samples down to mono floats, with full scale at 1.0.
+ */
+void dsp_downmix (const int16_t *samples, uint32_t channels, uint64_t frames, float *mono)
+{
+    const float scale = 1.0f / (32768.0f * channels);
+    uint64_t frame = 0;
+
+    if (channels == 2)
+    {
+        const v4f scale4 = { scale, scale, scale, scale };
+
+        for (; frame + 4 <= frames; frame += 4)
+        {
+            const int16_t *s = &samples [frame * 2];
+            v4f left = { s [0], s [2], s [4], s [6] };
+            v4f right = { s [1], s [3], s [5], s [7] };
+            store4 (&mono [frame], (left + right) * scale4);
+        }
+    }
+
+    for (; frame < frames; frame++)
+    {
+        int32_t sum = 0;
+
+        for (uint32_t channel = 0; channel < channels; channel++)
+        {
+            sum += samples [frame * channels + channel];
+        }
+        mono [frame] = sum * scale;
+    }
+}
+
+
+/*
+ * Sum of a [i] * b [i].
+ */
+double dsp_dot (const float *a, const float *b, uint64_t count)
+{
+    double total = 0.0;
+    uint64_t i = 0;
+
+    while (i + 4 <= count)
+    {
+        uint64_t block_end = (count - i > SUM_BLOCK) ? i + SUM_BLOCK : count;
+        v4f sum = { 0 };
+
+        for (; i + 4 <= block_end; i += 4)
+        {
+            sum += load4 (&a [i]) * load4 (&b [i]);
+        }
+        total += sum4 (sum);
+    }
+
+    for (; i < count; i++)
+    {
+        total += (double) a [i] * b [i];
+    }
+
+    return total;
+}
+
+
+/*
+ * Sum of a [i].
+ */
+double dsp_sum (const float *a, uint64_t count)
+{
+    double total = 0.0;
+    uint64_t i = 0;
+
+    while (i + 4 <= count)
+    {
+        uint64_t block_end = (count - i > SUM_BLOCK) ? i + SUM_BLOCK : count;
+        v4f sum = { 0 };
+
+        for (; i + 4 <= block_end; i += 4)
+        {
+            sum += load4 (&a [i]);
+        }
+        total += sum4 (sum);
+    }
+
+    for (; i < count; i++)
+    {
+        total += a [i];
+    }
+
+    return total;
+}
+
+
+/*
+ * out [i] = a [i] * b [i].
+ */
+void dsp_multiply (float *out, const float *a, const float *b, uint64_t count)
+{
+    uint64_t i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        store4 (&out [i], load4 (&a [i]) * load4 (&b [i]));
+    }
+
+    for (; i < count; i++)
+    {
+        out [i] = a [i] * b [i];
+    }
+}
+
+
+/*
+ * out [i] = a [i] * scale + offset.
+ */
+void dsp_scale (float *out, const float *a, float scale, float offset, uint64_t count)
+{
+    const v4f scale4 = { scale, scale, scale, scale };
+    const v4f offset4 = { offset, offset, offset, offset };
+    uint64_t i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        store4 (&out [i], load4 (&a [i]) * scale4 + offset4);
+    }
+
+    for (; i < count; i++)
+    {
+        out [i] = a [i] * scale + offset;
+    }
+}
+
+
+/*
+ * power [i] += re [i] * re [i] + im [i] * im [i].
+ */
+void dsp_power_accumulate (float *power, const float *re, const float *im, uint64_t count)
+{
+    uint64_t i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        v4f r = load4 (&re [i]);
+        v4f m = load4 (&im [i]);
+        store4 (&power [i], load4 (&power [i]) + r * r + m * m);
+    }
+
+    for (; i < count; i++)
+    {
+        power [i] += re [i] * re [i] + im [i] * im [i];
+    }
+}
+
+
+/*
+ * Cross-correlate a against b, for lags from -max_lag to +max_lag, where a [n + lag] lines up with b [n].
+ * Returns the lag with the largest magnitude of correlation, and its correlation in *peak.
+ *
+ * Both signals are real, so they share one transform: a as the real part and b as the imaginary part.
+ * Their spectra are separated using the symmetry of real signals' transforms.
+ */
+int64_t dsp_cross_correlate (const fft_t *fft, float *re, float *im,
+                             const float *a, uint64_t a_count, const float *b, uint64_t b_count,
+                             uint32_t max_lag, double *peak)
+{
+    uint32_t size = fft->size;
+
+    memcpy (re, a, a_count * sizeof (float));
+    memset (&re [a_count], 0, (size - a_count) * sizeof (float));
+    memcpy (im, b, b_count * sizeof (float));
+    memset (&im [b_count], 0, (size - b_count) * sizeof (float));
+
+    fft_forward (fft, re, im);
+
+    /* X [k] = A [k] * conj (B [k]), and X [size - k] = conj (X [k]) */
+    for (uint32_t k = 0; k <= size / 2; k++)
+    {
+        uint32_t m = (size - k) & (size - 1);
+        float a_re = (re [k] + re [m]) * 0.5f;
+        float a_im = (im [k] - im [m]) * 0.5f;
+        float b_re = (im [k] + im [m]) * 0.5f;
+        float b_im = (re [m] - re [k]) * 0.5f;
+        float x_re = a_re * b_re + a_im * b_im;
+        float x_im = a_im * b_re - a_re * b_im;
+
+        re [k] = x_re;
+        im [k] = x_im;
+        re [m] = x_re;
+        im [m] = -x_im;
+    }
+
+    fft_inverse (fft, re, im);
+
+    int64_t best_lag = 0;
+    double best = 0.0;
+    for (int64_t lag = -(int64_t) max_lag; lag <= (int64_t) max_lag; lag++)
+    {
+        double value = re [(lag < 0) ? size + lag : lag];
+        if (fabs (value) > fabs (best))
+        {
+            best = value;
+            best_lag = lag;
+        }
+    }
+
+    *peak = best;
+    return best_lag;
+}
+
+
+/*
+ * Find the overall offset between two signals, from the cross-correlation of
+ * the first window samples of b with the samples of a that could line up.
+ * Returns -1 on error.
+ */
+int dsp_align (const float *a, uint64_t a_count, const float *b, uint64_t b_count,
+               uint64_t window, uint32_t max_lag, int64_t *lag, double *peak)
+{
+    fft_t fft;
+
+    if (window > b_count)
+    {
+        window = b_count;
+    }
+    uint64_t a_window = (window + max_lag < a_count) ? window + max_lag : a_count;
+
+    uint32_t size = fft_size_for (((a_window > window) ? a_window : window) + max_lag);
+    if (size == 0 || fft_init (&fft, size) == -1)
+    {
+        return -1;
+    }
+
+    float *re = malloc (fft.size * sizeof (float));
+    float *im = malloc (fft.size * sizeof (float));
+    if (re == NULL || im == NULL)
+    {
+        free (re);
+        free (im);
+        fft_free (&fft);
+        return -1;
+    }
+
+    *lag = dsp_cross_correlate (&fft, re, im, a, a_window, b, window, max_lag, peak);
+
+    free (re);
+    free (im);
+    fft_free (&fft);
+
+    return 0;
+}
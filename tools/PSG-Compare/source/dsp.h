@@ -0,0 +1,59 @@
+/*
+ * PSG-Compare
+ * FFT and signal kernels, vectorised four floats at a time.
+ *
+ * JoppyFurr 2024
+ */
+
+/* Complex FFT of a power-of-two size, on separate real and imaginary arrays. */
+typedef struct fft_s {
+    uint32_t size;
+    uint32_t *reverse;
+    float *twiddle_re;      /* Twiddles for a stage of half-size h are at [h, 2h) */
+    float *twiddle_im;
+} fft_t;
+
+/* Prepare an FFT of the given size, which must be a power of two, at least 8. Returns -1 on error. */
+int fft_init (fft_t *fft, uint32_t size);
+
+/* Forward transform, in place. */
+void fft_forward (const fft_t *fft, float *re, float *im);
+
+/* Inverse transform, in place, scaled by 1 / size. */
+void fft_inverse (const fft_t *fft, float *re, float *im);
+
+/* Free the FFT's tables. */
+void fft_free (fft_t *fft);
+
+/* Smallest power of two that is at least the given count, and at least 8. */
+uint32_t fft_size_for (uint64_t count);
+
+/* Mix interleaved 16-bit samples down to mono floats, with full scale at 1.0. */
+void dsp_downmix (const int16_t *samples, uint32_t channels, uint64_t frames, float *mono);
+
+/* Sum of a [i] * b [i]. */
+double dsp_dot (const float *a, const float *b, uint64_t count);
+
+/* Sum of a [i]. */
+double dsp_sum (const float *a, uint64_t count);
+
+/* out [i] = a [i] * b [i]. */
+void dsp_multiply (float *out, const float *a, const float *b, uint64_t count);
+
+/* out [i] = a [i] * scale + offset. */
+void dsp_scale (float *out, const float *a, float scale, float offset, uint64_t count);
+
+/* power [i] += re [i] * re [i] + im [i] * im [i]. */
+void dsp_power_accumulate (float *power, const float *re, const float *im, uint64_t count);
+
+/* Cross-correlate a against b, for lags from -max_lag to +max_lag, where a [n + lag] lines up with b [n].
+ * Buffers re and im must each hold fft->size floats, which must be at least a_count + max_lag, and b_count + max_lag.
+ * Returns the lag with the largest magnitude of correlation, and its correlation in *peak. */
+int64_t dsp_cross_correlate (const fft_t *fft, float *re, float *im,
+                             const float *a, uint64_t a_count, const float *b, uint64_t b_count,
+                             uint32_t max_lag, double *peak);
+
+/* Find the overall lag of a against b, as above, over the first window samples of b.
+ * Returns -1 on error. */
+int dsp_align (const float *a, uint64_t a_count, const float *b, uint64_t b_count,
+               uint64_t window, uint32_t max_lag, int64_t *lag, double *peak);
@@ -0,0 +1,587 @@
+/*
+ * PSG-Compare
+ * A tool to render a PSG log against every known variant of the chip, and
+ * report how each differs from a reference.
+ *
+ * JoppyFurr 2024
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../../PSG-Log/source/psg_log.h"
+#include "../../SN76489-Model/source/sn76489.h"
+#include "dsp.h"
+#include "render.h"
+#include "wav.h"
+
+#define DEFAULT_SAMPLE_RATE 44100
+#define THREADS_MAX         64
+
+/* A capture is aligned with each render as psgalign does, over the first
+ * ALIGN_WINDOW_S seconds, for offsets of up to ALIGN_MAX_LAG_MS either way */
+#define ALIGN_WINDOW_S      30
+#define ALIGN_MAX_LAG_MS    5000
+
+/* How one variant's render differs from the reference */
+typedef struct job_s {
+    const variant_t *variant;
+    uint64_t frames;
+    double rms_difference;      /* dBFS */
+    double residual;            /* dB, relative to the reference's level */
+    double correlation;
+    int32_t peak_difference;
+    int64_t first_difference;   /* Frame, or -1 if the same */
+    int64_t offset;             /* Frames that the capture starts before the render */
+    double gain;                /* Applied to the render to match the capture, negative if inverted */
+    bool failed;
+} job_t;
+
+/* Shared by the worker threads. Only next_job is written once the threads start. */
+typedef struct context_s {
+    const psg_log_map_t *log;
+    const char *output_dir;
+    uint32_t sample_rate;
+    const wav_t *reference;
+    const float *capture;       /* The reference mixed down to mono, or NULL if it is not a capture */
+    job_t *jobs;
+    uint32_t job_count;
+    uint32_t next_job;
+    pthread_mutex_t mutex;
+} context_t;
+
+
+/*
+ * Compare a stereo render with the reference, which may be mono.
+ * The shorter of the two sets the length compared.
+ */
+static void job_compare (job_t *job, const int16_t *samples, uint64_t frames, const wav_t *reference)
+{
+    uint64_t length = (frames < reference->frames) ? frames : reference->frames;
+    double sum_reference = 0.0;
+    double sum_render = 0.0;
+    double sum_difference = 0.0;
+    double sum_product = 0.0;
+    int32_t peak = 0;
+
+    job->first_difference = -1;
+
+    for (uint64_t frame = 0; frame < length; frame++)
+    {
+        for (uint32_t channel = 0; channel < reference->channels; channel++)
+        {
+            int32_t expected = reference->samples [frame * reference->channels + channel];
+            int32_t actual;
+
+            if (reference->channels == 1)
+            {
+                actual = (samples [frame * 2] + samples [frame * 2 + 1]) / 2;
+            }
+            else
+            {
+                actual = samples [frame * 2 + channel];
+            }
+
+            int32_t difference = actual - expected;
+            if (difference != 0 && job->first_difference == -1)
+            {
+                job->first_difference = frame;
+            }
+            if (abs (difference) > peak)
+            {
+                peak = abs (difference);
+            }
+
+            sum_reference += (double) expected * expected;
+            sum_render += (double) actual * actual;
+            sum_difference += (double) difference * difference;
+            sum_product += (double) expected * actual;
+        }
+    }
+
+    uint64_t count = length * reference->channels;
+    job->rms_difference = (count > 0) ? 20.0 * log10 (sqrt (sum_difference / count) / 32768.0) : -INFINITY;
+    job->residual = (sum_reference > 0.0) ? 10.0 * log10 (sum_difference / sum_reference) : INFINITY;
+    job->correlation = (sum_reference > 0.0 && sum_render > 0.0) ? sum_product / sqrt (sum_reference * sum_render) : 0.0;
+    job->peak_difference = peak;
+}
+
+
+/*
+ * Compare a stereo render with a capture from hardware, mixed down to mono.
+ * The capture is aligned with the render, and the render scaled to the
+ * capture's level and polarity by a least-squares gain, before comparing the
+ * span where the two overlap. Returns -1 on error.
+ */
+static int job_compare_capture (job_t *job, const int16_t *samples, uint64_t frames,
+                                 const float *capture, uint64_t capture_frames, uint32_t sample_rate)
+{
+    float *render = malloc ((frames + 1) * sizeof (float));
+    if (render == NULL)
+    {
+        return -1;
+    }
+
+    dsp_downmix (samples, 2, frames, render);
+    if (frames > 0)
+    {
+        float mean = dsp_sum (render, frames) / frames;
+        dsp_scale (render, render, 1.0f, -mean, frames);
+    }
+
+    int64_t lag = 0;
+    double peak = 0.0;
+    if (dsp_align (capture, capture_frames, render, frames, (uint64_t) sample_rate * ALIGN_WINDOW_S,
+                   (uint64_t) sample_rate * ALIGN_MAX_LAG_MS / 1000, &lag, &peak) == -1)
+    {
+        free (render);
+        return -1;
+    }
+
+    /* The span of the render that the capture covers */
+    uint64_t start = (lag < 0) ? -lag : 0;
+    uint64_t end = ((int64_t) capture_frames - lag < (int64_t) frames) ? capture_frames - lag : frames;
+    if (peak == 0.0 || end <= start)
+    {
+        fprintf (stderr, "Error: Could not align the capture with '%s'.\n", job->variant->name);
+        free (render);
+        return -1;
+    }
+
+    const float *cap = &capture [start + lag];
+    const float *ren = &render [start];
+    uint64_t count = end - start;
+    double capture_power = dsp_dot (cap, cap, count);
+    double render_power = dsp_dot (ren, ren, count);
+    double cross = dsp_dot (cap, ren, count);
+    double gain = (render_power > 0.0) ? cross / render_power : 0.0;
+    double difference_power = fmax (capture_power - gain * cross, 0.0);
+    double largest = 0.0;
+
+    job->first_difference = -1;
+    for (uint64_t i = 0; i < count; i++)
+    {
+        double difference = fabs (cap [i] - gain * ren [i]) * 32768.0;
+        if (difference >= 0.5 && job->first_difference == -1)
+        {
+            job->first_difference = start + i;
+        }
+        largest = fmax (largest, difference);
+    }
+
+    job->offset = lag;
+    job->gain = gain;
+    job->rms_difference = 10.0 * log10 (difference_power / count);
+    job->residual = (capture_power > 0.0) ? 10.0 * log10 (difference_power / capture_power) : INFINITY;
+    job->correlation = (capture_power > 0.0 && render_power > 0.0) ? fabs (cross) / sqrt (capture_power * render_power) : 0.0;
+    job->peak_difference = lround (largest);
+
+    free (render);
+    return 0;
+}
+
+
+/*
+ * Render and compare variants until none are left.
+ */
+static void *worker (void *arg)
+{
+    context_t *context = arg;
+    char filename [4096];
+
+    while (true)
+    {
+        pthread_mutex_lock (&context->mutex);
+        uint32_t index = context->next_job++;
+        pthread_mutex_unlock (&context->mutex);
+
+        if (index >= context->job_count)
+        {
+            break;
+        }
+
+        job_t *job = &context->jobs [index];
+        wav_t wav = { .channels = 2, .sample_rate = context->sample_rate };
+
+        if (render_log (context->log, job->variant, context->sample_rate, &wav.samples, &wav.frames) == -1)
+        {
+            job->failed = true;
+            job->residual = INFINITY;
+            continue;
+        }
+
+        job->frames = wav.frames;
+        snprintf (filename, sizeof (filename), "%s/%s.wav", context->output_dir, job->variant->name);
+        if (wav_write (&wav, filename) == -1)
+        {
+            job->failed = true;
+        }
+
+        if (context->capture != NULL)
+        {
+            if (job_compare_capture (job, wav.samples, wav.frames, context->capture,
+                                     context->reference->frames, context->sample_rate) == -1)
+            {
+                job->failed = true;
+                job->residual = INFINITY;
+            }
+        }
+        else if (context->reference != NULL)
+        {
+            job_compare (job, wav.samples, wav.frames, context->reference);
+        }
+
+        wav_free (&wav);
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Sort jobs by how closely they match the reference.
+ */
+static int job_compare_residual (const void *a, const void *b)
+{
+    const job_t *job_a = a;
+    const job_t *job_b = b;
+
+    return (job_a->residual > job_b->residual) - (job_a->residual < job_b->residual);
+}
+
+
+/*
+ * Print the difference report, closest match first.
+ */
+static void report_print (job_t *jobs, uint32_t job_count, const char *reference_name, const wav_t *reference,
+                          bool capture)
+{
+    qsort (jobs, job_count, sizeof (job_t), job_compare_residual);
+
+    printf ("Reference: %s, %.3f s, %u channel%s at %u Hz\n", reference_name,
+            (double) reference->frames / reference->sample_rate, reference->channels,
+            (reference->channels == 1) ? "" : "s", reference->sample_rate);
+    printf ("%-18s %10s %10s %11s %7s %12s", "Variant", "Difference", "Residual", "Correlation", "Peak", "First diff");
+    if (capture)
+    {
+        printf (" %12s %13s", "Offset", "Gain");
+    }
+    printf ("  %s\n", "Description");
+
+    for (uint32_t i = 0; i < job_count; i++)
+    {
+        if (jobs [i].failed)
+        {
+            printf ("%-18s %10s\n", jobs [i].variant->name, "failed");
+            continue;
+        }
+
+        printf ("%-18s %6.1f dBFS %7.1f dB %11.4f %7d ", jobs [i].variant->name,
+                jobs [i].rms_difference, jobs [i].residual, jobs [i].correlation, jobs [i].peak_difference);
+
+        if (jobs [i].first_difference == -1)
+        {
+            printf ("%12s", "-");
+        }
+        else
+        {
+            printf ("%10.4f s", (double) jobs [i].first_difference / reference->sample_rate);
+        }
+
+        if (capture)
+        {
+            printf (" %+9.3f ms %7.2f dB %s", 1000.0 * jobs [i].offset / reference->sample_rate,
+                    20.0 * log10 (fabs (jobs [i].gain)), (jobs [i].gain < 0.0) ? "inv" : "   ");
+        }
+
+        printf ("  %s", jobs [i].variant->description);
+        if (!capture && jobs [i].frames != reference->frames)
+        {
+            printf (" (length differs by %+lld frames)", (long long) jobs [i].frames - (long long) reference->frames);
+        }
+        printf ("\n");
+    }
+}
+
+
+/*
+ * Print the usage, and the list of variants.
+ */
+static void usage (const char *argv_0)
+{
+    fprintf (stderr, "Usage: %s [--rate <hz>] [--threads <n>] [--variants <name,...>]\n"
+                     "        [--reference <name> | --capture <file.wav>] <input.psgl> <output-dir>\n\n", argv_0);
+    fprintf (stderr, "Variants:\n");
+    for (uint32_t i = 0; i < variant_count; i++)
+    {
+        fprintf (stderr, "  %-18s %s\n", variants [i].name, variants [i].description);
+    }
+}
+
+
+int main (int argc, char **argv)
+{
+    const char *input_filename = NULL;
+    const char *output_dir = NULL;
+    const char *capture_filename = NULL;
+    const char *reference_name = NULL;
+    char *variant_list = NULL;
+    uint32_t sample_rate = 0;
+    uint32_t thread_count = 0;
+    job_t jobs [VARIANTS_MAX];
+    uint32_t job_count = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp (argv [i], "--rate") == 0 && i + 1 < argc)
+        {
+            sample_rate = strtoul (argv [++i], NULL, 10);
+        }
+        else if (strcmp (argv [i], "--threads") == 0 && i + 1 < argc)
+        {
+            thread_count = strtoul (argv [++i], NULL, 10);
+        }
+        else if (strcmp (argv [i], "--variants") == 0 && i + 1 < argc)
+        {
+            variant_list = argv [++i];
+        }
+        else if (strcmp (argv [i], "--reference") == 0 && i + 1 < argc)
+        {
+            reference_name = argv [++i];
+        }
+        else if (strcmp (argv [i], "--capture") == 0 && i + 1 < argc)
+        {
+            capture_filename = argv [++i];
+        }
+        else if (input_filename == NULL && argv [i][0] != '-')
+        {
+            input_filename = argv [i];
+        }
+        else if (output_dir == NULL && argv [i][0] != '-')
+        {
+            output_dir = argv [i];
+        }
+        else
+        {
+            output_dir = NULL;
+            break;
+        }
+    }
+
+    if (input_filename == NULL || output_dir == NULL || (capture_filename != NULL && reference_name != NULL))
+    {
+        usage (argv [0]);
+        return EXIT_FAILURE;
+    }
+
+    /* Choose the variants, in the order given */
+    if (variant_list == NULL)
+    {
+        for (uint32_t i = 0; i < variant_count; i++)
+        {
+            jobs [job_count++] = (job_t) { .variant = &variants [i] };
+        }
+    }
+    else
+    {
+        char *save = NULL;
+        for (char *name = strtok_r (variant_list, ",", &save); name != NULL; name = strtok_r (NULL, ",", &save))
+        {
+            const variant_t *variant = variant_find (name);
+            if (variant == NULL)
+            {
+                fprintf (stderr, "Error: Unknown variant '%s'.\n\n", name);
+                usage (argv [0]);
+                return EXIT_FAILURE;
+            }
+            if (job_count == VARIANTS_MAX)
+            {
+                fprintf (stderr, "Error: Too many variants.\n");
+                return EXIT_FAILURE;
+            }
+            jobs [job_count++] = (job_t) { .variant = variant };
+        }
+    }
+
+    if (reference_name != NULL && variant_find (reference_name) == NULL)
+    {
+        fprintf (stderr, "Error: Unknown reference variant '%s'.\n", reference_name);
+        return EXIT_FAILURE;
+    }
+
+    /* A capture is compared at its own sample rate, mixed down to mono without its DC offset */
+    wav_t reference = { 0 };
+    float *capture = NULL;
+    if (capture_filename != NULL)
+    {
+        if (wav_read (&reference, capture_filename) == -1)
+        {
+            return EXIT_FAILURE;
+        }
+
+        capture = malloc ((reference.frames + 1) * sizeof (float));
+        if (capture == NULL)
+        {
+            fprintf (stderr, "Error: Failed to allocate memory for '%s'.\n", capture_filename);
+            wav_free (&reference);
+            return EXIT_FAILURE;
+        }
+        dsp_downmix (reference.samples, reference.channels, reference.frames, capture);
+        if (reference.frames > 0)
+        {
+            float mean = dsp_sum (capture, reference.frames) / reference.frames;
+            dsp_scale (capture, capture, 1.0f, -mean, reference.frames);
+        }
+
+        if (sample_rate != 0 && sample_rate != reference.sample_rate)
+        {
+            fprintf (stderr, "Note: Rendering at the capture's rate of %u Hz.\n", reference.sample_rate);
+        }
+        sample_rate = reference.sample_rate;
+        reference_name = capture_filename;
+    }
+    else if (sample_rate == 0)
+    {
+        sample_rate = DEFAULT_SAMPLE_RATE;
+    }
+
+    if (mkdir (output_dir, 0777) == -1 && errno != EEXIST)
+    {
+        fprintf (stderr, "Failed to create output directory '%s'.\n", output_dir);
+        free (capture);
+        wav_free (&reference);
+        return EXIT_FAILURE;
+    }
+
+    psg_log_map_t map;
+    if (psg_log_map (&map, input_filename) == -1)
+    {
+        fprintf (stderr, "Failed to open input file '%s'.\n", input_filename);
+        free (capture);
+        wav_free (&reference);
+        return EXIT_FAILURE;
+    }
+
+    /* The first call to sn76489_init builds the model's shared tables, so must be made before the threads start */
+    sn76489_t *psg = malloc (sizeof (sn76489_t));
+    if (psg == NULL)
+    {
+        fprintf (stderr, "Error: Failed to allocate memory for the model.\n");
+        psg_log_unmap (&map);
+        free (capture);
+        wav_free (&reference);
+        return EXIT_FAILURE;
+    }
+    sn76489_init (psg, SN76489_VARIANT_SEGA, SN76489_CLOCK_NTSC, sample_rate);
+    free (psg);
+
+    /* Without a capture, the reference is rendered first, for the others to be compared against */
+    if (capture_filename == NULL)
+    {
+        const variant_t *variant = (reference_name != NULL) ? variant_find (reference_name) : jobs [0].variant;
+
+        reference.channels = 2;
+        reference.sample_rate = sample_rate;
+        reference_name = variant->name;
+        if (render_log (&map, variant, sample_rate, &reference.samples, &reference.frames) == -1)
+        {
+            psg_log_unmap (&map);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (thread_count == 0)
+    {
+        long cores = sysconf (_SC_NPROCESSORS_ONLN);
+        thread_count = (cores > 0) ? cores : 1;
+    }
+    if (thread_count > job_count)
+    {
+        thread_count = job_count;
+    }
+    if (thread_count > THREADS_MAX)
+    {
+        thread_count = THREADS_MAX;
+    }
+
+    /* Each job holds its whole render while it is written out and compared:
+     * 16-bit stereo, and with a capture a mono float copy too. At 44.1 kHz
+     * that is 635 MB per hour of log, or twice that with a capture, so the
+     * threads are limited to as many renders as fit in half of the memory,
+     * less what the reference already holds. */
+    uint64_t job_bytes = (render_frames (&map, sample_rate) + sample_rate) * ((capture != NULL) ? 8 : 4);
+    uint64_t reference_bytes = reference.frames * (reference.channels * sizeof (int16_t) + ((capture != NULL) ? sizeof (float) : 0));
+    long pages = sysconf (_SC_PHYS_PAGES);
+    long page_size = sysconf (_SC_PAGESIZE);
+    if (pages > 0 && page_size > 0)
+    {
+        uint64_t memory = (uint64_t) pages * page_size / 2;
+        uint64_t fit = (memory > reference_bytes) ? (memory - reference_bytes) / job_bytes : 0;
+        if (fit < thread_count)
+        {
+            thread_count = (fit > 0) ? fit : 1;
+            fprintf (stderr, "Note: Using %u thread%s, as each render needs %.0f MB.\n", thread_count,
+                     (thread_count == 1) ? "" : "s", job_bytes / 1e6);
+        }
+    }
+
+    context_t context = {
+        .log = &map,
+        .output_dir = output_dir,
+        .sample_rate = sample_rate,
+        .reference = &reference,
+        .capture = capture,
+        .jobs = jobs,
+        .job_count = job_count,
+        .next_job = 0
+    };
+    pthread_mutex_init (&context.mutex, NULL);
+
+    /* The main thread works too, alongside the others */
+    pthread_t threads [THREADS_MAX];
+    uint32_t threads_started = 0;
+    for (uint32_t i = 1; i < thread_count; i++)
+    {
+        if (pthread_create (&threads [threads_started], NULL, worker, &context) != 0)
+        {
+            break;
+        }
+        threads_started++;
+    }
+
+    worker (&context);
+
+    for (uint32_t i = 0; i < threads_started; i++)
+    {
+        pthread_join (threads [i], NULL);
+    }
+    pthread_mutex_destroy (&context.mutex);
+
+    report_print (jobs, job_count, reference_name, &reference, capture != NULL);
+
+    int result = EXIT_SUCCESS;
+    for (uint32_t i = 0; i < job_count; i++)
+    {
+        if (jobs [i].failed)
+        {
+            result = EXIT_FAILURE;
+        }
+    }
+
+    free (capture);
+    wav_free (&reference);
+    psg_log_unmap (&map);
+
+    return result;
+}
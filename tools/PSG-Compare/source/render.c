@@ -0,0 +1,214 @@
+/*
+ * PSG-Compare
+ * Rendering a PSG log with a model of one variant of the chip.
+ *
+ * JoppyFurr 2024
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../PSG-Log/source/psg_log.h"
+#include "../../SN76489-Model/source/sn76489.h"
+#include "render.h"
+
+/* Largest number of clocks run in one call to sn76489_run */
+#define RUN_CLOCKS_MAX      65536
+
+const variant_t variants [] = {
+    { "gg",                 "Sega VDP, Game Gear stereo",           SN76489_VARIANT_SEGA, 16, 0x0009, true },
+    { "sms",                "Sega VDP, mono",                       SN76489_VARIANT_SEGA, 16, 0x0009, false },
+    { "sms-lfsr15",         "Sega VDP, 15-bit LFSR",                SN76489_VARIANT_SEGA, 15, 0x0003, false },
+    { "sms-taps-0003",      "Sega VDP, 16-bit LFSR tapped 0x0003",  SN76489_VARIANT_SEGA, 16, 0x0003, false },
+    { "sn76489",            "Discrete SN76489",                     SN76489_VARIANT_TI,   15, 0x0003, false },
+    { "sn76489-lfsr16",     "SN76489, 16-bit LFSR",                 SN76489_VARIANT_TI,   16, 0x0009, false },
+    { "sn76489-taps-0009",  "SN76489, 15-bit LFSR tapped 0x0009",   SN76489_VARIANT_TI,   15, 0x0009, false },
+    { "sn76489a",           "Discrete SN76489A",                    SN76489_VARIANT_TI_A, 17, 0x000c, false },
+};
+
+const uint32_t variant_count = sizeof (variants) / sizeof (variants [0]);
+
+_Static_assert (sizeof (variants) / sizeof (variants [0]) <= VARIANTS_MAX, "VARIANTS_MAX is too small");
+
+
+/*
+ * Find a variant by name. Returns NULL if there is no such variant.
+ */
+const variant_t *variant_find (const char *name)
+{
+    for (uint32_t i = 0; i < variant_count; i++)
+    {
+        if (strcmp (name, variants [i].name) == 0)
+        {
+            return &variants [i];
+        }
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Convert a time in ticks to PSG clocks, without overflow for long logs.
+ */
+static uint64_t ticks_to_clocks (uint64_t ticks, const psg_log_info_t *info)
+{
+    return (ticks / info->tick_rate) * info->psg_clock + (ticks % info->tick_rate) * info->psg_clock / info->tick_rate;
+}
+
+
+/*
+ * The number of frames that rendering a log produces, give or take a few, for
+ * sizing buffers before rendering. Returns 0 if the log cannot be read.
+ */
+uint64_t render_frames (const psg_log_map_t *log, uint32_t sample_rate)
+{
+    psg_log_reader_t reader;
+    psg_log_event_t event;
+    psg_log_info_t info;
+
+    if (psg_log_reader_init (&reader, &info, log->data, log->size) == -1)
+    {
+        return 0;
+    }
+
+    while (psg_log_read (&reader, &event) == 1)
+    {
+    }
+
+    return (reader.time / info.tick_rate) * sample_rate + (reader.time % info.tick_rate) * sample_rate / info.tick_rate;
+}
+
+
+/*
+ * Run the model up to a point in time, growing the sample buffer as needed.
+ * Returns -1 on error.
+ */
+static int render_run (sn76489_t *psg, uint64_t *clock, uint64_t until,
+                       int16_t **samples, uint64_t *frames, uint64_t *capacity)
+{
+    while (*clock < until)
+    {
+        uint32_t clocks = (until - *clock > RUN_CLOCKS_MAX) ? RUN_CLOCKS_MAX : until - *clock;
+        uint32_t frames_max = sn76489_frames_max (psg, clocks);
+
+        if (*frames + frames_max > *capacity)
+        {
+            uint64_t new_capacity = (*capacity == 0) ? 65536 : *capacity * 2;
+            while (*frames + frames_max > new_capacity)
+            {
+                new_capacity *= 2;
+            }
+
+            int16_t *new_samples = realloc (*samples, new_capacity * 2 * sizeof (int16_t));
+            if (new_samples == NULL)
+            {
+                return -1;
+            }
+            *samples = new_samples;
+            *capacity = new_capacity;
+        }
+
+        *frames += sn76489_run (psg, clocks, &(*samples) [*frames * 2]);
+        *clock += clocks;
+    }
+
+    return 0;
+}
+
+
+/*
+ * Render a log to interleaved stereo samples, which the caller must free.
+ * Returns -1 on error.
+ */
+int render_log (const psg_log_map_t *log, const variant_t *variant, uint32_t sample_rate,
+                int16_t **samples, uint64_t *frames)
+{
+    psg_log_reader_t reader;
+    psg_log_event_t event;
+    psg_log_info_t info;
+    uint64_t capacity = 0;
+    uint64_t clock = 0;
+    int result;
+
+    *samples = NULL;
+    *frames = 0;
+
+    /* Sized up front with a second to spare, so that the buffer is not grown
+     * by doubling, which would hold up to twice the render in memory */
+    capacity = render_frames (log, sample_rate) + sample_rate;
+    *samples = malloc (capacity * 2 * sizeof (int16_t));
+    if (*samples == NULL)
+    {
+        fprintf (stderr, "Error: Failed to allocate memory for samples.\n");
+        return -1;
+    }
+
+    if (psg_log_reader_init (&reader, &info, log->data, log->size) == -1)
+    {
+        fprintf (stderr, "Error: Input is not a PSG log.\n");
+        free (*samples);
+        *samples = NULL;
+        return -1;
+    }
+
+    sn76489_t *psg = malloc (sizeof (sn76489_t));
+    if (psg == NULL)
+    {
+        fprintf (stderr, "Error: Failed to allocate memory for the model.\n");
+        free (*samples);
+        *samples = NULL;
+        return -1;
+    }
+
+    sn76489_init (psg, variant->chip, info.psg_clock, sample_rate);
+    sn76489_set_lfsr (psg, variant->lfsr_width, variant->lfsr_taps);
+
+    while ((result = psg_log_read (&reader, &event)) == 1)
+    {
+        if (render_run (psg, &clock, ticks_to_clocks (event.time, &info), samples, frames, &capacity) == -1)
+        {
+            result = -2;
+            break;
+        }
+
+        if (event.port == PSG_LOG_PORT_PSG)
+        {
+            sn76489_write (psg, event.data);
+        }
+        else if (event.port == PSG_LOG_PORT_STEREO && variant->stereo)
+        {
+            sn76489_write_stereo (psg, event.data);
+        }
+    }
+
+    if (result == 0 && render_run (psg, &clock, ticks_to_clocks (reader.time, &info), samples, frames, &capacity) == -1)
+    {
+        result = -2;
+    }
+
+    free (psg);
+
+    if (result == -1)
+    {
+        fprintf (stderr, "Error: Log is corrupt at offset %zu.\n", reader.offset);
+    }
+    else if (result == -2)
+    {
+        fprintf (stderr, "Error: Failed to allocate memory for samples.\n");
+    }
+
+    if (result != 0)
+    {
+        free (*samples);
+        *samples = NULL;
+        *frames = 0;
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,30 @@
+/*
+ * PSG-Compare
+ * Rendering a PSG log with a model of one variant of the chip.
+ *
+ * JoppyFurr 2024
+ */
+
+typedef struct variant_s {
+    const char *name;
+    const char *description;
+    sn76489_variant_t chip;
+    uint8_t lfsr_width;
+    uint32_t lfsr_taps;
+    bool stereo;            /* If false, writes to the Game Gear stereo port are ignored */
+} variant_t;
+
+/* Every known variant */
+#define VARIANTS_MAX    8
+extern const variant_t variants [];
+extern const uint32_t variant_count;
+
+/* Find a variant by name. Returns NULL if there is no such variant. */
+const variant_t *variant_find (const char *name);
+
+/* The number of frames that rendering a log produces, give or take a few. Returns 0 if the log cannot be read. */
+uint64_t render_frames (const psg_log_map_t *log, uint32_t sample_rate);
+
+/* Render a log to interleaved stereo samples, which the caller must free. Returns -1 on error. */
+int render_log (const psg_log_map_t *log, const variant_t *variant, uint32_t sample_rate,
+                int16_t **samples, uint64_t *frames);
@@ -0,0 +1,292 @@
+/*
+ * PSG-Compare
+ * Reading and writing 16-bit PCM wave files.
+ *
+ * JoppyFurr 2024
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "wav.h"
+
+#define WAV_HEADER_SIZE     44
+
+/* The data chunk's size field is 32 bits */
+#define WAV_DATA_MAX        0xffffffd0
+
+
+/*
+ * Read a little-endian value of up to four bytes.
+ */
+static uint32_t read_le (const uint8_t *bytes, uint32_t count)
+{
+    uint32_t value = 0;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        value |= (uint32_t) bytes [i] << (i * 8);
+    }
+
+    return value;
+}
+
+
+/*
+ * Write a little-endian value of up to four bytes.
+ */
+static void write_le (uint8_t *bytes, uint32_t value, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        bytes [i] = value >> (i * 8);
+    }
+}
+
+
+/*
+ * Open a 16-bit PCM wave file, with one or two channels, for reading.
+ * The file is left positioned at the start of the samples.
+ * Returns -1 on error.
+ */
+int wav_open (wav_stream_t *stream, const char *filename)
+{
+    uint8_t riff [12];
+    uint8_t chunk [8];
+    bool found_format = false;
+
+    memset (stream, 0, sizeof (wav_stream_t));
+
+    FILE *file = fopen (filename, "rb");
+    if (file == NULL)
+    {
+        fprintf (stderr, "Failed to open wave file '%s'.\n", filename);
+        return -1;
+    }
+
+    if (fread (riff, 1, 12, file) != 12 || memcmp (riff, "RIFF", 4) != 0 || memcmp (&riff [8], "WAVE", 4) != 0)
+    {
+        fprintf (stderr, "Error: '%s' is not a wave file.\n", filename);
+        fclose (file);
+        return -1;
+    }
+
+    while (fread (chunk, 1, 8, file) == 8)
+    {
+        uint32_t chunk_size = read_le (&chunk [4], 4);
+
+        if (memcmp (chunk, "fmt ", 4) == 0)
+        {
+            uint8_t format [40] = { 0 };
+            uint32_t format_length = (chunk_size < 40) ? chunk_size : 40;
+
+            if (chunk_size < 16 || fread (format, 1, format_length, file) != format_length)
+            {
+                break;
+            }
+
+            uint32_t format_type = read_le (&format [0], 2);
+            uint32_t bits_per_sample = read_le (&format [14], 2);
+            stream->channels = read_le (&format [2], 2);
+            stream->sample_rate = read_le (&format [4], 4);
+
+            /* WAVE_FORMAT_EXTENSIBLE keeps the real format in its sub-format GUID */
+            if (format_type == 0xfffe && chunk_size >= 40)
+            {
+                format_type = read_le (&format [24], 2);
+            }
+
+            if (format_type != 1 || bits_per_sample != 16 || stream->channels < 1 || stream->channels > 2 || stream->sample_rate == 0)
+            {
+                fprintf (stderr, "Error: '%s' is not 16-bit PCM with one or two channels.\n", filename);
+                fclose (file);
+                return -1;
+            }
+
+            found_format = true;
+            if (chunk_size > 40)
+            {
+                fseek (file, chunk_size - 40, SEEK_CUR);
+            }
+        }
+        else if (memcmp (chunk, "data", 4) == 0)
+        {
+            if (found_format)
+            {
+                stream->file = file;
+                stream->frames = chunk_size / (stream->channels * sizeof (int16_t));
+                return 0;
+            }
+            break;
+        }
+        else
+        {
+            fseek (file, chunk_size, SEEK_CUR);
+        }
+
+        /* Chunks are padded to an even length */
+        if (chunk_size & 1)
+        {
+            fseek (file, 1, SEEK_CUR);
+        }
+    }
+
+    fclose (file);
+    fprintf (stderr, "Error: No sample data found in '%s'.\n", filename);
+
+    return -1;
+}
+
+
+/*
+ * Read up to the given number of frames, as interleaved samples.
+ * Returns the number of frames read, which is zero at the end of the file.
+ * Files cut short are read up to the last whole frame.
+ */
+uint64_t wav_read_frames (wav_stream_t *stream, int16_t *samples, uint64_t frames)
+{
+    uint32_t frame_size = stream->channels * sizeof (int16_t);
+    uint8_t *bytes = (uint8_t *) samples;
+
+    if (frames > stream->frames)
+    {
+        frames = stream->frames;
+    }
+
+    size_t bytes_read = fread (bytes, 1, frames * frame_size, stream->file);
+
+    /* A short read means the file was cut short, so there is nothing more to read */
+    stream->frames = (bytes_read < frames * frame_size) ? 0 : stream->frames - frames;
+    frames = bytes_read / frame_size;
+
+    /* Samples are converted in place, which is safe as each keeps its own two bytes */
+    for (uint64_t i = 0; i < frames * stream->channels; i++)
+    {
+        samples [i] = (int16_t) read_le (&bytes [i * 2], 2);
+    }
+
+    return frames;
+}
+
+
+/*
+ * Close a wave file opened for reading.
+ */
+void wav_close (wav_stream_t *stream)
+{
+    if (stream->file != NULL)
+    {
+        fclose (stream->file);
+    }
+    stream->file = NULL;
+    stream->frames = 0;
+}
+
+
+/*
+ * Read a 16-bit PCM wave file, with one or two channels.
+ * Returns -1 on error.
+ */
+int wav_read (wav_t *wav, const char *filename)
+{
+    wav_stream_t stream;
+
+    memset (wav, 0, sizeof (wav_t));
+
+    if (wav_open (&stream, filename) == -1)
+    {
+        return -1;
+    }
+
+    wav->channels = stream.channels;
+    wav->sample_rate = stream.sample_rate;
+    wav->samples = malloc (stream.frames * stream.channels * sizeof (int16_t) + 1);
+    if (wav->samples == NULL)
+    {
+        fprintf (stderr, "Error: Failed to allocate memory for samples.\n");
+        wav_close (&stream);
+        return -1;
+    }
+
+    wav->frames = wav_read_frames (&stream, wav->samples, stream.frames);
+    wav_close (&stream);
+
+    return 0;
+}
+
+
+/*
+ * Write a 16-bit PCM wave file.
+ * Returns -1 on error.
+ */
+int wav_write (const wav_t *wav, const char *filename)
+{
+    uint8_t header [WAV_HEADER_SIZE];
+    uint8_t buffer [8192];
+    uint64_t data_size = wav->frames * wav->channels * sizeof (int16_t);
+
+    if (data_size > WAV_DATA_MAX)
+    {
+        fprintf (stderr, "Error: Too many samples for wave file '%s'.\n", filename);
+        return -1;
+    }
+
+    FILE *file = fopen (filename, "wb");
+    if (file == NULL)
+    {
+        fprintf (stderr, "Failed to open wave file '%s'.\n", filename);
+        return -1;
+    }
+
+    memcpy (&header [0], "RIFF", 4);
+    write_le (&header [4], WAV_HEADER_SIZE - 8 + data_size, 4);
+    memcpy (&header [8], "WAVE", 4);
+    memcpy (&header [12], "fmt ", 4);
+    write_le (&header [16], 16, 4);
+    write_le (&header [20], 1, 2);
+    write_le (&header [22], wav->channels, 2);
+    write_le (&header [24], wav->sample_rate, 4);
+    write_le (&header [28], wav->sample_rate * wav->channels * sizeof (int16_t), 4);
+    write_le (&header [32], wav->channels * sizeof (int16_t), 2);
+    write_le (&header [34], 16, 2);
+    memcpy (&header [36], "data", 4);
+    write_le (&header [40], data_size, 4);
+    fwrite (header, 1, WAV_HEADER_SIZE, file);
+
+    /* Samples are converted to little-endian through a small buffer */
+    uint64_t count = wav->frames * wav->channels;
+    for (uint64_t i = 0; i < count; )
+    {
+        uint32_t used = 0;
+
+        while (i < count && used < sizeof (buffer))
+        {
+            write_le (&buffer [used], (uint16_t) wav->samples [i++], 2);
+            used += 2;
+        }
+
+        fwrite (buffer, 1, used, file);
+    }
+
+    if (fclose (file) != 0)
+    {
+        fprintf (stderr, "Failed to write wave file '%s'.\n", filename);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/*
+ * Free the wave's samples.
+ */
+void wav_free (wav_t *wav)
+{
+    free (wav->samples);
+    wav->samples = NULL;
+    wav->frames = 0;
+}
@@ -0,0 +1,39 @@
+/*
+ * PSG-Compare
+ * Reading and writing 16-bit PCM wave files.
+ *
+ * JoppyFurr 2024
+ */
+
+typedef struct wav_s {
+    int16_t *samples;       /* Interleaved */
+    uint32_t channels;
+    uint32_t sample_rate;
+    uint64_t frames;
+} wav_t;
+
+/* A wave file opened for reading a block at a time. */
+typedef struct wav_stream_s {
+    FILE *file;
+    uint32_t channels;
+    uint32_t sample_rate;
+    uint64_t frames;        /* Frames left to read */
+} wav_stream_t;
+
+/* Open a 16-bit PCM wave file, with one or two channels, for reading. Returns -1 on error. */
+int wav_open (wav_stream_t *stream, const char *filename);
+
+/* Read up to the given number of frames, as interleaved samples. Returns the number of frames read. */
+uint64_t wav_read_frames (wav_stream_t *stream, int16_t *samples, uint64_t frames);
+
+/* Close a wave file opened for reading. */
+void wav_close (wav_stream_t *stream);
+
+/* Read a 16-bit PCM wave file, with one or two channels. Returns -1 on error. */
+int wav_read (wav_t *wav, const char *filename);
+
+/* Write a 16-bit PCM wave file. Returns -1 on error. */
+int wav_write (const wav_t *wav, const char *filename);
+
+/* Free the wave's samples. */
+void wav_free (wav_t *wav);
@@ -0,0 +1,7 @@
+#!/bin/sh
+
+CC=gcc
+CFLAGS="-std=c11 -O2 -Wall -Werror"
+
+
+$CC $CFLAGS source/main.c source/psg_log.c -o psglog
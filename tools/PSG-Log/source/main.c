@@ -0,0 +1,430 @@
+/*
+ * PSG-Log
+ * A tool to inspect PSG write logs, and convert them to and from VGM.
+ *
+ * JoppyFurr 2024
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "psg_log.h"
+
+/* VGM timing is always in samples at 44.1 kHz. */
+#define VGM_SAMPLE_RATE     44100
+#define VGM_HEADER_SIZE     0x40
+#define VGM_VERSION         0x151
+
+/* VGM commands */
+#define VGM_STEREO          0x4f
+#define VGM_PSG             0x50
+#define VGM_WAIT            0x61
+#define VGM_WAIT_NTSC       0x62
+#define VGM_WAIT_PAL        0x63
+#define VGM_END             0x66
+#define VGM_WAIT_SHORT      0x70
+
+#define OUTPUT_BUFFER_SIZE  65536
+
+static uint8_t output_buffer [OUTPUT_BUFFER_SIZE];
+
+
+/*
+ * Read a little-endian 16-bit value.
+ */
+static uint16_t read_u16 (const uint8_t *data)
+{
+    return data [0] | (data [1] << 8);
+}
+
+
+/*
+ * Read a little-endian 32-bit value.
+ */
+static uint32_t read_u32 (const uint8_t *data)
+{
+    return data [0] | (data [1] << 8) | (data [2] << 16) | ((uint32_t) data [3] << 24);
+}
+
+
+/*
+ * Write a little-endian 32-bit value.
+ */
+static void write_u32 (uint8_t *data, uint32_t value)
+{
+    data [0] = value;
+    data [1] = value >> 8;
+    data [2] = value >> 16;
+    data [3] = value >> 24;
+}
+
+
+/*
+ * Check if a filename ends with the given extension.
+ */
+static bool has_extension (const char *filename, const char *extension)
+{
+    size_t filename_length = strlen (filename);
+    size_t extension_length = strlen (extension);
+
+    return filename_length > extension_length &&
+           strcmp (&filename [filename_length - extension_length], extension) == 0;
+}
+
+
+/*
+ * Convert a time in log ticks to VGM samples.
+ * Split to avoid overflow on long logs.
+ */
+static uint64_t ticks_to_samples (uint64_t ticks, uint32_t tick_rate)
+{
+    return (ticks / tick_rate) * VGM_SAMPLE_RATE + (ticks % tick_rate) * VGM_SAMPLE_RATE / tick_rate;
+}
+
+
+/*
+ * Write VGM wait commands to cover a number of samples.
+ */
+static void vgm_wait (FILE *file, uint64_t samples)
+{
+    while (samples > 0)
+    {
+        if (samples == 735)
+        {
+            fputc (VGM_WAIT_NTSC, file);
+            samples = 0;
+        }
+        else if (samples == 882)
+        {
+            fputc (VGM_WAIT_PAL, file);
+            samples = 0;
+        }
+        else if (samples <= 16)
+        {
+            fputc (VGM_WAIT_SHORT | (samples - 1), file);
+            samples = 0;
+        }
+        else
+        {
+            uint16_t chunk = (samples > 0xffff) ? 0xffff : samples;
+            fputc (VGM_WAIT, file);
+            fputc (chunk, file);
+            fputc (chunk >> 8, file);
+            samples -= chunk;
+        }
+    }
+}
+
+
+/*
+ * Print the writes in a log, one per line.
+ */
+static int log_dump (const psg_log_map_t *map)
+{
+    psg_log_reader_t reader;
+    psg_log_info_t info;
+    psg_log_event_t event;
+    int result;
+
+    if (psg_log_reader_init (&reader, &info, map->data, map->size) == -1)
+    {
+        fprintf (stderr, "Error: Input is not a PSG log.\n");
+        return -1;
+    }
+
+    printf ("PSG clock %u Hz, LFSR width %u, feedback 0x%04x, flags 0x%02x\n",
+            info.psg_clock, info.lfsr_width, info.lfsr_feedback, info.psg_flags);
+    printf ("Tick rate %u Hz, %u ticks per frame\n", info.tick_rate, info.frame_ticks);
+
+    while ((result = psg_log_read (&reader, &event)) == 1)
+    {
+        if (info.frame_ticks != 0)
+        {
+            printf ("%6llu:%-6llu  ", (unsigned long long) (event.time / info.frame_ticks),
+                                      (unsigned long long) (event.time % info.frame_ticks));
+        }
+        else
+        {
+            printf ("%12llu  ", (unsigned long long) event.time);
+        }
+        printf ("%s 0x%02x\n", (event.port == PSG_LOG_PORT_PSG) ? "psg   " : "stereo", event.data);
+    }
+
+    if (result == -1)
+    {
+        fprintf (stderr, "Error: Log is corrupt at offset %zu.\n", reader.offset);
+        return -1;
+    }
+
+    printf ("End at tick %llu\n", (unsigned long long) reader.time);
+
+    return 0;
+}
+
+
+/*
+ * Convert a log to VGM.
+ */
+static int log_to_vgm (const psg_log_map_t *map, FILE *file)
+{
+    psg_log_reader_t reader;
+    psg_log_info_t info;
+    psg_log_event_t event;
+    uint64_t sample = 0;
+    int result;
+
+    if (psg_log_reader_init (&reader, &info, map->data, map->size) == -1)
+    {
+        fprintf (stderr, "Error: Input is not a PSG log.\n");
+        return -1;
+    }
+
+    /* The header is filled in once the length is known */
+    fseek (file, VGM_HEADER_SIZE, SEEK_SET);
+
+    while ((result = psg_log_read (&reader, &event)) == 1)
+    {
+        uint64_t event_sample = ticks_to_samples (event.time, info.tick_rate);
+        vgm_wait (file, event_sample - sample);
+        sample = event_sample;
+
+        fputc ((event.port == PSG_LOG_PORT_PSG) ? VGM_PSG : VGM_STEREO, file);
+        fputc (event.data, file);
+    }
+
+    if (result == -1)
+    {
+        fprintf (stderr, "Error: Log is corrupt at offset %zu.\n", reader.offset);
+        return -1;
+    }
+
+    uint64_t end_sample = ticks_to_samples (reader.time, info.tick_rate);
+    vgm_wait (file, end_sample - sample);
+    fputc (VGM_END, file);
+
+    if (end_sample > UINT32_MAX)
+    {
+        fprintf (stderr, "Error: Log is too long for VGM.\n");
+        return -1;
+    }
+
+    uint8_t header [VGM_HEADER_SIZE] = { 'V', 'g', 'm', ' ' };
+    write_u32 (&header [0x04], ftell (file) - 0x04);
+    write_u32 (&header [0x08], VGM_VERSION);
+    write_u32 (&header [0x0c], info.psg_clock);
+    write_u32 (&header [0x18], end_sample);
+    if (info.frame_ticks != 0)
+    {
+        write_u32 (&header [0x24], (info.tick_rate + info.frame_ticks / 2) / info.frame_ticks);
+    }
+    header [0x28] = info.lfsr_feedback;
+    header [0x29] = info.lfsr_feedback >> 8;
+    header [0x2a] = info.lfsr_width;
+    header [0x2b] = info.psg_flags;
+    write_u32 (&header [0x34], VGM_HEADER_SIZE - 0x34);
+
+    fseek (file, 0, SEEK_SET);
+    fwrite (header, 1, VGM_HEADER_SIZE, file);
+
+    return 0;
+}
+
+
+/*
+ * Convert a VGM to a log.
+ * The log uses VGM's 44.1 kHz sample timing, so converting back gives the same writes at the same times.
+ */
+static int vgm_to_log (const psg_log_map_t *map, FILE *file)
+{
+    const uint8_t *vgm = map->data;
+    psg_log_writer_t writer;
+    psg_log_info_t info;
+    uint64_t sample = 0;
+
+    if (map->size < VGM_HEADER_SIZE || memcmp (vgm, "Vgm ", 4) != 0)
+    {
+        fprintf (stderr, "Error: Input is not a VGM file. Compressed VGZ files should be unpacked first.\n");
+        return -1;
+    }
+
+    uint32_t version = read_u32 (&vgm [0x08]);
+    uint32_t psg_clock = read_u32 (&vgm [0x0c]);
+    uint32_t rate = read_u32 (&vgm [0x24]);
+    size_t offset = 0x40;
+
+    if (psg_clock == 0)
+    {
+        fprintf (stderr, "Error: VGM file does not use the SN76489.\n");
+        return -1;
+    }
+    if (psg_clock & 0xc0000000)
+    {
+        fprintf (stderr, "Error: Dual-chip and T6W28 VGM files are not supported.\n");
+        return -1;
+    }
+
+    /* Fields added in later versions of the format */
+    psg_log_info_sega (&info, psg_clock, VGM_SAMPLE_RATE, 0);
+    if (version >= 0x110)
+    {
+        info.lfsr_feedback = read_u16 (&vgm [0x28]);
+        info.lfsr_width = vgm [0x2a];
+    }
+    if (version >= 0x150 && read_u32 (&vgm [0x34]) != 0)
+    {
+        offset = 0x34 + read_u32 (&vgm [0x34]);
+    }
+    if (version >= 0x151 && offset > 0x2b)
+    {
+        info.psg_flags = vgm [0x2b];
+    }
+    if (rate != 0 && VGM_SAMPLE_RATE % rate == 0)
+    {
+        info.frame_ticks = VGM_SAMPLE_RATE / rate;
+    }
+    if (read_u32 (&vgm [0x1c]) != 0)
+    {
+        fprintf (stderr, "Warning: VGM loop point is not kept in the log.\n");
+    }
+
+    if (psg_log_writer_init (&writer, &info, output_buffer, OUTPUT_BUFFER_SIZE, file) == -1)
+    {
+        fprintf (stderr, "Error: Failed to start log.\n");
+        return -1;
+    }
+
+    while (true)
+    {
+        if (offset >= map->size)
+        {
+            fprintf (stderr, "Error: VGM data ends without an end command.\n");
+            return -1;
+        }
+
+        uint8_t command = vgm [offset];
+        size_t length = (command == VGM_STEREO || command == VGM_PSG) ? 2 : (command == VGM_WAIT) ? 3 : 1;
+        int result = 0;
+
+        if (map->size - offset < length)
+        {
+            fprintf (stderr, "Error: VGM data ends part-way through a command.\n");
+            return -1;
+        }
+
+        if (command == VGM_STEREO)
+        {
+            result = psg_log_write (&writer, sample, PSG_LOG_PORT_STEREO, vgm [offset + 1]);
+        }
+        else if (command == VGM_PSG)
+        {
+            result = psg_log_write (&writer, sample, PSG_LOG_PORT_PSG, vgm [offset + 1]);
+        }
+        else if (command == VGM_WAIT)
+        {
+            sample += read_u16 (&vgm [offset + 1]);
+        }
+        else if (command == VGM_WAIT_NTSC)
+        {
+            sample += 735;
+        }
+        else if (command == VGM_WAIT_PAL)
+        {
+            sample += 882;
+        }
+        else if ((command & 0xf0) == VGM_WAIT_SHORT)
+        {
+            sample += (command & 0x0f) + 1;
+        }
+        else if (command == VGM_END)
+        {
+            break;
+        }
+        else
+        {
+            fprintf (stderr, "Error: Unsupported VGM command 0x%02x at offset 0x%zx.\n", command, offset);
+            return -1;
+        }
+
+        if (result == -1)
+        {
+            fprintf (stderr, "Error: Failed to write log.\n");
+            return -1;
+        }
+
+        offset += length;
+    }
+
+    if (psg_log_writer_end (&writer, sample) == -1)
+    {
+        fprintf (stderr, "Error: Failed to write log.\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+
+int main (int argc, char **argv)
+{
+    psg_log_map_t map;
+    int result;
+
+    if (argc != 2 && argc != 3)
+    {
+        fprintf (stderr, "Usage: %s <input-file.psgl> [output-file.vgm]\n", argv [0]);
+        fprintf (stderr, "       %s <input-file.vgm> <output-file.psgl>\n", argv [0]);
+        return EXIT_FAILURE;
+    }
+
+    const char *input_filename = argv [1];
+    const char *output_filename = (argc == 3) ? argv [2] : NULL;
+    bool input_vgm = has_extension (input_filename, ".vgm");
+
+    if (output_filename == NULL && input_vgm)
+    {
+        fprintf (stderr, "Error: An output file is needed for VGM input.\n");
+        return EXIT_FAILURE;
+    }
+    if (output_filename != NULL && !has_extension (output_filename, input_vgm ? ".psgl" : ".vgm"))
+    {
+        fprintf (stderr, "Output file must have '%s' extension.\n", input_vgm ? ".psgl" : ".vgm");
+        return EXIT_FAILURE;
+    }
+
+    if (psg_log_map (&map, input_filename) == -1)
+    {
+        fprintf (stderr, "Failed to open input file '%s'.\n", input_filename);
+        return EXIT_FAILURE;
+    }
+
+    if (output_filename == NULL)
+    {
+        result = log_dump (&map);
+    }
+    else
+    {
+        FILE *output_file = fopen (output_filename, "wb");
+        if (output_file == NULL)
+        {
+            fprintf (stderr, "Failed to open output file '%s'.\n", output_filename);
+            psg_log_unmap (&map);
+            return EXIT_FAILURE;
+        }
+
+        result = input_vgm ? vgm_to_log (&map, output_file) : log_to_vgm (&map, output_file);
+
+        if (fclose (output_file) != 0)
+        {
+            fprintf (stderr, "Failed to write output file '%s'.\n", output_filename);
+            result = -1;
+        }
+    }
+
+    psg_log_unmap (&map);
+
+    return (result == -1) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,349 @@
+/*
+ * PSG-Log
+ * A compact log of writes to the SN76489 and Game Gear stereo ports.
+ *
+ * JoppyFurr 2024
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "psg_log.h"
+
+#define PSG_LOG_VERSION 1
+
+
+/*
+ * Read a little-endian 16-bit value.
+ */
+static uint16_t read_u16 (const uint8_t *data)
+{
+    return data [0] | (data [1] << 8);
+}
+
+
+/*
+ * Read a little-endian 32-bit value.
+ */
+static uint32_t read_u32 (const uint8_t *data)
+{
+    return data [0] | (data [1] << 8) | (data [2] << 16) | ((uint32_t) data [3] << 24);
+}
+
+
+/*
+ * Write a little-endian 16-bit value.
+ */
+static void write_u16 (uint8_t *data, uint16_t value)
+{
+    data [0] = value;
+    data [1] = value >> 8;
+}
+
+
+/*
+ * Write a little-endian 32-bit value.
+ */
+static void write_u32 (uint8_t *data, uint32_t value)
+{
+    data [0] = value;
+    data [1] = value >> 8;
+    data [2] = value >> 16;
+    data [3] = value >> 24;
+}
+
+
+/*
+ * Default values for the Sega VDP's PSG.
+ */
+void psg_log_info_sega (psg_log_info_t *info, uint32_t psg_clock, uint32_t tick_rate, uint32_t frame_ticks)
+{
+    info->lfsr_width = 16;
+    info->lfsr_feedback = 0x0009;
+    info->psg_flags = 0x00;
+    info->psg_clock = psg_clock;
+    info->tick_rate = tick_rate;
+    info->frame_ticks = frame_ticks;
+}
+
+
+/*
+ * Check the header and prepare to read the records.
+ * Returns -1 if the data is not a valid log.
+ */
+int psg_log_reader_init (psg_log_reader_t *reader, psg_log_info_t *info, const void *data, size_t size)
+{
+    const uint8_t *header = data;
+
+    if (size < PSG_LOG_HEADER_SIZE || memcmp (header, "PSGL", 4) != 0 || header [4] != PSG_LOG_VERSION)
+    {
+        return -1;
+    }
+
+    info->lfsr_width = header [0x05];
+    info->lfsr_feedback = read_u16 (&header [0x06]);
+    info->psg_flags = header [0x08];
+    info->psg_clock = read_u32 (&header [0x0c]);
+    info->tick_rate = read_u32 (&header [0x10]);
+    info->frame_ticks = read_u32 (&header [0x14]);
+
+    if (info->tick_rate == 0)
+    {
+        return -1;
+    }
+
+    reader->data = header;
+    reader->size = size;
+    reader->offset = PSG_LOG_HEADER_SIZE;
+    reader->time = 0;
+    reader->end = false;
+
+    return 0;
+}
+
+
+/*
+ * Read the next write.
+ * Returns 1 for a write, 0 at the end of the log, or -1 if the log is corrupt.
+ */
+int psg_log_read (psg_log_reader_t *reader, psg_log_event_t *event)
+{
+    const uint8_t *data = reader->data;
+    size_t offset = reader->offset;
+    uint64_t delta = 0;
+
+    if (reader->end || offset == reader->size)
+    {
+        reader->end = true;
+        return 0;
+    }
+
+    /* Most writes are close together, so take a short path for single-byte deltas. */
+    if (data [offset] < 0x80)
+    {
+        delta = data [offset++];
+    }
+    else
+    {
+        for (uint32_t shift = 0; ; shift += 7)
+        {
+            if (offset == reader->size || shift > 63)
+            {
+                return -1;
+            }
+
+            uint8_t byte = data [offset++];
+            delta |= (uint64_t) (byte & 0x7f) << shift;
+
+            if ((byte & 0x80) == 0)
+            {
+                break;
+            }
+        }
+    }
+
+    if (reader->size - offset < 2)
+    {
+        return -1;
+    }
+
+    reader->time += delta;
+    event->time = reader->time;
+    event->port = data [offset];
+    event->data = data [offset + 1];
+    reader->offset = offset + 2;
+
+    switch (event->port)
+    {
+        case PSG_LOG_PORT_PSG:
+        case PSG_LOG_PORT_STEREO:
+            return 1;
+
+        case PSG_LOG_PORT_END:
+            reader->end = true;
+            return 0;
+
+        default:
+            return -1;
+    }
+}
+
+
+/*
+ * Write any buffered records to the file.
+ * Returns -1 on error.
+ */
+int psg_log_writer_flush (psg_log_writer_t *writer)
+{
+    if (writer->file == NULL || writer->used == 0)
+    {
+        return 0;
+    }
+
+    if (fwrite (writer->buffer, 1, writer->used, writer->file) != writer->used)
+    {
+        return -1;
+    }
+    writer->used = 0;
+
+    return 0;
+}
+
+
+/*
+ * Start a new log.
+ * With a NULL file, the log must fit within the buffer.
+ * Returns -1 on error.
+ */
+int psg_log_writer_init (psg_log_writer_t *writer, const psg_log_info_t *info, void *buffer, size_t size, FILE *file)
+{
+    uint8_t *header = buffer;
+
+    if (size < PSG_LOG_HEADER_SIZE + PSG_LOG_RECORD_MAX || info->tick_rate == 0)
+    {
+        return -1;
+    }
+
+    memset (header, 0, PSG_LOG_HEADER_SIZE);
+    memcpy (header, "PSGL", 4);
+    header [0x04] = PSG_LOG_VERSION;
+    header [0x05] = info->lfsr_width;
+    write_u16 (&header [0x06], info->lfsr_feedback);
+    header [0x08] = info->psg_flags;
+    write_u32 (&header [0x0c], info->psg_clock);
+    write_u32 (&header [0x10], info->tick_rate);
+    write_u32 (&header [0x14], info->frame_ticks);
+
+    writer->buffer = buffer;
+    writer->size = size;
+    writer->used = PSG_LOG_HEADER_SIZE;
+    writer->file = file;
+    writer->time = 0;
+
+    return 0;
+}
+
+
+/*
+ * Append a record.
+ */
+static int psg_log_append (psg_log_writer_t *writer, uint64_t time, uint8_t port, uint8_t data)
+{
+    if (time < writer->time)
+    {
+        return -1;
+    }
+
+    if (writer->size - writer->used < PSG_LOG_RECORD_MAX)
+    {
+        if (writer->file == NULL || psg_log_writer_flush (writer) == -1)
+        {
+            return -1;
+        }
+    }
+
+    uint8_t *record = &writer->buffer [writer->used];
+    uint64_t delta = time - writer->time;
+
+    while (delta >= 0x80)
+    {
+        *record++ = 0x80 | (delta & 0x7f);
+        delta >>= 7;
+    }
+    *record++ = delta;
+    *record++ = port;
+    *record++ = data;
+
+    writer->used = record - writer->buffer;
+    writer->time = time;
+
+    return 0;
+}
+
+
+/*
+ * Append a write.
+ * Times must not go backwards.
+ * Returns -1 on error.
+ */
+int psg_log_write (psg_log_writer_t *writer, uint64_t time, uint8_t port, uint8_t data)
+{
+    if (port != PSG_LOG_PORT_PSG && port != PSG_LOG_PORT_STEREO)
+    {
+        return -1;
+    }
+
+    return psg_log_append (writer, time, port, data);
+}
+
+
+/*
+ * Append an end record, and flush the buffer to the file.
+ * Returns -1 on error.
+ */
+int psg_log_writer_end (psg_log_writer_t *writer, uint64_t time)
+{
+    if (psg_log_append (writer, time, PSG_LOG_PORT_END, 0x00) == -1)
+    {
+        return -1;
+    }
+
+    return psg_log_writer_flush (writer);
+}
+
+
+/*
+ * Map a log file into memory, read-only.
+ * Returns -1 on error.
+ */
+int psg_log_map (psg_log_map_t *map, const char *filename)
+{
+    struct stat file_stat;
+    void *data;
+
+    int fd = open (filename, O_RDONLY);
+    if (fd == -1)
+    {
+        return -1;
+    }
+
+    if (fstat (fd, &file_stat) == -1 || file_stat.st_size == 0)
+    {
+        close (fd);
+        return -1;
+    }
+
+    data = mmap (NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+
+    if (data == MAP_FAILED)
+    {
+        return -1;
+    }
+
+    map->data = data;
+    map->size = file_stat.st_size;
+
+    return 0;
+}
+
+
+/*
+ * Release a mapped log file.
+ */
+void psg_log_unmap (psg_log_map_t *map)
+{
+    munmap ((void *) map->data, map->size);
+    map->data = NULL;
+    map->size = 0;
+}
@@ -0,0 +1,100 @@
+/*
+ * PSG-Log
+ * A compact log of writes to the SN76489 and Game Gear stereo ports.
+ *
+ * JoppyFurr 2024
+ */
+
+/*
+ * File layout, with all fields little-endian:
+ *
+ *   0x00  "PSGL"
+ *   0x04  u8   Version (1)
+ *   0x05  u8   LFSR width, as in VGM (16 for Sega, 15 for TI)
+ *   0x06  u16  LFSR feedback pattern, as in VGM (0x0009 for Sega, 0x0003 for TI)
+ *   0x08  u8   SN76489 flags, as in VGM
+ *   0x09       Reserved, three bytes of zero
+ *   0x0c  u32  PSG clock rate, in Hz
+ *   0x10  u32  Tick rate, in ticks per second
+ *   0x14  u32  Ticks per frame, or zero if unknown
+ *   0x18       Records
+ *
+ * Each record is the number of ticks since the previous record as an unsigned
+ * LEB128 varint, followed by a port byte and a data byte. An end record may
+ * follow the last write, to mark the total length of the log.
+ */
+
+#define PSG_LOG_HEADER_SIZE     24
+#define PSG_LOG_RECORD_MAX      12  /* 10-byte varint, port, and data */
+
+/* Port numbers */
+#define PSG_LOG_PORT_PSG        0x40
+#define PSG_LOG_PORT_STEREO     0x06
+#define PSG_LOG_PORT_END        0xff
+
+typedef struct psg_log_info_s {
+    uint8_t lfsr_width;
+    uint16_t lfsr_feedback;
+    uint8_t psg_flags;
+    uint32_t psg_clock;
+    uint32_t tick_rate;
+    uint32_t frame_ticks;
+} psg_log_info_t;
+
+typedef struct psg_log_event_s {
+    uint64_t time;
+    uint8_t port;
+    uint8_t data;
+} psg_log_event_t;
+
+/* Reads records in place, from a buffer or mapped file. */
+typedef struct psg_log_reader_s {
+    const uint8_t *data;
+    size_t size;
+    size_t offset;
+    uint64_t time;
+    bool end;
+} psg_log_reader_t;
+
+/* Appends records to a caller-supplied buffer, which is flushed to the file when full. */
+typedef struct psg_log_writer_s {
+    uint8_t *buffer;
+    size_t size;
+    size_t used;
+    FILE *file;
+    uint64_t time;
+} psg_log_writer_t;
+
+/* A log file mapped into memory. */
+typedef struct psg_log_map_s {
+    const uint8_t *data;
+    size_t size;
+} psg_log_map_t;
+
+/* Default values for the Sega VDP's PSG. */
+void psg_log_info_sega (psg_log_info_t *info, uint32_t psg_clock, uint32_t tick_rate, uint32_t frame_ticks);
+
+/* Check the header and prepare to read the records. Returns -1 if the data is not a valid log. */
+int psg_log_reader_init (psg_log_reader_t *reader, psg_log_info_t *info, const void *data, size_t size);
+
+/* Read the next write. Returns 1 for a write, 0 at the end of the log, or -1 if the log is corrupt.
+ * At the end of the log, reader->time holds the total length. */
+int psg_log_read (psg_log_reader_t *reader, psg_log_event_t *event);
+
+/* Start a new log. With a NULL file, the log must fit within the buffer. Returns -1 on error. */
+int psg_log_writer_init (psg_log_writer_t *writer, const psg_log_info_t *info, void *buffer, size_t size, FILE *file);
+
+/* Append a write. Times must not go backwards. Returns -1 on error. */
+int psg_log_write (psg_log_writer_t *writer, uint64_t time, uint8_t port, uint8_t data);
+
+/* Append an end record, and flush the buffer to the file. Returns -1 on error. */
+int psg_log_writer_end (psg_log_writer_t *writer, uint64_t time);
+
+/* Write any buffered records to the file. Returns -1 on error. */
+int psg_log_writer_flush (psg_log_writer_t *writer);
+
+/* Map a log file into memory, read-only. Returns -1 on error. */
+int psg_log_map (psg_log_map_t *map, const char *filename);
+
+/* Release a mapped log file. */
+void psg_log_unmap (psg_log_map_t *map);
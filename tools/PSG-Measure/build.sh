@@ -0,0 +1,10 @@
+#!/bin/sh
+
+CC=gcc
+CFLAGS="-std=c11 -O2 -Wall -Werror"
+
+common="source/capture.c source/steps.c ../PSG-Compare/source/dsp.c ../PSG-Compare/source/wav.c"
+
+$CC $CFLAGS source/pitch.c $common -lm -o psgpitch
+$CC $CFLAGS source/noise.c $common -lm -o psgnoise
+$CC $CFLAGS source/ladder.c $common -lm -o psgladder
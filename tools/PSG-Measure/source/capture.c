@@ -0,0 +1,119 @@
+/*
+ * PSG-Measure
+ * Streaming a capture through a sliding window of mono samples.
+ *
+ * JoppyFurr 2024
+ *
+ * Captures of a full sweep run to several minutes, so rather than loading the
+ * whole file, it is read a block at a time into a window that only holds as
+ * much as the analysis still needs.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../PSG-Compare/source/dsp.h"
+#include "../../PSG-Compare/source/wav.h"
+#include "capture.h"
+
+/* Frames read from the file at a time */
+#define CAPTURE_BLOCK   65536
+
+
+/*
+ * Open a capture, keeping room for at least the given number of seconds.
+ * Returns -1 on error.
+ */
+int capture_open (capture_t *capture, const char *filename, double history)
+{
+    memset (capture, 0, sizeof (capture_t));
+
+    if (wav_open (&capture->wav, filename) == -1)
+    {
+        return -1;
+    }
+
+    capture->sample_rate = capture->wav.sample_rate;
+    capture->capacity = (uint64_t) (history * capture->sample_rate) + CAPTURE_BLOCK;
+    capture->raw = malloc (CAPTURE_BLOCK * capture->wav.channels * sizeof (int16_t));
+    capture->samples = malloc (capture->capacity * sizeof (float));
+
+    if (capture->raw == NULL || capture->samples == NULL)
+    {
+        fprintf (stderr, "Error: Failed to allocate memory for '%s'.\n", filename);
+        capture_close (capture);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/*
+ * Read until the window reaches the given end, discarding samples before keep.
+ * Returns false if the capture ends first.
+ */
+bool capture_fill (capture_t *capture, uint64_t end, uint64_t keep)
+{
+    while (capture->start + capture->count < end)
+    {
+        /* Make room by discarding samples that are no longer needed */
+        if (capture->capacity - capture->count < CAPTURE_BLOCK && keep > capture->start)
+        {
+            uint64_t discard = keep - capture->start;
+            if (discard > capture->count)
+            {
+                discard = capture->count;
+            }
+
+            memmove (capture->samples, &capture->samples [discard], (capture->count - discard) * sizeof (float));
+            capture->start += discard;
+            capture->count -= discard;
+        }
+
+        uint64_t space = capture->capacity - capture->count;
+        if (space == 0)
+        {
+            fprintf (stderr, "Error: Capture window is too small.\n");
+            return false;
+        }
+
+        uint64_t frames = wav_read_frames (&capture->wav, capture->raw, (space < CAPTURE_BLOCK) ? space : CAPTURE_BLOCK);
+        if (frames == 0)
+        {
+            return false;
+        }
+
+        dsp_downmix (capture->raw, capture->wav.channels, frames, &capture->samples [capture->count]);
+        capture->count += frames;
+    }
+
+    return true;
+}
+
+
+/*
+ * Get a pointer to the sample at a position in the capture, which must be within the window.
+ */
+const float *capture_at (const capture_t *capture, uint64_t position)
+{
+    return &capture->samples [position - capture->start];
+}
+
+
+/*
+ * Close the capture and free its window.
+ */
+void capture_close (capture_t *capture)
+{
+    wav_close (&capture->wav);
+    free (capture->raw);
+    free (capture->samples);
+
+    capture->raw = NULL;
+    capture->samples = NULL;
+    capture->count = 0;
+}
@@ -0,0 +1,29 @@
+/*
+ * PSG-Measure
+ * Streaming a capture through a sliding window of mono samples.
+ *
+ * JoppyFurr 2024
+ */
+
+/* A window onto a capture, which is read from the file as it is needed. */
+typedef struct capture_s {
+    wav_stream_t wav;
+    uint32_t sample_rate;
+    int16_t *raw;
+    float *samples;         /* Mono, with full scale at 1.0 */
+    uint64_t start;         /* Position in the capture of samples [0] */
+    uint64_t count;
+    uint64_t capacity;
+} capture_t;
+
+/* Open a capture, keeping room for at least the given number of seconds. Returns -1 on error. */
+int capture_open (capture_t *capture, const char *filename, double history);
+
+/* Read until the window reaches the given end, discarding samples before keep. Returns false if the capture ends first. */
+bool capture_fill (capture_t *capture, uint64_t end, uint64_t keep);
+
+/* Get a pointer to the sample at a position in the capture, which must be within the window. */
+const float *capture_at (const capture_t *capture, uint64_t position);
+
+/* Close the capture and free its window. */
+void capture_close (capture_t *capture);
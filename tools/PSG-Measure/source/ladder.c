@@ -0,0 +1,346 @@
+/*
+ * PSG-Measure
+ * A tool to measure the attenuation curve of each tone channel, from
+ * captures of the test ROM's ladder mode.
+ *
+ * JoppyFurr 2024
+ *
+ * The level of each step is the RMS of its samples, with their mean removed.
+ * Levels are given relative to the channel at attenuation 0, and a line is
+ * fitted through them by least squares to find the size of each step, which
+ * the SN76489 documents as 2 dB. Steps too close to the capture's noise floor
+ * are left out of the fit.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../PSG-Compare/source/dsp.h"
+#include "steps.h"
+
+/* The ladder's schedule, from source/sweep.h in the test ROM */
+#define LADDER_PREAMBLE_FRAMES  120
+#define LADDER_HOLD_FRAMES      15
+#define LADDER_MARKER_FRAMES    5
+#define LADDER_CHANNELS         3
+#define LADDER_LEVELS           16
+#define LADDER_STEPS            (LADDER_CHANNELS * LADDER_LEVELS)
+
+/* Attenuation of each step, as documented */
+#define NOMINAL_STEP_DB         -2.0
+
+/* Steps within this much of the channel's level when off are left out of the fit */
+#define FLOOR_MARGIN_DB         10.0
+
+/* Most captures that can be compared at once */
+#define CONSOLES_MAX            8
+
+
+/* Measurements from one capture */
+typedef struct console_s {
+    const char *name;
+    const char *filename;
+    steps_result_t result;
+    bool found [LADDER_STEPS];
+    double level [LADDER_STEPS];        /* dBFS */
+} console_t;
+
+/* Fit of one channel's levels against attenuation */
+typedef struct fit_s {
+    uint32_t points;
+    double step;                /* dB per step of attenuation */
+    double rms_error;           /* RMS difference between the levels and the fitted line */
+    double largest_error;       /* Largest difference from the nominal ladder */
+    uint32_t largest_at;
+    double off;                 /* Level at attenuation 15, relative to attenuation 0 */
+    double full;                /* Level at attenuation 0, dBFS */
+} fit_t;
+
+
+/*
+ * Measure the level of one step of the ladder.
+ */
+static void ladder_measure (void *context, uint32_t step, const float *samples, uint64_t count, uint32_t sample_rate)
+{
+    console_t *console = context;
+    (void) sample_rate;
+
+    if (step >= LADDER_STEPS)
+    {
+        return;
+    }
+
+    double mean = dsp_sum (samples, count) / count;
+    double mean_square = dsp_dot (samples, samples, count) / count - mean * mean;
+
+    console->found [step] = true;
+    console->level [step] = (mean_square > 0.0) ? 10.0 * log10 (mean_square) : -INFINITY;
+}
+
+
+/*
+ * Check if a step is usable in the fit.
+ */
+static bool ladder_usable (const console_t *console, uint32_t channel, uint32_t attenuation)
+{
+    const uint32_t base = channel * LADDER_LEVELS;
+
+    if (!console->found [base + attenuation] || !console->found [base])
+    {
+        return false;
+    }
+
+    /* Without a measurement of the channel when off, every step that was found is used */
+    if (!console->found [base + 15])
+    {
+        return true;
+    }
+
+    return console->level [base + attenuation] > console->level [base + 15] + FLOOR_MARGIN_DB;
+}
+
+
+/*
+ * Fit a line through a channel's levels, relative to its level at attenuation 0.
+ */
+static void ladder_fit (const console_t *console, uint32_t channel, fit_t *fit)
+{
+    const uint32_t base = channel * LADDER_LEVELS;
+    double sum_x = 0.0, sum_y = 0.0, sum_xx = 0.0, sum_xy = 0.0;
+
+    memset (fit, 0, sizeof (fit_t));
+    fit->full = console->found [base] ? console->level [base] : NAN;
+    fit->off = (console->found [base] && console->found [base + 15]) ? console->level [base + 15] - console->level [base] : NAN;
+
+    for (uint32_t attenuation = 0; attenuation < 15; attenuation++)
+    {
+        if (!ladder_usable (console, channel, attenuation))
+        {
+            continue;
+        }
+
+        double y = console->level [base + attenuation] - console->level [base];
+        double error = y - NOMINAL_STEP_DB * attenuation;
+
+        fit->points++;
+        sum_x += attenuation;
+        sum_y += y;
+        sum_xx += attenuation * attenuation;
+        sum_xy += attenuation * y;
+
+        if (fabs (error) > fabs (fit->largest_error))
+        {
+            fit->largest_error = error;
+            fit->largest_at = attenuation;
+        }
+    }
+
+    if (fit->points < 2)
+    {
+        fit->step = NAN;
+        fit->rms_error = NAN;
+        return;
+    }
+
+    fit->step = (fit->points * sum_xy - sum_x * sum_y) / (fit->points * sum_xx - sum_x * sum_x);
+    double intercept = (sum_y - fit->step * sum_x) / fit->points;
+
+    double sum_error = 0.0;
+    for (uint32_t attenuation = 0; attenuation < 15; attenuation++)
+    {
+        if (ladder_usable (console, channel, attenuation))
+        {
+            double error = console->level [base + attenuation] - console->level [base] -
+                           (intercept + fit->step * attenuation);
+            sum_error += error * error;
+        }
+    }
+    fit->rms_error = sqrt (sum_error / fit->points);
+}
+
+
+/*
+ * Print the table of levels for one console.
+ */
+static void ladder_print_console (const console_t *console)
+{
+    const steps_result_t *result = &console->result;
+
+    printf ("%s: %s, %.3f s at %u Hz\n", console->name, console->filename, result->duration, result->sample_rate);
+    if (result->preamble_time == 0.0)
+    {
+        printf ("Error: The ladder's preamble was not found.\n\n");
+        return;
+    }
+    printf ("%s, preamble ends at %.3f s, %u of %u steps found, %u markers missed\n", video_name (result->video),
+            result->preamble_time, result->found, LADDER_STEPS, result->markers_missed);
+    printf ("\n");
+
+    printf ("%5s %9s", "Atten", "Nominal");
+    for (uint32_t channel = 0; channel < LADDER_CHANNELS; channel++)
+    {
+        printf ("   %14s %u", "Channel", channel);
+    }
+    printf ("\n");
+
+    for (uint32_t attenuation = 0; attenuation < LADDER_LEVELS; attenuation++)
+    {
+        if (attenuation == 15)
+        {
+            printf ("%5u %9s", attenuation, "off");
+        }
+        else
+        {
+            printf ("%5u %6.1f dB", attenuation, NOMINAL_STEP_DB * attenuation);
+        }
+
+        for (uint32_t channel = 0; channel < LADDER_CHANNELS; channel++)
+        {
+            const uint32_t base = channel * LADDER_LEVELS;
+            double relative = console->level [base + attenuation] - console->level [base];
+
+            if (!console->found [base + attenuation] || !console->found [base])
+            {
+                printf ("   %16s", "-");
+            }
+            else if (attenuation == 15 || !ladder_usable (console, channel, attenuation))
+            {
+                printf ("   %6.2f dB %6s", relative, "floor");
+            }
+            else
+            {
+                printf ("   %6.2f dB %+6.2f", relative, relative - NOMINAL_STEP_DB * attenuation);
+            }
+        }
+        printf ("\n");
+    }
+    printf ("\n");
+}
+
+
+/*
+ * Print the fits for one channel, a row for each console.
+ */
+static void ladder_print_channel (const console_t *consoles, uint32_t console_count, uint32_t channel)
+{
+    printf ("Channel %u\n", channel);
+    printf ("%-12s %10s %6s %10s %12s %10s %12s\n",
+            "Console", "Step", "Points", "Fit RMS", "Largest", "Off", "Full");
+
+    for (uint32_t i = 0; i < console_count; i++)
+    {
+        fit_t fit;
+
+        if (consoles [i].result.preamble_time == 0.0)
+        {
+            continue;
+        }
+
+        ladder_fit (&consoles [i], channel, &fit);
+        printf ("%-12s %7.3f dB %6u %7.3f dB %+6.2f dB %2u %7.1f dB %7.1f dBFS\n", consoles [i].name,
+                fit.step, fit.points, fit.rms_error, fit.largest_error, fit.largest_at, fit.off, fit.full);
+    }
+    printf ("\n");
+}
+
+
+/*
+ * Entry point.
+ */
+int main (int argc, char **argv)
+{
+    console_t consoles [CONSOLES_MAX];
+    uint32_t console_count = 0;
+    video_t video = VIDEO_AUTO;
+    bool usage = false;
+    schedule_t schedule = {
+        .preamble_frames = LADDER_PREAMBLE_FRAMES,
+        .hold_frames = LADDER_HOLD_FRAMES,
+        .marker_frames = LADDER_MARKER_FRAMES,
+        .steps = LADDER_STEPS
+    };
+
+    memset (consoles, 0, sizeof (consoles));
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp (argv [i], "--ntsc") == 0)
+        {
+            video = VIDEO_NTSC;
+        }
+        else if (strcmp (argv [i], "--pal") == 0)
+        {
+            video = VIDEO_PAL;
+        }
+        else if (strcmp (argv [i], "--hold") == 0 && i + 1 < argc)
+        {
+            schedule.hold_frames = strtoul (argv [++i], NULL, 10);
+        }
+        else if (strcmp (argv [i], "--marker") == 0 && i + 1 < argc)
+        {
+            schedule.marker_frames = strtoul (argv [++i], NULL, 10);
+        }
+        else if (console_count < CONSOLES_MAX && argv [i][0] != '-')
+        {
+            /* Captures may be named as <console>=<capture.wav>, or are named after the file */
+            console_t *console = &consoles [console_count++];
+            char *separator = strchr (argv [i], '=');
+
+            if (separator != NULL)
+            {
+                *separator = '\0';
+                console->name = argv [i];
+                console->filename = separator + 1;
+            }
+            else
+            {
+                console->name = argv [i];
+                console->filename = argv [i];
+            }
+        }
+        else
+        {
+            usage = true;
+            break;
+        }
+    }
+
+    if (usage || console_count == 0 || schedule.hold_frames == 0 || schedule.marker_frames == 0)
+    {
+        fprintf (stderr, "Usage: %s [--ntsc | --pal] [--hold <frames>] [--marker <frames>]\n"
+                         "        [<console>=]<capture.wav> ...\n", argv [0]);
+        fprintf (stderr, "Up to %u captures can be compared, for example sms1=sms1.wav sms2=sms2.wav gg=gg.wav\n",
+                 CONSOLES_MAX);
+        return EXIT_FAILURE;
+    }
+
+    bool failed = false;
+    for (uint32_t i = 0; i < console_count; i++)
+    {
+        console_t *console = &consoles [i];
+
+        if (steps_follow (console->filename, &schedule, video, ladder_measure, console, &console->result) == -1)
+        {
+            return EXIT_FAILURE;
+        }
+
+        ladder_print_console (console);
+        failed |= (console->result.preamble_time == 0.0);
+    }
+
+    for (uint32_t channel = 0; channel < LADDER_CHANNELS; channel++)
+    {
+        ladder_print_channel (consoles, console_count, channel);
+    }
+
+    printf ("Step is the fitted attenuation per step, nominally %.1f dB, over the points clear of the noise floor.\n",
+            NOMINAL_STEP_DB);
+    printf ("Largest is the largest difference from the nominal ladder, and the attenuation it was found at.\n");
+    printf ("Off is the level at attenuation 15, relative to attenuation 0, and Full is the level at attenuation 0.\n");
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
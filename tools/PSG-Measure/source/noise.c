@@ -0,0 +1,819 @@
+/*
+ * PSG-Measure
+ * A tool to recover the noise channel's LFSR from a capture, and infer its
+ * width and feedback taps.
+ *
+ * JoppyFurr 2024
+ *
+ * The noise channel's output is the LFSR's low bit, which changes only when
+ * the register shifts, at a rate known from the noise control register. The
+ * capture is read twice:
+ *
+ *  1. The shift clock is recovered from the transitions. The squared
+ *     difference between samples is demodulated at the nominal shift rate, a
+ *     block at a time, and a line is fitted through the phase of each block.
+ *     Its slope corrects the shift rate for the console's and recorder's clocks,
+ *     and its offset gives the position of the first shift.
+ *
+ *  2. Each bit is read from the middle half of its interval, and compared with
+ *     the average levels of the high and low bits seen so far.
+ *
+ * The period is found from the autocorrelation of the bits, by FFT. For white
+ * noise, the shortest linear recurrence that generates the bits is found by
+ * Berlekamp-Massey over short windows, so that a bit error only spoils the
+ * windows it falls in, and the most common result is taken.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../PSG-Compare/source/dsp.h"
+#include "../../PSG-Compare/source/wav.h"
+#include "capture.h"
+#include "steps.h"
+
+#ifndef M_PI
+#define M_PI                3.14159265358979323846
+#endif
+
+/* Bits in each block when recovering the shift clock. The clock can be out
+ * by up to half a bit per block, about 2000 ppm, before the phase wraps. */
+#define TIMING_BLOCK_BITS   256
+
+/* Blocks more than this far below the loudest are taken to be before or after the noise */
+#define ACTIVE_RANGE_DB     20.0
+
+/* Rate at which the average high and low levels follow the capture */
+#define LEVEL_RATE          (1.0 / 32.0)
+
+/* Longest run of bits analysed */
+#define ANALYSIS_BITS_MAX   (1 << 21)
+
+/* A lag whose normalised autocorrelation is above this is taken as the period,
+ * as long as at least this many bits overlap a period later */
+#define PERIOD_CORRELATION  0.8
+#define PERIOD_OVERLAP      4096
+
+/* Berlekamp-Massey is run over windows of this many bits, which finds recurrences up to half as long */
+#define RECURRENCE_WINDOW   256
+#define RECURRENCE_WINDOWS  64
+#define RECURRENCE_MAX      63
+
+/* Longest register simulated to find its period */
+#define SIMULATE_WIDTH_MAX  24
+
+
+/* Shift clock, in samples */
+typedef struct timing_s {
+    double period;
+    double offset;              /* Position of a shift */
+    uint64_t start;             /* The part of the capture with noise in it */
+    uint64_t end;
+} timing_t;
+
+/* A linear recurrence, b [k] = XOR of b [k - i] for each bit i set in taps */
+typedef struct recurrence_s {
+    uint32_t order;
+    uint64_t taps;
+} recurrence_t;
+
+/* Registers found in known chips */
+typedef struct known_lfsr_s {
+    const char *name;
+    uint32_t width;
+    uint32_t taps;
+} known_lfsr_t;
+
+static const known_lfsr_t known_lfsrs [] = {
+    { "Sega VDP",           16, 0x0009 },
+    { "SN76489",            15, 0x0003 },
+    { "SN76489A",           17, 0x000c },
+};
+
+
+/*
+ * Find the shift clock, from the transitions in the capture.
+ * Returns -1 on error.
+ */
+static int timing_recover (const char *filename, uint32_t sample_rate, double nominal,
+                           double start_s, double length_s, timing_t *timing)
+{
+    capture_t capture;
+    uint64_t block = ceil (TIMING_BLOCK_BITS * nominal);
+    int result = -1;
+
+    if (capture_open (&capture, filename, (double) (block + 2) / sample_rate) == -1)
+    {
+        return -1;
+    }
+
+    uint64_t start = start_s * sample_rate;
+    uint64_t end = (length_s > 0.0) ? start + (uint64_t) (length_s * sample_rate) : UINT64_MAX;
+
+    float *cos_table = malloc (block * sizeof (float));
+    float *sin_table = malloc (block * sizeof (float));
+    float *energy = malloc (block * sizeof (float));
+    uint64_t blocks_max = 1024;
+    uint64_t blocks = 0;
+    double *phase = malloc (blocks_max * sizeof (double));
+    double *weight = malloc (blocks_max * sizeof (double));
+    double *level = malloc (blocks_max * sizeof (double));
+
+    if (cos_table == NULL || sin_table == NULL || energy == NULL || phase == NULL || weight == NULL || level == NULL)
+    {
+        fprintf (stderr, "Error: Failed to allocate memory for clock recovery.\n");
+        goto done;
+    }
+
+    for (uint64_t n = 0; n < block; n++)
+    {
+        cos_table [n] = cos (2.0 * M_PI * n / nominal);
+        sin_table [n] = sin (2.0 * M_PI * n / nominal);
+    }
+
+    for (uint64_t position = start; position + block + 1 <= end; position += block)
+    {
+        if (!capture_fill (&capture, position + block + 1, position))
+        {
+            break;
+        }
+
+        if (blocks == blocks_max)
+        {
+            blocks_max *= 2;
+            double *new_phase = realloc (phase, blocks_max * sizeof (double));
+            double *new_weight = realloc (weight, blocks_max * sizeof (double));
+            double *new_level = realloc (level, blocks_max * sizeof (double));
+            if (new_phase != NULL) phase = new_phase;
+            if (new_weight != NULL) weight = new_weight;
+            if (new_level != NULL) level = new_level;
+            if (new_phase == NULL || new_weight == NULL || new_level == NULL)
+            {
+                fprintf (stderr, "Error: Failed to allocate memory for clock recovery.\n");
+                goto done;
+            }
+        }
+
+        /* Transitions show up in the squared difference, centred half way between samples */
+        const float *samples = capture_at (&capture, position);
+        for (uint64_t n = 0; n < block; n++)
+        {
+            energy [n] = samples [n + 1] - samples [n];
+        }
+        dsp_multiply (energy, energy, energy, block);
+
+        double re = dsp_dot (energy, cos_table, block);
+        double im = -dsp_dot (energy, sin_table, block);
+        double rotation = -2.0 * M_PI * fmod (position + 0.5, nominal) / nominal;
+        double mean = dsp_sum (samples, block) / block;
+        double mean_square = dsp_dot (samples, samples, block) / block - mean * mean;
+
+        phase [blocks] = -atan2 (re * sin (rotation) + im * cos (rotation), re * cos (rotation) - im * sin (rotation));
+        weight [blocks] = hypot (re, im);
+        level [blocks] = (mean_square > 0.0) ? 10.0 * log10 (mean_square) : -INFINITY;
+        blocks++;
+    }
+
+    /* Only the blocks with noise in them are used */
+    double loudest = -INFINITY;
+    for (uint64_t b = 0; b < blocks; b++)
+    {
+        loudest = fmax (loudest, level [b]);
+    }
+
+    uint64_t first = blocks;
+    uint64_t last = 0;
+    for (uint64_t b = 0; b < blocks; b++)
+    {
+        if (level [b] > loudest - ACTIVE_RANGE_DB)
+        {
+            first = (b < first) ? b : first;
+            last = b;
+        }
+    }
+
+    if (first == blocks || last - first < 2)
+    {
+        fprintf (stderr, "Error: Not enough noise found in '%s'.\n", filename);
+        goto done;
+    }
+
+    /* Unwrap the phase, and fit a weighted line through it against each block's centre */
+    double sum_w = 0.0, sum_x = 0.0, sum_y = 0.0, sum_xx = 0.0, sum_xy = 0.0;
+    double unwrapped = phase [first];
+    for (uint64_t b = first; b <= last; b++)
+    {
+        if (b > first)
+        {
+            double step = phase [b] - phase [b - 1];
+            step -= 2.0 * M_PI * round (step / (2.0 * M_PI));
+            unwrapped += step;
+        }
+
+        double x = start + (b + 0.5) * block;
+        double w = weight [b];
+        sum_w += w;
+        sum_x += w * x;
+        sum_y += w * unwrapped;
+        sum_xx += w * x * x;
+        sum_xy += w * x * unwrapped;
+    }
+
+    double slope = (sum_w * sum_xy - sum_x * sum_y) / (sum_w * sum_xx - sum_x * sum_x);
+    double intercept = (sum_y - slope * sum_x) / sum_w;
+
+    /* Shifts are where the demodulating phase, 2 pi n / nominal, meets the fitted line */
+    double rate = 2.0 * M_PI / nominal - slope;
+    timing->period = 2.0 * M_PI / rate;
+    timing->offset = fmod (intercept / rate, timing->period);
+    if (timing->offset < 0.0)
+    {
+        timing->offset += timing->period;
+    }
+    timing->start = start + first * block;
+    timing->end = start + (last + 1) * block;
+    result = 0;
+
+done:
+    capture_close (&capture);
+    free (cos_table);
+    free (sin_table);
+    free (energy);
+    free (phase);
+    free (weight);
+    free (level);
+
+    return result;
+}
+
+
+/*
+ * Read the bits from the capture, using the recovered shift clock.
+ * Returns the number of bits read, or 0 on error.
+ */
+static uint64_t bits_read (const char *filename, const timing_t *timing, uint8_t *bits, uint64_t bits_max)
+{
+    capture_t capture;
+    uint64_t count = 0;
+
+    /* The slowest shift rate, with tone 2 at 0x3ff, is just over 100 Hz */
+    if (capture_open (&capture, filename, 0.1) == -1)
+    {
+        return 0;
+    }
+
+    double high = -INFINITY;
+    double low = INFINITY;
+    uint64_t k = ceil ((timing->start - timing->offset) / timing->period);
+
+    for (; count < bits_max; k++)
+    {
+        double bit_start = timing->offset + k * timing->period;
+        if (bit_start + timing->period > timing->end)
+        {
+            break;
+        }
+
+        /* Average over the middle half of the bit, or take the sample nearest its centre */
+        uint64_t from = ceil (bit_start + 0.25 * timing->period);
+        uint64_t to = floor (bit_start + 0.75 * timing->period);
+        if (to < from)
+        {
+            from = to = llround (bit_start + 0.5 * timing->period);
+        }
+
+        if (!capture_fill (&capture, to + 1, floor (bit_start)))
+        {
+            break;
+        }
+
+        double value = dsp_sum (capture_at (&capture, from), to - from + 1) / (to - from + 1);
+
+        /* The first bits set the levels, until a high and a low bit have been seen.
+         * After that, each level follows the bits nearest it. */
+        if (count == 0)
+        {
+            high = low = value;
+        }
+        bool bit = value > 0.5 * (high + low);
+        if (high == low)
+        {
+            bit = value > high;
+            high = fmax (high, value);
+            low = fmin (low, value);
+        }
+        else if (bit)
+        {
+            high += LEVEL_RATE * (value - high);
+        }
+        else
+        {
+            low += LEVEL_RATE * (value - low);
+        }
+
+        bits [count++] = bit;
+    }
+
+    capture_close (&capture);
+
+    return count;
+}
+
+
+/*
+ * Find the period of the bits, from their autocorrelation.
+ * Returns the period, or 0 if none was found.
+ */
+static uint64_t bits_period (const uint8_t *bits, uint64_t count, double *mismatch)
+{
+    uint32_t size = fft_size_for (2 * count);
+    fft_t fft;
+    uint64_t period = 0;
+
+    float *re = malloc (size * sizeof (float));
+    float *im = malloc (size * sizeof (float));
+    float *power = calloc (size, sizeof (float));
+
+    if (re == NULL || im == NULL || power == NULL || fft_init (&fft, size) == -1)
+    {
+        fprintf (stderr, "Error: Failed to allocate memory for autocorrelation.\n");
+        free (re);
+        free (im);
+        free (power);
+        return 0;
+    }
+
+    /* Autocovariance of the bits as +1 and -1, zero-padded so that the correlation does not wrap */
+    double ones = 0.0;
+    for (uint64_t i = 0; i < count; i++)
+    {
+        ones += bits [i];
+    }
+    double mean = 2.0 * ones / count - 1.0;
+    double variance = 1.0 - mean * mean;
+
+    for (uint64_t i = 0; i < count; i++)
+    {
+        re [i] = (bits [i] ? 1.0f : -1.0f) - mean;
+    }
+    memset (&re [count], 0, (size - count) * sizeof (float));
+    memset (im, 0, size * sizeof (float));
+
+    fft_forward (&fft, re, im);
+    dsp_power_accumulate (power, re, im, size);
+    memcpy (re, power, size * sizeof (float));
+    memset (im, 0, size * sizeof (float));
+    fft_inverse (&fft, re, im);
+
+    for (uint64_t lag = 2; lag + PERIOD_OVERLAP <= count && variance > 0.0; lag++)
+    {
+        if (re [lag] / ((count - lag) * variance) > PERIOD_CORRELATION)
+        {
+            period = lag;
+            break;
+        }
+    }
+
+    /* Count the bits that differ from those a period later, using the same +1 / -1 values */
+    if (period != 0)
+    {
+        for (uint64_t i = 0; i < count; i++)
+        {
+            re [i] = bits [i] ? 1.0f : -1.0f;
+        }
+        double agreement = dsp_dot (re, &re [period], count - period);
+        *mismatch = 0.5 * ((count - period) - agreement) / (count - period);
+    }
+
+    fft_free (&fft);
+    free (re);
+    free (im);
+    free (power);
+
+    return period;
+}
+
+
+/*
+ * Find the shortest linear recurrence that generates a run of bits, by Berlekamp-Massey.
+ * Returns false if it is longer than RECURRENCE_MAX.
+ */
+static bool berlekamp_massey (const uint8_t *bits, uint32_t count, recurrence_t *recurrence)
+{
+    uint8_t c [RECURRENCE_WINDOW + 1] = { 1 };
+    uint8_t b [RECURRENCE_WINDOW + 1] = { 1 };
+    uint8_t t [RECURRENCE_WINDOW + 1];
+    uint32_t order = 0;
+    uint32_t shift = 1;
+
+    for (uint32_t n = 0; n < count; n++)
+    {
+        uint8_t discrepancy = bits [n];
+        for (uint32_t i = 1; i <= order; i++)
+        {
+            discrepancy ^= c [i] & bits [n - i];
+        }
+
+        if (discrepancy == 0)
+        {
+            shift++;
+        }
+        else if (2 * order <= n)
+        {
+            memcpy (t, c, sizeof (t));
+            for (uint32_t i = 0; i + shift <= count; i++)
+            {
+                c [i + shift] ^= b [i];
+            }
+            order = n + 1 - order;
+            memcpy (b, t, sizeof (b));
+            shift = 1;
+        }
+        else
+        {
+            for (uint32_t i = 0; i + shift <= count; i++)
+            {
+                c [i + shift] ^= b [i];
+            }
+            shift++;
+        }
+    }
+
+    if (order > RECURRENCE_MAX)
+    {
+        return false;
+    }
+
+    recurrence->order = order;
+    recurrence->taps = 0;
+    for (uint32_t i = 1; i <= order; i++)
+    {
+        if (c [i])
+        {
+            recurrence->taps |= (uint64_t) 1 << i;
+        }
+    }
+
+    return true;
+}
+
+
+/*
+ * Find the recurrence that generates the most windows of the bits.
+ * Returns the number of windows that agree, or 0 if none was found.
+ */
+static uint32_t bits_recurrence (const uint8_t *bits, uint64_t count, recurrence_t *recurrence)
+{
+    recurrence_t found [RECURRENCE_WINDOWS];
+    uint32_t found_count = 0;
+    uint32_t best_votes = 0;
+
+    if (count < RECURRENCE_WINDOW)
+    {
+        return 0;
+    }
+
+    uint64_t spacing = (count - RECURRENCE_WINDOW) / RECURRENCE_WINDOWS + 1;
+    for (uint64_t start = 0; start + RECURRENCE_WINDOW <= count && found_count < RECURRENCE_WINDOWS; start += spacing)
+    {
+        if (berlekamp_massey (&bits [start], RECURRENCE_WINDOW, &found [found_count]))
+        {
+            found_count++;
+        }
+    }
+
+    for (uint32_t i = 0; i < found_count; i++)
+    {
+        uint32_t votes = 0;
+        for (uint32_t j = 0; j < found_count; j++)
+        {
+            votes += (found [j].order == found [i].order && found [j].taps == found [i].taps);
+        }
+        if (votes > best_votes)
+        {
+            best_votes = votes;
+            *recurrence = found [i];
+        }
+    }
+
+    return best_votes;
+}
+
+
+/*
+ * Count the bits that the recurrence does not generate from the bits before them.
+ */
+static uint64_t recurrence_errors (const uint8_t *bits, uint64_t count, const recurrence_t *recurrence)
+{
+    uint64_t errors = 0;
+
+    for (uint64_t k = recurrence->order; k < count; k++)
+    {
+        uint8_t bit = 0;
+        for (uint32_t i = 1; i <= recurrence->order; i++)
+        {
+            if (recurrence->taps & ((uint64_t) 1 << i))
+            {
+                bit ^= bits [k - i];
+            }
+        }
+        errors += (bit != bits [k]);
+    }
+
+    return errors;
+}
+
+
+/*
+ * Convert a recurrence into the taps of a right-shifting register of the given width,
+ * which feeds back into its top bit and outputs its bottom bit.
+ */
+static uint64_t recurrence_register_taps (const recurrence_t *recurrence, uint32_t width)
+{
+    uint64_t taps = 0;
+
+    for (uint32_t i = 1; i <= recurrence->order; i++)
+    {
+        if (recurrence->taps & ((uint64_t) 1 << i))
+        {
+            taps |= (uint64_t) 1 << (width - i);
+        }
+    }
+
+    return taps;
+}
+
+
+/*
+ * Find the period of a register, starting with only its top bit set.
+ * Returns 0 if the register is too wide to simulate, or never returns to its start.
+ */
+static uint64_t register_period (uint32_t width, uint64_t taps)
+{
+    if (width > SIMULATE_WIDTH_MAX)
+    {
+        return 0;
+    }
+
+    uint32_t start = 1u << (width - 1);
+    uint32_t state = start;
+    uint64_t period = 0;
+
+    do
+    {
+        uint32_t feedback = __builtin_parity (state & taps);
+        state = (state >> 1) | (feedback << (width - 1));
+        period++;
+    } while (state != start && period <= (1u << width));
+
+    return (state == start) ? period : 0;
+}
+
+
+/*
+ * Entry point.
+ */
+int main (int argc, char **argv)
+{
+    const char *capture_filename = NULL;
+    const char *control_string = NULL;
+    video_t video = VIDEO_NTSC;
+    uint32_t tone2 = 0;
+    uint32_t width = 0;
+    double start_s = 0.0;
+    double length_s = 0.0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp (argv [i], "--ntsc") == 0)
+        {
+            video = VIDEO_NTSC;
+        }
+        else if (strcmp (argv [i], "--pal") == 0)
+        {
+            video = VIDEO_PAL;
+        }
+        else if (strcmp (argv [i], "--tone2") == 0 && i + 1 < argc)
+        {
+            tone2 = strtoul (argv [++i], NULL, 0);
+        }
+        else if (strcmp (argv [i], "--width") == 0 && i + 1 < argc)
+        {
+            width = strtoul (argv [++i], NULL, 10);
+        }
+        else if (strcmp (argv [i], "--start") == 0 && i + 1 < argc)
+        {
+            start_s = strtod (argv [++i], NULL);
+        }
+        else if (strcmp (argv [i], "--length") == 0 && i + 1 < argc)
+        {
+            length_s = strtod (argv [++i], NULL);
+        }
+        else if (control_string == NULL && argv [i][0] != '-')
+        {
+            control_string = argv [i];
+        }
+        else if (capture_filename == NULL && argv [i][0] != '-')
+        {
+            capture_filename = argv [i];
+        }
+        else
+        {
+            capture_filename = NULL;
+            break;
+        }
+    }
+
+    uint32_t control = (control_string != NULL) ? strtoul (control_string, NULL, 0) : 0;
+    if (capture_filename == NULL || control > 7 || ((control & 0x03) == 0x03 && (tone2 == 0 || tone2 > 0x3ff)) ||
+        width > RECURRENCE_MAX || start_s < 0.0 || length_s < 0.0)
+    {
+        fprintf (stderr, "Usage: %s [--ntsc | --pal] [--tone2 <period>] [--width <bits>] [--start <s>] [--length <s>]\n"
+                         "        <noise-control> <capture.wav>\n", argv [0]);
+        fprintf (stderr, "The tone 2 period is needed when the noise control's shift rate is 3.\n");
+        return EXIT_FAILURE;
+    }
+
+    bool white = control & 0x04;
+    double clock = video_clock (video);
+    double shift_rate = ((control & 0x03) == 0x03) ? clock / (32.0 * tone2) : clock / (512 << (control & 0x03));
+
+    capture_t capture;
+    if (capture_open (&capture, capture_filename, 0.0) == -1)
+    {
+        return EXIT_FAILURE;
+    }
+    uint32_t sample_rate = capture.sample_rate;
+    capture_close (&capture);
+
+    if (shift_rate > 0.5 * sample_rate)
+    {
+        fprintf (stderr, "Error: The shift rate, %.1f Hz, is too fast for a capture at %u Hz.\n", shift_rate, sample_rate);
+        return EXIT_FAILURE;
+    }
+
+    timing_t timing;
+    if (timing_recover (capture_filename, sample_rate, sample_rate / shift_rate, start_s, length_s, &timing) == -1)
+    {
+        return EXIT_FAILURE;
+    }
+
+    uint8_t *bits = malloc (ANALYSIS_BITS_MAX);
+    if (bits == NULL)
+    {
+        fprintf (stderr, "Error: Failed to allocate memory for bits.\n");
+        return EXIT_FAILURE;
+    }
+
+    uint64_t count = bits_read (capture_filename, &timing, bits, ANALYSIS_BITS_MAX);
+    double measured_rate = sample_rate / timing.period;
+
+    printf ("Capture:    %s, noise from %.3f s to %.3f s at %u Hz\n", capture_filename,
+            (double) timing.start / sample_rate, (double) timing.end / sample_rate, sample_rate);
+    printf ("Noise:      %s, control 0x%x, %s clock\n", white ? "white" : "periodic", control, video_name (video));
+    printf ("Shift rate: %.2f Hz expected, %.2f Hz measured (%+.0f ppm)\n", shift_rate, measured_rate,
+            1e6 * (measured_rate / shift_rate - 1.0));
+    printf ("Bits:       %llu recovered\n", (unsigned long long) count);
+
+    if (count < RECURRENCE_WINDOW)
+    {
+        printf ("Error: Too few bits recovered to analyse.\n");
+        free (bits);
+        return EXIT_FAILURE;
+    }
+
+    /* The capture's polarity is unknown. Inverting white noise needs an extra term in its recurrence,
+     * and periodic noise has a single set bit in each period, so each has a right way up. */
+    recurrence_t recurrence = { 0 };
+    uint32_t votes = 0;
+    bool inverted = false;
+
+    if (white)
+    {
+        recurrence_t recurrence_inverted = { 0 };
+        votes = bits_recurrence (bits, count, &recurrence);
+
+        for (uint64_t i = 0; i < count; i++)
+        {
+            bits [i] ^= 1;
+        }
+        uint32_t votes_inverted = bits_recurrence (bits, count, &recurrence_inverted);
+
+        if (votes_inverted > 0 && (votes == 0 || recurrence_inverted.order < recurrence.order))
+        {
+            recurrence = recurrence_inverted;
+            votes = votes_inverted;
+            inverted = true;
+        }
+        else
+        {
+            for (uint64_t i = 0; i < count; i++)
+            {
+                bits [i] ^= 1;
+            }
+        }
+    }
+    else
+    {
+        uint64_t ones = 0;
+        for (uint64_t i = 0; i < count; i++)
+        {
+            ones += bits [i];
+        }
+        if (2 * ones > count)
+        {
+            for (uint64_t i = 0; i < count; i++)
+            {
+                bits [i] ^= 1;
+            }
+            inverted = true;
+        }
+    }
+    printf ("Polarity:   %s\n", inverted ? "inverted" : "as captured");
+
+    double mismatch = 0.0;
+    uint64_t period = bits_period (bits, count, &mismatch);
+    if (period != 0)
+    {
+        printf ("Period:     %llu bits, with %.3f%% of bits differing from one period later\n",
+                (unsigned long long) period, 100.0 * mismatch);
+    }
+    else
+    {
+        printf ("Period:     not found, as it is longer than %llu bits. A longer capture is needed.\n",
+                (unsigned long long) (count - PERIOD_OVERLAP));
+    }
+
+    if (!white)
+    {
+        /* Periodic noise feeds the output bit alone back to the top, so it repeats after the width */
+        if (period != 0)
+        {
+            printf ("Width:      %llu bits\n", (unsigned long long) period);
+            for (uint32_t i = 0; i < sizeof (known_lfsrs) / sizeof (known_lfsrs [0]); i++)
+            {
+                if (known_lfsrs [i].width == period)
+                {
+                    printf ("Matches:    %s\n", known_lfsrs [i].name);
+                }
+            }
+        }
+        free (bits);
+        return (period != 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (votes == 0)
+    {
+        printf ("Feedback:   no recurrence of up to %u bits found\n", RECURRENCE_MAX);
+        free (bits);
+        return EXIT_FAILURE;
+    }
+
+    uint64_t errors = recurrence_errors (bits, count, &recurrence);
+    uint64_t taps = recurrence_register_taps (&recurrence, recurrence.order);
+    printf ("Feedback:   order %u, taps 0x%04llx, found in %u of %u windows, with %llu bits (%.3f%%) not following it\n",
+            recurrence.order, (unsigned long long) taps, votes, RECURRENCE_WINDOWS,
+            (unsigned long long) errors, 100.0 * errors / (count - recurrence.order));
+
+    /* Taps that skip the low bits only delay the output, so need the width from periodic noise to place them */
+    if (width > recurrence.order)
+    {
+        taps = recurrence_register_taps (&recurrence, width);
+        printf ("Register:   %u bits, taps 0x%04llx\n", width, (unsigned long long) taps);
+    }
+    else
+    {
+        width = recurrence.order;
+        printf ("Register:   %u bits, taps 0x%04llx, or wider if the lowest tap is above bit 0\n",
+                width, (unsigned long long) taps);
+    }
+
+    /* Widening the register only delays the output, so the period comes from the recurrence */
+    uint64_t expected_period = register_period (recurrence.order, recurrence_register_taps (&recurrence, recurrence.order));
+    if (expected_period != 0)
+    {
+        printf ("            A register with these taps repeats every %llu bits%s\n", (unsigned long long) expected_period,
+                (period == 0) ? "" : (period == expected_period) ? ", matching the capture" : ", which does not match the capture");
+    }
+
+    for (uint32_t i = 0; i < sizeof (known_lfsrs) / sizeof (known_lfsrs [0]); i++)
+    {
+        const known_lfsr_t *known = &known_lfsrs [i];
+        uint32_t skip = __builtin_ctz (known->taps);
+
+        /* Compare with the register's taps moved down to bit 0, as the capture cannot see the difference */
+        if (known->width - skip == recurrence.order &&
+            (known->taps >> skip) == recurrence_register_taps (&recurrence, recurrence.order))
+        {
+            printf ("Matches:    %s, %u bits, taps 0x%04x\n", known->name, known->width, known->taps);
+        }
+    }
+
+    free (bits);
+
+    return EXIT_SUCCESS;
+}
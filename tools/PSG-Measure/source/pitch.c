@@ -0,0 +1,348 @@
+/*
+ * PSG-Measure
+ * A tool to measure the pitch of every tone period, from a capture of the
+ * test ROM's sweep mode.
+ *
+ * JoppyFurr 2024
+ *
+ * Each step is measured with an FFT, zero-padded to four times the step's
+ * length. The loudest bin is found, and its position refined by fitting a
+ * parabola through the logs of it and its neighbours, which is exact for a
+ * Gaussian peak and close for the Hann window used here.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../PSG-Compare/source/dsp.h"
+#include "steps.h"
+
+#ifndef M_PI
+#define M_PI                3.14159265358979323846
+#endif
+
+/* The sweep's schedule, from source/sweep.h in the test ROM */
+#define SWEEP_PREAMBLE_FRAMES   120
+#define SWEEP_HOLD_FRAMES       15
+#define SWEEP_MARKER_FRAMES     5
+#define SWEEP_PERIODS           1024
+
+/* Largest FFT used to measure a step */
+#define PITCH_FFT_MAX           (1 << 20)
+
+/* Lowest frequency searched for a peak */
+#define PITCH_LOW_HZ            20.0
+
+/* Steps this far below the marker's level are taken to be silent */
+#define SILENT_DB               25.0
+
+/* Frequencies above this share of the sample rate are too close to Nyquist to measure */
+#define NYQUIST_SHARE           0.45
+
+/* A measurement within this many cents of a period is taken to match it */
+#define MATCH_CENTS             50.0
+
+
+/* Measurement of a single step */
+typedef struct step_pitch_s {
+    bool found;
+    double frequency;           /* Hz */
+    double level;               /* dBFS */
+} step_pitch_t;
+
+/* State shared with the step callback */
+typedef struct pitch_s {
+    fft_t fft;
+    uint32_t size;
+    float *re;
+    float *im;
+    float *power;
+    bool failed;
+    step_pitch_t steps [SWEEP_PERIODS];
+} pitch_t;
+
+
+/*
+ * Frequency of a tone period, treating zero as 0x400.
+ */
+static double period_frequency (double clock, uint32_t period)
+{
+    return clock / (32.0 * ((period == 0) ? 0x400 : period));
+}
+
+
+/*
+ * Difference between two frequencies, in cents.
+ */
+static double cents (double measured, double expected)
+{
+    return 1200.0 * log2 (measured / expected);
+}
+
+
+/*
+ * Measure the fundamental of one step of the sweep.
+ */
+static void pitch_measure (void *context, uint32_t step, const float *samples, uint64_t count, uint32_t sample_rate)
+{
+    pitch_t *pitch = context;
+    step_pitch_t *result = &pitch->steps [step];
+
+    /* The FFT is sized from the first step, as the rest are the same length */
+    if (pitch->size == 0)
+    {
+        uint64_t size = fft_size_for (count * 4);
+        pitch->size = (size > PITCH_FFT_MAX || size == 0) ? PITCH_FFT_MAX : size;
+        pitch->re = malloc (pitch->size * sizeof (float));
+        pitch->im = malloc (pitch->size * sizeof (float));
+        pitch->power = malloc (pitch->size / 2 * sizeof (float));
+
+        if (pitch->re == NULL || pitch->im == NULL || pitch->power == NULL || fft_init (&pitch->fft, pitch->size) == -1)
+        {
+            fprintf (stderr, "Error: Failed to allocate memory for pitch measurement.\n");
+            pitch->failed = true;
+        }
+    }
+
+    if (pitch->failed || step >= SWEEP_PERIODS)
+    {
+        return;
+    }
+
+    if (count > pitch->size)
+    {
+        count = pitch->size;
+    }
+
+    uint32_t half = pitch->size / 2;
+    double mean = dsp_sum (samples, count) / count;
+    double mean_square = dsp_dot (samples, samples, count) / count - mean * mean;
+
+    result->found = true;
+    result->level = (mean_square > 0.0) ? 10.0 * log10 (mean_square) : -INFINITY;
+
+    /* Remove the mean, apply a Hann window, and zero-pad */
+    for (uint64_t i = 0; i < count; i++)
+    {
+        pitch->re [i] = (samples [i] - mean) * (0.5 - 0.5 * cos (2.0 * M_PI * i / count));
+    }
+    memset (&pitch->re [count], 0, (pitch->size - count) * sizeof (float));
+    memset (pitch->im, 0, pitch->size * sizeof (float));
+
+    fft_forward (&pitch->fft, pitch->re, pitch->im);
+    memset (pitch->power, 0, half * sizeof (float));
+    dsp_power_accumulate (pitch->power, pitch->re, pitch->im, half);
+
+    uint32_t low = ceil (PITCH_LOW_HZ * pitch->size / sample_rate);
+    uint32_t peak = low;
+    for (uint32_t k = low; k < half - 1; k++)
+    {
+        if (pitch->power [k] > pitch->power [peak])
+        {
+            peak = k;
+        }
+    }
+
+    /* Parabolic interpolation on the log of the power */
+    double a = log (pitch->power [peak - 1] + 1e-30);
+    double b = log (pitch->power [peak] + 1e-30);
+    double c = log (pitch->power [peak + 1] + 1e-30);
+    double divisor = a - 2.0 * b + c;
+    double delta = (divisor < 0.0) ? 0.5 * (a - c) / divisor : 0.0;
+
+    result->frequency = (peak + delta) * sample_rate / pitch->size;
+}
+
+
+/*
+ * Describe how a step compares with what is expected of it.
+ */
+static const char *pitch_note (uint32_t period, const step_pitch_t *step, bool silent, bool near_nyquist,
+                               bool above_nyquist, double clock)
+{
+    if (period == 0)
+    {
+        if (silent)
+        {
+            return "silent, zero holds the output, as on the Sega chip";
+        }
+        if (fabs (cents (step->frequency, period_frequency (clock, 0x400))) < MATCH_CENTS)
+        {
+            return "zero acts as 0x400, as on the TI chip";
+        }
+        if (fabs (cents (step->frequency, period_frequency (clock, 1))) < MATCH_CENTS)
+        {
+            return "zero acts as 1";
+        }
+        return "zero acts as neither 0x400 nor 1";
+    }
+
+    if (above_nyquist)
+    {
+        return silent ? "above Nyquist, silent" : "above Nyquist, aliased";
+    }
+
+    if (near_nyquist)
+    {
+        return silent ? "near Nyquist, silent" : "near Nyquist, not measured";
+    }
+
+    if (silent)
+    {
+        return "silent";
+    }
+
+    return "";
+}
+
+
+/*
+ * Entry point.
+ */
+int main (int argc, char **argv)
+{
+    const char *capture_filename = NULL;
+    video_t video = VIDEO_AUTO;
+    schedule_t schedule = {
+        .preamble_frames = SWEEP_PREAMBLE_FRAMES,
+        .hold_frames = SWEEP_HOLD_FRAMES,
+        .marker_frames = SWEEP_MARKER_FRAMES,
+        .steps = SWEEP_PERIODS
+    };
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp (argv [i], "--ntsc") == 0)
+        {
+            video = VIDEO_NTSC;
+        }
+        else if (strcmp (argv [i], "--pal") == 0)
+        {
+            video = VIDEO_PAL;
+        }
+        else if (strcmp (argv [i], "--hold") == 0 && i + 1 < argc)
+        {
+            schedule.hold_frames = strtoul (argv [++i], NULL, 10);
+        }
+        else if (strcmp (argv [i], "--marker") == 0 && i + 1 < argc)
+        {
+            schedule.marker_frames = strtoul (argv [++i], NULL, 10);
+        }
+        else if (capture_filename == NULL && argv [i][0] != '-')
+        {
+            capture_filename = argv [i];
+        }
+        else
+        {
+            capture_filename = NULL;
+            break;
+        }
+    }
+
+    if (capture_filename == NULL || schedule.hold_frames == 0 || schedule.marker_frames == 0)
+    {
+        fprintf (stderr, "Usage: %s [--ntsc | --pal] [--hold <frames>] [--marker <frames>] <capture.wav>\n", argv [0]);
+        return EXIT_FAILURE;
+    }
+
+    pitch_t *pitch = calloc (1, sizeof (pitch_t));
+    if (pitch == NULL)
+    {
+        fprintf (stderr, "Error: Failed to allocate memory for results.\n");
+        return EXIT_FAILURE;
+    }
+
+    steps_result_t result;
+    if (steps_follow (capture_filename, &schedule, video, pitch_measure, pitch, &result) == -1 || pitch->failed)
+    {
+        fft_free (&pitch->fft);
+        free (pitch->re);
+        free (pitch->im);
+        free (pitch->power);
+        free (pitch);
+        return EXIT_FAILURE;
+    }
+
+    double clock = video_clock (result.video);
+
+    printf ("Capture:   %s, %.3f s at %u Hz\n", capture_filename, result.duration, result.sample_rate);
+    if (result.preamble_time == 0.0)
+    {
+        printf ("Error: The sweep's preamble was not found.\n");
+    }
+    else
+    {
+        printf ("Clock:     %s, %.0f Hz%s\n", video_name (result.video), clock,
+                (video == VIDEO_AUTO) ? ", from the length of the preamble" : "");
+        printf ("Preamble:  ends at %.3f s, marker level %.1f dBFS\n", result.preamble_time, result.preamble_level);
+        printf ("Steps:     %u of %u found, %u markers missed\n", result.found, SWEEP_PERIODS, result.markers_missed);
+        printf ("\n");
+        printf ("%6s %12s %12s %10s %9s  %s\n", "Period", "Expected", "Measured", "Error", "Level", "Note");
+    }
+
+    double worst_error = 0.0;
+    uint32_t worst_period = 0;
+    uint32_t measured = 0;
+    uint32_t within_cent = 0;
+
+    for (uint32_t period = 0; period < SWEEP_PERIODS; period++)
+    {
+        const step_pitch_t *step = &pitch->steps [period];
+        double expected = period_frequency (clock, period);
+        bool near_nyquist = expected > NYQUIST_SHARE * result.sample_rate;
+        bool above_nyquist = expected > 0.5 * result.sample_rate;
+        bool silent = step->level < result.preamble_level - SILENT_DB;
+
+        if (!step->found)
+        {
+            continue;
+        }
+
+        printf ("%6u %9.2f Hz", period, expected);
+        if (silent)
+        {
+            printf (" %12s %10s", "-", "-");
+        }
+        else if (near_nyquist || period == 0)
+        {
+            printf (" %9.2f Hz %10s", step->frequency, "-");
+        }
+        else
+        {
+            double error = cents (step->frequency, expected);
+            printf (" %9.2f Hz %+5.2f cent", step->frequency, error);
+
+            if (fabs (error) > fabs (worst_error))
+            {
+                worst_error = error;
+                worst_period = period;
+            }
+            if (fabs (error) <= 1.0)
+            {
+                within_cent++;
+            }
+            measured++;
+        }
+        const char *note = pitch_note (period, step, silent, near_nyquist, above_nyquist, clock);
+        printf (" %6.1f dB%s%s\n", step->level, (note [0] != '\0') ? "  " : "", note);
+    }
+
+    if (measured > 0)
+    {
+        printf ("\n");
+        printf ("Largest error: %+.2f cents, at period %u\n", worst_error, worst_period);
+        printf ("Within one cent: %u of %u periods measured\n", within_cent, measured);
+    }
+
+    fft_free (&pitch->fft);
+    free (pitch->re);
+    free (pitch->im);
+    free (pitch->power);
+    free (pitch);
+
+    return (result.preamble_time == 0.0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,411 @@
+/*
+ * PSG-Measure
+ * Finding the steps of a ROM measurement mode in a capture.
+ *
+ * JoppyFurr 2024
+ *
+ * The ROM's measurement modes play a long marker of white noise, then hold
+ * each step for a fixed number of frames, with a short marker after each.
+ * The capture is scanned in short overlapping windows, and a window is taken
+ * to be marker when its spectrum is flat, loud, and has much of its power in
+ * the band where the noise has its energy. Tones have a spectrum of separate peaks,
+ * so are never flat within the band, and silence is never loud.
+ *
+ * The preamble gives the level of the marker, and its length tells NTSC from
+ * PAL. After that, each step is expected where the schedule puts it, relative
+ * to the end of the previous marker, so clock drift between the console and
+ * the recorder does not build up over the sweep. A marker that is not found
+ * where expected is assumed to be there anyway.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../PSG-Compare/source/dsp.h"
+#include "../../PSG-Compare/source/wav.h"
+#include "capture.h"
+#include "steps.h"
+
+#ifndef M_PI
+#define M_PI                3.14159265358979323846
+#endif
+
+/* Window length and spacing when looking for markers */
+#define DETECT_WINDOW_MS    20
+#define DETECT_HOP_MS       5
+
+/* The band in which the noise marker has most of its energy */
+#define MARKER_BAND_LOW     150.0
+#define MARKER_BAND_HIGH    3000.0
+
+/* A window is marker if its spectral flatness within the band, from 0 to 1, is above this,
+ * at least this much of its power is within the band, and it is loud enough. */
+#define MARKER_FLATNESS     0.25
+#define MARKER_BAND_SHARE   0.2
+#define PREAMBLE_LEVEL_DB   -50.0
+#define MARKER_LEVEL_DB     15.0    /* Below the preamble's level */
+
+/* Flatness is measured from a single window, so a run of marker may have gaps this long */
+#define MARKER_GAP_MS       20
+
+/* Each step is trimmed by this much at each end, or by a quarter of its length if shorter */
+#define STEP_GUARD_MS       40
+
+
+/* State for classifying windows of the capture */
+typedef struct detector_s {
+    fft_t fft;
+    uint32_t size;
+    uint32_t band_low;
+    uint32_t band_high;
+    double level_scale;
+    float *window;
+    float *re;
+    float *im;
+    float *power;
+} detector_t;
+
+/* A window of the capture, as classified by the detector */
+typedef struct detection_s {
+    bool marker;
+    double flatness;
+    double band_share;
+    double level;               /* dBFS */
+} detection_t;
+
+/* Progress through the schedule */
+typedef enum follow_state_e {
+    FOLLOW_PREAMBLE = 0,
+    FOLLOW_HOLD,
+    FOLLOW_MARKER,
+    FOLLOW_DONE
+} follow_state_t;
+
+
+/*
+ * Get the name of a video standard.
+ */
+const char *video_name (video_t video)
+{
+    return (video == VIDEO_PAL) ? "PAL" : "NTSC";
+}
+
+
+/*
+ * Get the PSG clock for a video standard.
+ */
+double video_clock (video_t video)
+{
+    return (video == VIDEO_PAL) ? CLOCK_PAL : CLOCK_NTSC;
+}
+
+
+/*
+ * Get the frame rate for a video standard.
+ */
+static double video_frame_rate (video_t video)
+{
+    return (video == VIDEO_PAL) ? FRAME_RATE_PAL : FRAME_RATE_NTSC;
+}
+
+
+/*
+ * Free the detector's buffers.
+ */
+static void detector_free (detector_t *detector)
+{
+    fft_free (&detector->fft);
+    free (detector->window);
+    free (detector->re);
+    free (detector->im);
+    free (detector->power);
+}
+
+
+/*
+ * Prepare the detector for a sample rate.
+ * Returns -1 on error.
+ */
+static int detector_init (detector_t *detector, uint32_t sample_rate)
+{
+    memset (detector, 0, sizeof (detector_t));
+
+    detector->size = fft_size_for ((uint64_t) sample_rate * DETECT_WINDOW_MS / 1000);
+    detector->band_low = ceil (MARKER_BAND_LOW * detector->size / sample_rate);
+    detector->band_high = floor (MARKER_BAND_HIGH * detector->size / sample_rate);
+    if (detector->band_high >= detector->size / 2)
+    {
+        detector->band_high = detector->size / 2 - 1;
+    }
+
+    if (fft_init (&detector->fft, detector->size) == -1)
+    {
+        return -1;
+    }
+
+    detector->window = malloc (detector->size * sizeof (float));
+    detector->re = malloc (detector->size * sizeof (float));
+    detector->im = malloc (detector->size * sizeof (float));
+    detector->power = malloc (detector->size * sizeof (float));
+
+    if (detector->window == NULL || detector->re == NULL || detector->im == NULL || detector->power == NULL)
+    {
+        detector_free (detector);
+        return -1;
+    }
+
+    /* Hann window, with the scale that turns the one-sided power back into a mean square */
+    for (uint32_t i = 0; i < detector->size; i++)
+    {
+        detector->window [i] = 0.5 - 0.5 * cos (2.0 * M_PI * i / detector->size);
+    }
+    detector->level_scale = 2.0 / (detector->size * dsp_dot (detector->window, detector->window, detector->size));
+
+    return 0;
+}
+
+
+/*
+ * Classify one window of the capture, given the level a marker must reach.
+ */
+static void detector_classify (detector_t *detector, const float *samples, double marker_level, detection_t *detection)
+{
+    uint32_t half = detector->size / 2;
+    double band_power = 0.0;
+    double band_log = 0.0;
+
+    dsp_multiply (detector->re, samples, detector->window, detector->size);
+    memset (detector->im, 0, detector->size * sizeof (float));
+    fft_forward (&detector->fft, detector->re, detector->im);
+
+    memset (detector->power, 0, half * sizeof (float));
+    dsp_power_accumulate (detector->power, detector->re, detector->im, half);
+
+    /* The lowest bins are left out, as captures often have a DC offset */
+    double total_power = dsp_sum (&detector->power [2], half - 2);
+
+    for (uint32_t k = detector->band_low; k <= detector->band_high; k++)
+    {
+        band_power += detector->power [k];
+        band_log += log (detector->power [k] + 1e-20);
+    }
+
+    uint32_t bins = detector->band_high - detector->band_low + 1;
+    double band_mean = band_power / bins;
+    double mean_square = total_power * detector->level_scale;
+
+    detection->flatness = (band_mean > 0.0) ? exp (band_log / bins) / band_mean : 0.0;
+    detection->band_share = (total_power > 0.0) ? band_power / total_power : 0.0;
+    detection->level = (mean_square > 0.0) ? 10.0 * log10 (mean_square) : -200.0;
+    detection->marker = detection->flatness > MARKER_FLATNESS && detection->band_share > MARKER_BAND_SHARE &&
+                        detection->level > marker_level;
+}
+
+
+/*
+ * Follow the schedule through a capture, calling back for each step found.
+ * Returns -1 on error.
+ */
+int steps_follow (const char *filename, const schedule_t *schedule, video_t video,
+                  step_callback_t callback, void *context, steps_result_t *result)
+{
+    capture_t capture;
+    detector_t detector;
+
+    memset (result, 0, sizeof (steps_result_t));
+
+    /* Two whole steps at the slower PAL frame rate is plenty of history */
+    double step_frames = schedule->hold_frames + schedule->marker_frames;
+    if (capture_open (&capture, filename, 2.0 * (step_frames + 2) / FRAME_RATE_PAL + 0.1) == -1)
+    {
+        return -1;
+    }
+
+    uint32_t sample_rate = capture.sample_rate;
+    if (detector_init (&detector, sample_rate) == -1)
+    {
+        fprintf (stderr, "Error: Failed to allocate memory for marker detection.\n");
+        capture_close (&capture);
+        return -1;
+    }
+
+    result->sample_rate = sample_rate;
+
+    uint64_t hop = (uint64_t) sample_rate * DETECT_HOP_MS / 1000;
+    uint64_t centre = detector.size / 2;
+    double marker_level = PREAMBLE_LEVEL_DB;
+    follow_state_t state = FOLLOW_PREAMBLE;
+
+    /* Lengths in samples, known once the preamble has given the video standard */
+    double frame_length = 0.0;
+    double hold_length = 0.0;
+    double marker_length = 0.0;
+    double hold_tolerance = 0.0;
+    double marker_tolerance = 0.0;
+    uint64_t guard = 0;
+
+    /* The current run of marker windows */
+    uint32_t gap_limit = MARKER_GAP_MS / DETECT_HOP_MS;
+    bool in_run = false;
+    uint32_t gap_windows = 0;
+    uint64_t gap_start = 0;
+    uint64_t run_start = 0;
+    uint64_t run_end = 0;
+    uint64_t run_windows = 0;
+    double run_level = 0.0;
+
+    uint32_t step = 0;
+    uint64_t step_start = 0;
+    uint64_t marker_start = 0;
+
+    for (uint64_t position = 0; state != FOLLOW_DONE; position += hop)
+    {
+        uint64_t keep = (state == FOLLOW_HOLD && step_start < position) ? step_start : position;
+        if (!capture_fill (&capture, position + detector.size, keep))
+        {
+            break;
+        }
+
+        detection_t detection;
+        detector_classify (&detector, capture_at (&capture, position), marker_level, &detection);
+
+        /* Times are taken at the centre of the window */
+        uint64_t time = position + centre;
+        bool run_began = false;
+        bool run_ended = false;
+
+        if (detection.marker)
+        {
+            if (!in_run)
+            {
+                in_run = true;
+                run_began = true;
+                run_start = time;
+                run_windows = 0;
+                run_level = 0.0;
+            }
+            gap_windows = 0;
+            run_windows++;
+            run_level += detection.level;
+        }
+        else if (in_run)
+        {
+            /* The run ends where its gap began, once the gap is too long */
+            if (gap_windows++ == 0)
+            {
+                gap_start = time;
+            }
+            if (gap_windows > gap_limit)
+            {
+                in_run = false;
+                run_ended = true;
+                run_end = gap_start;
+            }
+        }
+
+        switch (state)
+        {
+            case FOLLOW_PREAMBLE:
+            {
+                /* The preamble is the first marker of at least three quarters of its length at NTSC speed */
+                double run_seconds = (double) (run_end - run_start) / sample_rate;
+                if (!run_ended || run_seconds < 0.75 * schedule->preamble_frames / FRAME_RATE_NTSC)
+                {
+                    break;
+                }
+
+                if (video == VIDEO_AUTO)
+                {
+                    double midpoint = 0.5 * (schedule->preamble_frames / FRAME_RATE_NTSC +
+                                             schedule->preamble_frames / FRAME_RATE_PAL);
+                    video = (run_seconds > midpoint) ? VIDEO_PAL : VIDEO_NTSC;
+                }
+
+                frame_length = sample_rate / video_frame_rate (video);
+                hold_length = schedule->hold_frames * frame_length;
+                marker_length = schedule->marker_frames * frame_length;
+                hold_tolerance = 0.25 * hold_length;
+                marker_tolerance = 0.5 * marker_length;
+                guard = (uint64_t) sample_rate * STEP_GUARD_MS / 1000;
+                if (guard > hold_length / 4)
+                {
+                    guard = hold_length / 4;
+                }
+
+                result->video = video;
+                result->preamble_time = (double) run_end / sample_rate;
+                result->preamble_level = run_level / run_windows;
+                marker_level = result->preamble_level - MARKER_LEVEL_DB;
+
+                step_start = run_end;
+                state = FOLLOW_HOLD;
+                break;
+            }
+
+            case FOLLOW_HOLD:
+            {
+                double expected = step_start + hold_length;
+                bool found = run_began && fabs ((double) run_start - expected) <= hold_tolerance;
+
+                if (!found && time <= expected + hold_tolerance)
+                {
+                    break;
+                }
+
+                if (found)
+                {
+                    marker_start = run_start;
+                }
+                else
+                {
+                    marker_start = expected;
+                    result->markers_missed++;
+                }
+
+                if (marker_start > step_start + 2 * guard)
+                {
+                    callback (context, step, capture_at (&capture, step_start + guard),
+                              marker_start - step_start - 2 * guard, sample_rate);
+                    result->found++;
+                }
+                state = FOLLOW_MARKER;
+                break;
+            }
+
+            case FOLLOW_MARKER:
+            {
+                double expected = marker_start + marker_length;
+                bool found = run_ended && fabs ((double) run_end - expected) <= marker_tolerance;
+
+                if (!found && time <= expected + marker_tolerance)
+                {
+                    break;
+                }
+
+                if (++step == schedule->steps)
+                {
+                    state = FOLLOW_DONE;
+                    break;
+                }
+
+                step_start = found ? run_end : expected;
+                state = FOLLOW_HOLD;
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+
+    result->duration = (double) (capture.start + capture.count) / sample_rate;
+
+    capture_close (&capture);
+    detector_free (&detector);
+
+    return 0;
+}
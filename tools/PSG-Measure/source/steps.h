@@ -0,0 +1,51 @@
+/*
+ * PSG-Measure
+ * Finding the steps of a ROM measurement mode in a capture.
+ *
+ * JoppyFurr 2024
+ */
+
+/* PSG clocks, and frame rates from 228 clocks per line */
+#define CLOCK_NTSC          3579545.0
+#define CLOCK_PAL           3546893.0
+#define FRAME_RATE_NTSC     (CLOCK_NTSC / (228 * 262))
+#define FRAME_RATE_PAL      (CLOCK_PAL / (228 * 313))
+
+typedef enum video_e {
+    VIDEO_AUTO = 0,
+    VIDEO_NTSC,
+    VIDEO_PAL
+} video_t;
+
+/* How a ROM measurement mode lays out its steps, in frames. A long marker
+ * comes first, then each step is held, followed by a short marker. */
+typedef struct schedule_s {
+    uint32_t preamble_frames;
+    uint32_t hold_frames;
+    uint32_t marker_frames;
+    uint32_t steps;
+} schedule_t;
+
+/* What was found while following the schedule */
+typedef struct steps_result_s {
+    video_t video;
+    uint32_t sample_rate;
+    double duration;            /* Seconds of capture read */
+    double preamble_time;       /* Seconds, where the first step starts */
+    double preamble_level;      /* dBFS */
+    uint32_t found;
+    uint32_t markers_missed;
+} steps_result_t;
+
+/* Called with the held part of each step, trimmed of its edges. */
+typedef void (*step_callback_t) (void *context, uint32_t step, const float *samples, uint64_t count, uint32_t sample_rate);
+
+/* Follow the schedule through a capture, calling back for each step found. Returns -1 on error. */
+int steps_follow (const char *filename, const schedule_t *schedule, video_t video,
+                  step_callback_t callback, void *context, steps_result_t *result);
+
+/* Get the name of a video standard. */
+const char *video_name (video_t video);
+
+/* Get the PSG clock for a video standard. */
+double video_clock (video_t video);
@@ -1,2 +1,3 @@
 #!/bin/sh
 gcc source/main.c -o tapewave -std=c11 -Wall
+gcc source/tapecheck.c -o tapecheck -std=c11 -Wall -lm
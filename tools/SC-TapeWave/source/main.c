@@ -12,26 +12,101 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "turbo_loader.h"
+
 /* Note that samples in 8-bit wave files are unsigned. */
 #define WAVE_ZERO       "\xff\xff\xff\xff\x00\x00\x00\x00"
 #define WAVE_ONE        "\xff\xff\x00\x00\xff\xff\x00\x00"
-#define WAVE_SILENT     "\x80"
+#define WAVE_SILENT     0x80
+
+/* Bit image: one character per bit, with a space for each bit-length of silence. */
+#define BIT_ZERO        '0'
+#define BIT_ONE         '1'
+#define BIT_SILENT      ' '
+
+/* Each byte is sent as a start bit, eight data bits, and two stop bits. */
+#define SAMPLES_PER_BIT     8
+#define SAMPLES_PER_BYTE    (11 * SAMPLES_PER_BIT)
+
+/* Turbo encoding: each bit is a single cycle, at 2400 Hz for a zero, or 1600 Hz for a one. */
+#define TURBO_WAVE_ZERO     "\xff\xff\x00\x00"
+#define TURBO_WAVE_ONE      "\xff\xff\xff\x00\x00\x00"
+#define TURBO_PILOT_CYCLES  12000
+
+/* Samples are collected in memory and written to the file in large chunks. */
+#define OUTPUT_BUFFER_SIZE  65536
 
 static FILE *output_file = NULL;
+static bool output_bit_image = false;
 static int8_t checksum = 0;
 
+static uint8_t output_buffer [OUTPUT_BUFFER_SIZE];
+static uint32_t output_buffer_used = 0;
+
+/* Pre-generated samples for each possible byte value. */
+static uint8_t byte_samples [256] [SAMPLES_PER_BYTE];
+
+
+/*
+ * Write the contents of the output buffer to the output file.
+ */
+static void output_flush (void)
+{
+    fwrite (output_buffer, 1, output_buffer_used, output_file);
+    output_buffer_used = 0;
+}
+
+
+/*
+ * Add samples to the output buffer.
+ */
+static void output_samples (const uint8_t *samples, uint32_t count)
+{
+    while (count > 0)
+    {
+        uint32_t chunk = OUTPUT_BUFFER_SIZE - output_buffer_used;
+        if (chunk > count)
+        {
+            chunk = count;
+        }
+
+        memcpy (&output_buffer [output_buffer_used], samples, chunk);
+        output_buffer_used += chunk;
+        samples += chunk;
+        count -= chunk;
+
+        if (output_buffer_used == OUTPUT_BUFFER_SIZE)
+        {
+            output_flush ();
+        }
+    }
+}
+
 
 /*
  * Write a specified length of silence to the output file.
  */
 static void write_silent_ms (uint32_t length)
 {
-    /* 9.6 samples per ms. */
-    int samples = length * 96 / 10;
+    /* 9.6 samples per ms, or 1.2 bits per ms for the bit image. */
+    uint32_t samples = output_bit_image ? (length * 12 / 10) : (length * 96 / 10);
 
-    for (int i = 0; i < samples; i++)
+    while (samples > 0)
     {
-        fwrite (WAVE_SILENT, 1, 1, output_file);
+        uint32_t chunk = OUTPUT_BUFFER_SIZE - output_buffer_used;
+        if (chunk > samples)
+        {
+            chunk = samples;
+        }
+
+        memset (&output_buffer [output_buffer_used], output_bit_image ? BIT_SILENT : WAVE_SILENT, chunk);
+        output_buffer_used += chunk;
+        samples -= chunk;
+
+        if (output_buffer_used == OUTPUT_BUFFER_SIZE)
+        {
+            output_flush ();
+        }
     }
 }
 
@@ -41,28 +116,53 @@ static void write_silent_ms (uint32_t length)
  */
 static void write_bit (bool bit)
 {
-    /* Note: We have 8 samples per bit */
-    fwrite (bit ? WAVE_ONE : WAVE_ZERO, 1, 8, output_file);
+    if (output_bit_image)
+    {
+        uint8_t symbol = bit ? BIT_ONE : BIT_ZERO;
+        output_samples (&symbol, 1);
+    }
+    else
+    {
+        output_samples ((const uint8_t *) (bit ? WAVE_ONE : WAVE_ZERO), SAMPLES_PER_BIT);
+    }
 }
 
 
 /*
- * Write a byte to the wave file.
+ * Generate the samples for each possible byte value.
+ * For the bit image, each entry holds one character per bit.
  */
-static void write_byte (uint8_t byte)
+static void byte_samples_init (void)
 {
-    /* Start bit */
-    write_bit (0);
-
-    /* Data bits */
-    for (int i = 0; i < 8; i++)
+    for (int byte = 0; byte < 256; byte++)
     {
-        write_bit ((byte >> i) & 1);
+        uint8_t *samples = byte_samples [byte];
+        uint16_t bits = 0x600 | (byte << 1);    /* Start bit, data bits, and two stop bits */
+
+        for (int i = 0; i < 11; i++)
+        {
+            bool bit = (bits >> i) & 1;
+
+            if (output_bit_image)
+            {
+                *samples++ = bit ? BIT_ONE : BIT_ZERO;
+            }
+            else
+            {
+                memcpy (samples, bit ? WAVE_ONE : WAVE_ZERO, SAMPLES_PER_BIT);
+                samples += SAMPLES_PER_BIT;
+            }
+        }
     }
+}
 
-    /* Stop bits */
-    write_bit (1);
-    write_bit (1);
+
+/*
+ * Write a byte to the wave file.
+ */
+static void write_byte (uint8_t byte)
+{
+    output_samples (byte_samples [byte], output_bit_image ? 11 : SAMPLES_PER_BYTE);
 
     checksum += byte;
 }
@@ -71,7 +171,7 @@ static void write_byte (uint8_t byte)
 /*
  * Write the tape to the wave file.
  */
-static void write_tape (const char *name, uint16_t program_length, uint8_t *program)
+static void write_tape (const char *name, uint16_t program_length, const uint8_t *program)
 {
     int name_length = strlen (name);
 
@@ -137,6 +237,82 @@ static void write_tape (const char *name, uint16_t program_length, uint8_t *prog
 }
 
 
+/*
+ * Write a single bit to the wave file, using the turbo encoding.
+ */
+static void write_turbo_bit (bool bit)
+{
+    if (bit)
+    {
+        output_samples ((const uint8_t *) TURBO_WAVE_ONE, 6);
+    }
+    else
+    {
+        output_samples ((const uint8_t *) TURBO_WAVE_ZERO, 4);
+    }
+}
+
+
+/*
+ * Write a byte to the wave file, using the turbo encoding.
+ */
+static void write_turbo_byte (uint8_t byte)
+{
+    /* Most significant bit first */
+    for (int i = 7; i >= 0; i--)
+    {
+        write_turbo_bit ((byte >> i) & 1);
+    }
+
+    checksum += byte;
+}
+
+
+/*
+ * Write the program to the wave file as a turbo block, to be read by the turbo loader.
+ */
+static void write_turbo_block (uint16_t program_length, const uint8_t *program)
+{
+    /* One second of silence */
+    write_silent_ms (1000);
+
+    /* Write the pilot tone. This is kept long, to allow
+     * time for the turbo loader to be started using CALL. */
+    for (int i = 0; i < TURBO_PILOT_CYCLES; i++)
+    {
+        write_turbo_bit (0);
+    }
+
+    /* Write the sync cycle */
+    write_turbo_bit (1);
+    checksum = 0;
+
+    /* Write the header */
+    write_turbo_byte (TURBO_LOAD_ADDRESS & 0xff);
+    write_turbo_byte (TURBO_LOAD_ADDRESS >> 8);
+    write_turbo_byte (program_length & 0xff);
+    write_turbo_byte (program_length >> 8);
+
+    /* Write the program */
+    for (int i = 0; i < program_length; i++)
+    {
+        write_turbo_byte (program [i]);
+    }
+
+    /* Write the parity byte */
+    write_turbo_byte (-checksum);
+
+    /* A few trailing cycles, so that the final bit is followed by an edge */
+    for (int i = 0; i < 8; i++)
+    {
+        write_turbo_bit (0);
+    }
+
+    /* Write a short silent section. */
+    write_silent_ms (10);
+}
+
+
 /*
  * Entry point.
  *
@@ -162,11 +338,20 @@ int main (int argc, char **argv)
     fpos_t data_size_pos;
 
     const char *argv_0 = argv [0];
+    bool turbo = false;
+
+    /* Turbo loader */
+    if (argc > 1 && strcmp (argv [1], "--turbo") == 0)
+    {
+        turbo = true;
+        argv++;
+        argc--;
+    }
 
     /* Check parameters */
     if (argc != 4)
     {
-        fprintf (stderr, "Usage: %s <name-on-tape> <input-file> <output-file.wav>\n", argv_0);
+        fprintf (stderr, "Usage: %s [--turbo] <name-on-tape> <input-file> <output-file.wav|.bit>\n", argv_0);
         return EXIT_FAILURE;
     }
 
@@ -174,14 +359,28 @@ int main (int argc, char **argv)
     const char *input_filename =  argv [2];
     const char *output_filename = argv [3];
 
-    /* Check for the .wav extension in the output filename */
+    /* Check for the .wav or .bit extension in the output filename */
     const char *output_extension = strrchr (output_filename, '.');
-    if (output_extension == NULL || strlen(output_extension) != 4 ||
+    if (output_extension != NULL && strlen(output_extension) == 4 &&
+        tolower (output_extension [1]) == 'b' &&
+        tolower (output_extension [2]) == 'i' &&
+        tolower (output_extension [3]) == 't')
+    {
+        output_bit_image = true;
+    }
+    else if (output_extension == NULL || strlen(output_extension) != 4 ||
         tolower (output_extension [1]) != 'w' ||
         tolower (output_extension [2]) != 'a' ||
         tolower (output_extension [3]) != 'v')
     {
-        fprintf (stderr, "Output file must have '.wav' extension.\n");
+        fprintf (stderr, "Output file must have '.wav' or '.bit' extension.\n");
+        return EXIT_FAILURE;
+    }
+
+    /* The turbo block's timing cannot be described by a bit image */
+    if (turbo && output_bit_image)
+    {
+        fprintf (stderr, "Error: Turbo loading is only available for '.wav' output.\n");
         return EXIT_FAILURE;
     }
 
@@ -203,6 +402,13 @@ int main (int argc, char **argv)
         return EXIT_FAILURE;
     }
 
+    /* The turbo loader cannot load an empty program */
+    if (turbo && program_length == 0)
+    {
+        fprintf (stderr, "Error: Program '%s' is empty.\n", input_filename);
+        return EXIT_FAILURE;
+    }
+
     /* Copy the input file into a buffer */
     uint8_t *program_buffer = calloc (program_length, 1);
     if (program_buffer == NULL)
@@ -224,6 +430,17 @@ int main (int argc, char **argv)
         return EXIT_FAILURE;
     }
 
+    /* The bit image has no header, just the bits */
+    if (output_bit_image)
+    {
+        byte_samples_init ();
+        write_tape (tape_name, program_length, program_buffer);
+        output_flush ();
+        fclose (output_file);
+
+        return EXIT_SUCCESS;
+    }
+
     /* Write RIFF header */
     fwrite ("RIFF", 1, 4, output_file);
     fgetpos (output_file, &riff_size_pos);
@@ -244,7 +461,18 @@ int main (int argc, char **argv)
     fwrite ("data", 1, 4, output_file);
     fgetpos (output_file, &data_size_pos);
     fwrite (&data_size, 1, 4, output_file);
-    write_tape (tape_name, program_length, program_buffer);
+    byte_samples_init ();
+    if (turbo)
+    {
+        /* The turbo loader is loaded by BASIC, and then loads the program */
+        write_tape (tape_name, sizeof (turbo_loader), turbo_loader);
+        write_turbo_block (program_length, program_buffer);
+    }
+    else
+    {
+        write_tape (tape_name, program_length, program_buffer);
+    }
+    output_flush ();
 
     /* Get size */
     output_file_size = ftell (output_file);
@@ -0,0 +1,882 @@
+/*
+ * SC-TapeWave
+ * A tool to decode and check SC-3000 tape audio.
+ *
+ * JoppyFurr 2024
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "turbo_loader.h"
+
+/* Wave files are read in chunks of this many bytes. */
+#define INPUT_BUFFER_SIZE   65536
+
+/* Nominal length of a short (2400 Hz) half-cycle in microseconds. Long half-cycles
+ * are twice this in the standard format (1200 Hz), and 1.5 times in the turbo format (1600 Hz). */
+#define HALF_SHORT_US       208.3
+
+/* A gap with no edges longer than this ends any block being read. */
+#define GAP_US              1500.0
+
+/* Ignore half-cycles shorter than this, which can only be noise. */
+#define GLITCH_US           50.0
+
+/* A run of this many short half-cycles is taken as a turbo pilot tone. */
+#define TURBO_PILOT_HALVES  512
+
+/* Where the decoder is in the tape */
+typedef enum tape_state_e {
+    STATE_HEADER_KEY = 0,
+    STATE_HEADER,
+    STATE_PROGRAM_KEY,
+    STATE_PROGRAM,
+    STATE_TURBO_PILOT,
+    STATE_TURBO,
+    STATE_DONE
+} tape_state_t;
+
+/* Input wave file */
+static FILE *input_file = NULL;
+static uint8_t input_buffer [INPUT_BUFFER_SIZE];
+static uint32_t input_buffer_used = 0;
+static uint32_t input_buffer_position = 0;
+static uint32_t data_remaining = 0;
+
+static uint16_t format_type = 0;
+static uint16_t format_channels = 0;
+static uint32_t format_sample_rate = 0;
+static uint16_t format_bits_per_sample = 0;
+static uint16_t format_block_align = 0;
+
+/* Bit slicer */
+static double sample_time_us = 0.0;
+static double filter_level = 0.0;
+static double dc_level = 0.0;
+static double envelope = 0.0;
+static double envelope_slow = 0.0;
+static double previous_level = 0.0;
+static double last_crossing_us = 0.0;
+static double last_edge_us = 0.0;
+static bool slicer_high = false;
+
+/* Length of a short half-cycle, tracked to follow the speed of the tape */
+static double short_half_us = HALF_SHORT_US;
+
+/* Standard format bit and byte framing */
+static uint32_t bit_units = 0;
+static uint32_t bit_longs = 0;
+static double bit_length_us = 0.0;
+static uint32_t one_run = 0;
+static uint32_t byte_bits = 0;
+static uint16_t byte_value = 0;
+
+/* Turbo format bit and byte framing */
+static uint32_t turbo_short_run = 0;
+static uint32_t turbo_halves = 0;
+static double turbo_cycle_us = 0.0;
+static bool turbo_synced = false;
+
+/* Tape contents */
+static tape_state_t state = STATE_HEADER_KEY;
+static bool turbo = false;
+static FILE *output_file = NULL;
+static uint8_t checksum = 0;
+static uint32_t block_position = 0;
+static uint8_t header [20];
+static uint16_t program_length = 0;
+static uint16_t turbo_length = 0;
+static uint32_t errors = 0;
+
+
+/*
+ * Report an error in the tape, along with its position.
+ */
+static void tape_error (const char *message)
+{
+    fprintf (stderr, "Error at %.3f s: %s\n", sample_time_us / 1000000.0, message);
+    errors++;
+}
+
+
+/*
+ * Read a little-endian value from a byte buffer.
+ */
+static uint32_t read_le (const uint8_t *bytes, uint32_t size)
+{
+    uint32_t value = 0;
+
+    for (uint32_t i = 0; i < size; i++)
+    {
+        value |= (uint32_t) bytes [i] << (i * 8);
+    }
+
+    return value;
+}
+
+
+/*
+ * Read the RIFF headers, leaving the input file at the start of the sample data.
+ */
+static int wav_open (void)
+{
+    uint8_t chunk [8];
+    uint8_t riff [12];
+    bool found_format = false;
+
+    if (fread (riff, 1, 12, input_file) != 12 || memcmp (riff, "RIFF", 4) != 0 || memcmp (&riff [8], "WAVE", 4) != 0)
+    {
+        fprintf (stderr, "Error: Input is not a wave file.\n");
+        return -1;
+    }
+
+    while (fread (chunk, 1, 8, input_file) == 8)
+    {
+        uint32_t chunk_size = read_le (&chunk [4], 4);
+
+        if (memcmp (chunk, "fmt ", 4) == 0)
+        {
+            uint8_t format [40] = { };
+            uint32_t format_length = (chunk_size < 40) ? chunk_size : 40;
+
+            if (chunk_size < 16 || fread (format, 1, format_length, input_file) != format_length)
+            {
+                break;
+            }
+
+            format_type             = read_le (&format [0], 2);
+            format_channels         = read_le (&format [2], 2);
+            format_sample_rate      = read_le (&format [4], 4);
+            format_block_align      = read_le (&format [12], 2);
+            format_bits_per_sample  = read_le (&format [14], 2);
+
+            /* WAVE_FORMAT_EXTENSIBLE keeps the real format in its sub-format GUID */
+            if (format_type == 0xfffe && chunk_size >= 40)
+            {
+                format_type = read_le (&format [24], 2);
+            }
+
+            found_format = true;
+            if (chunk_size > 40)
+            {
+                fseek (input_file, chunk_size - 40, SEEK_CUR);
+            }
+        }
+        else if (memcmp (chunk, "data", 4) == 0)
+        {
+            if (!found_format)
+            {
+                break;
+            }
+
+            data_remaining = chunk_size;
+            return 0;
+        }
+        else
+        {
+            fseek (input_file, chunk_size, SEEK_CUR);
+        }
+
+        /* Chunks are padded to an even length */
+        if (chunk_size & 1)
+        {
+            fseek (input_file, 1, SEEK_CUR);
+        }
+    }
+
+    fprintf (stderr, "Error: No sample data found in wave file.\n");
+    return -1;
+}
+
+
+/*
+ * Check that the wave format is one that can be read.
+ */
+static int wav_check_format (void)
+{
+    bool pcm = (format_type == 1) && (format_bits_per_sample == 8  || format_bits_per_sample == 16 ||
+                                       format_bits_per_sample == 24 || format_bits_per_sample == 32);
+    bool ieee_float = (format_type == 3) && (format_bits_per_sample == 32);
+
+    if (!(pcm || ieee_float) || format_channels == 0 || format_sample_rate == 0 ||
+        format_block_align != format_channels * format_bits_per_sample / 8)
+    {
+        fprintf (stderr, "Error: Unsupported wave format (type %u, %u channels, %u-bit).\n",
+                 format_type, format_channels, format_bits_per_sample);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/*
+ * Read the next frame from the wave file, mixed down to a single sample in the range -1 to +1.
+ * Returns false once there are no more frames.
+ */
+static bool wav_read_frame (double *sample)
+{
+    uint32_t bytes_per_sample = format_bits_per_sample / 8;
+    double sum = 0.0;
+
+    if (input_buffer_used - input_buffer_position < format_block_align)
+    {
+        /* Keep whole frames together, moving any partial frame to the start of the buffer */
+        uint32_t leftover = input_buffer_used - input_buffer_position;
+        memmove (input_buffer, &input_buffer [input_buffer_position], leftover);
+        input_buffer_position = 0;
+        input_buffer_used = leftover;
+
+        uint32_t request = INPUT_BUFFER_SIZE - leftover;
+        if (request > data_remaining)
+        {
+            request = data_remaining;
+        }
+
+        uint32_t bytes_read = fread (&input_buffer [leftover], 1, request, input_file);
+        input_buffer_used += bytes_read;
+        data_remaining -= bytes_read;
+
+        /* Stop early if the file has been truncated */
+        if (bytes_read < request)
+        {
+            data_remaining = 0;
+        }
+
+        if (input_buffer_used < format_block_align)
+        {
+            return false;
+        }
+    }
+
+    const uint8_t *frame = &input_buffer [input_buffer_position];
+    input_buffer_position += format_block_align;
+
+    for (uint32_t channel = 0; channel < format_channels; channel++)
+    {
+        const uint8_t *bytes = &frame [channel * bytes_per_sample];
+        uint32_t raw = read_le (bytes, bytes_per_sample);
+
+        if (format_type == 3)
+        {
+            float value;
+            memcpy (&value, &raw, sizeof (value));
+            sum += value;
+        }
+        else if (bytes_per_sample == 1)
+        {
+            /* 8-bit samples are unsigned */
+            sum += ((int32_t) raw - 128) / 128.0;
+        }
+        else
+        {
+            /* Sign-extend from the top bit of the sample */
+            uint32_t bits = bytes_per_sample * 8;
+            int64_t value = (raw ^ (1u << (bits - 1))) - (int64_t) (1u << (bits - 1));
+            sum += value / (double) (1u << (bits - 1));
+        }
+    }
+
+    *sample = sum / format_channels;
+    return true;
+}
+
+
+/*
+ * Follow the speed of the tape using the length of the short half-cycles in a
+ * leader or pilot tone.
+ *
+ * Only long runs of short half-cycles are used, so that noise between blocks
+ * cannot drag the estimate away, and it is kept within 25% of the nominal speed.
+ */
+static void track_short_half (double length_us)
+{
+    short_half_us += (length_us - short_half_us) / 64.0;
+
+    if (short_half_us < HALF_SHORT_US * 0.75)
+    {
+        short_half_us = HALF_SHORT_US * 0.75;
+    }
+    else if (short_half_us > HALF_SHORT_US * 1.25)
+    {
+        short_half_us = HALF_SHORT_US * 1.25;
+    }
+}
+
+
+/*
+ * Report a framing error in the standard format. Between blocks, noise
+ * can look like a broken byte, so only errors within a block are reported.
+ */
+static void frame_error (const char *message)
+{
+    if (state == STATE_HEADER || state == STATE_PROGRAM)
+    {
+        tape_error (message);
+    }
+}
+
+
+/*
+ * Start a new byte in the standard format.
+ */
+static void frame_reset (void)
+{
+    bit_units = 0;
+    bit_longs = 0;
+    byte_bits = 0;
+    one_run = 0;
+}
+
+
+/*
+ * Write a byte of the program to the output file.
+ */
+static void output_byte (uint8_t byte)
+{
+    if (output_file != NULL)
+    {
+        fputc (byte, output_file);
+    }
+}
+
+
+/*
+ * Process a byte read in the standard format.
+ */
+static void tape_byte (uint8_t byte)
+{
+    switch (state)
+    {
+        case STATE_HEADER_KEY:
+            /* Anything before the key-code, such as dummy bytes, is skipped */
+            if (byte == 0x16)
+            {
+                state = STATE_HEADER;
+                block_position = 0;
+                checksum = 0;
+            }
+            break;
+
+        case STATE_HEADER:
+            header [block_position++] = byte;
+            checksum += byte;
+
+            /* Name, length, and parity */
+            if (block_position == 19)
+            {
+                program_length = (header [16] << 8) | header [17];
+                printf ("Header:  \"%.16s\", %u bytes, parity %s\n", header, program_length,
+                        checksum == 0 ? "ok" : "bad");
+
+                if (checksum != 0)
+                {
+                    tape_error ("Header parity check failed");
+                }
+
+                state = STATE_PROGRAM_KEY;
+            }
+            break;
+
+        case STATE_PROGRAM_KEY:
+            if (byte == 0x16)
+            {
+                tape_error ("Header repeated before program");
+                state = STATE_HEADER;
+                block_position = 0;
+                checksum = 0;
+            }
+            else if (byte == 0x17)
+            {
+                state = STATE_PROGRAM;
+                block_position = 0;
+                checksum = 0;
+            }
+            break;
+
+        case STATE_PROGRAM:
+            checksum += byte;
+
+            /* The program, followed by its parity byte */
+            if (block_position < program_length)
+            {
+                /* With the turbo loader, only the program in the turbo block is output */
+                if (turbo)
+                {
+                    if (block_position >= sizeof (turbo_loader) || byte != turbo_loader [block_position])
+                    {
+                        tape_error ("Program does not match the turbo loader");
+                        turbo = false;
+                    }
+                }
+                else
+                {
+                    output_byte (byte);
+                }
+
+                block_position++;
+            }
+            else
+            {
+                printf ("Program: %u bytes, parity %s\n", program_length, checksum == 0 ? "ok" : "bad");
+
+                if (checksum != 0)
+                {
+                    tape_error ("Program parity check failed");
+                }
+
+                if (turbo && program_length != sizeof (turbo_loader))
+                {
+                    tape_error ("Program does not match the turbo loader");
+                    turbo = false;
+                }
+
+                state = turbo ? STATE_TURBO_PILOT : STATE_DONE;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+/*
+ * Process a bit read in the standard format.
+ *
+ * Each byte is a start bit (zero), eight data bits, least significant first,
+ * and two stop bits (ones). The leader is a long run of ones.
+ */
+static void frame_bit (bool bit)
+{
+    if (byte_bits == 0)
+    {
+        /* Idle, waiting for a start bit */
+        if (bit == 0)
+        {
+            byte_bits = 1;
+            byte_value = 0;
+        }
+    }
+    else if (byte_bits <= 8)
+    {
+        byte_value |= bit << (byte_bits - 1);
+        byte_bits++;
+    }
+    else
+    {
+        /* First stop bit. The second is absorbed while idle. */
+        if (bit == 1)
+        {
+            tape_byte (byte_value);
+        }
+        else
+        {
+            frame_error ("Missing stop bit");
+        }
+        byte_bits = 0;
+    }
+}
+
+
+/*
+ * Process a half-cycle in the standard format.
+ *
+ * A zero is one cycle at 1200 Hz, making two long half-cycles. A one is two
+ * cycles at 2400 Hz, making four short half-cycles. Counting a short half as
+ * one unit and a long half as two, every bit is four units long.
+ */
+static void frame_half (double length_us)
+{
+    bool is_long = length_us > short_half_us * 1.5;
+
+    if (is_long)
+    {
+        if (bit_units == 2 && bit_longs == 1)
+        {
+            bit_units = 0;
+            bit_longs = 0;
+            one_run = 0;
+            frame_bit (0);
+        }
+        else
+        {
+            /* The first half of a zero. Any short halves before it
+             * were not a complete bit, so are dropped to regain sync. */
+            if (bit_units != 0 && byte_bits != 0)
+            {
+                frame_error ("Incomplete bit");
+                byte_bits = 0;
+            }
+            bit_units = 2;
+            bit_longs = 1;
+        }
+    }
+    else
+    {
+        if (bit_longs != 0)
+        {
+            if (byte_bits != 0)
+            {
+                frame_error ("Incomplete bit");
+                byte_bits = 0;
+            }
+            bit_units = 0;
+            bit_longs = 0;
+        }
+
+        bit_length_us = (bit_units == 0) ? length_us : bit_length_us + length_us;
+
+        if (++bit_units == 4)
+        {
+            bit_units = 0;
+            if (++one_run >= 8 && bit_length_us > short_half_us * 3.0)
+            {
+                track_short_half (bit_length_us / 4.0);
+            }
+            frame_bit (1);
+        }
+    }
+}
+
+
+/*
+ * Process a half-cycle in the turbo format.
+ *
+ * After a pilot of short cycles, the first half of the long sync cycle sets
+ * the phase. Each following bit is a single cycle, short for zero and long for
+ * one, with the bytes sent most significant bit first.
+ */
+static void turbo_half (double length_us)
+{
+    bool is_long = length_us > short_half_us * 1.25;
+
+    if (state == STATE_TURBO_PILOT)
+    {
+        if (!is_long && length_us > short_half_us * 0.75)
+        {
+            if (++turbo_short_run >= 16)
+            {
+                track_short_half (length_us);
+            }
+        }
+        else if (turbo_short_run >= TURBO_PILOT_HALVES)
+        {
+            /* First half of the sync cycle */
+            state = STATE_TURBO;
+            turbo_synced = false;
+            turbo_halves = 0;
+            block_position = 0;
+            checksum = 0;
+            byte_bits = 0;
+            byte_value = 0;
+        }
+        else
+        {
+            turbo_short_run = 0;
+        }
+        return;
+    }
+
+    /* Second half of the sync cycle. If it is not also long, the
+     * first half was noise in the pilot, so go back to the pilot. */
+    if (!turbo_synced)
+    {
+        if (is_long)
+        {
+            turbo_synced = true;
+        }
+        else
+        {
+            state = STATE_TURBO_PILOT;
+        }
+        return;
+    }
+
+    /* Measure full cycles, as the two halves may not be equal on a real recording */
+    if (turbo_halves++ == 0)
+    {
+        turbo_cycle_us = length_us;
+        return;
+    }
+    turbo_cycle_us += length_us;
+    turbo_halves = 0;
+
+    byte_value = (byte_value << 1) | (turbo_cycle_us > short_half_us * 2.5);
+    if (++byte_bits < 8)
+    {
+        return;
+    }
+
+    uint8_t byte = byte_value;
+    byte_bits = 0;
+    byte_value = 0;
+    checksum += byte;
+
+    /* Four byte header, the program, and the parity byte */
+    if (block_position < 4)
+    {
+        header [block_position] = byte;
+    }
+    else if (block_position - 4 < turbo_length)
+    {
+        output_byte (byte);
+    }
+
+    block_position++;
+
+    if (block_position == 4)
+    {
+        turbo_length = header [2] | (header [3] << 8);
+    }
+    else if (block_position == turbo_length + 5u)
+    {
+        uint16_t address = header [0] | (header [1] << 8);
+        printf ("Turbo:   %u bytes at 0x%04x, parity %s\n", turbo_length, address, checksum == 0 ? "ok" : "bad");
+
+        if (checksum != 0)
+        {
+            tape_error ("Turbo block parity check failed");
+        }
+        if (address != TURBO_LOAD_ADDRESS)
+        {
+            tape_error ("Unexpected turbo block load address");
+        }
+
+        state = STATE_DONE;
+    }
+}
+
+
+/*
+ * Handle a gap in the signal, where no edges have been seen.
+ */
+static void tape_gap (void)
+{
+    switch (state)
+    {
+        case STATE_HEADER:
+            tape_error ("Header block cut short");
+            state = STATE_HEADER_KEY;
+            break;
+
+        case STATE_PROGRAM:
+            tape_error ("Program block cut short");
+            state = STATE_PROGRAM_KEY;
+            break;
+
+        case STATE_TURBO:
+            tape_error ("Turbo block cut short");
+            state = STATE_TURBO_PILOT;
+            break;
+
+        default:
+            break;
+    }
+
+    frame_reset ();
+    turbo_short_run = 0;
+}
+
+
+/*
+ * Process the time between two edges of the signal.
+ */
+static void tape_half (double length_us)
+{
+    if (length_us > GAP_US)
+    {
+        tape_gap ();
+    }
+    else if (state == STATE_TURBO_PILOT || state == STATE_TURBO)
+    {
+        turbo_half (length_us);
+    }
+    else if (state != STATE_DONE)
+    {
+        frame_half (length_us);
+    }
+}
+
+
+/*
+ * Bit slicer, finding the edges of the tape signal.
+ *
+ * High sample rates are first low-pass filtered, as the tape signal has
+ * nothing of use above a few kHz. The DC level is removed with a slow moving
+ * average, and a Schmitt trigger with hysteresis proportional to the signal's
+ * envelope rejects noise. A slower envelope keeps the hysteresis up through
+ * the silence between blocks, so that tape hiss is not taken for a signal. The
+ * edge time is taken from the zero crossing that came before the trigger,
+ * interpolated between samples, so that timing does not depend on the
+ * amplitude of the signal.
+ */
+static void slicer_sample (double sample)
+{
+    double sample_period_us = 1000000.0 / format_sample_rate;
+
+    /* Single-pole low-pass filter, with a time constant of about 25 us (6.4 kHz) */
+    if (sample_period_us < 25.0)
+    {
+        filter_level += (sample - filter_level) * (sample_period_us / 25.0);
+        sample = filter_level;
+    }
+
+    /* Time constants of about 5 ms for the DC level, 20 ms for the envelope, and 1 s for the slow envelope */
+    dc_level += (sample - dc_level) * (sample_period_us / 5000.0);
+    double level = sample - dc_level;
+
+    if (fabs (level) > envelope)
+    {
+        envelope = fabs (level);
+    }
+    else
+    {
+        envelope -= envelope * (sample_period_us / 20000.0);
+    }
+
+    if (fabs (level) > envelope_slow)
+    {
+        envelope_slow = fabs (level);
+    }
+    else
+    {
+        envelope_slow -= envelope_slow * (sample_period_us / 1000000.0);
+    }
+
+    /* A crossing between the previous sample and this one */
+    if ((level >= 0.0) != (previous_level >= 0.0))
+    {
+        double fraction = previous_level / (previous_level - level);
+        last_crossing_us = sample_time_us - sample_period_us + fraction * sample_period_us;
+    }
+    previous_level = level;
+
+    /* Schmitt trigger, ignoring anything quieter than about -40 dBFS */
+    double hysteresis = envelope * 0.25;
+    if (hysteresis < envelope_slow * 0.1)
+    {
+        hysteresis = envelope_slow * 0.1;
+    }
+    if (hysteresis < 0.01)
+    {
+        hysteresis = 0.01;
+    }
+
+    if ((slicer_high && level < -hysteresis) || (!slicer_high && level > hysteresis))
+    {
+        slicer_high = !slicer_high;
+
+        double length_us = last_crossing_us - last_edge_us;
+        if (length_us >= GLITCH_US)
+        {
+            tape_half (length_us);
+        }
+        last_edge_us = last_crossing_us;
+    }
+
+    /* Report gaps as they happen, so that a block ending in silence is noticed */
+    if (sample_time_us - last_edge_us > GAP_US && sample_time_us - sample_period_us - last_edge_us <= GAP_US)
+    {
+        tape_gap ();
+    }
+
+    sample_time_us += sample_period_us;
+}
+
+
+/*
+ * Entry point.
+ */
+int main (int argc, char **argv)
+{
+    const char *argv_0 = argv [0];
+
+    /* Turbo loader */
+    if (argc > 1 && strcmp (argv [1], "--turbo") == 0)
+    {
+        turbo = true;
+        argv++;
+        argc--;
+    }
+
+    /* Check parameters */
+    if (argc != 2 && argc != 3)
+    {
+        fprintf (stderr, "Usage: %s [--turbo] <input-file.wav> [output-file]\n", argv_0);
+        return EXIT_FAILURE;
+    }
+
+    const char *input_filename =  argv [1];
+    const char *output_filename = (argc == 3) ? argv [2] : NULL;
+
+    /* Open the input file */
+    input_file = fopen (input_filename, "rb");
+    if (input_file == NULL)
+    {
+        fprintf (stderr, "Failed to open input file '%s'.\n", input_filename);
+        return EXIT_FAILURE;
+    }
+
+    if (wav_open () != 0 || wav_check_format () != 0)
+    {
+        fclose (input_file);
+        return EXIT_FAILURE;
+    }
+
+    /* Open the output file */
+    if (output_filename != NULL)
+    {
+        output_file = fopen (output_filename, "wb");
+        if (output_file == NULL)
+        {
+            fprintf (stderr, "Failed to open output file '%s'.\n", output_filename);
+            fclose (input_file);
+            return EXIT_FAILURE;
+        }
+    }
+
+    /* Decode the tape, a frame at a time */
+    double sample;
+    while (state != STATE_DONE && wav_read_frame (&sample))
+    {
+        slicer_sample (sample);
+    }
+
+    /* Check that the tape was complete */
+    switch (state)
+    {
+        case STATE_HEADER_KEY:
+            tape_error ("No header block found");
+            break;
+
+        case STATE_PROGRAM_KEY:
+            tape_error ("No program block found");
+            break;
+
+        case STATE_TURBO_PILOT:
+            tape_error ("No turbo block found");
+            break;
+
+        case STATE_DONE:
+            break;
+
+        default:
+            /* A block was still being read */
+            tape_gap ();
+            break;
+    }
+
+    fclose (input_file);
+    if (output_file != NULL)
+    {
+        fclose (output_file);
+    }
+
+    return (errors == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,129 @@
+/*
+ * SC-TapeWave
+ * A tool to generate SC-3000 tape audio.
+ *
+ * JoppyFurr 2024
+ */
+
+/*
+ * Turbo loader, written to tape at the standard speed.
+ *
+ * BASIC loads this to 0x9800, where the program will also be loaded. So the
+ * first step, once called, is to copy the loader to 0x9700 and continue from
+ * there. The program is then read from the cassette input on bit 7 of the PPI
+ * port B, measuring the length of each cycle by counting iterations of a
+ * 29 T-state polling loop.
+ *
+ * The turbo block is made up of:
+ *  - A pilot tone of short cycles. 256 in a row are needed before looking for sync.
+ *  - A sync cycle, the first long cycle. Its first half is used to find the
+ *    phase of the signal, so that each following cycle is measured in full.
+ *  - A four byte header, the load address followed by the length, both little-endian.
+ *  - The program, followed by a parity byte, which brings the sum of all bytes to zero.
+ *
+ * Each bit is a single cycle, short for zero and long for one, sent MSB first.
+ * If the parity check fails, the backdrop is set to red and the loader stops.
+ * Otherwise, the program is started from its load address.
+ */
+
+#define TURBO_LOAD_ADDRESS      0x9800
+
+/* Threshold between short and long cycles, in polling loop iterations.
+ * At 3.58 MHz, a short cycle is about 51 iterations, and a long cycle 77.
+ * Time spent outside of the polling loop brings both down by a few. */
+#define TURBO_THRESHOLD         60
+
+static const uint8_t turbo_loader [] = {
+
+    /* Bootstrap, runs at 0x9800 */
+    0xf3,                   /* 9800:  di                        */
+    0x21, 0x0f, 0x98,       /* 9801:  ld hl, 0x980f             */
+    0x11, 0x00, 0x97,       /* 9804:  ld de, 0x9700             */
+    0x01, 0x7b, 0x00,       /* 9807:  ld bc, 0x007b             */
+    0xed, 0xb0,             /* 980a:  ldir                      */
+    0xc3, 0x00, 0x97,       /* 980c:  jp 0x9700                 */
+
+    /* Loader, runs at 0x9700 */
+    0x31, 0x00, 0x97,       /* 9700:  ld sp, 0x9700             */
+    0xdb, 0xdd,             /* 9703:  in a, (0xdd)              */
+    0xe6, 0x80,             /* 9705:  and 0x80                  */
+    0x4f,                   /* 9707:  ld c, a                   ; c = current input level */
+                            /*      find_pilot:                 */
+    0x16, 0x00,             /* 9708:  ld d, 0                   */
+                            /*      pilot_loop:                 */
+    0xcd, 0x5e, 0x97,       /* 970a:  call read_bit             */
+    0x38, 0xf9,             /* 970d:  jr c, find_pilot          */
+    0x15,                   /* 970f:  dec d                     */
+    0x20, 0xf8,             /* 9710:  jr nz, pilot_loop         */
+                            /*      wait_sync:                  */
+    0x06, 0x00,             /* 9712:  ld b, 0                   */
+    0xcd, 0x6b, 0x97,       /* 9714:  call wait_edge            */
+    0x78,                   /* 9717:  ld a, b                   */
+    0xfe, TURBO_THRESHOLD / 2,
+                            /* 9718:  cp TURBO_THRESHOLD / 2    ; half-cycle */
+    0x38, 0xf6,             /* 971a:  jr c, wait_sync           */
+    0xcd, 0x6b, 0x97,       /* 971c:  call wait_edge            ; second half of sync */
+    0xaf,                   /* 971f:  xor a                     */
+    0x08,                   /* 9720:  ex af, af'                ; a' = parity */
+    0x21, 0x77, 0x97,       /* 9721:  ld hl, header             */
+    0x1e, 0x04,             /* 9724:  ld e, 4                   */
+                            /*      header_loop:                */
+    0xcd, 0x51, 0x97,       /* 9726:  call read_byte            */
+    0x23,                   /* 9729:  inc hl                    */
+    0x1d,                   /* 972a:  dec e                     */
+    0x20, 0xf9,             /* 972b:  jr nz, header_loop        */
+    0x2a, 0x77, 0x97,       /* 972d:  ld hl, (header)           */
+    0xed, 0x5b, 0x79, 0x97, /* 9730:  ld de, (header + 2)       */
+    0xe5,                   /* 9734:  push hl                   ; start address */
+                            /*      data_loop:                  */
+    0xcd, 0x51, 0x97,       /* 9735:  call read_byte            */
+    0x23,                   /* 9738:  inc hl                    */
+    0x1b,                   /* 9739:  dec de                    */
+    0x7a,                   /* 973a:  ld a, d                   */
+    0xb3,                   /* 973b:  or e                      */
+    0x20, 0xf7,             /* 973c:  jr nz, data_loop          */
+    0x21, 0x77, 0x97,       /* 973e:  ld hl, header             */
+    0xcd, 0x51, 0x97,       /* 9741:  call read_byte            ; parity byte */
+    0x08,                   /* 9744:  ex af, af'                */
+    0xb7,                   /* 9745:  or a                      */
+    0xc8,                   /* 9746:  ret z                     ; run the program */
+    0x3e, 0x08,             /* 9747:  ld a, 0x08                ; medium red */
+    0xd3, 0xbf,             /* 9749:  out (0xbf), a             */
+    0x3e, 0x87,             /* 974b:  ld a, 0x87                ; backdrop register */
+    0xd3, 0xbf,             /* 974d:  out (0xbf), a             */
+                            /*      error:                      */
+    0x18, 0xfe,             /* 974f:  jr error                  */
+
+                            /*      read_byte:                  ; byte to (hl), updates parity */
+    0x36, 0x01,             /* 9751:  ld (hl), 1                ; marker bit */
+                            /*      read_byte_loop:             */
+    0xcd, 0x5e, 0x97,       /* 9753:  call read_bit             */
+    0xcb, 0x16,             /* 9756:  rl (hl)                   */
+    0x30, 0xf9,             /* 9758:  jr nc, read_byte_loop     ; until the marker is shifted out */
+    0x08,                   /* 975a:  ex af, af'                */
+    0x86,                   /* 975b:  add a, (hl)               */
+    0x08,                   /* 975c:  ex af, af'                */
+    0xc9,                   /* 975d:  ret                       */
+
+                            /*      read_bit:                   ; bit to carry */
+    0x06, 0x00,             /* 975e:  ld b, 0                   */
+    0xcd, 0x6b, 0x97,       /* 9760:  call wait_edge            */
+    0xcd, 0x6b, 0x97,       /* 9763:  call wait_edge            */
+    0x78,                   /* 9766:  ld a, b                   */
+    0xfe, TURBO_THRESHOLD,  /* 9767:  cp TURBO_THRESHOLD        */
+    0x3f,                   /* 9769:  ccf                       */
+    0xc9,                   /* 976a:  ret                       */
+
+                            /*      wait_edge:                  ; counts iterations in b */
+    0x04,                   /* 976b:  inc b                     */
+    0xdb, 0xdd,             /* 976c:  in a, (0xdd)              */
+    0xa9,                   /* 976e:  xor c                     */
+    0xf2, 0x6b, 0x97,       /* 976f:  jp p, wait_edge           */
+    0x79,                   /* 9772:  ld a, c                   */
+    0xee, 0x80,             /* 9773:  xor 0x80                  */
+    0x4f,                   /* 9775:  ld c, a                   */
+    0xc9,                   /* 9776:  ret                       */
+
+                            /*      header:                     */
+    0x00, 0x00, 0x00, 0x00  /* 9777:  ds 4                      */
+};
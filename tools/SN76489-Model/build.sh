@@ -0,0 +1,11 @@
+#!/bin/sh
+
+CC=gcc
+CFLAGS="-std=c11 -O2 -Wall -Werror"
+
+
+$CC $CFLAGS -c source/sn76489.c -o sn76489.o
+ar rcs libsn76489.a sn76489.o
+rm sn76489.o
+
+./test.sh
@@ -0,0 +1,575 @@
+/*
+ * SN76489-Model
+ * A reference model of the SN76489 PSG.
+ *
+ * JoppyFurr 2024
+ *
+ * The chip divides its clock by 16, and each tone counter counts down once
+ * per tick, flipping its channel's output and reloading from the tone
+ * register when it expires. The noise counter is reloaded from its shift
+ * rate, or from tone 2's register, and every second expiry shifts the LFSR.
+ *
+ * Rather than stepping through every tick, the model jumps from one counter
+ * expiry to the next. Each change in output level is added to a delta buffer
+ * as a band-limited step, using a windowed-sinc kernel at the sub-sample
+ * position of the change. Integrating the delta buffer gives the output.
+ *
+ * The kernel is stored as integers, with each phase summing to exactly
+ * KERNEL_UNIT, so the integration is exact and never drifts however long
+ * the model is run for.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "sn76489.h"
+
+#ifndef M_PI
+#define M_PI            3.14159265358979323846
+#endif
+
+/* A counter that is held, and will never expire */
+#define TICK_NEVER      UINT64_MAX
+
+/* Bits of the fractional sample position used to select the kernel phase */
+#define PHASE_SHIFT     (32 - 6)
+
+/* Output level of a channel at full volume, leaving headroom for all four */
+#define CHANNEL_LEVEL   8191
+
+/* Kernel scale, as a shift and as the sum of each phase */
+#define KERNEL_SHIFT    14
+#define KERNEL_UNIT     (1 << KERNEL_SHIFT)
+
+/* Band-limited step kernel, as the difference between successive samples */
+static int32_t kernel [SN76489_KERNEL_PHASES] [SN76489_KERNEL_WIDTH];
+static bool kernel_ready = false;
+
+/* Output level for each attenuation value, in 2 dB steps with 0x0f being off */
+static int32_t volume_table [16];
+
+
+/*
+ * Generate the band-limited step kernel and volume table.
+ *
+ * Each phase is a Blackman-windowed sinc, with its cut-off just below the
+ * Nyquist frequency, offset by the fraction of a sample that the step
+ * happens at. Each phase is scaled to sum to KERNEL_UNIT, with any rounding
+ * error taken up by its largest tap, so that each step is exactly its delta.
+ */
+static void sn76489_tables_init (void)
+{
+    const double cutoff = 0.9;
+
+    for (int phase = 0; phase < SN76489_KERNEL_PHASES; phase++)
+    {
+        double taps [SN76489_KERNEL_WIDTH];
+        double sum = 0.0;
+        int32_t total = 0;
+        int largest = 0;
+
+        for (int i = 0; i < SN76489_KERNEL_WIDTH; i++)
+        {
+            double t = i - (SN76489_KERNEL_WIDTH / 2 - 1) - phase / (double) SN76489_KERNEL_PHASES;
+            double x = M_PI * cutoff * t;
+            double sinc = (x == 0.0) ? 1.0 : sin (x) / x;
+            double window = 0.42 + 0.5 * cos (2.0 * M_PI * t / SN76489_KERNEL_WIDTH)
+                                 + 0.08 * cos (4.0 * M_PI * t / SN76489_KERNEL_WIDTH);
+
+            taps [i] = sinc * window;
+            sum += taps [i];
+        }
+
+        for (int i = 0; i < SN76489_KERNEL_WIDTH; i++)
+        {
+            kernel [phase] [i] = lrint (taps [i] * KERNEL_UNIT / sum);
+            total += kernel [phase] [i];
+
+            if (kernel [phase] [i] > kernel [phase] [largest])
+            {
+                largest = i;
+            }
+        }
+
+        kernel [phase] [largest] += KERNEL_UNIT - total;
+    }
+
+    for (int i = 0; i < 15; i++)
+    {
+        volume_table [i] = lrint (CHANNEL_LEVEL * pow (10.0, -2.0 * i / 20.0));
+    }
+    volume_table [15] = 0;
+
+    kernel_ready = true;
+}
+
+
+/*
+ * Add a band-limited step to a delta buffer.
+ */
+static inline void sn76489_add_step (int32_t *buffer, uint64_t position, int32_t delta)
+{
+    int32_t *target = &buffer [position >> 32];
+    const int32_t *step = kernel [(position >> PHASE_SHIFT) & (SN76489_KERNEL_PHASES - 1)];
+
+    for (int i = 0; i < SN76489_KERNEL_WIDTH; i++)
+    {
+        target [i] += delta * step [i];
+    }
+}
+
+
+/*
+ * Recalculate the output levels after a change, adding steps for any difference.
+ */
+static void sn76489_update_level (sn76489_t *psg, uint64_t position)
+{
+    int32_t left = 0;
+    int32_t right = 0;
+
+    for (int channel = 0; channel < 4; channel++)
+    {
+        int32_t level = volume_table [psg->attenuation [channel]];
+        if (!psg->output [channel])
+        {
+            level = -level;
+        }
+
+        if (psg->stereo & (0x10 << channel))
+        {
+            left += level;
+        }
+        if (psg->stereo & (0x01 << channel))
+        {
+            right += level;
+        }
+    }
+
+    if (left != psg->level_left)
+    {
+        sn76489_add_step (psg->delta_left, position, left - psg->level_left);
+        psg->level_left = left;
+    }
+    if (right != psg->level_right)
+    {
+        if (psg->stereo_active)
+        {
+            sn76489_add_step (psg->delta_right, position, right - psg->level_right);
+        }
+        psg->level_right = right;
+    }
+}
+
+
+/*
+ * Add the step for a single channel changing its output.
+ */
+static inline void sn76489_channel_step (sn76489_t *psg, uint8_t channel, uint64_t position)
+{
+    int32_t level = volume_table [psg->attenuation [channel]];
+
+    if (level == 0)
+    {
+        return;
+    }
+
+    int32_t delta = psg->output [channel] ? (2 * level) : (-2 * level);
+
+    if (psg->stereo & (0x10 << channel))
+    {
+        sn76489_add_step (psg->delta_left, position, delta);
+        psg->level_left += delta;
+    }
+    if (psg->stereo & (0x01 << channel))
+    {
+        if (psg->stereo_active)
+        {
+            sn76489_add_step (psg->delta_right, position, delta);
+        }
+        psg->level_right += delta;
+    }
+}
+
+
+/*
+ * Number of ticks between expiries of a tone counter.
+ * Zero is treated as 0x400 on the TI chip. The Sega chip's zero is handled by sn76489_tone_held.
+ */
+static uint32_t sn76489_tone_period (const sn76489_t *psg, uint8_t channel)
+{
+    uint16_t value = psg->tone [channel];
+
+    if (value == 0)
+    {
+        return (psg->variant == SN76489_VARIANT_SEGA) ? 1 : 0x400;
+    }
+
+    return value;
+}
+
+
+/*
+ * On the Sega chip, a tone value of zero or one holds the output at +1.
+ */
+static bool sn76489_tone_held (const sn76489_t *psg, uint8_t channel)
+{
+    return psg->variant == SN76489_VARIANT_SEGA && psg->tone [channel] <= 1;
+}
+
+
+/*
+ * Number of ticks between expiries of the noise counter.
+ */
+static uint32_t sn76489_noise_period (const sn76489_t *psg)
+{
+    uint8_t rate = psg->noise_control & 0x03;
+
+    if (rate == 3)
+    {
+        return sn76489_tone_period (psg, 2);
+    }
+
+    return 0x10 << rate;
+}
+
+
+/*
+ * Reset the LFSR, which happens on any write to the noise control register.
+ * Only the top bit is set.
+ */
+static void sn76489_lfsr_reset (sn76489_t *psg)
+{
+    psg->lfsr = (uint32_t) 1 << (psg->lfsr_width - 1);
+    psg->output [3] = psg->lfsr & 1;
+}
+
+
+/*
+ * Shift the LFSR. White noise feeds back the parity of the tapped bits,
+ * and periodic noise feeds back the output bit alone.
+ */
+static void sn76489_lfsr_shift (sn76489_t *psg)
+{
+    uint32_t feedback;
+
+    if (psg->noise_control & 0x04)
+    {
+        feedback = psg->lfsr & psg->lfsr_taps;
+        feedback ^= feedback >> 16;
+        feedback ^= feedback >> 8;
+        feedback ^= feedback >> 4;
+        feedback ^= feedback >> 2;
+        feedback ^= feedback >> 1;
+    }
+    else
+    {
+        feedback = psg->lfsr;
+    }
+
+    psg->lfsr = (psg->lfsr >> 1) | ((feedback & 1) << (psg->lfsr_width - 1));
+    psg->output [3] = psg->lfsr & 1;
+}
+
+
+/*
+ * Write a tone register, keeping the channel's counter running.
+ */
+static void sn76489_tone_write (sn76489_t *psg, uint8_t channel, uint16_t value)
+{
+    psg->tone [channel] = value;
+
+    if (sn76489_tone_held (psg, channel))
+    {
+        psg->output [channel] = 1;
+        psg->next_tick [channel] = TICK_NEVER;
+    }
+    else if (psg->next_tick [channel] == TICK_NEVER)
+    {
+        psg->next_tick [channel] = psg->tick + sn76489_tone_period (psg, channel);
+    }
+}
+
+
+/*
+ * Reset the model, with all channels silent.
+ */
+void sn76489_init (sn76489_t *psg, sn76489_variant_t variant, uint32_t clock_rate, uint32_t sample_rate)
+{
+    if (!kernel_ready)
+    {
+        sn76489_tables_init ();
+    }
+
+    memset (psg, 0, sizeof (sn76489_t));
+
+    psg->variant = variant;
+    psg->clock_rate = clock_rate;
+    psg->sample_rate = sample_rate;
+    psg->position_per_tick = (((uint64_t) sample_rate << 32) * 16) / clock_rate;
+
+    switch (variant)
+    {
+        case SN76489_VARIANT_TI:
+            psg->lfsr_width = 15;
+            psg->lfsr_taps = 0x0003;
+            break;
+        case SN76489_VARIANT_TI_A:
+            psg->lfsr_width = 17;
+            psg->lfsr_taps = 0x000c;
+            break;
+        default:
+            psg->lfsr_width = 16;
+            psg->lfsr_taps = 0x0009;
+            break;
+    }
+
+    for (int channel = 0; channel < 4; channel++)
+    {
+        psg->attenuation [channel] = 0x0f;
+    }
+    psg->stereo = 0xff;
+
+    for (int channel = 0; channel < 3; channel++)
+    {
+        psg->next_tick [channel] = TICK_NEVER;
+        sn76489_tone_write (psg, channel, 0);
+    }
+
+    psg->next_tick [3] = sn76489_noise_period (psg);
+    sn76489_lfsr_reset (psg);
+}
+
+
+/*
+ * Replace the variant's LFSR with one of a different width, tapped at the bits set in taps.
+ * The LFSR is reset. Returns -1 if the width is not between 2 and SN76489_LFSR_WIDTH_MAX.
+ */
+int sn76489_set_lfsr (sn76489_t *psg, uint8_t width, uint32_t taps)
+{
+    if (width < 2 || width > SN76489_LFSR_WIDTH_MAX)
+    {
+        return -1;
+    }
+
+    psg->lfsr_width = width;
+    psg->lfsr_taps = taps;
+    sn76489_lfsr_reset (psg);
+
+    return 0;
+}
+
+
+/*
+ * Write a byte to the PSG port.
+ *
+ * A latch byte (bit 7 set) selects a register with bits 6-4, and writes its
+ * low four bits. A data byte writes the upper six bits of a tone register,
+ * or the four bits of any other register.
+ */
+void sn76489_write (sn76489_t *psg, uint8_t value)
+{
+    if (value & 0x80)
+    {
+        psg->latch = (value >> 4) & 0x07;
+    }
+
+    uint8_t reg = psg->latch;
+    uint8_t channel = reg >> 1;
+
+    if (reg & 1)
+    {
+        psg->attenuation [channel] = value & 0x0f;
+    }
+    else if (channel == 3)
+    {
+        psg->noise_control = value & 0x07;
+        sn76489_lfsr_reset (psg);
+    }
+    else if (value & 0x80)
+    {
+        sn76489_tone_write (psg, channel, (psg->tone [channel] & 0x3f0) | (value & 0x0f));
+    }
+    else
+    {
+        sn76489_tone_write (psg, channel, (psg->tone [channel] & 0x00f) | ((value & 0x3f) << 4));
+    }
+
+    sn76489_update_level (psg, psg->position);
+}
+
+
+/*
+ * Write a byte to the Game Gear stereo port.
+ *
+ * Bits 0-3 enable channels 0-3 on the right output, and bits 4-7 enable them on the left.
+ */
+void sn76489_write_stereo (sn76489_t *psg, uint8_t value)
+{
+    /* Until the first write that separates the outputs, the right output shares the left buffer */
+    if (!psg->stereo_active && value != 0xff)
+    {
+        memcpy (psg->delta_right, psg->delta_left, sizeof (psg->delta_right));
+        psg->stereo_active = true;
+    }
+
+    psg->stereo = value;
+    sn76489_update_level (psg, psg->position);
+}
+
+
+/*
+ * Run the counters up to (but not including) a tick.
+ */
+static void sn76489_advance (sn76489_t *psg, uint64_t end_tick)
+{
+    uint64_t start_tick = psg->tick;
+    uint64_t start_position = psg->position;
+
+    while (true)
+    {
+        /* Find the next counter to expire */
+        uint8_t channel = 0;
+        for (int i = 1; i < 4; i++)
+        {
+            if (psg->next_tick [i] < psg->next_tick [channel])
+            {
+                channel = i;
+            }
+        }
+
+        uint64_t tick = psg->next_tick [channel];
+        if (tick >= end_tick)
+        {
+            break;
+        }
+
+        psg->tick = tick;
+        uint64_t position = start_position + (tick - start_tick) * psg->position_per_tick;
+
+        if (channel < 3)
+        {
+            psg->output [channel] ^= 1;
+            psg->next_tick [channel] += sn76489_tone_period (psg, channel);
+            sn76489_channel_step (psg, channel, position);
+        }
+        else
+        {
+            psg->noise_flip_flop ^= 1;
+            if (psg->noise_flip_flop)
+            {
+                uint8_t previous = psg->output [3];
+                sn76489_lfsr_shift (psg);
+
+                if (psg->output [3] != previous)
+                {
+                    sn76489_channel_step (psg, 3, position);
+                }
+            }
+            psg->next_tick [3] += sn76489_noise_period (psg);
+        }
+    }
+
+    psg->tick = end_tick;
+    psg->position = start_position + (end_tick - start_tick) * psg->position_per_tick;
+}
+
+
+/*
+ * Integrate the completed samples in the delta buffers, and move
+ * the rest of the buffers down to start from the next sample.
+ */
+static uint32_t sn76489_flush (sn76489_t *psg, int16_t *samples)
+{
+    uint32_t count = psg->position >> 32;
+    int32_t sum_left = psg->sum_left;
+    int32_t sum_right = psg->sum_right;
+
+    if (psg->stereo_active)
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            sum_left += psg->delta_left [i];
+            sum_right += psg->delta_right [i];
+
+            int32_t left = (sum_left + (KERNEL_UNIT >> 1)) >> KERNEL_SHIFT;
+            int32_t right = (sum_right + (KERNEL_UNIT >> 1)) >> KERNEL_SHIFT;
+
+            samples [i * 2 + 0] = (left  > INT16_MAX) ? INT16_MAX : (left  < INT16_MIN) ? INT16_MIN : left;
+            samples [i * 2 + 1] = (right > INT16_MAX) ? INT16_MAX : (right < INT16_MIN) ? INT16_MIN : right;
+        }
+
+        memmove (psg->delta_right, &psg->delta_right [count], SN76489_KERNEL_WIDTH * sizeof (int32_t));
+        memset (&psg->delta_right [SN76489_KERNEL_WIDTH], 0, count * sizeof (int32_t));
+    }
+    else
+    {
+        /* Both outputs are the same, so only the left buffer is used */
+        for (uint32_t i = 0; i < count; i++)
+        {
+            sum_left += psg->delta_left [i];
+
+            int32_t left = (sum_left + (KERNEL_UNIT >> 1)) >> KERNEL_SHIFT;
+            left = (left > INT16_MAX) ? INT16_MAX : (left < INT16_MIN) ? INT16_MIN : left;
+
+            samples [i * 2 + 0] = left;
+            samples [i * 2 + 1] = left;
+        }
+
+        sum_right = sum_left;
+    }
+
+    psg->sum_left = sum_left;
+    psg->sum_right = sum_right;
+
+    /* Steps reach at most a kernel's width past the current sample */
+    memmove (psg->delta_left, &psg->delta_left [count], SN76489_KERNEL_WIDTH * sizeof (int32_t));
+    memset (&psg->delta_left [SN76489_KERNEL_WIDTH], 0, count * sizeof (int32_t));
+
+    psg->position -= (uint64_t) count << 32;
+
+    return count;
+}
+
+
+/*
+ * Largest number of frames that sn76489_run can produce for a number of clocks.
+ */
+uint32_t sn76489_frames_max (const sn76489_t *psg, uint32_t clocks)
+{
+    return ((uint64_t) clocks * psg->sample_rate) / psg->clock_rate + 2;
+}
+
+
+/*
+ * Run the model for a number of clocks, writing interleaved stereo samples.
+ * Returns the number of stereo frames written.
+ *
+ * Samples are written once no later step can affect them, so the output
+ * lags the model by half of the kernel width.
+ */
+uint32_t sn76489_run (sn76489_t *psg, uint32_t clocks, int16_t *samples)
+{
+    uint64_t total = (uint64_t) psg->clock_remainder + clocks;
+    uint64_t ticks = total / 16;
+    uint32_t frames = 0;
+
+    psg->clock_remainder = total % 16;
+
+    while (ticks > 0)
+    {
+        /* Keep each pass within the delta buffers */
+        uint64_t chunk = ((((uint64_t) SN76489_CHUNK_SAMPLES) << 32) - psg->position) / psg->position_per_tick;
+        if (chunk > ticks)
+        {
+            chunk = ticks;
+        }
+
+        sn76489_advance (psg, psg->tick + chunk);
+        frames += sn76489_flush (psg, &samples [frames * 2]);
+        ticks -= chunk;
+    }
+
+    return frames;
+}
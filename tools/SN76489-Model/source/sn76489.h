@@ -0,0 +1,86 @@
+/*
+ * SN76489-Model
+ * A reference model of the SN76489 PSG.
+ *
+ * JoppyFurr 2024
+ */
+
+/* Common clock rates */
+#define SN76489_CLOCK_NTSC      3579545
+#define SN76489_CLOCK_PAL       3546893
+
+/* Band-limited synthesis: each step is spread over this many output samples,
+ * with this many phases of sub-sample timing. */
+#define SN76489_KERNEL_WIDTH    16
+#define SN76489_KERNEL_PHASES   64
+
+/* Largest number of samples produced by one pass of the synthesis. */
+#define SN76489_CHUNK_SAMPLES   4096
+
+typedef enum sn76489_variant_e {
+    SN76489_VARIANT_SEGA = 0,   /* Sega VDP (SMS, GG): 16-bit LFSR tapped at bits 0 and 3, tone 0 and 1 hold +1 */
+    SN76489_VARIANT_TI,         /* Discrete SN76489: 15-bit LFSR tapped at bits 0 and 1, tone 0 acts as 0x400 */
+    SN76489_VARIANT_TI_A        /* Discrete SN76489A: 17-bit LFSR tapped at bits 2 and 3, tone 0 acts as 0x400 */
+} sn76489_variant_t;
+
+/* Longest LFSR that can be modelled */
+#define SN76489_LFSR_WIDTH_MAX  32
+
+typedef struct sn76489_s {
+
+    /* Configuration */
+    sn76489_variant_t variant;
+    uint32_t clock_rate;
+    uint32_t sample_rate;
+
+    /* Registers, as written through the latch / data protocol */
+    uint16_t tone [3];
+    uint8_t attenuation [4];
+    uint8_t noise_control;
+    uint8_t latch;
+    uint8_t stereo;
+
+    /* Channel state. Time is counted in ticks, which are 16 clocks. */
+    uint64_t tick;
+    uint64_t next_tick [4];
+    uint8_t output [4];
+    uint8_t noise_flip_flop;
+    uint32_t lfsr;
+    uint8_t lfsr_width;
+    uint32_t lfsr_taps;
+    uint32_t clock_remainder;
+
+    /* Synthesis. Positions are in output samples, as 32.32 fixed point,
+     * relative to the first sample in the delta buffers. */
+    uint64_t position;
+    uint64_t position_per_tick;
+    bool stereo_active;
+    int32_t level_left;
+    int32_t level_right;
+    int32_t sum_left;
+    int32_t sum_right;
+    int32_t delta_left [SN76489_CHUNK_SAMPLES + SN76489_KERNEL_WIDTH];
+    int32_t delta_right [SN76489_CHUNK_SAMPLES + SN76489_KERNEL_WIDTH];
+
+} sn76489_t;
+
+/* Reset the model, with all channels silent.
+ * The first call also generates shared tables, so should not be made from several threads at once. */
+void sn76489_init (sn76489_t *psg, sn76489_variant_t variant, uint32_t clock_rate, uint32_t sample_rate);
+
+/* Replace the variant's LFSR with one of a different width, tapped at the bits set in taps.
+ * The LFSR is reset. Returns -1 if the width is not between 2 and SN76489_LFSR_WIDTH_MAX. */
+int sn76489_set_lfsr (sn76489_t *psg, uint8_t width, uint32_t taps);
+
+/* Write a byte to the PSG port (0x40 - 0x7f). */
+void sn76489_write (sn76489_t *psg, uint8_t value);
+
+/* Write a byte to the Game Gear stereo port (0x06). */
+void sn76489_write_stereo (sn76489_t *psg, uint8_t value);
+
+/* Largest number of frames that sn76489_run can produce for a number of clocks. */
+uint32_t sn76489_frames_max (const sn76489_t *psg, uint32_t clocks);
+
+/* Run the model for a number of clocks, writing interleaved stereo samples.
+ * Returns the number of stereo frames written. */
+uint32_t sn76489_run (sn76489_t *psg, uint32_t clocks, int16_t *samples);
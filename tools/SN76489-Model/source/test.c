@@ -0,0 +1,265 @@
+/*
+ * SN76489-Model
+ * Checks of the model's pitch and noise, for each variant of the chip.
+ *
+ * JoppyFurr 2024
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sn76489.h"
+
+#define TEST_SAMPLE_RATE    44100
+
+/* Tone 2's period while it clocks the noise, so that each bit of the LFSR
+ * lasts about 200 samples, and the bits to compare. */
+#define TEST_NOISE_PERIOD   0x200
+#define TEST_NOISE_BITS     600
+
+typedef struct test_variant_s {
+    const char *name;
+    sn76489_variant_t variant;
+    uint8_t lfsr_width;
+    uint32_t lfsr_taps;
+} test_variant_t;
+
+static const test_variant_t test_variants [] = {
+    { "sega",       SN76489_VARIANT_SEGA,   16, 0x0009 },
+    { "sn76489",    SN76489_VARIANT_TI,     15, 0x0003 },
+    { "sn76489a",   SN76489_VARIANT_TI_A,   17, 0x000c },
+};
+
+static uint32_t failed = 0;
+
+
+/*
+ * Print the result of a check, counting any failure.
+ */
+static void test_result (bool pass, const test_variant_t *variant, const char *check)
+{
+    printf ("%s: %s %s\n", pass ? "pass" : "FAIL", variant->name, check);
+    if (!pass)
+    {
+        failed++;
+    }
+}
+
+
+/*
+ * Run the model for a number of samples, keeping the left output.
+ * Returns NULL on error.
+ */
+static int16_t *test_render (sn76489_t *psg, uint32_t length)
+{
+    uint32_t clocks = ((uint64_t) length * psg->clock_rate) / psg->sample_rate;
+    int16_t *stereo = malloc ((sn76489_frames_max (psg, clocks) + 1) * 2 * sizeof (int16_t));
+    int16_t *samples = malloc (length * sizeof (int16_t));
+
+    if (stereo == NULL || samples == NULL)
+    {
+        free (stereo);
+        free (samples);
+        return NULL;
+    }
+
+    uint32_t frames = sn76489_run (psg, clocks, stereo);
+    for (uint32_t i = 0; i < length; i++)
+    {
+        samples [i] = (i < frames) ? stereo [i * 2] : 0;
+    }
+
+    free (stereo);
+    return samples;
+}
+
+
+/*
+ * Count the rising edges in a tone, with hysteresis so that the ringing of
+ * the band-limited steps is not counted.
+ */
+static uint32_t test_count_edges (const int16_t *samples, uint32_t length)
+{
+    uint32_t edges = 0;
+    bool high = samples [0] > 0;
+
+    for (uint32_t i = 1; i < length; i++)
+    {
+        if (!high && samples [i] > 2048)
+        {
+            high = true;
+            edges++;
+        }
+        else if (high && samples [i] < -2048)
+        {
+            high = false;
+        }
+    }
+
+    return edges;
+}
+
+
+/*
+ * Check that tone 0 plays at clock / (32 * period), and what a period of zero
+ * does: the Sega chip holds the output, and the discrete chips treat it as
+ * 0x400. Writing the period does not restart the counter, so the first
+ * second is skipped, for the period written at reset to run out.
+ */
+static void test_pitch (const test_variant_t *variant, sn76489_t *psg)
+{
+    const uint16_t periods [] = { 0x0fe, 0x000 };
+    char check [64];
+
+    for (uint32_t i = 0; i < sizeof (periods) / sizeof (periods [0]); i++)
+    {
+        uint16_t period = periods [i];
+        uint32_t seconds = 10;
+        uint32_t settle = TEST_SAMPLE_RATE;
+
+        sn76489_init (psg, variant->variant, SN76489_CLOCK_NTSC, TEST_SAMPLE_RATE);
+        sn76489_write (psg, 0x80 | (period & 0x0f));
+        sn76489_write (psg, (period >> 4) & 0x3f);
+        sn76489_write (psg, 0x90);
+
+        int16_t *samples = test_render (psg, settle + seconds * TEST_SAMPLE_RATE);
+        if (samples == NULL)
+        {
+            fprintf (stderr, "Error: Failed to allocate memory for samples.\n");
+            exit (EXIT_FAILURE);
+        }
+        uint32_t edges = test_count_edges (&samples [settle], seconds * TEST_SAMPLE_RATE);
+        free (samples);
+
+        uint32_t expected = 0;
+        if (period != 0 || variant->variant != SN76489_VARIANT_SEGA)
+        {
+            double cycles = (double) seconds * SN76489_CLOCK_NTSC / (32.0 * ((period == 0) ? 0x400 : period));
+            expected = cycles + 0.5;
+        }
+
+        snprintf (check, sizeof (check), "pitch of period 0x%03x, %u cycles in %u s", period, edges, seconds);
+        test_result (edges + 1 >= expected && edges <= expected + 1, variant, check);
+    }
+}
+
+
+/*
+ * Shift a reference LFSR, independently of the model, and return its output bit.
+ */
+static uint8_t test_lfsr_shift (uint32_t *lfsr, uint8_t width, uint32_t taps, bool white)
+{
+    uint32_t feedback = 0;
+
+    if (white)
+    {
+        for (uint8_t bit = 0; bit < width; bit++)
+        {
+            if (taps & (1u << bit))
+            {
+                feedback ^= (*lfsr >> bit) & 1;
+            }
+        }
+    }
+    else
+    {
+        feedback = *lfsr & 1;
+    }
+
+    *lfsr = (*lfsr >> 1) | (feedback << (width - 1));
+    return *lfsr & 1;
+}
+
+
+/*
+ * Check the noise's output bits against a reference LFSR, for white and
+ * periodic noise clocked by tone 2.
+ *
+ * The LFSR is reset with only its top bit set, so the output is first high
+ * after width - 1 shifts. The bits are read from that edge onwards, at the
+ * middle of each bit.
+ */
+static void test_lfsr (const test_variant_t *variant, sn76489_t *psg)
+{
+    char check [64];
+
+    for (uint32_t white = 0; white < 2; white++)
+    {
+        sn76489_init (psg, variant->variant, SN76489_CLOCK_NTSC, TEST_SAMPLE_RATE);
+        sn76489_write (psg, 0xc0 | (TEST_NOISE_PERIOD & 0x0f));
+        sn76489_write (psg, (TEST_NOISE_PERIOD >> 4) & 0x3f);
+        sn76489_write (psg, white ? 0xe7 : 0xe3);
+        sn76489_write (psg, 0xf0);
+
+        double bit_samples = 2.0 * 16 * TEST_NOISE_PERIOD * TEST_SAMPLE_RATE / SN76489_CLOCK_NTSC;
+        uint32_t length = (variant->lfsr_width + TEST_NOISE_BITS + 2) * bit_samples;
+        int16_t *samples = test_render (psg, length);
+        if (samples == NULL)
+        {
+            fprintf (stderr, "Error: Failed to allocate memory for samples.\n");
+            exit (EXIT_FAILURE);
+        }
+
+        /* The first rising edge, past the ringing as the channel is unmuted */
+        uint32_t edge = 0;
+        bool low = false;
+        while (edge < length && !(low && samples [edge] > 0))
+        {
+            low = low || samples [edge] < -4096;
+            edge++;
+        }
+
+        uint32_t lfsr = 1u << (variant->lfsr_width - 1);
+        uint8_t expected = 0;
+        for (uint32_t i = 0; i < variant->lfsr_width - 1u; i++)
+        {
+            expected = test_lfsr_shift (&lfsr, variant->lfsr_width, variant->lfsr_taps, white);
+        }
+
+        uint32_t matched = 0;
+        for (uint32_t i = 0; i < TEST_NOISE_BITS; i++)
+        {
+            uint32_t position = edge + (i + 0.5) * bit_samples;
+            if (position >= length || (samples [position] > 0) != expected)
+            {
+                break;
+            }
+            matched++;
+            expected = test_lfsr_shift (&lfsr, variant->lfsr_width, variant->lfsr_taps, white);
+        }
+        free (samples);
+
+        snprintf (check, sizeof (check), "%s noise, %u of %u bits match", white ? "white" : "periodic",
+                  matched, TEST_NOISE_BITS);
+        test_result (matched == TEST_NOISE_BITS, variant, check);
+    }
+}
+
+
+int main (void)
+{
+    sn76489_t *psg = malloc (sizeof (sn76489_t));
+    if (psg == NULL)
+    {
+        fprintf (stderr, "Error: Failed to allocate memory for the model.\n");
+        return EXIT_FAILURE;
+    }
+
+    for (uint32_t i = 0; i < sizeof (test_variants) / sizeof (test_variants [0]); i++)
+    {
+        test_pitch (&test_variants [i], psg);
+        test_lfsr (&test_variants [i], psg);
+    }
+
+    free (psg);
+
+    if (failed != 0)
+    {
+        printf ("%u check(s) failed\n", failed);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
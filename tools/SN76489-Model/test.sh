@@ -0,0 +1,18 @@
+#!/bin/sh
+# Check the model's pitch and noise for each variant of the chip.
+#
+# Tone 0 is counted over ten seconds for the period 0x0fe, and for a period
+# of zero, which the Sega chip holds and the discrete chips treat as 0x400.
+# White and periodic noise are read back bit by bit, and compared with a
+# reference LFSR of the variant's width and taps.
+#
+# Usage: ./test.sh
+
+CC=gcc
+CFLAGS="-std=c11 -O2 -Wall -Werror"
+
+work="$(mktemp -d)"
+trap 'rm -rf "${work}"' EXIT
+
+cd "$(dirname "${0}")"
+$CC $CFLAGS source/test.c -L. -lsn76489 -lm -o "${work}/test" && "${work}/test"
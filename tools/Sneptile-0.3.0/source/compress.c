@@ -0,0 +1,190 @@
+/*
+ * Sneptile
+ * Joppy Furr 2024
+ *
+ * Compression of the pattern data, for use with the --compress option.
+ *
+ * The format is a byte-oriented LZ77 variant that is simple to decode on the
+ * Z80, using a 256-byte window so that the decoder needs only 256 bytes of RAM:
+ *
+ *  0x00 - 0x7f: Literal run, copy the next (token + 1) bytes to the output.
+ *  0x80       : End of stream.
+ *  0x81 - 0xff: Match, followed by a distance byte. Copy (token & 0x7f) + 2 bytes,
+ *               starting from (distance + 1) bytes back in the output.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sneptile.h"
+#include "compress.h"
+
+#define LZ_WINDOW_SIZE      256
+#define LZ_MATCH_MIN          3
+#define LZ_MATCH_MAX        129
+#define LZ_LITERAL_MAX      128
+#define LZ_END             0x80
+
+/* Uncompressed pattern data */
+static uint8_t *buffer = NULL;
+static uint32_t buffer_size = 0;
+static uint32_t buffer_capacity = 0;
+
+/* Output formatting */
+static uint32_t line_byte_index = 0;
+static uint32_t output_size = 0;
+
+
+/*
+ * Add bytes of pattern data to the buffer to be compressed.
+ */
+int compress_add (const uint8_t *data, uint32_t size)
+{
+    if (buffer_size + size > buffer_capacity)
+    {
+        uint32_t new_capacity = (buffer_capacity == 0) ? 4096 : buffer_capacity;
+        while (buffer_size + size > new_capacity)
+        {
+            new_capacity *= 2;
+        }
+
+        uint8_t *new_buffer = realloc (buffer, new_capacity);
+
+        if (new_buffer == NULL)
+        {
+            fprintf (stderr, "Error: Failed to allocate memory for compression buffer.\n");
+            return RC_ERROR;
+        }
+
+        buffer = new_buffer;
+        buffer_capacity = new_capacity;
+    }
+
+    for (uint32_t i = 0; i < size; i++)
+    {
+        buffer [buffer_size++] = data [i];
+    }
+
+    return RC_OK;
+}
+
+
+/*
+ * Output one byte of compressed data.
+ */
+static void compress_emit (FILE *file, uint8_t byte)
+{
+    /* Sixteen bytes per line. Indent at the start of each line, plus spaces between bytes. */
+    fprintf (file, "%s0x%02x,", line_byte_index == 0 ? "    " : " ", byte);
+    line_byte_index++;
+    output_size++;
+
+    if (line_byte_index == 16)
+    {
+        fprintf (file, "\n");
+        line_byte_index = 0;
+    }
+}
+
+
+/*
+ * Output a run of literal bytes.
+ */
+static void compress_emit_literals (FILE *file, uint32_t from, uint32_t to)
+{
+    while (from < to)
+    {
+        uint32_t length = to - from;
+        if (length > LZ_LITERAL_MAX)
+        {
+            length = LZ_LITERAL_MAX;
+        }
+
+        compress_emit (file, length - 1);
+        for (uint32_t i = 0; i < length; i++)
+        {
+            compress_emit (file, buffer [from + i]);
+        }
+        from += length;
+    }
+}
+
+
+/*
+ * Find the longest match for the data at position 'pos' within the window.
+ * Returns the match length, and sets 'distance'.
+ */
+static uint32_t compress_find_match (uint32_t pos, uint32_t *distance)
+{
+    uint32_t best_length = 0;
+    uint32_t window_start = (pos > LZ_WINDOW_SIZE) ? pos - LZ_WINDOW_SIZE : 0;
+
+    for (uint32_t candidate = window_start; candidate < pos; candidate++)
+    {
+        uint32_t length = 0;
+
+        /* Matches may overlap the current position */
+        while (length < LZ_MATCH_MAX && pos + length < buffer_size &&
+               buffer [candidate + length] == buffer [pos + length])
+        {
+            length++;
+        }
+
+        /* Prefer the closest match of a given length */
+        if (length >= best_length)
+        {
+            best_length = length;
+            *distance = pos - candidate;
+        }
+    }
+
+    return best_length;
+}
+
+
+/*
+ * Compress the buffered pattern data and write it to the pattern file.
+ */
+int compress_write (FILE *file)
+{
+    uint32_t literal_start = 0;
+    uint32_t pos = 0;
+
+    fprintf (file, "#define PATTERNS_COMPRESSED\n");
+    fprintf (file, "#define PATTERNS_SIZE %u\n", buffer_size);
+    fprintf (file, "static const uint8_t patterns_compressed [] = {\n");
+
+    while (pos < buffer_size)
+    {
+        uint32_t distance = 0;
+        uint32_t length = compress_find_match (pos, &distance);
+
+        if (length >= LZ_MATCH_MIN)
+        {
+            compress_emit_literals (file, literal_start, pos);
+            compress_emit (file, 0x80 | (length - 2));
+            compress_emit (file, distance - 1);
+            pos += length;
+            literal_start = pos;
+        }
+        else
+        {
+            pos++;
+        }
+    }
+
+    compress_emit_literals (file, literal_start, pos);
+    compress_emit (file, LZ_END);
+
+    fprintf (file, "%s};\n", line_byte_index != 0 ? "\n" : "");
+    fprintf (file, "/* %u bytes compressed to %u bytes */\n", buffer_size, output_size);
+
+    free (buffer);
+    buffer = NULL;
+    buffer_size = 0;
+    buffer_capacity = 0;
+
+    return RC_OK;
+}
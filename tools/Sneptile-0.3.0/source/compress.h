@@ -0,0 +1,10 @@
+/*
+ * Sneptile
+ * Joppy Furr 2024
+ */
+
+/* Add bytes of pattern data to the buffer to be compressed. */
+int compress_add (const uint8_t *data, uint32_t size);
+
+/* Compress the buffered pattern data and write it to the pattern file. */
+int compress_write (FILE *file);
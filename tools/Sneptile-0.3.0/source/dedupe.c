@@ -0,0 +1,215 @@
+/*
+ * Sneptile
+ * Joppy Furr 2024
+ *
+ * Removal of duplicate patterns, for use with the --dedupe option.
+ *
+ * Each tile read from the input images is given a logical index, which is
+ * what the PATTERN_ defines in pattern_index.h refer to. Only the first copy
+ * of each pattern is emitted, and the remap table written to pattern_remap.h
+ * gives the emitted (physical) index for each logical index.
+ *
+ * Patterns are found through a hash table of FNV-1a hashes. The caller
+ * decides what makes two tiles interchangeable by choosing the key bytes.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sneptile.h"
+#include "dedupe.h"
+
+#define DEDUPE_KEY_MAX      64
+#define DEDUPE_BUCKETS    1024
+
+/* A unique pattern that has been emitted */
+typedef struct dedupe_entry_s {
+    uint8_t key [DEDUPE_KEY_MAX];
+    uint32_t hash;
+    uint32_t physical_index;
+    uint32_t next;
+} dedupe_entry_t;
+
+/* Hash table of unique patterns. Bucket and chain
+ * links hold entry index + 1, with zero ending a chain. */
+static uint32_t buckets [DEDUPE_BUCKETS] = { };
+static dedupe_entry_t *entries = NULL;
+static uint32_t entries_count = 0;
+static uint32_t entries_capacity = 0;
+
+/* Logical to physical index map */
+static uint32_t *remap = NULL;
+static uint32_t remap_count = 0;
+static uint32_t remap_capacity = 0;
+
+/* Output formatting */
+static uint32_t line_entry_index = 0;
+
+
+/*
+ * FNV-1a hash of a pattern key.
+ */
+static uint32_t dedupe_hash (const uint8_t *key, uint32_t size)
+{
+    uint32_t hash = 0x811c9dc5;
+
+    for (uint32_t i = 0; i < size; i++)
+    {
+        hash ^= key [i];
+        hash *= 0x01000193;
+    }
+
+    return hash;
+}
+
+
+/*
+ * Append an entry to the logical to physical index map.
+ */
+static int dedupe_remap_add (uint32_t physical_index)
+{
+    if (remap_count == remap_capacity)
+    {
+        uint32_t new_capacity = (remap_capacity == 0) ? 256 : remap_capacity * 2;
+        uint32_t *new_remap = realloc (remap, new_capacity * sizeof (uint32_t));
+
+        if (new_remap == NULL)
+        {
+            fprintf (stderr, "Error: Failed to allocate memory for remap table.\n");
+            return RC_ERROR;
+        }
+
+        remap = new_remap;
+        remap_capacity = new_capacity;
+    }
+
+    remap [remap_count++] = physical_index;
+
+    return RC_OK;
+}
+
+
+/*
+ * Look up a tile by its key.
+ *
+ * If an identical tile has already been emitted, its physical index is
+ * recorded for this logical tile, and true is returned.
+ */
+bool dedupe_find (const uint8_t *key, uint32_t size)
+{
+    uint32_t hash = dedupe_hash (key, size);
+    uint32_t bucket = hash % DEDUPE_BUCKETS;
+
+    for (uint32_t link = buckets [bucket]; link != 0; link = entries [link - 1].next)
+    {
+        dedupe_entry_t *entry = &entries [link - 1];
+
+        if (entry->hash == hash && memcmp (entry->key, key, size) == 0)
+        {
+            dedupe_remap_add (entry->physical_index);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/*
+ * Record a new tile, which is being emitted at 'physical_index'.
+ */
+int dedupe_add (const uint8_t *key, uint32_t size, uint32_t physical_index)
+{
+    uint32_t hash = dedupe_hash (key, size);
+    uint32_t bucket = hash % DEDUPE_BUCKETS;
+
+    if (entries_count == entries_capacity)
+    {
+        uint32_t new_capacity = (entries_capacity == 0) ? 256 : entries_capacity * 2;
+        dedupe_entry_t *new_entries = realloc (entries, new_capacity * sizeof (dedupe_entry_t));
+
+        if (new_entries == NULL)
+        {
+            fprintf (stderr, "Error: Failed to allocate memory for dedupe table.\n");
+            return RC_ERROR;
+        }
+
+        entries = new_entries;
+        entries_capacity = new_capacity;
+    }
+
+    dedupe_entry_t *entry = &entries [entries_count];
+    memcpy (entry->key, key, size);
+    entry->hash = hash;
+    entry->physical_index = physical_index;
+    entry->next = buckets [bucket];
+    buckets [bucket] = ++entries_count;
+
+    return dedupe_remap_add (physical_index);
+}
+
+
+/*
+ * Return the number of logical tiles seen so far.
+ */
+uint32_t dedupe_logical_index (void)
+{
+    return remap_count;
+}
+
+
+/*
+ * Write the remap table to the remap file.
+ */
+int dedupe_write (FILE *file)
+{
+    uint32_t physical_count = 0;
+
+    for (uint32_t i = 0; i < remap_count; i++)
+    {
+        if (remap [i] + 1 > physical_count)
+        {
+            physical_count = remap [i] + 1;
+        }
+    }
+
+    /* Use a byte per entry, unless there are too many patterns */
+    bool wide = (physical_count > 256);
+
+    /* The table is declared for every file that includes it, and defined in the one that defines PATTERN_REMAP_DEFINE */
+    fprintf (file, "extern const %s pattern_remap [%u];\n", wide ? "uint16_t" : "uint8_t", remap_count);
+    fprintf (file, "#ifdef PATTERN_REMAP_DEFINE\n");
+    fprintf (file, "const %s pattern_remap [%u] = {\n", wide ? "uint16_t" : "uint8_t", remap_count);
+
+    for (uint32_t i = 0; i < remap_count; i++)
+    {
+        /* Sixteen entries per line. Indent at the start of each line, plus spaces between entries. */
+        fprintf (file, wide ? "%s0x%04x," : "%s0x%02x,", line_entry_index == 0 ? "    " : " ", remap [i]);
+        line_entry_index++;
+
+        if (line_entry_index == 16)
+        {
+            fprintf (file, "\n");
+            line_entry_index = 0;
+        }
+    }
+
+    fprintf (file, "%s};\n", line_entry_index != 0 ? "\n" : "");
+    fprintf (file, "#endif\n");
+    fprintf (file, "/* %u patterns, %u unique */\n", remap_count, entries_count);
+
+    free (entries);
+    entries = NULL;
+    entries_count = 0;
+    entries_capacity = 0;
+
+    free (remap);
+    remap = NULL;
+    remap_count = 0;
+    remap_capacity = 0;
+
+    return RC_OK;
+}
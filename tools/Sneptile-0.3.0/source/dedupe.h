@@ -0,0 +1,16 @@
+/*
+ * Sneptile
+ * Joppy Furr 2024
+ */
+
+/* Look up a tile by its key, returning true if an identical tile has already been emitted. */
+bool dedupe_find (const uint8_t *key, uint32_t size);
+
+/* Record a new tile, which is being emitted at 'physical_index'. */
+int dedupe_add (const uint8_t *key, uint32_t size, uint32_t physical_index);
+
+/* Return the number of logical tiles seen so far. */
+uint32_t dedupe_logical_index (void);
+
+/* Write the remap table to the remap file. */
+int dedupe_write (FILE *file);
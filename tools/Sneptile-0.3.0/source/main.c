@@ -8,7 +8,6 @@
  * To Do list:
  *  - 'sprite mode' to not match on palette index 0
  *  - 'tall sprite mode' vertical tile ordering
- *  - Option for removing duplicate tiles
  *  - Option to generate tile maps for larger images
  *  - Option to help automate colour-cycling
  */
@@ -29,6 +28,8 @@
 /* Global State */
 target_t target = VDP_MODE_4;
 char *output_dir = NULL;
+bool compress = false;
+bool dedupe = false;
 
 
 /*
@@ -177,7 +178,7 @@ int main (int argc, char **argv)
 
     if (argc < 2)
     {
-        fprintf (stderr, "Usage: %s [--mode-0] [--output <dir>] [--palette <0x00 0x01..>] <tiles.png>\n", argv [0]);
+        fprintf (stderr, "Usage: %s [--mode-0] [--compress] [--dedupe] [--output <dir>] [--palette <0x00 0x01..>] <tiles.png>\n", argv [0]);
         return EXIT_FAILURE;
     }
     argv++;
@@ -191,6 +192,22 @@ int main (int argc, char **argv)
         argc -= 1;
     }
 
+    /* Compressed pattern data */
+    if (strcmp (argv [0], "--compress") == 0)
+    {
+        compress = true;
+        argv += 1;
+        argc -= 1;
+    }
+
+    /* Remove duplicate patterns */
+    if (strcmp (argv [0], "--dedupe") == 0)
+    {
+        dedupe = true;
+        argv += 1;
+        argc -= 1;
+    }
+
     /* User-specified output directory */
     if (strcmp (argv [0], "--output") == 0 && argc > 2)
     {
@@ -11,6 +11,8 @@
 #include <stdlib.h>
 
 #include "sneptile.h"
+#include "compress.h"
+#include "dedupe.h"
 
 /* State */
 static uint32_t pattern_index = 0;
@@ -21,6 +23,7 @@ static uint32_t palette_size = 0;
 static FILE *pattern_file = NULL;
 static FILE *pattern_index_file = NULL;
 static FILE *palette_file = NULL;
+static FILE *pattern_remap_file = NULL;
 
 
 /*
@@ -31,6 +34,7 @@ int mode4_open_files (void)
     char *pattern_path = "pattern.h";
     char *pattern_index_path = "pattern_index.h";
     char *palette_path = "palette.h";
+    char *pattern_remap_path = "pattern_remap.h";
 
     /* If the user has specified an output
      * directory, create and change into it */
@@ -39,6 +43,7 @@ int mode4_open_files (void)
         asprintf (&pattern_path, "%s/pattern.h", output_dir);
         asprintf (&pattern_index_path, "%s/pattern_index.h", output_dir);
         asprintf (&palette_path, "%s/palette.h", output_dir);
+        asprintf (&pattern_remap_path, "%s/pattern_remap.h", output_dir);
     }
 
     pattern_file = fopen (pattern_path, "w");
@@ -47,7 +52,10 @@ int mode4_open_files (void)
         fprintf (stderr, "Unable to open output file pattern.h\n");
         return RC_ERROR;
     }
-    fprintf (pattern_file, "static const uint32_t patterns [] = {\n");
+    if (!compress)
+    {
+        fprintf (pattern_file, "static const uint32_t patterns [] = {\n");
+    }
 
     pattern_index_file = fopen (pattern_index_path, "w");
     if (pattern_index_file == NULL)
@@ -55,6 +63,10 @@ int mode4_open_files (void)
         fprintf (stderr, "Unable to open output file pattern_index.h\n");
         return RC_ERROR;
     }
+    if (dedupe)
+    {
+        fprintf (pattern_index_file, "#define PATTERNS_DEDUPED\n");
+    }
 
     palette_file = fopen (palette_path, "w");
     if (palette_file == NULL)
@@ -63,11 +75,22 @@ int mode4_open_files (void)
         return RC_ERROR;
     }
 
+    if (dedupe)
+    {
+        pattern_remap_file = fopen (pattern_remap_path, "w");
+        if (pattern_remap_file == NULL)
+        {
+            fprintf (stderr, "Unable to open output file pattern_remap.h\n");
+            return RC_ERROR;
+        }
+    }
+
     if (output_dir != NULL)
     {
         free (pattern_path);
         free (pattern_index_path);
         free (palette_path);
+        free (pattern_remap_path);
     }
 
     return RC_OK;
@@ -80,7 +103,10 @@ int mode4_open_files (void)
 void mode4_new_input_file (const char *name)
 {
     /* Mark in patterns file */
-    fprintf (pattern_file, "\n    /* %s */\n", name);
+    if (!compress)
+    {
+        fprintf (pattern_file, "\n    /* %s */\n", name);
+    }
 
     /* Generate pattern index define */
     fprintf (pattern_index_file, "#define PATTERN_");
@@ -100,7 +126,8 @@ void mode4_new_input_file (const char *name)
         fprintf (pattern_index_file, "%c", toupper(c));
     }
 
-    fprintf (pattern_index_file, " %d\n", pattern_index);
+    /* When removing duplicates, the defines refer to logical indices, to be looked up in the remap table */
+    fprintf (pattern_index_file, " %d\n", dedupe ? dedupe_logical_index () : pattern_index);
 }
 
 
@@ -165,7 +192,17 @@ int mode4_close_files (void)
     rc = mode4_palette_write ();
 
     /* Pattern file */
-    fprintf (pattern_file, "};\n");
+    if (compress)
+    {
+        if (compress_write (pattern_file) != RC_OK)
+        {
+            rc = RC_ERROR;
+        }
+    }
+    else
+    {
+        fprintf (pattern_file, "};\n");
+    }
     fclose (pattern_file);
     pattern_file = NULL;
 
@@ -177,6 +214,17 @@ int mode4_close_files (void)
     fclose (palette_file);
     palette_file = NULL;
 
+    /* Pattern remap file */
+    if (dedupe)
+    {
+        if (dedupe_write (pattern_remap_file) != RC_OK)
+        {
+            rc = RC_ERROR;
+        }
+        fclose (pattern_remap_file);
+        pattern_remap_file = NULL;
+    }
+
     return rc;
 }
 
@@ -222,11 +270,10 @@ static uint8_t mode4_rgb_to_index (pixel_t p)
  */
 void mode4_process_tile (pixel_t *buffer, uint32_t stride)
 {
-    fprintf (pattern_file, "    ");
+    uint8_t pattern_lines [8][4] = { };
+
     for (uint32_t y = 0; y < 8; y++)
     {
-        uint8_t line_data[4] = { };
-
         for (uint32_t x = 0; x < 8; x++)
         {
             uint8_t index = 0;
@@ -243,14 +290,35 @@ void mode4_process_tile (pixel_t *buffer, uint32_t stride)
             {
                 if (index & (1 << i))
                 {
-                    line_data [i] |= (1 << (7 - x));
+                    pattern_lines [y][i] |= (1 << (7 - x));
                 }
             }
         }
+    }
 
-        fprintf (pattern_file, "0x%02x%02x%02x%02x%s",
-                 line_data [3], line_data [2], line_data [1], line_data [0],
-                 (y < 7) ? ", " : ",\n");
+    /* Skip patterns that have already been emitted */
+    if (dedupe)
+    {
+        if (dedupe_find ((uint8_t *) pattern_lines, sizeof (pattern_lines)))
+        {
+            return;
+        }
+        dedupe_add ((uint8_t *) pattern_lines, sizeof (pattern_lines), pattern_index);
+    }
+
+    if (compress)
+    {
+        compress_add ((uint8_t *) pattern_lines, sizeof (pattern_lines));
+    }
+    else
+    {
+        fprintf (pattern_file, "    ");
+        for (uint32_t y = 0; y < 8; y++)
+        {
+            fprintf (pattern_file, "0x%02x%02x%02x%02x%s",
+                     pattern_lines [y][3], pattern_lines [y][2], pattern_lines [y][1], pattern_lines [y][0],
+                     (y < 7) ? ", " : ",\n");
+        }
     }
 
     pattern_index++;
@@ -22,4 +22,6 @@ typedef enum target_e {
 /* Global State */
 extern target_t target;
 extern char *output_dir;
+extern bool compress;
+extern bool dedupe;
 
@@ -11,6 +11,8 @@
 #include <stdlib.h>
 
 #include "sneptile.h"
+#include "compress.h"
+#include "dedupe.h"
 
 /* State */
 static uint32_t pattern_index = 0;
@@ -32,6 +34,7 @@ static uint32_t test_ct_entry_size = 0;
 static FILE *pattern_file = NULL;
 static FILE *pattern_index_file = NULL;
 static FILE *colour_table_file = NULL;
+static FILE *pattern_remap_file = NULL;
 
 /* TMS9928a palette (gamma corrected) */
 static const pixel_t tms9928a_palette [16] = {
@@ -62,6 +65,7 @@ int tms9928a_open_files (void)
     char *pattern_path = "pattern.h";
     char *pattern_index_path = "pattern_index.h";
     char *colour_table_path = "colour_table.h";
+    char *pattern_remap_path = "pattern_remap.h";
 
     /* If the user has specified an output
      * directory, create and change into it */
@@ -70,6 +74,7 @@ int tms9928a_open_files (void)
         asprintf (&pattern_path, "%s/pattern.h", output_dir);
         asprintf (&pattern_index_path, "%s/pattern_index.h", output_dir);
         asprintf (&colour_table_path, "%s/colour_table.h", output_dir);
+        asprintf (&pattern_remap_path, "%s/pattern_remap.h", output_dir);
     }
 
     /* Pattern file */
@@ -79,7 +84,10 @@ int tms9928a_open_files (void)
         fprintf (stderr, "Unable to open output file pattern.h\n");
         return RC_ERROR;
     }
-    fprintf (pattern_file, "static const uint32_t patterns [] = {\n");
+    if (!compress)
+    {
+        fprintf (pattern_file, "static const uint32_t patterns [] = {\n");
+    }
 
     /* Pattern index file */
     pattern_index_file = fopen (pattern_index_path, "w");
@@ -88,6 +96,10 @@ int tms9928a_open_files (void)
         fprintf (stderr, "Unable to open output file pattern_index.h\n");
         return RC_ERROR;
     }
+    if (dedupe)
+    {
+        fprintf (pattern_index_file, "#define PATTERNS_DEDUPED\n");
+    }
 
     /* Colour table file */
     colour_table_file = fopen (colour_table_path, "w");
@@ -98,11 +110,23 @@ int tms9928a_open_files (void)
     }
     fprintf (colour_table_file, "static const uint8_t colour_table [] = {\n");
 
+    /* Pattern remap file */
+    if (dedupe)
+    {
+        pattern_remap_file = fopen (pattern_remap_path, "w");
+        if (pattern_remap_file == NULL)
+        {
+            fprintf (stderr, "Unable to open output file pattern_remap.h\n");
+            return RC_ERROR;
+        }
+    }
+
     if (output_dir != NULL)
     {
         free (pattern_path);
         free (pattern_index_path);
         free (colour_table_path);
+        free (pattern_remap_path);
     }
 
     return RC_OK;
@@ -114,6 +138,12 @@ int tms9928a_open_files (void)
  */
 static void tms9928a_emit_pattern (uint8_t *pattern_lines)
 {
+    if (compress)
+    {
+        compress_add (pattern_lines, 8);
+        return;
+    }
+
     /* Indent at the start of  each line, plus spaces between patterns */
     fprintf (pattern_file, "%s", line_pattern_index == 0 ? "    " : " ");
 
@@ -155,8 +185,17 @@ static void tms9928a_emit_ct_entry (void)
  */
 int tms9928a_close_files (void)
 {
+    int rc = RC_OK;
+
     /* Pattern file */
-    fprintf (pattern_file, "%s};\n", line_pattern_index != 0 ? "\n" : "");
+    if (compress)
+    {
+        rc = compress_write (pattern_file);
+    }
+    else
+    {
+        fprintf (pattern_file, "%s};\n", line_pattern_index != 0 ? "\n" : "");
+    }
     fclose (pattern_file);
     pattern_file = NULL;
 
@@ -173,20 +212,34 @@ int tms9928a_close_files (void)
     fclose (colour_table_file);
     colour_table_file = NULL;
 
-    return RC_OK;
+    /* Pattern remap file */
+    if (dedupe)
+    {
+        if (dedupe_write (pattern_remap_file) != RC_OK)
+        {
+            rc = RC_ERROR;
+        }
+        fclose (pattern_remap_file);
+        pattern_remap_file = NULL;
+    }
+
+    return rc;
 }
 
 
 /*
- * Mark the start of a new source file.
+ * Mark the start of a new source file, whose first tile has the given index.
  */
-void tms9928a_new_input_first_tile (void)
+void tms9928a_new_input_first_tile (uint32_t index)
 {
     const char *name = input_filename;
 
     /* Mark in patterns file */
-    fprintf (pattern_file, "%s\n    /* %s */\n", line_pattern_index != 0 ? "\n" : "", name);
-    line_pattern_index = 0;
+    if (!compress)
+    {
+        fprintf (pattern_file, "%s\n    /* %s */\n", line_pattern_index != 0 ? "\n" : "", name);
+        line_pattern_index = 0;
+    }
 
     /* Generate pattern index define */
     fprintf (pattern_index_file, "#define PATTERN_");
@@ -206,7 +259,7 @@ void tms9928a_new_input_first_tile (void)
         fprintf (pattern_index_file, "%c", toupper(c));
     }
 
-    fprintf (pattern_index_file, " %d\n", pattern_index);
+    fprintf (pattern_index_file, " %u\n", index);
 
     first_pattern_in_file = false;
 }
@@ -367,6 +420,7 @@ static bool tms9928a_check_ct_compatible (void)
 void tms9928a_process_tile (pixel_t *buffer, uint32_t stride)
 {
     uint8_t pattern_lines [8] = { };
+    uint8_t tile_colours [64] = { };
 
     /* First, generate the palette we'd need for this tile so that
      * we can check it against the limitations of the tms9928a. */
@@ -379,6 +433,32 @@ void tms9928a_process_tile (pixel_t *buffer, uint32_t stride)
         return;
     }
 
+    /* When removing duplicates, tiles are compared by their colours rather than their
+     * pattern bits. A repeated tile then displays correctly using the earlier copy,
+     * along with the colour-table entry that the earlier copy was emitted under. */
+    if (dedupe)
+    {
+        for (uint32_t y = 0; y < 8; y++)
+        {
+            for (uint32_t x = 0; x < 8; x++)
+            {
+                tile_colours [x + y * 8] = tms9928a_rgb_to_colour_index (buffer [x + y * stride]);
+            }
+        }
+
+        /* Taken before the lookup, which adds a duplicate to the remap table */
+        uint32_t logical_index = dedupe_logical_index ();
+
+        if (dedupe_find (tile_colours, sizeof (tile_colours)))
+        {
+            if (first_pattern_in_file)
+            {
+                tms9928a_new_input_first_tile (logical_index);
+            }
+            return;
+        }
+    }
+
     /* If the colours are not compatible, we need to emit dummy
      * tiles until we reach the next block of eight patterns so
      * that the palette can be reset. */
@@ -415,7 +495,12 @@ void tms9928a_process_tile (pixel_t *buffer, uint32_t stride)
      * mark it in the pattern file and generate the index definition. */
     if (first_pattern_in_file)
     {
-        tms9928a_new_input_first_tile ();
+        /* When removing duplicates, the defines refer to logical indices, to be looked up in the remap table */
+        tms9928a_new_input_first_tile (dedupe ? dedupe_logical_index () : pattern_index);
+    }
+    if (dedupe)
+    {
+        dedupe_add (tile_colours, sizeof (tile_colours), pattern_index);
     }
     tms9928a_emit_pattern (pattern_lines);
 
@@ -0,0 +1,56 @@
+#!/bin/sh
+# Check the pattern indices that --dedupe generates, in both modes.
+#
+# Each image is given twice, so that the second copy is made entirely of
+# duplicates, and is followed by an image with new patterns. The defines
+# count every tile given, duplicates included, so each should be the total
+# number of tiles in the images before it.
+#
+# Usage: ./test.sh
+
+sneptile="$(dirname "${0}")/Sneptile"
+tiles="$(dirname "${0}")/../../tiles"
+
+work="$(mktemp -d)"
+trap 'rm -rf "${work}"' EXIT
+
+failed=0
+
+# Parameter {1} - Expected pattern_index.h
+# Parameter {2} - Sneptile options
+# Remaining parameters - Images
+check_indices ()
+{
+    expected="${1}"
+    options="${2}"
+    shift 2
+
+    if ! ${sneptile} ${options} --output "${work}" "${@}" > /dev/null
+    then
+        echo "FAIL: Sneptile ${options} ${*}"
+        failed=$((failed + 1))
+        return
+    fi
+
+    if printf "${expected}" | cmp -s - "${work}/pattern_index.h"
+    then
+        echo "pass: Sneptile ${options}"
+    else
+        echo "FAIL: Sneptile ${options} ${*}"
+        printf "${expected}" | diff - "${work}/pattern_index.h"
+        failed=$((failed + 1))
+    fi
+}
+
+# empty is one tile, and led is four
+check_indices "#define PATTERNS_DEDUPED\n#define PATTERN_EMPTY 0\n#define PATTERN_LED 1\n#define PATTERN_EMPTY 5\n#define PATTERN_LED 6\n#define PATTERN_BUTTON 10\n" \
+    "--dedupe" "${tiles}/empty.png" "${tiles}/led.png" "${tiles}/empty.png" "${tiles}/led.png" "${tiles}/button.png"
+
+check_indices "#define PATTERNS_DEDUPED\n#define PATTERN_EMPTY_TMS 0\n#define PATTERN_LED_TMS 1\n#define PATTERN_EMPTY_TMS 5\n#define PATTERN_LED_TMS 6\n#define PATTERN_BUTTON_TMS 10\n" \
+    "--mode-0 --dedupe" "${tiles}/empty_tms.png" "${tiles}/led_tms.png" "${tiles}/empty_tms.png" "${tiles}/led_tms.png" "${tiles}/button_tms.png"
+
+if [ ${failed} -ne 0 ]
+then
+    echo "${failed} check(s) failed"
+    exit 1
+fi
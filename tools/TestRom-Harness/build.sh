@@ -0,0 +1,9 @@
+#!/bin/sh
+
+CC=gcc
+CFLAGS="-std=c11 -O2 -Wall -Werror"
+
+common="source/input.c source/machine.c source/rom.c source/symbols.c source/z80.c ../PSG-Log/source/psg_log.c"
+
+$CC $CFLAGS source/main.c $common -o harness
+$CC $CFLAGS source/bench.c $common -o bench
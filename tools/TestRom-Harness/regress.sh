@@ -0,0 +1,101 @@
+#!/bin/sh
+# Run every input script in a directory against a ROM, and compare the
+# PSG writes and final GUI values with those expected.
+#
+# Usage: ./regress.sh [--update] <rom-file> <symbol-file> <script-dir> <expected-dir>
+#
+# Each <script-dir>/<name>.txt is checked against <expected-dir>/<name>.writes
+# and <expected-dir>/<name>.values. With --update, the expected files are
+# written from the current ROM instead.
+#
+# The writes are compared by frame, so that a change to the ROM's timing
+# within a frame does not fail every script. Writes made before the script's
+# first key press are listed as "start", as are those made as the ROM starts.
+
+harness="$(dirname "${0}")/harness"
+psglog="$(dirname "${0}")/../PSG-Log/psglog"
+
+
+# List the writes in a PSG log by frame, without the ticks within the frame.
+writes ()
+{
+    first="$(sed 's/#.*//' "${2}" | grep -o 'frame[[:space:]]*[0-9]*' | tr -dc '0-9\n' | sort -n | head -n 1)"
+
+    ${psglog} "${1}" | awk -v first="${first:-0}" '
+        /^ *[0-9]+:/ { split($1, time, ":"); printf "%6s  %-6s %s\n", (time[1] < first) ? "start" : time[1], $2, $3; next }
+        /^End at tick/ { next }
+        { print }'
+}
+
+update=false
+if [ "${1}" = "--update" ]
+then
+    update=true
+    shift
+fi
+
+if [ $# -ne 4 ]
+then
+    echo "Usage: ${0} [--update] <rom-file> <symbol-file> <script-dir> <expected-dir>"
+    exit 1
+fi
+
+if [ ! -x "${psglog}" ]
+then
+    echo "Error: ${psglog} is needed to list the writes. Run its build.sh first."
+    exit 1
+fi
+
+rom="${1}"
+symbols="${2}"
+scripts="${3}"
+expected="${4}"
+
+work="$(mktemp -d)"
+trap 'rm -rf "${work}"' EXIT
+
+mkdir -p "${expected}"
+
+passed=0
+failed=0
+for script in "${scripts}"/*.txt
+do
+    [ -e "${script}" ] || continue
+    name="$(basename "${script}" .txt)"
+
+    if ! ${harness} --input "${script}" --symbols "${symbols}" --values "${work}/${name}.values" \
+        "${rom}" "${work}/${name}.psgl" > /dev/null
+    then
+        echo "FAIL ${name}: harness error"
+        failed=$((failed + 1))
+        continue
+    fi
+    writes "${work}/${name}.psgl" "${script}" > "${work}/${name}.writes"
+
+    if [ ${update} = true ]
+    then
+        cp "${work}/${name}.writes" "${work}/${name}.values" "${expected}/"
+        passed=$((passed + 1))
+    elif ! cmp -s "${work}/${name}.values" "${expected}/${name}.values"
+    then
+        echo "FAIL ${name}: GUI values differ"
+        diff "${expected}/${name}.values" "${work}/${name}.values" | sed 's/^/    /'
+        failed=$((failed + 1))
+    elif ! cmp -s "${work}/${name}.writes" "${expected}/${name}.writes"
+    then
+        echo "FAIL ${name}: PSG writes differ"
+        diff "${expected}/${name}.writes" "${work}/${name}.writes" | sed 's/^/    /'
+        failed=$((failed + 1))
+    else
+        passed=$((passed + 1))
+    fi
+done
+
+if [ ${update} = true ]
+then
+    echo "Updated ${passed} expected results."
+else
+    echo "${passed} passed, ${failed} failed."
+fi
+
+[ ${failed} -eq 0 ]
@@ -0,0 +1,524 @@
+/*
+ * TestRom-Harness
+ * A tool to measure the T-states taken by the test ROM's hot paths.
+ *
+ * JoppyFurr 2024
+ *
+ * Each path is a function of the ROM, found by its symbol. A call is timed
+ * from the function's first instruction until it returns, and any interrupts
+ * taken part-way through are not counted against it. The main loop is timed
+ * from the return of SMS_waitForVBlank to the next call.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../PSG-Log/source/psg_log.h"
+#include "z80.h"
+#include "machine.h"
+#include "input.h"
+#include "rom.h"
+#include "symbols.h"
+
+#define DEFAULT_FRAMES      600
+#define DEFAULT_THRESHOLD   5
+#define SETTLE_FRAMES       60
+#define SYMBOL_FILES_MAX    4
+#define STACK_DEPTH         64
+
+/* Cycles between the end of the active display and the next frame */
+#define VBLANK_NTSC         ((MACHINE_LINES_NTSC - 192) * MACHINE_LINE_CYCLES)
+#define VBLANK_PAL          ((MACHINE_LINES_PAL - 192) * MACHINE_LINE_CYCLES)
+
+typedef enum path_id_e {
+    PATH_MAIN_LOOP = 0,
+    PATH_INTERRUPT,
+    PATH_WAIT,
+    PATH_FUNCTIONS
+} path_id_t;
+
+typedef struct path_s {
+    const char *name;
+    bool reported;
+    uint16_t addr;
+    bool found;
+    uint64_t calls;
+    uint64_t total;
+    uint64_t max;
+} path_t;
+
+/* The first three paths are timed specially, the rest are functions found by symbol */
+static path_t paths [] = {
+    { "main_loop",              true },
+    { "interrupt",              true },
+    { "SMS_waitForVBlank",      false },
+    { "frame_interrupt",        true },
+    { "cursor_tick",            true },
+    { "cursor_draw",            true },
+    { "key_repeat",             true },
+    { "draw_flush",             true },
+    { "draw_keyboard_update",   true },
+    { "draw_value_wide",        true },
+    { "element_update",         true },
+};
+
+#define PATH_COUNT (sizeof (paths) / sizeof (paths [0]))
+
+typedef struct call_s {
+    uint32_t path;
+    uint16_t sp;
+    uint64_t start;
+    uint64_t excluded;
+} call_t;
+
+typedef struct bench_s {
+    uint8_t entry [0x10000];
+    call_t stack [STACK_DEPTH];
+    uint32_t depth;
+    uint64_t interrupts;
+    uint64_t last_cycles;
+    bool loop_active;
+    uint64_t loop_start;
+    uint64_t loop_excluded;
+    bool overflow;
+} bench_t;
+
+static bench_t bench;
+
+
+/*
+ * Add a timed call to a path's totals.
+ */
+static void path_record (uint32_t path, uint64_t cycles)
+{
+    paths [path].calls++;
+    paths [path].total += cycles;
+    if (cycles > paths [path].max)
+    {
+        paths [path].max = cycles;
+    }
+}
+
+
+/*
+ * Start timing a call. The stack pointer given is that just after the return address was pushed.
+ */
+static void call_push (uint32_t path, uint16_t sp, uint64_t start)
+{
+    /* A jump back to the start of a function is not a new call */
+    if (bench.depth > 0 && bench.stack [bench.depth - 1].path == path && bench.stack [bench.depth - 1].sp == sp)
+    {
+        return;
+    }
+
+    if (bench.depth == STACK_DEPTH)
+    {
+        bench.overflow = true;
+        return;
+    }
+
+    bench.stack [bench.depth].path = path;
+    bench.stack [bench.depth].sp = sp;
+    bench.stack [bench.depth].start = start;
+    bench.stack [bench.depth].excluded = 0;
+    bench.depth++;
+}
+
+
+/*
+ * Finish timing a call that has returned.
+ */
+static void call_pop (uint64_t cycles)
+{
+    call_t *call = &bench.stack [--bench.depth];
+    uint64_t taken = cycles - call->start;
+
+    path_record (call->path, taken - call->excluded);
+
+    if (call->path == PATH_INTERRUPT)
+    {
+        /* Everything still on the stack was interrupted */
+        for (uint32_t i = 0; i < bench.depth; i++)
+        {
+            bench.stack [i].excluded += taken;
+        }
+        bench.loop_excluded += taken;
+    }
+    else if (call->path == PATH_WAIT)
+    {
+        bench.loop_active = true;
+        bench.loop_start = cycles;
+        bench.loop_excluded = 0;
+    }
+}
+
+
+/*
+ * Called by the Z80 after each instruction or accepted interrupt.
+ */
+static void bench_trace (void *context, const z80_t *z80)
+{
+    if (z80->interrupts != bench.interrupts)
+    {
+        bench.interrupts = z80->interrupts;
+        call_push (PATH_INTERRUPT, z80->sp, bench.last_cycles);
+    }
+
+    /* Returning pops the return address, leaving the stack pointer above where it was on entry */
+    while (bench.depth > 0 && z80->sp > bench.stack [bench.depth - 1].sp)
+    {
+        call_pop (z80->cycles);
+    }
+
+    uint32_t path = bench.entry [z80->pc];
+    if (path != 0)
+    {
+        if (path == PATH_WAIT && bench.loop_active)
+        {
+            path_record (PATH_MAIN_LOOP, z80->cycles - bench.loop_start - bench.loop_excluded);
+            bench.loop_active = false;
+        }
+        call_push (path, z80->sp, z80->cycles);
+    }
+
+    bench.last_cycles = z80->cycles;
+}
+
+
+/*
+ * Find the address of each path's function.
+ * Returns -1 if a path needed to time the main loop is missing.
+ */
+static int paths_find (const symbol_table_t *symbols, console_t console)
+{
+    if (console == CONSOLE_SG)
+    {
+        paths [PATH_WAIT].name = "SG_waitForVBlank";
+    }
+
+    for (uint32_t i = PATH_WAIT; i < PATH_COUNT; i++)
+    {
+        if (symbols_find (symbols, paths [i].name, &paths [i].addr) == -1)
+        {
+            /* Static functions are only listed in the .cdb file */
+            fprintf (stderr, "Warning: Symbol '_%s' not found, it will not be timed.\n", paths [i].name);
+            continue;
+        }
+
+        if (bench.entry [paths [i].addr] != 0)
+        {
+            fprintf (stderr, "Warning: '%s' shares its address with '%s', it will not be timed.\n",
+                     paths [i].name, paths [bench.entry [paths [i].addr]].name);
+            continue;
+        }
+
+        paths [i].found = true;
+        bench.entry [paths [i].addr] = i;
+    }
+
+    if (!paths [PATH_WAIT].found)
+    {
+        fprintf (stderr, "Error: The main loop cannot be timed without '_%s'.\n", paths [PATH_WAIT].name);
+        return -1;
+    }
+
+    paths [PATH_MAIN_LOOP].found = true;
+    paths [PATH_INTERRUPT].found = true;
+
+    return 0;
+}
+
+
+/*
+ * Read the worst-case cost of each path from a baseline file.
+ * Paths missing from the file are given a baseline of 0.
+ * Returns -1 if the file cannot be read.
+ */
+static int baseline_read (const char *filename, uint64_t *baseline)
+{
+    char line [256];
+
+    FILE *file = fopen (filename, "r");
+    if (file == NULL)
+    {
+        return -1;
+    }
+
+    while (fgets (line, sizeof (line), file) != NULL)
+    {
+        char name [128];
+        unsigned long long max;
+
+        if (line [0] == '#' || sscanf (line, "%127s %llu", name, &max) != 2)
+        {
+            continue;
+        }
+
+        for (uint32_t i = 0; i < PATH_COUNT; i++)
+        {
+            if (strcmp (name, paths [i].name) == 0)
+            {
+                baseline [i] = max;
+            }
+        }
+    }
+
+    fclose (file);
+    return 0;
+}
+
+
+/*
+ * Write the worst-case cost of each path to a baseline file.
+ */
+static int baseline_write (const char *filename, const char *rom_filename)
+{
+    FILE *file = fopen (filename, "w");
+    if (file == NULL)
+    {
+        fprintf (stderr, "Failed to open baseline file '%s'.\n", filename);
+        return -1;
+    }
+
+    fprintf (file, "# Worst-case T-states for %s\n", rom_filename);
+    for (uint32_t i = 0; i < PATH_COUNT; i++)
+    {
+        if (paths [i].reported && paths [i].calls > 0)
+        {
+            fprintf (file, "%s %llu\n", paths [i].name, (unsigned long long) paths [i].max);
+        }
+    }
+
+    if (fclose (file) != 0)
+    {
+        fprintf (stderr, "Failed to write baseline file '%s'.\n", filename);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/*
+ * Print the cost of each path, against the VBlank budgets and the baseline.
+ * Returns the number of paths that have regressed.
+ */
+static uint32_t report_print (const uint64_t *baseline, uint32_t threshold)
+{
+    uint32_t regressions = 0;
+
+    printf ("%-22s %7s %8s %8s %7s %7s %9s\n", "Path", "Calls", "Mean", "Max", "NTSC", "PAL", "Baseline");
+
+    for (uint32_t i = 0; i < PATH_COUNT; i++)
+    {
+        if (!paths [i].reported || !paths [i].found)
+        {
+            continue;
+        }
+
+        if (paths [i].calls == 0)
+        {
+            printf ("%-22s %7s\n", paths [i].name, "-");
+            continue;
+        }
+
+        printf ("%-22s %7llu %8llu %8llu %6.1f%% %6.1f%%", paths [i].name,
+                (unsigned long long) paths [i].calls,
+                (unsigned long long) ((paths [i].total + paths [i].calls / 2) / paths [i].calls),
+                (unsigned long long) paths [i].max,
+                100.0 * paths [i].max / VBLANK_NTSC, 100.0 * paths [i].max / VBLANK_PAL);
+
+        if (baseline != NULL && baseline [i] != 0)
+        {
+            printf (" %9llu", (unsigned long long) baseline [i]);
+
+            /* Worst-case costs are compared, as they decide whether a path fits in the frame */
+            if (paths [i].max * 100 > baseline [i] * (100 + threshold))
+            {
+                printf ("  Regressed by %.1f%%", 100.0 * paths [i].max / baseline [i] - 100.0);
+                regressions++;
+            }
+        }
+        printf ("\n");
+    }
+
+    printf ("VBlank budgets: %u T-states for NTSC, %u T-states for PAL\n", VBLANK_NTSC, VBLANK_PAL);
+
+    return regressions;
+}
+
+
+int main (int argc, char **argv)
+{
+    const char *symbol_filenames [SYMBOL_FILES_MAX];
+    uint32_t symbol_file_count = 0;
+    const char *input_script_filename = NULL;
+    const char *baseline_filename = NULL;
+    const char *rom_filename = NULL;
+    uint32_t threshold = DEFAULT_THRESHOLD;
+    bool update = false;
+    uint64_t frames = 0;
+    int region = -1;
+    console_t console;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp (argv [i], "--frames") == 0 && i + 1 < argc)
+        {
+            frames = strtoull (argv [++i], NULL, 10);
+        }
+        else if (strcmp (argv [i], "--input") == 0 && i + 1 < argc)
+        {
+            input_script_filename = argv [++i];
+        }
+        else if (strcmp (argv [i], "--symbols") == 0 && i + 1 < argc && symbol_file_count < SYMBOL_FILES_MAX)
+        {
+            symbol_filenames [symbol_file_count++] = argv [++i];
+        }
+        else if (strcmp (argv [i], "--baseline") == 0 && i + 1 < argc)
+        {
+            baseline_filename = argv [++i];
+        }
+        else if (strcmp (argv [i], "--threshold") == 0 && i + 1 < argc)
+        {
+            threshold = strtoul (argv [++i], NULL, 10);
+        }
+        else if (strcmp (argv [i], "--update") == 0)
+        {
+            update = true;
+        }
+        else if (strcmp (argv [i], "--pal") == 0)
+        {
+            region = 1;
+        }
+        else if (strcmp (argv [i], "--ntsc") == 0)
+        {
+            region = 0;
+        }
+        else if (rom_filename == NULL && argv [i][0] != '-')
+        {
+            rom_filename = argv [i];
+        }
+        else
+        {
+            rom_filename = NULL;
+            break;
+        }
+    }
+
+    if (rom_filename == NULL || symbol_file_count == 0 || (update && baseline_filename == NULL))
+    {
+        fprintf (stderr, "Usage: %s [--frames <n>] [--input <script>] [--pal|--ntsc] --symbols <file.noi> [--symbols <file.cdb>]\n"
+                         "        [--baseline <file> [--threshold <percent>] [--update]] <rom-file>\n", argv [0]);
+        return EXIT_FAILURE;
+    }
+
+    if (rom_console (rom_filename, &console) == -1)
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (region == -1)
+    {
+        region = (strstr (rom_filename, "_PAL") != NULL) ? 1 : 0;
+    }
+    if (console == CONSOLE_GG && region == 1)
+    {
+        fprintf (stderr, "Error: The Game Gear is NTSC only.\n");
+        return EXIT_FAILURE;
+    }
+
+    symbol_table_t symbols = { 0 };
+    for (uint32_t i = 0; i < symbol_file_count; i++)
+    {
+        if (symbols_load (&symbols, symbol_filenames [i]) == -1)
+        {
+            symbols_free (&symbols);
+            return EXIT_FAILURE;
+        }
+    }
+
+    int result = paths_find (&symbols, console);
+    symbols_free (&symbols);
+    if (result == -1)
+    {
+        return EXIT_FAILURE;
+    }
+
+    uint8_t *rom = NULL;
+    uint32_t rom_size = rom_load (rom_filename, &rom);
+    if (rom_size == 0)
+    {
+        free (rom);
+        return EXIT_FAILURE;
+    }
+
+    static machine_t machine;
+    if (machine_init (&machine, console, region == 1, rom, rom_size) == -1)
+    {
+        fprintf (stderr, "Error: Failed to set up machine for ROM file '%s'.\n", rom_filename);
+        free (rom);
+        return EXIT_FAILURE;
+    }
+    free (rom);
+
+    input_script_t script = { 0 };
+    if (input_script_filename != NULL && input_script_load (&script, input_script_filename) == -1)
+    {
+        machine_free (&machine);
+        return EXIT_FAILURE;
+    }
+
+    if (frames == 0)
+    {
+        frames = (script.count > 0) ? input_script_end (&script) + SETTLE_FRAMES : DEFAULT_FRAMES;
+    }
+
+    machine.z80.trace_context = &bench;
+    machine.z80.trace = bench_trace;
+
+    for (uint64_t frame = 0; frame < frames; frame++)
+    {
+        machine_set_keys (&machine, input_script_keys (&script, frame));
+        machine_run_frame (&machine);
+    }
+
+    input_script_free (&script);
+    machine_free (&machine);
+
+    if (bench.overflow)
+    {
+        fprintf (stderr, "Warning: Calls nested too deeply, some were not timed.\n");
+    }
+
+    printf ("%s, %llu frames\n", rom_filename, (unsigned long long) frames);
+
+    if (update)
+    {
+        report_print (NULL, threshold);
+        return (baseline_write (baseline_filename, rom_filename) == -1) ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    /* A missing baseline is an error, so that a regression check that was asked for cannot quietly pass */
+    uint64_t baseline [PATH_COUNT] = { 0 };
+    if (baseline_filename != NULL && baseline_read (baseline_filename, baseline) == -1)
+    {
+        report_print (NULL, threshold);
+        fprintf (stderr, "Error: No baseline found at '%s'. Use --update to record one.\n", baseline_filename);
+        return EXIT_FAILURE;
+    }
+
+    uint32_t regressions = report_print ((baseline_filename != NULL) ? baseline : NULL, threshold);
+    if (regressions > 0)
+    {
+        fprintf (stderr, "Error: %u path%s regressed by more than %u%%.\n", regressions, (regressions == 1) ? "" : "s", threshold);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
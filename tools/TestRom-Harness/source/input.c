@@ -0,0 +1,294 @@
+/*
+ * TestRom-Harness
+ * Scripted controller input.
+ *
+ * JoppyFurr 2024
+ *
+ * A script lists the keys pressed at each frame. Keys are pressed for a
+ * single frame, unless a number of frames to hold them for is given:
+ *
+ *   # Move right twice, then hold button 1 for a second and a half
+ *   frame 120: right; frame 130: right
+ *   frame 150: btn1 held 90 frames
+ *
+ * Entries are separated by new lines or semicolons, and may be in any order.
+ * Where entries overlap, their keys are held together.
+ * Keys are up, down, left, right, 1 (or btn1), 2 (or btn2), and pause
+ * (or start, on the Game Gear).
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "../../PSG-Log/source/psg_log.h"
+#include "z80.h"
+#include "machine.h"
+#include "input.h"
+
+#define SEPARATORS  " \t\r\n:,"
+
+typedef struct key_name_s {
+    const char *name;
+    uint16_t key;
+} key_name_t;
+
+static const key_name_t key_names [] = {
+    { "up",     MACHINE_KEY_UP },
+    { "down",   MACHINE_KEY_DOWN },
+    { "left",   MACHINE_KEY_LEFT },
+    { "right",  MACHINE_KEY_RIGHT },
+    { "1",      MACHINE_KEY_1 },
+    { "btn1",   MACHINE_KEY_1 },
+    { "2",      MACHINE_KEY_2 },
+    { "btn2",   MACHINE_KEY_2 },
+    { "pause",  MACHINE_KEY_PAUSE },
+    { "start",  MACHINE_KEY_PAUSE },
+};
+
+
+/*
+ * Look up a key by name. Returns 0 if the name is not known.
+ */
+static uint16_t key_lookup (const char *name)
+{
+    for (uint32_t i = 0; i < sizeof (key_names) / sizeof (key_names [0]); i++)
+    {
+        if (strcasecmp (name, key_names [i].name) == 0)
+        {
+            return key_names [i].key;
+        }
+    }
+
+    return 0;
+}
+
+
+/*
+ * Parse a number of frames. Returns false if the token is not a number.
+ */
+static bool parse_frames (const char *token, uint64_t *frames)
+{
+    char *end;
+
+    if (token == NULL || !isdigit ((unsigned char) token [0]))
+    {
+        return false;
+    }
+
+    *frames = strtoull (token, &end, 10);
+    return *end == '\0';
+}
+
+
+/*
+ * Parse one entry of a script. Blank entries produce no event.
+ * Returns 1 for an event, 0 for no event, or -1 on error.
+ */
+static int input_parse_entry (char *entry, input_event_t *event)
+{
+    char *save = NULL;
+    char *token;
+
+    token = strtok_r (entry, SEPARATORS, &save);
+    if (token == NULL)
+    {
+        return 0;
+    }
+
+    if (strcasecmp (token, "frame") != 0 || !parse_frames (strtok_r (NULL, SEPARATORS, &save), &event->frame))
+    {
+        return -1;
+    }
+
+    event->frames = 1;
+    event->keys = 0;
+
+    while ((token = strtok_r (NULL, SEPARATORS, &save)) != NULL)
+    {
+        if (strcasecmp (token, "held") == 0)
+        {
+            if (!parse_frames (strtok_r (NULL, SEPARATORS, &save), &event->frames))
+            {
+                return -1;
+            }
+
+            token = strtok_r (NULL, SEPARATORS, &save);
+            if ((token != NULL && strcasecmp (token, "frames") != 0 && strcasecmp (token, "frame") != 0) ||
+                strtok_r (NULL, SEPARATORS, &save) != NULL)
+            {
+                return -1;
+            }
+            break;
+        }
+
+        uint16_t key = key_lookup (token);
+        if (key == 0)
+        {
+            return -1;
+        }
+        event->keys |= key;
+    }
+
+    return (event->keys != 0 && event->frames != 0) ? 1 : -1;
+}
+
+
+/*
+ * Sort events by the frame they start on.
+ */
+static int input_event_compare (const void *a, const void *b)
+{
+    const input_event_t *event_a = a;
+    const input_event_t *event_b = b;
+
+    return (event_a->frame > event_b->frame) - (event_a->frame < event_b->frame);
+}
+
+
+/*
+ * Load an input script.
+ * Returns -1 on error.
+ */
+int input_script_load (input_script_t *script, const char *filename)
+{
+    uint32_t capacity = 0;
+    uint32_t line_number = 0;
+    bool error = false;
+    char line [1024];
+
+    memset (script, 0, sizeof (input_script_t));
+
+    FILE *file = fopen (filename, "r");
+    if (file == NULL)
+    {
+        fprintf (stderr, "Failed to open input script '%s'.\n", filename);
+        return -1;
+    }
+
+    while (!error && fgets (line, sizeof (line), file) != NULL)
+    {
+        char *comment = strchr (line, '#');
+        char *save = NULL;
+        char *entry;
+
+        line_number++;
+
+        if (comment != NULL)
+        {
+            *comment = '\0';
+        }
+
+        for (entry = strtok_r (line, ";", &save); entry != NULL; entry = strtok_r (NULL, ";", &save))
+        {
+            input_event_t event;
+            int result = input_parse_entry (entry, &event);
+
+            if (result == 0)
+            {
+                continue;
+            }
+            else if (result == -1)
+            {
+                fprintf (stderr, "Error: %s:%u: Expected 'frame <n>: <keys> [held <n> frames]'.\n", filename, line_number);
+                error = true;
+                break;
+            }
+
+            if (script->count == capacity)
+            {
+                capacity = (capacity == 0) ? 64 : capacity * 2;
+                input_event_t *events = realloc (script->events, capacity * sizeof (input_event_t));
+                if (events == NULL)
+                {
+                    fprintf (stderr, "Error: Failed to allocate memory for input script.\n");
+                    error = true;
+                    break;
+                }
+                script->events = events;
+            }
+
+            script->events [script->count++] = event;
+        }
+    }
+
+    fclose (file);
+
+    if (error)
+    {
+        input_script_free (script);
+        return -1;
+    }
+
+    qsort (script->events, script->count, sizeof (input_event_t), input_event_compare);
+
+    return 0;
+}
+
+
+/*
+ * Get the first frame after all of the script's keys have been released.
+ */
+uint64_t input_script_end (const input_script_t *script)
+{
+    uint64_t end = 0;
+
+    for (uint32_t i = 0; i < script->count; i++)
+    {
+        if (script->events [i].frame + script->events [i].frames > end)
+        {
+            end = script->events [i].frame + script->events [i].frames;
+        }
+    }
+
+    return end;
+}
+
+
+/*
+ * Get the keys held during a frame.
+ * Frames must be requested in order.
+ */
+uint16_t input_script_keys (input_script_t *script, uint64_t frame)
+{
+    uint16_t keys = 0;
+
+    while (script->next < script->count && script->events [script->next].frame <= frame)
+    {
+        script->next++;
+    }
+
+    /* Skip over events at the start of the list that have finished */
+    while (script->first_active < script->next &&
+           frame - script->events [script->first_active].frame >= script->events [script->first_active].frames)
+    {
+        script->first_active++;
+    }
+
+    for (uint32_t i = script->first_active; i < script->next; i++)
+    {
+        if (frame - script->events [i].frame < script->events [i].frames)
+        {
+            keys |= script->events [i].keys;
+        }
+    }
+
+    return keys;
+}
+
+
+/*
+ * Free the script's events.
+ */
+void input_script_free (input_script_t *script)
+{
+    free (script->events);
+    script->events = NULL;
+    script->count = 0;
+}
@@ -0,0 +1,32 @@
+/*
+ * TestRom-Harness
+ * Scripted controller input.
+ *
+ * JoppyFurr 2024
+ */
+
+/* Keys pressed at a frame, and held for a number of frames. */
+typedef struct input_event_s {
+    uint64_t frame;
+    uint64_t frames;
+    uint16_t keys;
+} input_event_t;
+
+typedef struct input_script_s {
+    input_event_t *events;
+    uint32_t count;
+    uint32_t next;
+    uint32_t first_active;
+} input_script_t;
+
+/* Load an input script. Returns -1 on error. */
+int input_script_load (input_script_t *script, const char *filename);
+
+/* Get the first frame after all of the script's keys have been released. */
+uint64_t input_script_end (const input_script_t *script);
+
+/* Get the keys held during a frame. Frames must be requested in order. */
+uint16_t input_script_keys (input_script_t *script, uint64_t frame);
+
+/* Free the script's events. */
+void input_script_free (input_script_t *script);
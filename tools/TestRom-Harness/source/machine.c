@@ -0,0 +1,476 @@
+/*
+ * TestRom-Harness
+ * Just enough of the SMS, Game Gear, and SG-1000 to run the test ROM.
+ *
+ * JoppyFurr 2024
+ *
+ * Only the parts of the consoles that the test ROM depends on are emulated:
+ *   - ROM, RAM, and the Sega mapper.
+ *   - VDP registers, VRAM, and CRAM, without any rendering.
+ *   - VDP status, frame and line interrupts, and the V-counter.
+ *   - Controller port A, and the pause / start button.
+ *   - Writes to the PSG and Game Gear stereo ports, which are logged.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../PSG-Log/source/psg_log.h"
+#include "z80.h"
+#include "machine.h"
+
+#define BANK_SIZE       0x4000
+#define PAGES_PER_BANK  (BANK_SIZE >> Z80_PAGE_SHIFT)
+
+/* The SMS VDP sets the frame interrupt flag as the V-counter changes to 0xc1,
+ * the TMS9918 as the active display ends. */
+#define FRAME_IRQ_LINE_SMS  0xc1
+#define FRAME_IRQ_LINE_TMS  0xc0
+#define ACTIVE_LINES        192
+
+
+/*
+ * Update the CPU's interrupt line from the VDP state.
+ */
+static void vdp_update_irq (machine_t *machine)
+{
+    bool frame_irq = (machine->vdp_status & 0x80) && (machine->vdp_regs [1] & 0x20);
+    bool line_irq = machine->line_irq && (machine->vdp_regs [0] & 0x10);
+
+    machine->z80.irq = frame_irq || (machine->console != CONSOLE_SG && line_irq);
+}
+
+
+/*
+ * Map a 16 KiB ROM bank into one of the three slots.
+ * The first 1 KiB of slot 0 is fixed to the start of the ROM.
+ */
+static void mapper_update (machine_t *machine, uint8_t slot)
+{
+    uint32_t bank = machine->mapper [slot + 1] % machine->rom_banks;
+    uint8_t first_page = (slot == 0) ? 1 : 0;
+
+    for (uint8_t page = first_page; page < PAGES_PER_BANK; page++)
+    {
+        machine->z80.read_map [slot * PAGES_PER_BANK + page] = &machine->rom [bank * BANK_SIZE + page * Z80_PAGE_SIZE];
+    }
+}
+
+
+/*
+ * Handle writes to memory without a direct write mapping:
+ * the top page of RAM, which also holds the mapper registers.
+ */
+static void machine_memory_write (void *context, uint16_t addr, uint8_t value)
+{
+    machine_t *machine = context;
+
+    if (addr < 0xc000)
+    {
+        return;
+    }
+
+    machine->ram [addr & machine->ram_mask] = value;
+
+    if (addr >= 0xfffc && machine->console != CONSOLE_SG)
+    {
+        uint8_t reg = addr & 0x03;
+        machine->mapper [reg] = value;
+
+        if (reg != 0)
+        {
+            mapper_update (machine, reg - 1);
+        }
+    }
+}
+
+
+/*
+ * Read the V-counter for the current line.
+ * The counter jumps back part-way through the vertical blank, so that it fits in eight bits.
+ */
+static uint8_t vdp_vcounter (const machine_t *machine)
+{
+    uint32_t line = machine->line;
+
+    if (machine->pal)
+    {
+        return (line <= 0xf2) ? line : line - 57;
+    }
+    return (line <= 0xda) ? line : line - 6;
+}
+
+
+/*
+ * Read the H-counter, approximated from the cycles into the current line.
+ */
+static uint8_t vdp_hcounter (const machine_t *machine)
+{
+    uint32_t cycles = machine->z80.cycles - machine->line_start;
+
+    if (cycles >= MACHINE_LINE_CYCLES)
+    {
+        cycles = MACHINE_LINE_CYCLES - 1;
+    }
+    return (cycles * 342 / MACHINE_LINE_CYCLES) >> 1;
+}
+
+
+/*
+ * Handle a write to the VDP control port.
+ */
+static void vdp_control_write (machine_t *machine, uint8_t value)
+{
+    if (!machine->vdp_latch)
+    {
+        machine->vdp_latch_value = value;
+        machine->vdp_addr = (machine->vdp_addr & 0x3f00) | value;
+        machine->vdp_latch = true;
+        return;
+    }
+
+    machine->vdp_latch = false;
+    machine->vdp_code = value >> 6;
+    machine->vdp_addr = ((value & 0x3f) << 8) | machine->vdp_latch_value;
+
+    if (machine->vdp_code == 2 || (machine->console == CONSOLE_SG && machine->vdp_code == 3))
+    {
+        uint8_t reg = value & ((machine->console == CONSOLE_SG) ? 0x07 : 0x0f);
+        machine->vdp_regs [reg] = machine->vdp_latch_value;
+        vdp_update_irq (machine);
+    }
+    else if (machine->vdp_code == 0)
+    {
+        machine->vdp_read_buffer = machine->vram [machine->vdp_addr];
+        machine->vdp_addr = (machine->vdp_addr + 1) & 0x3fff;
+    }
+}
+
+
+/*
+ * Handle a write to the VDP data port.
+ */
+static void vdp_data_write (machine_t *machine, uint8_t value)
+{
+    machine->vdp_latch = false;
+
+    if (machine->vdp_code == 3 && machine->console != CONSOLE_SG)
+    {
+        machine->cram [machine->vdp_addr & ((machine->console == CONSOLE_GG) ? 0x3f : 0x1f)] = value;
+    }
+    else
+    {
+        machine->vram [machine->vdp_addr] = value;
+    }
+
+    machine->vdp_read_buffer = value;
+    machine->vdp_addr = (machine->vdp_addr + 1) & 0x3fff;
+}
+
+
+/*
+ * Handle a read from the VDP data port.
+ */
+static uint8_t vdp_data_read (machine_t *machine)
+{
+    uint8_t value = machine->vdp_read_buffer;
+
+    machine->vdp_latch = false;
+    machine->vdp_read_buffer = machine->vram [machine->vdp_addr];
+    machine->vdp_addr = (machine->vdp_addr + 1) & 0x3fff;
+
+    return value;
+}
+
+
+/*
+ * Handle a read from the VDP status port, which clears the interrupt flags.
+ */
+static uint8_t vdp_status_read (machine_t *machine)
+{
+    uint8_t value = machine->vdp_status;
+
+    machine->vdp_latch = false;
+    machine->vdp_status = 0x00;
+    machine->line_irq = false;
+    vdp_update_irq (machine);
+
+    return value;
+}
+
+
+/*
+ * Record a write to the PSG or Game Gear stereo port.
+ */
+static void psg_capture (machine_t *machine, uint8_t port, uint8_t value)
+{
+    if (port == PSG_LOG_PORT_PSG)
+    {
+        machine->psg_writes++;
+    }
+    else
+    {
+        machine->stereo_writes++;
+    }
+
+    if (machine->log != NULL && psg_log_write (machine->log, machine->z80.cycles, port, value) == -1)
+    {
+        machine->log_error = true;
+    }
+}
+
+
+/*
+ * Handle a read from an I/O port.
+ */
+static uint8_t machine_port_read (void *context, uint16_t port)
+{
+    machine_t *machine = context;
+    uint8_t low = port & 0xff;
+
+    /* Game Gear registers */
+    if (machine->console == CONSOLE_GG && low == 0x00)
+    {
+        /* Bit 7: Start (active low), Bit 6: Export console */
+        return ((machine->keys & MACHINE_KEY_PAUSE) ? 0x00 : 0x80) | 0x40;
+    }
+
+    switch (low & 0xc1)
+    {
+        case 0x40: /* V-counter */
+            return (machine->console == CONSOLE_SG) ? 0xff : vdp_vcounter (machine);
+
+        case 0x41: /* H-counter */
+            return (machine->console == CONSOLE_SG) ? 0xff : vdp_hcounter (machine);
+
+        case 0x80:
+            return vdp_data_read (machine);
+
+        case 0x81:
+            return vdp_status_read (machine);
+
+        case 0xc0: /* Port A, active low */
+            return (~machine->keys & 0x3f) | 0xc0;
+
+        case 0xc1: /* Port B, active low */
+            return 0xff;
+
+        default:
+            return 0xff;
+    }
+}
+
+
+/*
+ * Handle a write to an I/O port.
+ */
+static void machine_port_write (void *context, uint16_t port, uint8_t value)
+{
+    machine_t *machine = context;
+    uint8_t low = port & 0xff;
+
+    if (machine->console == CONSOLE_GG && low == 0x06)
+    {
+        psg_capture (machine, PSG_LOG_PORT_STEREO, value);
+        return;
+    }
+
+    switch (low & 0xc1)
+    {
+        case 0x40:
+        case 0x41:
+            psg_capture (machine, PSG_LOG_PORT_PSG, value);
+            break;
+
+        case 0x80:
+            vdp_data_write (machine, value);
+            break;
+
+        case 0x81:
+            vdp_control_write (machine, value);
+            break;
+
+        default:
+            /* Memory control, I/O control, and unused ports */
+            break;
+    }
+}
+
+
+/*
+ * Set up the machine to run a ROM image.
+ * The image is copied. Returns -1 on error.
+ */
+int machine_init (machine_t *machine, console_t console, bool pal, const uint8_t *rom, uint32_t rom_size)
+{
+    memset (machine, 0, sizeof (machine_t));
+
+    machine->console = console;
+    machine->pal = pal;
+    machine->frame_lines = pal ? MACHINE_LINES_PAL : MACHINE_LINES_NTSC;
+
+    /* The SG-1000 has no mapper, so always sees 48 KiB of ROM. */
+    machine->rom_banks = (rom_size + BANK_SIZE - 1) / BANK_SIZE;
+    if (console == CONSOLE_SG)
+    {
+        if (rom_size > 3 * BANK_SIZE)
+        {
+            return -1;
+        }
+        machine->rom_banks = 3;
+    }
+
+    if (rom_size == 0)
+    {
+        return -1;
+    }
+
+    machine->rom = malloc (machine->rom_banks * BANK_SIZE);
+    if (machine->rom == NULL)
+    {
+        return -1;
+    }
+    memset (machine->rom, 0xff, machine->rom_banks * BANK_SIZE);
+    memcpy (machine->rom, rom, rom_size);
+    memset (machine->open_bus, 0xff, Z80_PAGE_SIZE);
+
+    /* The SG-1000 has 1 KiB of RAM, the SMS and Game Gear have 8 KiB. Both are mirrored up to 0xffff. */
+    machine->ram_mask = (console == CONSOLE_SG) ? 0x03ff : 0x1fff;
+
+    z80_t *z80 = &machine->z80;
+    for (uint32_t page = 0; page < Z80_PAGE_COUNT; page++)
+    {
+        uint16_t addr = page << Z80_PAGE_SHIFT;
+
+        if (addr < 0xc000)
+        {
+            z80->read_map [page] = &machine->rom [addr];
+            z80->write_map [page] = NULL;
+        }
+        else
+        {
+            z80->read_map [page] = &machine->ram [addr & machine->ram_mask & ~(Z80_PAGE_SIZE - 1)];
+            z80->write_map [page] = &machine->ram [addr & machine->ram_mask & ~(Z80_PAGE_SIZE - 1)];
+        }
+    }
+
+    if (console != CONSOLE_SG)
+    {
+        /* Mapper registers share the top page of RAM. */
+        z80->write_map [Z80_PAGE_COUNT - 1] = NULL;
+
+        machine->mapper [1] = 0;
+        machine->mapper [2] = 1;
+        machine->mapper [3] = 2;
+        mapper_update (machine, 0);
+        mapper_update (machine, 1);
+        mapper_update (machine, 2);
+    }
+
+    z80->context = machine;
+    z80->memory_write = machine_memory_write;
+    z80->port_read = machine_port_read;
+    z80->port_write = machine_port_write;
+    z80_reset (z80);
+
+    return 0;
+}
+
+
+/*
+ * Free the machine's copy of the ROM.
+ */
+void machine_free (machine_t *machine)
+{
+    free (machine->rom);
+    machine->rom = NULL;
+}
+
+
+/*
+ * Fill in PSG log settings to match the machine.
+ * The log is timed in CPU cycles, which run at the same rate as the PSG.
+ */
+void machine_log_info (const machine_t *machine, psg_log_info_t *info)
+{
+    uint32_t clock = machine->pal ? MACHINE_CLOCK_PAL : MACHINE_CLOCK_NTSC;
+
+    psg_log_info_sega (info, clock, clock, machine->frame_lines * MACHINE_LINE_CYCLES);
+
+    if (machine->console == CONSOLE_SG)
+    {
+        /* The SG-1000 uses a discrete SN76489 */
+        info->lfsr_width = 15;
+        info->lfsr_feedback = 0x0003;
+    }
+}
+
+
+/*
+ * Set the keys currently held on the controller.
+ * Pressing pause raises an NMI, except on the Game Gear where start is read from a port.
+ */
+void machine_set_keys (machine_t *machine, uint16_t keys)
+{
+    bool pause_pressed = (keys & ~machine->keys) & MACHINE_KEY_PAUSE;
+
+    machine->keys = keys;
+
+    if (pause_pressed && machine->console != CONSOLE_GG)
+    {
+        z80_nmi (&machine->z80);
+    }
+}
+
+
+/*
+ * Update the VDP at the start of a line.
+ */
+static void vdp_line_start (machine_t *machine)
+{
+    uint32_t line = machine->line;
+
+    if (line == ((machine->console == CONSOLE_SG) ? FRAME_IRQ_LINE_TMS : FRAME_IRQ_LINE_SMS))
+    {
+        machine->vdp_status |= 0x80;
+    }
+
+    /* The line counter counts down through the active display and the line after it,
+     * and is reloaded from register 10 for the rest of the frame. */
+    if (line <= ACTIVE_LINES)
+    {
+        if (machine->line_counter-- == 0)
+        {
+            machine->line_counter = machine->vdp_regs [10];
+            machine->line_irq = true;
+        }
+    }
+    else
+    {
+        machine->line_counter = machine->vdp_regs [10];
+    }
+
+    vdp_update_irq (machine);
+}
+
+
+/*
+ * Run for one frame, starting from the first line of the active display.
+ */
+void machine_run_frame (machine_t *machine)
+{
+    uint64_t frame_start = machine->frame * machine->frame_lines * MACHINE_LINE_CYCLES;
+
+    for (machine->line = 0; machine->line < machine->frame_lines; machine->line++)
+    {
+        machine->line_start = frame_start + machine->line * MACHINE_LINE_CYCLES;
+        vdp_line_start (machine);
+        z80_run (&machine->z80, machine->line_start + MACHINE_LINE_CYCLES);
+    }
+
+    machine->frame++;
+}
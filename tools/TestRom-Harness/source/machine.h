@@ -0,0 +1,85 @@
+/*
+ * TestRom-Harness
+ * Just enough of the SMS, Game Gear, and SG-1000 to run the test ROM.
+ *
+ * JoppyFurr 2024
+ */
+
+/* Timing */
+#define MACHINE_CLOCK_NTSC      3579545
+#define MACHINE_CLOCK_PAL       3546893
+#define MACHINE_LINE_CYCLES     228
+#define MACHINE_LINES_NTSC      262
+#define MACHINE_LINES_PAL       313
+
+/* Controller keys, matching SMSlib's PORT_A_KEY bits. */
+#define MACHINE_KEY_UP          0x0001
+#define MACHINE_KEY_DOWN        0x0002
+#define MACHINE_KEY_LEFT        0x0004
+#define MACHINE_KEY_RIGHT       0x0008
+#define MACHINE_KEY_1           0x0010
+#define MACHINE_KEY_2           0x0020
+#define MACHINE_KEY_PAUSE       0x0100  /* Start on the Game Gear */
+
+typedef enum console_e {
+    CONSOLE_SMS = 0,
+    CONSOLE_GG,
+    CONSOLE_SG
+} console_t;
+
+typedef struct machine_s {
+
+    z80_t z80;
+    console_t console;
+    bool pal;
+    uint32_t frame_lines;
+    uint64_t frame;
+
+    /* Memory */
+    uint8_t *rom;
+    uint32_t rom_banks;
+    uint8_t mapper [4];
+    uint8_t ram [0x2000];
+    uint32_t ram_mask;
+    uint8_t open_bus [Z80_PAGE_SIZE];
+
+    /* VDP */
+    uint8_t vdp_regs [16];
+    uint8_t vram [0x4000];
+    uint8_t cram [64];
+    uint16_t vdp_addr;
+    uint8_t vdp_code;
+    bool vdp_latch;
+    uint8_t vdp_latch_value;
+    uint8_t vdp_read_buffer;
+    uint8_t vdp_status;
+    bool line_irq;
+    uint8_t line_counter;
+    uint32_t line;
+    uint64_t line_start;
+
+    /* Controller */
+    uint16_t keys;
+
+    /* PSG capture */
+    psg_log_writer_t *log;
+    bool log_error;
+    uint64_t psg_writes;
+    uint64_t stereo_writes;
+
+} machine_t;
+
+/* Set up the machine to run a ROM image. The image is copied. Returns -1 on error. */
+int machine_init (machine_t *machine, console_t console, bool pal, const uint8_t *rom, uint32_t rom_size);
+
+/* Free the machine's copy of the ROM. */
+void machine_free (machine_t *machine);
+
+/* Fill in PSG log settings to match the machine. */
+void machine_log_info (const machine_t *machine, psg_log_info_t *info);
+
+/* Set the keys currently held on the controller. */
+void machine_set_keys (machine_t *machine, uint16_t keys);
+
+/* Run for one frame, starting from the first line of the active display. */
+void machine_run_frame (machine_t *machine);
@@ -0,0 +1,286 @@
+/*
+ * TestRom-Harness
+ * A tool to run the test ROM headless, and record its PSG writes.
+ *
+ * JoppyFurr 2024
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../../PSG-Log/source/psg_log.h"
+#include "z80.h"
+#include "machine.h"
+#include "input.h"
+#include "rom.h"
+#include "symbols.h"
+
+#define DEFAULT_FRAMES      600
+
+/* With a script, run on after the last key is released, to let the ROM settle. */
+#define SETTLE_FRAMES       300
+#define LOG_BUFFER_SIZE     65536
+
+static uint8_t log_buffer [LOG_BUFFER_SIZE];
+
+/* Element names, in the order of element_id_t in source/gui_elements.h */
+static const char *element_names [] = {
+    "CH0_VOLUME", "CH0_MODE_KEYBOARD", "CH0_MODE_CONSTANT", "CH0_FREQUENCY", "CH0_BUTTON",
+    "CH1_VOLUME", "CH1_MODE_KEYBOARD", "CH1_MODE_CONSTANT", "CH1_FREQUENCY", "CH1_BUTTON",
+    "CH2_VOLUME", "CH2_MODE_KEYBOARD", "CH2_MODE_CONSTANT", "CH2_FREQUENCY", "CH2_BUTTON",
+    "NOISE_VOLUME", "NOISE_MODE_KEYBOARD", "NOISE_MODE_CONSTANT", "NOISE_CONTROL", "NOISE_BUTTON",
+    "KEYBOARD"
+};
+
+static const char *element_names_gg [] = {
+    "CH0_VOLUME", "CH0_MODE_KEYBOARD", "CH0_MODE_CONSTANT", "CH0_FREQUENCY", "CH0_STEREO_LEFT", "CH0_STEREO_RIGHT", "CH0_BUTTON",
+    "CH1_VOLUME", "CH1_MODE_KEYBOARD", "CH1_MODE_CONSTANT", "CH1_FREQUENCY", "CH1_STEREO_LEFT", "CH1_STEREO_RIGHT", "CH1_BUTTON",
+    "CH2_VOLUME", "CH2_MODE_KEYBOARD", "CH2_MODE_CONSTANT", "CH2_FREQUENCY", "CH2_STEREO_LEFT", "CH2_STEREO_RIGHT", "CH2_BUTTON",
+    "NOISE_VOLUME", "NOISE_MODE_KEYBOARD", "NOISE_MODE_CONSTANT", "NOISE_CONTROL", "NOISE_STEREO_LEFT", "NOISE_STEREO_RIGHT", "NOISE_BUTTON",
+    "KEYBOARD"
+};
+
+
+/*
+ * Write the final values of the ROM's GUI elements, one per line.
+ */
+static int values_write (const machine_t *machine, uint16_t addr, const char *filename)
+{
+    const char **names = (machine->console == CONSOLE_GG) ? element_names_gg : element_names;
+    uint32_t count = (machine->console == CONSOLE_GG) ? sizeof (element_names_gg) / sizeof (element_names_gg [0])
+                                                      : sizeof (element_names) / sizeof (element_names [0]);
+
+    FILE *file = fopen (filename, "w");
+    if (file == NULL)
+    {
+        fprintf (stderr, "Failed to open values file '%s'.\n", filename);
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint16_t value = z80_peek (&machine->z80, addr + i * 2) | (z80_peek (&machine->z80, addr + i * 2 + 1) << 8);
+        fprintf (file, "%-20s %u\n", names [i], value);
+    }
+
+    if (fclose (file) != 0)
+    {
+        fprintf (stderr, "Failed to write values file '%s'.\n", filename);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+int main (int argc, char **argv)
+{
+    const char *input_script_filename = NULL;
+    const char *symbol_filename = NULL;
+    const char *values_filename = NULL;
+    uint16_t values_addr = 0;
+    const char *rom_filename = NULL;
+    const char *output_filename = NULL;
+    uint64_t frames = 0;
+    int region = -1;
+    console_t console;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp (argv [i], "--frames") == 0 && i + 1 < argc)
+        {
+            frames = strtoull (argv [++i], NULL, 10);
+        }
+        else if (strcmp (argv [i], "--input") == 0 && i + 1 < argc)
+        {
+            input_script_filename = argv [++i];
+        }
+        else if (strcmp (argv [i], "--symbols") == 0 && i + 1 < argc)
+        {
+            symbol_filename = argv [++i];
+        }
+        else if (strcmp (argv [i], "--values") == 0 && i + 1 < argc)
+        {
+            values_filename = argv [++i];
+        }
+        else if (strcmp (argv [i], "--pal") == 0)
+        {
+            region = 1;
+        }
+        else if (strcmp (argv [i], "--ntsc") == 0)
+        {
+            region = 0;
+        }
+        else if (rom_filename == NULL && argv [i][0] != '-')
+        {
+            rom_filename = argv [i];
+        }
+        else if (output_filename == NULL && argv [i][0] != '-')
+        {
+            output_filename = argv [i];
+        }
+        else
+        {
+            rom_filename = NULL;
+            break;
+        }
+    }
+
+    if (rom_filename == NULL || (values_filename != NULL && symbol_filename == NULL))
+    {
+        fprintf (stderr, "Usage: %s [--frames <n>] [--input <script>] [--pal|--ntsc]\n"
+                         "        [--symbols <file.noi> [--values <values-file>]] <rom-file> [output-file.psgl]\n", argv [0]);
+        return EXIT_FAILURE;
+    }
+
+    /* The console is chosen by the ROM's extension, and the region by its name */
+    if (rom_console (rom_filename, &console) == -1)
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (region == -1)
+    {
+        region = (strstr (rom_filename, "_PAL") != NULL) ? 1 : 0;
+    }
+    if (console == CONSOLE_GG && region == 1)
+    {
+        fprintf (stderr, "Error: The Game Gear is NTSC only.\n");
+        return EXIT_FAILURE;
+    }
+
+    if (output_filename != NULL && !has_extension (output_filename, ".psgl"))
+    {
+        fprintf (stderr, "Output file must have '.psgl' extension.\n");
+        return EXIT_FAILURE;
+    }
+
+    /* gui_state.element_values is the first member of gui_state. The count
+     * of dropped draw-queue runs is reported where the ROM has one. */
+    uint16_t overflows_addr = 0;
+    bool overflows_found = false;
+    if (symbol_filename != NULL)
+    {
+        symbol_table_t symbols = { 0 };
+        int result = symbols_load (&symbols, symbol_filename);
+
+        if (result == 0 && values_filename != NULL &&
+            (result = symbols_find (&symbols, "gui_state", &values_addr)) == -1)
+        {
+            fprintf (stderr, "Error: Symbol '_gui_state' not found in '%s'.\n", symbol_filename);
+        }
+        if (result == 0)
+        {
+            overflows_found = (symbols_find (&symbols, "draw_queue_overflows", &overflows_addr) == 0);
+        }
+
+        symbols_free (&symbols);
+        if (result == -1)
+        {
+            return EXIT_FAILURE;
+        }
+    }
+
+    uint8_t *rom = NULL;
+    uint32_t rom_size = rom_load (rom_filename, &rom);
+    if (rom_size == 0)
+    {
+        free (rom);
+        return EXIT_FAILURE;
+    }
+
+    static machine_t machine;
+    if (machine_init (&machine, console, region == 1, rom, rom_size) == -1)
+    {
+        fprintf (stderr, "Error: Failed to set up machine for ROM file '%s'.\n", rom_filename);
+        free (rom);
+        return EXIT_FAILURE;
+    }
+    free (rom);
+
+    input_script_t script = { 0 };
+    if (input_script_filename != NULL && input_script_load (&script, input_script_filename) == -1)
+    {
+        machine_free (&machine);
+        return EXIT_FAILURE;
+    }
+
+    if (frames == 0)
+    {
+        frames = (script.count > 0) ? input_script_end (&script) + SETTLE_FRAMES : DEFAULT_FRAMES;
+    }
+
+    FILE *output_file = NULL;
+    psg_log_writer_t writer;
+    if (output_filename != NULL)
+    {
+        psg_log_info_t info;
+
+        output_file = fopen (output_filename, "wb");
+        if (output_file == NULL)
+        {
+            fprintf (stderr, "Failed to open output file '%s'.\n", output_filename);
+            input_script_free (&script);
+            machine_free (&machine);
+            return EXIT_FAILURE;
+        }
+
+        machine_log_info (&machine, &info);
+        psg_log_writer_init (&writer, &info, log_buffer, LOG_BUFFER_SIZE, output_file);
+        machine.log = &writer;
+    }
+
+    struct timespec start;
+    struct timespec end;
+    clock_gettime (CLOCK_MONOTONIC, &start);
+
+    for (uint64_t frame = 0; frame < frames; frame++)
+    {
+        machine_set_keys (&machine, input_script_keys (&script, frame));
+        machine_run_frame (&machine);
+    }
+
+    clock_gettime (CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    int result = EXIT_SUCCESS;
+    if (output_file != NULL)
+    {
+        if (psg_log_writer_end (&writer, machine.z80.cycles) == -1 || machine.log_error || fclose (output_file) != 0)
+        {
+            fprintf (stderr, "Failed to write output file '%s'.\n", output_filename);
+            result = EXIT_FAILURE;
+        }
+    }
+
+    if (values_filename != NULL && values_write (&machine, values_addr, values_filename) == -1)
+    {
+        result = EXIT_FAILURE;
+    }
+
+    printf ("%llu frames, %llu cycles, %llu PSG writes, %llu stereo writes\n",
+            (unsigned long long) frames, (unsigned long long) machine.z80.cycles,
+            (unsigned long long) machine.psg_writes, (unsigned long long) machine.stereo_writes);
+    printf ("Ran in %.3f s, %.0f frames per second\n", seconds, (seconds > 0) ? frames / seconds : 0.0);
+
+    if (overflows_found)
+    {
+        uint16_t overflows = z80_peek (&machine.z80, overflows_addr) | (z80_peek (&machine.z80, overflows_addr + 1) << 8);
+        if (overflows != 0)
+        {
+            printf ("Warning: %u draw-queue runs were dropped, as the queue was full.\n", overflows);
+        }
+    }
+
+    input_script_free (&script);
+    machine_free (&machine);
+
+    return result;
+}
@@ -0,0 +1,97 @@
+/*
+ * TestRom-Harness
+ * Loading the test ROM.
+ *
+ * JoppyFurr 2024
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../PSG-Log/source/psg_log.h"
+#include "z80.h"
+#include "machine.h"
+#include "rom.h"
+
+#define ROM_SIZE_MAX        0x100000
+
+
+/*
+ * Check if a filename ends with the given extension.
+ */
+bool has_extension (const char *filename, const char *extension)
+{
+    size_t filename_length = strlen (filename);
+    size_t extension_length = strlen (extension);
+
+    return filename_length > extension_length &&
+           strcmp (&filename [filename_length - extension_length], extension) == 0;
+}
+
+
+/*
+ * Read a whole ROM file into memory.
+ * Returns the size, or 0 on error.
+ */
+uint32_t rom_load (const char *filename, uint8_t **rom)
+{
+    FILE *file = fopen (filename, "rb");
+    if (file == NULL)
+    {
+        fprintf (stderr, "Failed to open ROM file '%s'.\n", filename);
+        return 0;
+    }
+
+    *rom = malloc (ROM_SIZE_MAX);
+    if (*rom == NULL)
+    {
+        fprintf (stderr, "Failed to allocate memory for ROM file '%s'.\n", filename);
+        fclose (file);
+        return 0;
+    }
+
+    uint32_t size = fread (*rom, 1, ROM_SIZE_MAX, file);
+    if (size == ROM_SIZE_MAX && fgetc (file) != EOF)
+    {
+        fprintf (stderr, "Error: ROM file '%s' is too large.\n", filename);
+        size = 0;
+    }
+    else if (size == 0)
+    {
+        fprintf (stderr, "Error: ROM file '%s' is empty.\n", filename);
+    }
+
+    fclose (file);
+    return size;
+}
+
+
+/*
+ * Choose the console by the ROM's extension.
+ * Returns -1 if the extension is not known.
+ */
+int rom_console (const char *filename, console_t *console)
+{
+    if (has_extension (filename, ".sms"))
+    {
+        *console = CONSOLE_SMS;
+    }
+    else if (has_extension (filename, ".gg"))
+    {
+        *console = CONSOLE_GG;
+    }
+    else if (has_extension (filename, ".sg"))
+    {
+        *console = CONSOLE_SG;
+    }
+    else
+    {
+        fprintf (stderr, "ROM file must have '.sms', '.gg', or '.sg' extension.\n");
+        return -1;
+    }
+
+    return 0;
+}
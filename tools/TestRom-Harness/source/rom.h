@@ -0,0 +1,15 @@
+/*
+ * TestRom-Harness
+ * Loading the test ROM.
+ *
+ * JoppyFurr 2024
+ */
+
+/* Check if a filename ends with the given extension. */
+bool has_extension (const char *filename, const char *extension);
+
+/* Read a whole ROM file into memory. Returns the size, or 0 on error. */
+uint32_t rom_load (const char *filename, uint8_t **rom);
+
+/* Choose the console by the ROM's extension. Returns -1 if the extension is not known. */
+int rom_console (const char *filename, console_t *console);
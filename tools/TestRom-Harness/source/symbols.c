@@ -0,0 +1,220 @@
+/*
+ * TestRom-Harness
+ * Symbol addresses from the files written by the sdcc linker.
+ *
+ * JoppyFurr 2024
+ *
+ * Three formats are read:
+ *   .noi  "DEF _symbol 0xADDR", global symbols only.
+ *   .map  "ADDR _symbol module", global symbols only.
+ *   .cdb  "L:G$symbol$0_0$0:ADDR" for globals, and "L:Fmodule$symbol$0_0$0:ADDR"
+ *         for static functions and variables, when built with --debug.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "symbols.h"
+
+
+/*
+ * Parse a hexadecimal address. Returns false if the text is not an address.
+ */
+static bool parse_addr (const char *text, uint16_t *addr)
+{
+    char *end;
+
+    if (text == NULL || text [0] == '\0')
+    {
+        return false;
+    }
+
+    unsigned long value = strtoul (text, &end, 16);
+    if (*end != '\0' || value > 0xffff)
+    {
+        return false;
+    }
+
+    *addr = value;
+    return true;
+}
+
+
+/*
+ * Add a symbol to the table, removing the leading underscore added by sdcc.
+ */
+static int symbols_add (symbol_table_t *table, const char *name, size_t length, uint16_t addr)
+{
+    if (length > 0 && name [0] == '_')
+    {
+        name++;
+        length--;
+    }
+
+    if (table->count == table->capacity)
+    {
+        uint32_t capacity = (table->capacity == 0) ? 256 : table->capacity * 2;
+        symbol_t *symbols = realloc (table->symbols, capacity * sizeof (symbol_t));
+        if (symbols == NULL)
+        {
+            return -1;
+        }
+        table->symbols = symbols;
+        table->capacity = capacity;
+    }
+
+    char *copy = malloc (length + 1);
+    if (copy == NULL)
+    {
+        return -1;
+    }
+    memcpy (copy, name, length);
+    copy [length] = '\0';
+
+    table->symbols [table->count].name = copy;
+    table->symbols [table->count].addr = addr;
+    table->count++;
+
+    return 0;
+}
+
+
+/*
+ * Parse a line of a .cdb file. Only linker records for global and file-scope symbols are used.
+ */
+static int symbols_parse_cdb (symbol_table_t *table, char *line)
+{
+    uint16_t addr;
+
+    if (strncmp (line, "L:G$", 4) != 0 && strncmp (line, "L:F", 3) != 0)
+    {
+        return 0;
+    }
+
+    char *name = strchr (line, '$');
+    char *name_end = (name != NULL) ? strchr (name + 1, '$') : NULL;
+    char *colon = strrchr (line, ':');
+
+    if (name_end == NULL || colon == NULL || !parse_addr (colon + 1, &addr))
+    {
+        return 0;
+    }
+
+    return symbols_add (table, name + 1, name_end - name - 1, addr);
+}
+
+
+/*
+ * Parse a line of a .noi or .map file.
+ */
+static int symbols_parse_noi_map (symbol_table_t *table, char *line)
+{
+    char *save = NULL;
+    char *tokens [3];
+    uint16_t addr;
+
+    tokens [0] = strtok_r (line, " \t", &save);
+    tokens [1] = strtok_r (NULL, " \t", &save);
+    tokens [2] = strtok_r (NULL, " \t", &save);
+
+    if (tokens [0] == NULL || tokens [1] == NULL || tokens [1][0] != '_')
+    {
+        return 0;
+    }
+
+    if (strcmp (tokens [0], "DEF") == 0)
+    {
+        if (!parse_addr (tokens [2], &addr))
+        {
+            return 0;
+        }
+    }
+    else if (!parse_addr (tokens [0], &addr))
+    {
+        return 0;
+    }
+
+    return symbols_add (table, tokens [1], strlen (tokens [1]), addr);
+}
+
+
+/*
+ * Add the symbols from a .noi, .map, or .cdb file to the table.
+ * Returns -1 on error.
+ */
+int symbols_load (symbol_table_t *table, const char *filename)
+{
+    char line [512];
+    int result = 0;
+
+    FILE *file = fopen (filename, "r");
+    if (file == NULL)
+    {
+        fprintf (stderr, "Failed to open symbol file '%s'.\n", filename);
+        return -1;
+    }
+
+    while (result == 0 && fgets (line, sizeof (line), file) != NULL)
+    {
+        line [strcspn (line, "\r\n")] = '\0';
+
+        if (line [0] == 'L' && line [1] == ':')
+        {
+            result = symbols_parse_cdb (table, line);
+        }
+        else
+        {
+            result = symbols_parse_noi_map (table, line);
+        }
+    }
+
+    fclose (file);
+
+    if (result == -1)
+    {
+        fprintf (stderr, "Error: Failed to allocate memory for symbols.\n");
+    }
+
+    return result;
+}
+
+
+/*
+ * Find a symbol by its C name, without the leading underscore.
+ * Returns -1 if not found.
+ */
+int symbols_find (const symbol_table_t *table, const char *name, uint16_t *addr)
+{
+    for (uint32_t i = 0; i < table->count; i++)
+    {
+        if (strcmp (table->symbols [i].name, name) == 0)
+        {
+            *addr = table->symbols [i].addr;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+
+/*
+ * Free the table's symbols.
+ */
+void symbols_free (symbol_table_t *table)
+{
+    for (uint32_t i = 0; i < table->count; i++)
+    {
+        free (table->symbols [i].name);
+    }
+    free (table->symbols);
+
+    table->symbols = NULL;
+    table->count = 0;
+    table->capacity = 0;
+}
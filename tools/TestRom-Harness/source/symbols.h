@@ -0,0 +1,26 @@
+/*
+ * TestRom-Harness
+ * Symbol addresses from the files written by the sdcc linker.
+ *
+ * JoppyFurr 2024
+ */
+
+typedef struct symbol_s {
+    char *name;
+    uint16_t addr;
+} symbol_t;
+
+typedef struct symbol_table_s {
+    symbol_t *symbols;
+    uint32_t count;
+    uint32_t capacity;
+} symbol_table_t;
+
+/* Add the symbols from a .noi, .map, or .cdb file to the table. Returns -1 on error. */
+int symbols_load (symbol_table_t *table, const char *filename);
+
+/* Find a symbol by its C name, without the leading underscore. Returns -1 if not found. */
+int symbols_find (const symbol_table_t *table, const char *name, uint16_t *addr);
+
+/* Free the table's symbols. */
+void symbols_free (symbol_table_t *table);
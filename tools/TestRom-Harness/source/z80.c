@@ -0,0 +1,1301 @@
+/*
+ * TestRom-Harness
+ * A Z80 core for running the test ROM on the host.
+ *
+ * JoppyFurr 2024
+ *
+ * All documented instructions are implemented with their exact T-state
+ * counts, along with the undocumented IXH / IXL / IYH / IYL forms and SLL.
+ * The undocumented X / Y flags follow the result of most instructions, but
+ * are not exact for BIT n,(HL) or the block instructions.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "z80.h"
+
+/* Flag lookup tables, filled in on the first reset. */
+static uint8_t sz53_table [256];
+static uint8_t sz53p_table [256];
+static bool tables_ready = false;
+
+/* Flag tested by each condition code, pairs of not-set / set. */
+static const uint8_t condition_flag [4] = { Z80_FLAG_Z, Z80_FLAG_C, Z80_FLAG_PV, Z80_FLAG_S };
+
+/* Interrupt mode for each encoding of the IM instruction. */
+static const uint8_t im_mode [4] = { 0, 0, 1, 2 };
+
+
+/*
+ * Fill in the flag lookup tables.
+ */
+static void z80_tables_init (void)
+{
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint8_t parity = 0;
+        for (uint32_t bit = 0; bit < 8; bit++)
+        {
+            parity ^= (i >> bit) & 1;
+        }
+
+        sz53_table [i] = (i & (Z80_FLAG_S | Z80_FLAG_Y | Z80_FLAG_X)) | ((i == 0) ? Z80_FLAG_Z : 0);
+        sz53p_table [i] = sz53_table [i] | (parity ? 0 : Z80_FLAG_PV);
+    }
+
+    tables_ready = true;
+}
+
+
+/*
+ * Read a byte from memory.
+ */
+static inline uint8_t read8 (const z80_t *z80, uint16_t addr)
+{
+    return z80->read_map [addr >> Z80_PAGE_SHIFT] [addr & (Z80_PAGE_SIZE - 1)];
+}
+
+
+/*
+ * Write a byte to memory.
+ */
+static inline void write8 (z80_t *z80, uint16_t addr, uint8_t value)
+{
+    uint8_t *page = z80->write_map [addr >> Z80_PAGE_SHIFT];
+
+    if (page != NULL)
+    {
+        page [addr & (Z80_PAGE_SIZE - 1)] = value;
+    }
+    else
+    {
+        z80->memory_write (z80->context, addr, value);
+    }
+}
+
+
+/*
+ * Read a 16-bit value from memory.
+ */
+static inline uint16_t read16 (const z80_t *z80, uint16_t addr)
+{
+    return read8 (z80, addr) | (read8 (z80, addr + 1) << 8);
+}
+
+
+/*
+ * Write a 16-bit value to memory.
+ */
+static inline void write16 (z80_t *z80, uint16_t addr, uint16_t value)
+{
+    write8 (z80, addr, value);
+    write8 (z80, addr + 1, value >> 8);
+}
+
+
+/*
+ * Read the byte at the program counter.
+ */
+static inline uint8_t fetch8 (z80_t *z80)
+{
+    return read8 (z80, z80->pc++);
+}
+
+
+/*
+ * Read the 16-bit value at the program counter.
+ */
+static inline uint16_t fetch16 (z80_t *z80)
+{
+    uint16_t value = read16 (z80, z80->pc);
+    z80->pc += 2;
+    return value;
+}
+
+
+/*
+ * Push a 16-bit value onto the stack.
+ */
+static inline void push16 (z80_t *z80, uint16_t value)
+{
+    z80->sp -= 2;
+    write16 (z80, z80->sp, value);
+}
+
+
+/*
+ * Pop a 16-bit value from the stack.
+ */
+static inline uint16_t pop16 (z80_t *z80)
+{
+    uint16_t value = read16 (z80, z80->sp);
+    z80->sp += 2;
+    return value;
+}
+
+
+/*
+ * Increment the lower seven bits of the refresh register, once per opcode fetch.
+ */
+static inline void refresh (z80_t *z80)
+{
+    z80->r = (z80->r & 0x80) | ((z80->r + 1) & 0x7f);
+}
+
+
+/*
+ * Check a condition code.
+ */
+static inline bool condition (const z80_t *z80, uint8_t code)
+{
+    return ((z80->af.l & condition_flag [code >> 1]) != 0) == (code & 1);
+}
+
+
+/*
+ * Get a pointer to an 8-bit register, by its index in the instruction encoding.
+ * Index 6, (HL), has no register and returns NULL.
+ */
+static inline uint8_t *reg8 (z80_t *z80, uint8_t index)
+{
+    switch (index)
+    {
+        case 0: return &z80->bc.h;
+        case 1: return &z80->bc.l;
+        case 2: return &z80->de.h;
+        case 3: return &z80->de.l;
+        case 4: return &z80->hl.h;
+        case 5: return &z80->hl.l;
+        case 7: return &z80->af.h;
+        default: return NULL;
+    }
+}
+
+
+/*
+ * Get a pointer to an 8-bit register, with H and L replaced by the halves of an index register.
+ */
+static inline uint8_t *index_reg8 (z80_t *z80, z80_pair_t *index, uint8_t reg)
+{
+    if (reg == 4)
+    {
+        return &index->h;
+    }
+    else if (reg == 5)
+    {
+        return &index->l;
+    }
+    return reg8 (z80, reg);
+}
+
+
+/*
+ * Get a pointer to a 16-bit register pair, by its index in the instruction encoding.
+ * Index 3 is SP. Index 2 is HL, or the index register when prefixed.
+ */
+static inline uint16_t *reg16 (z80_t *z80, z80_pair_t *hl, uint8_t index)
+{
+    switch (index)
+    {
+        case 0: return &z80->bc.w;
+        case 1: return &z80->de.w;
+        case 2: return &hl->w;
+        default: return &z80->sp;
+    }
+}
+
+
+/*
+ * 8-bit arithmetic and logic, selected by the instruction encoding.
+ *   0: ADD, 1: ADC, 2: SUB, 3: SBC, 4: AND, 5: XOR, 6: OR, 7: CP
+ */
+static inline void alu8 (z80_t *z80, uint8_t op, uint8_t value)
+{
+    uint8_t a = z80->af.h;
+    uint16_t result;
+
+    switch (op)
+    {
+        case 0: /* ADD */
+        case 1: /* ADC */
+            result = a + value + ((op == 1) ? (z80->af.l & Z80_FLAG_C) : 0);
+            z80->af.h = result;
+            z80->af.l = sz53_table [result & 0xff] | ((a ^ value ^ result) & Z80_FLAG_H) |
+                        (((a ^ ~value) & (a ^ result) & 0x80) >> 5) | (result >> 8);
+            break;
+
+        case 2: /* SUB */
+        case 3: /* SBC */
+        case 7: /* CP */
+            result = a - value - ((op == 3) ? (z80->af.l & Z80_FLAG_C) : 0);
+            z80->af.l = sz53_table [result & 0xff] | ((a ^ value ^ result) & Z80_FLAG_H) |
+                        (((a ^ value) & (a ^ result) & 0x80) >> 5) | Z80_FLAG_N | ((result >> 8) & Z80_FLAG_C);
+            if (op == 7)
+            {
+                /* CP takes X and Y from the operand */
+                z80->af.l = (z80->af.l & ~(Z80_FLAG_X | Z80_FLAG_Y)) | (value & (Z80_FLAG_X | Z80_FLAG_Y));
+            }
+            else
+            {
+                z80->af.h = result;
+            }
+            break;
+
+        case 4: /* AND */
+            z80->af.h = a & value;
+            z80->af.l = sz53p_table [z80->af.h] | Z80_FLAG_H;
+            break;
+
+        case 5: /* XOR */
+            z80->af.h = a ^ value;
+            z80->af.l = sz53p_table [z80->af.h];
+            break;
+
+        default: /* OR */
+            z80->af.h = a | value;
+            z80->af.l = sz53p_table [z80->af.h];
+            break;
+    }
+}
+
+
+/*
+ * 8-bit increment.
+ */
+static inline uint8_t inc8 (z80_t *z80, uint8_t value)
+{
+    value++;
+    z80->af.l = (z80->af.l & Z80_FLAG_C) | sz53_table [value] |
+                (((value & 0x0f) == 0x00) ? Z80_FLAG_H : 0) | ((value == 0x80) ? Z80_FLAG_PV : 0);
+    return value;
+}
+
+
+/*
+ * 8-bit decrement.
+ */
+static inline uint8_t dec8 (z80_t *z80, uint8_t value)
+{
+    value--;
+    z80->af.l = (z80->af.l & Z80_FLAG_C) | Z80_FLAG_N | sz53_table [value] |
+                (((value & 0x0f) == 0x0f) ? Z80_FLAG_H : 0) | ((value == 0x7f) ? Z80_FLAG_PV : 0);
+    return value;
+}
+
+
+/*
+ * 16-bit addition, for ADD HL / IX / IY.
+ */
+static inline uint16_t add16 (z80_t *z80, uint16_t a, uint16_t b)
+{
+    uint32_t result = a + b;
+    z80->af.l = (z80->af.l & (Z80_FLAG_S | Z80_FLAG_Z | Z80_FLAG_PV)) | (((a ^ b ^ result) >> 8) & Z80_FLAG_H) |
+                ((result >> 8) & (Z80_FLAG_X | Z80_FLAG_Y)) | (result >> 16);
+    return result;
+}
+
+
+/*
+ * 16-bit add or subtract with carry, for ADC HL / SBC HL.
+ */
+static inline void adc16 (z80_t *z80, uint16_t value, bool subtract)
+{
+    uint16_t hl = z80->hl.w;
+    uint32_t carry = z80->af.l & Z80_FLAG_C;
+    uint32_t result;
+    uint8_t overflow;
+
+    if (subtract)
+    {
+        result = (uint32_t) hl - value - carry;
+        overflow = ((hl ^ value) & (hl ^ result) & 0x8000) >> 13;
+    }
+    else
+    {
+        result = (uint32_t) hl + value + carry;
+        overflow = ((hl ^ ~value) & (hl ^ result) & 0x8000) >> 13;
+    }
+
+    z80->hl.w = result;
+    z80->af.l = ((result >> 8) & (Z80_FLAG_S | Z80_FLAG_X | Z80_FLAG_Y)) | ((result & 0xffff) ? 0 : Z80_FLAG_Z) |
+                (((hl ^ value ^ result) >> 8) & Z80_FLAG_H) | overflow | (subtract ? Z80_FLAG_N : 0) |
+                ((result >> 16) & Z80_FLAG_C);
+}
+
+
+/*
+ * Rotates and shifts from the CB page, selected by the instruction encoding.
+ *   0: RLC, 1: RRC, 2: RL, 3: RR, 4: SLA, 5: SRA, 6: SLL, 7: SRL
+ */
+static inline uint8_t rotate (z80_t *z80, uint8_t op, uint8_t value)
+{
+    uint8_t carry_in = z80->af.l & Z80_FLAG_C;
+    uint8_t carry;
+    uint8_t result;
+
+    switch (op)
+    {
+        case 0:  result = (value << 1) | (value >> 7);     carry = value >> 7;  break;
+        case 1:  result = (value >> 1) | (value << 7);     carry = value & 1;   break;
+        case 2:  result = (value << 1) | carry_in;         carry = value >> 7;  break;
+        case 3:  result = (value >> 1) | (carry_in << 7);  carry = value & 1;   break;
+        case 4:  result = value << 1;                      carry = value >> 7;  break;
+        case 5:  result = (value >> 1) | (value & 0x80);   carry = value & 1;   break;
+        case 6:  result = (value << 1) | 1;                carry = value >> 7;  break;
+        default: result = value >> 1;                      carry = value & 1;   break;
+    }
+
+    z80->af.l = sz53p_table [result] | carry;
+    return result;
+}
+
+
+/*
+ * Test a bit, for BIT n.
+ * X and Y are taken from the given value, which differs for the memory forms.
+ */
+static inline void bit (z80_t *z80, uint8_t bit, uint8_t value, uint8_t xy)
+{
+    uint8_t flags = (z80->af.l & Z80_FLAG_C) | Z80_FLAG_H | (xy & (Z80_FLAG_X | Z80_FLAG_Y));
+
+    if (value & (1 << bit))
+    {
+        flags |= (bit == 7) ? Z80_FLAG_S : 0;
+    }
+    else
+    {
+        flags |= Z80_FLAG_Z | Z80_FLAG_PV;
+    }
+
+    z80->af.l = flags;
+}
+
+
+/*
+ * Decimal adjust the accumulator.
+ */
+static void daa (z80_t *z80)
+{
+    uint8_t a = z80->af.h;
+    uint8_t flags = z80->af.l;
+    uint8_t correction = 0;
+    uint8_t carry = flags & Z80_FLAG_C;
+    bool half;
+
+    if ((flags & Z80_FLAG_H) || (a & 0x0f) > 9)
+    {
+        correction |= 0x06;
+    }
+    if (carry || a > 0x99)
+    {
+        correction |= 0x60;
+        carry = Z80_FLAG_C;
+    }
+
+    if (flags & Z80_FLAG_N)
+    {
+        half = (flags & Z80_FLAG_H) && (a & 0x0f) < 6;
+        z80->af.h = a - correction;
+    }
+    else
+    {
+        half = (a & 0x0f) > 9;
+        z80->af.h = a + correction;
+    }
+
+    z80->af.l = sz53p_table [z80->af.h] | (flags & Z80_FLAG_N) | carry | (half ? Z80_FLAG_H : 0);
+}
+
+
+/*
+ * Run an instruction from the CB page, operating on registers or (HL).
+ */
+static uint32_t z80_execute_cb (z80_t *z80)
+{
+    uint8_t op = fetch8 (z80);
+    uint8_t x = op >> 6;
+    uint8_t y = (op >> 3) & 7;
+    uint8_t *reg = reg8 (z80, op & 7);
+    uint8_t value = (reg != NULL) ? *reg : read8 (z80, z80->hl.w);
+    uint8_t result;
+
+    refresh (z80);
+
+    switch (x)
+    {
+        case 0: result = rotate (z80, y, value); break;
+        case 1: bit (z80, y, value, value); return (reg != NULL) ? 8 : 12;
+        case 2: result = value & ~(1 << y); break;
+        default: result = value | (1 << y); break;
+    }
+
+    if (reg != NULL)
+    {
+        *reg = result;
+        return 8;
+    }
+
+    write8 (z80, z80->hl.w, result);
+    return 15;
+}
+
+
+/*
+ * Run an indexed instruction from the CB page, operating on (IX+d) or (IY+d).
+ * The undocumented forms also copy the result into a register.
+ */
+static uint32_t z80_execute_index_cb (z80_t *z80, uint16_t index)
+{
+    uint16_t addr = index + (int8_t) fetch8 (z80);
+    uint8_t op = fetch8 (z80);
+    uint8_t x = op >> 6;
+    uint8_t y = (op >> 3) & 7;
+    uint8_t value = read8 (z80, addr);
+    uint8_t result;
+
+    switch (x)
+    {
+        case 0: result = rotate (z80, y, value); break;
+        case 1: bit (z80, y, value, addr >> 8); return 20;
+        case 2: result = value & ~(1 << y); break;
+        default: result = value | (1 << y); break;
+    }
+
+    write8 (z80, addr, result);
+
+    uint8_t *reg = reg8 (z80, op & 7);
+    if (reg != NULL)
+    {
+        *reg = result;
+    }
+
+    return 23;
+}
+
+
+/*
+ * Run a block transfer, compare, or I/O instruction from the ED page.
+ *   y = 4: increment, 5: decrement, 6: increment and repeat, 7: decrement and repeat
+ *   z = 0: LD, 1: CP, 2: IN, 3: OUT
+ */
+static uint32_t z80_execute_block (z80_t *z80, uint8_t y, uint8_t z)
+{
+    int16_t step = (y & 1) ? -1 : 1;
+    bool repeat = (y >= 6);
+    uint8_t value;
+
+    switch (z)
+    {
+        case 0: /* LDI, LDD, LDIR, LDDR */
+        {
+            value = read8 (z80, z80->hl.w);
+            write8 (z80, z80->de.w, value);
+            z80->hl.w += step;
+            z80->de.w += step;
+            z80->bc.w--;
+
+            uint8_t n = value + z80->af.h;
+            z80->af.l = (z80->af.l & (Z80_FLAG_S | Z80_FLAG_Z | Z80_FLAG_C)) | (z80->bc.w ? Z80_FLAG_PV : 0) |
+                        (n & Z80_FLAG_X) | ((n << 4) & Z80_FLAG_Y);
+            repeat = repeat && z80->bc.w != 0;
+            break;
+        }
+
+        case 1: /* CPI, CPD, CPIR, CPDR */
+        {
+            value = read8 (z80, z80->hl.w);
+            uint8_t result = z80->af.h - value;
+            uint8_t half = (z80->af.h ^ value ^ result) & Z80_FLAG_H;
+            z80->hl.w += step;
+            z80->bc.w--;
+
+            uint8_t n = result - (half ? 1 : 0);
+            z80->af.l = (z80->af.l & Z80_FLAG_C) | Z80_FLAG_N | (sz53_table [result] & ~(Z80_FLAG_X | Z80_FLAG_Y)) |
+                        half | (z80->bc.w ? Z80_FLAG_PV : 0) | (n & Z80_FLAG_X) | ((n << 4) & Z80_FLAG_Y);
+            repeat = repeat && z80->bc.w != 0 && result != 0;
+            break;
+        }
+
+        case 2: /* INI, IND, INIR, INDR */
+            value = z80->port_read (z80->context, z80->bc.w);
+            write8 (z80, z80->hl.w, value);
+            z80->hl.w += step;
+            z80->bc.h--;
+            z80->af.l = (z80->af.l & Z80_FLAG_C) | sz53_table [z80->bc.h] | Z80_FLAG_N;
+            repeat = repeat && z80->bc.h != 0;
+            break;
+
+        default: /* OUTI, OUTD, OTIR, OTDR */
+            value = read8 (z80, z80->hl.w);
+            z80->bc.h--;
+            z80->port_write (z80->context, z80->bc.w, value);
+            z80->hl.w += step;
+            z80->af.l = (z80->af.l & Z80_FLAG_C) | sz53_table [z80->bc.h] | Z80_FLAG_N;
+            repeat = repeat && z80->bc.h != 0;
+            break;
+    }
+
+    if (repeat)
+    {
+        z80->pc -= 2;
+        return 21;
+    }
+
+    return 16;
+}
+
+
+/*
+ * Run an instruction from the ED page.
+ */
+static uint32_t z80_execute_ed (z80_t *z80)
+{
+    uint8_t op = fetch8 (z80);
+    uint8_t x = op >> 6;
+    uint8_t y = (op >> 3) & 7;
+    uint8_t z = op & 7;
+
+    refresh (z80);
+
+    if (x == 2 && y >= 4 && z <= 3)
+    {
+        return z80_execute_block (z80, y, z);
+    }
+    else if (x != 1)
+    {
+        /* Invalid instructions act as two NOPs */
+        return 8;
+    }
+
+    switch (z)
+    {
+        case 0: /* IN r,(C) */
+        {
+            uint8_t value = z80->port_read (z80->context, z80->bc.w);
+            uint8_t *reg = reg8 (z80, y);
+            if (reg != NULL)
+            {
+                *reg = value;
+            }
+            z80->af.l = (z80->af.l & Z80_FLAG_C) | sz53p_table [value];
+            return 12;
+        }
+
+        case 1: /* OUT (C),r */
+        {
+            uint8_t *reg = reg8 (z80, y);
+            z80->port_write (z80->context, z80->bc.w, (reg != NULL) ? *reg : 0);
+            return 12;
+        }
+
+        case 2: /* SBC HL,rr / ADC HL,rr */
+            adc16 (z80, *reg16 (z80, &z80->hl, y >> 1), (y & 1) == 0);
+            return 15;
+
+        case 3: /* LD (nn),rr / LD rr,(nn) */
+        {
+            uint16_t addr = fetch16 (z80);
+            uint16_t *reg = reg16 (z80, &z80->hl, y >> 1);
+            if (y & 1)
+            {
+                *reg = read16 (z80, addr);
+            }
+            else
+            {
+                write16 (z80, addr, *reg);
+            }
+            return 20;
+        }
+
+        case 4: /* NEG */
+        {
+            uint8_t value = z80->af.h;
+            z80->af.h = 0;
+            alu8 (z80, 2, value);
+            return 8;
+        }
+
+        case 5: /* RETN / RETI */
+            z80->iff1 = z80->iff2;
+            z80->pc = pop16 (z80);
+            return 14;
+
+        case 6: /* IM */
+            z80->im = im_mode [y & 3];
+            return 8;
+
+        default:
+            switch (y)
+            {
+                case 0: /* LD I,A */
+                    z80->i = z80->af.h;
+                    return 9;
+
+                case 1: /* LD R,A */
+                    z80->r = z80->af.h;
+                    return 9;
+
+                case 2: /* LD A,I */
+                case 3: /* LD A,R */
+                    z80->af.h = (y == 2) ? z80->i : z80->r;
+                    z80->af.l = (z80->af.l & Z80_FLAG_C) | sz53_table [z80->af.h] | (z80->iff2 ? Z80_FLAG_PV : 0);
+                    return 9;
+
+                case 4: /* RRD */
+                case 5: /* RLD */
+                {
+                    uint8_t value = read8 (z80, z80->hl.w);
+                    uint8_t a = z80->af.h;
+                    if (y == 4)
+                    {
+                        write8 (z80, z80->hl.w, (a << 4) | (value >> 4));
+                        z80->af.h = (a & 0xf0) | (value & 0x0f);
+                    }
+                    else
+                    {
+                        write8 (z80, z80->hl.w, (value << 4) | (a & 0x0f));
+                        z80->af.h = (a & 0xf0) | (value >> 4);
+                    }
+                    z80->af.l = (z80->af.l & Z80_FLAG_C) | sz53p_table [z80->af.h];
+                    return 18;
+                }
+
+                default:
+                    return 8;
+            }
+    }
+}
+
+
+static uint32_t z80_execute (z80_t *z80, uint8_t op);
+
+
+/*
+ * Run an instruction with a DD or FD prefix, using IX or IY in place of HL.
+ * Instructions that do not use HL run as normal, with four extra T-states for the prefix.
+ */
+static uint32_t z80_execute_index (z80_t *z80, z80_pair_t *index)
+{
+    uint8_t op = fetch8 (z80);
+    refresh (z80);
+
+    /* LD r,r' */
+    if (op >= 0x40 && op < 0x80 && op != 0x76)
+    {
+        uint8_t dst = (op >> 3) & 7;
+        uint8_t src = op & 7;
+
+        if (src == 6)
+        {
+            *reg8 (z80, dst) = read8 (z80, index->w + (int8_t) fetch8 (z80));
+            return 19;
+        }
+        else if (dst == 6)
+        {
+            write8 (z80, index->w + (int8_t) fetch8 (z80), *reg8 (z80, src));
+            return 19;
+        }
+
+        *index_reg8 (z80, index, dst) = *index_reg8 (z80, index, src);
+        return 8;
+    }
+
+    /* 8-bit arithmetic and logic */
+    if (op >= 0x80 && op < 0xc0)
+    {
+        uint8_t src = op & 7;
+
+        if (src == 6)
+        {
+            alu8 (z80, (op >> 3) & 7, read8 (z80, index->w + (int8_t) fetch8 (z80)));
+            return 19;
+        }
+
+        alu8 (z80, (op >> 3) & 7, *index_reg8 (z80, index, src));
+        return 8;
+    }
+
+    switch (op)
+    {
+        case 0x09: case 0x19: case 0x29: case 0x39: /* ADD IX,rr */
+            index->w = add16 (z80, index->w, *reg16 (z80, index, op >> 4));
+            return 15;
+
+        case 0x21: /* LD IX,nn */
+            index->w = fetch16 (z80);
+            return 14;
+
+        case 0x22: /* LD (nn),IX */
+            write16 (z80, fetch16 (z80), index->w);
+            return 20;
+
+        case 0x2a: /* LD IX,(nn) */
+            index->w = read16 (z80, fetch16 (z80));
+            return 20;
+
+        case 0x23: /* INC IX */
+            index->w++;
+            return 10;
+
+        case 0x2b: /* DEC IX */
+            index->w--;
+            return 10;
+
+        case 0x24: /* INC IXH */
+            index->h = inc8 (z80, index->h);
+            return 8;
+
+        case 0x25: /* DEC IXH */
+            index->h = dec8 (z80, index->h);
+            return 8;
+
+        case 0x26: /* LD IXH,n */
+            index->h = fetch8 (z80);
+            return 11;
+
+        case 0x2c: /* INC IXL */
+            index->l = inc8 (z80, index->l);
+            return 8;
+
+        case 0x2d: /* DEC IXL */
+            index->l = dec8 (z80, index->l);
+            return 8;
+
+        case 0x2e: /* LD IXL,n */
+            index->l = fetch8 (z80);
+            return 11;
+
+        case 0x34: /* INC (IX+d) */
+        {
+            uint16_t addr = index->w + (int8_t) fetch8 (z80);
+            write8 (z80, addr, inc8 (z80, read8 (z80, addr)));
+            return 23;
+        }
+
+        case 0x35: /* DEC (IX+d) */
+        {
+            uint16_t addr = index->w + (int8_t) fetch8 (z80);
+            write8 (z80, addr, dec8 (z80, read8 (z80, addr)));
+            return 23;
+        }
+
+        case 0x36: /* LD (IX+d),n */
+        {
+            uint16_t addr = index->w + (int8_t) fetch8 (z80);
+            write8 (z80, addr, fetch8 (z80));
+            return 19;
+        }
+
+        case 0xcb:
+            return z80_execute_index_cb (z80, index->w);
+
+        case 0xe1: /* POP IX */
+            index->w = pop16 (z80);
+            return 14;
+
+        case 0xe3: /* EX (SP),IX */
+        {
+            uint16_t value = read16 (z80, z80->sp);
+            write16 (z80, z80->sp, index->w);
+            index->w = value;
+            return 23;
+        }
+
+        case 0xe5: /* PUSH IX */
+            push16 (z80, index->w);
+            return 15;
+
+        case 0xe9: /* JP (IX) */
+            z80->pc = index->w;
+            return 8;
+
+        case 0xf9: /* LD SP,IX */
+            z80->sp = index->w;
+            return 10;
+
+        default:
+            /* The prefix has no effect on this instruction */
+            return 4 + z80_execute (z80, op);
+    }
+}
+
+
+/*
+ * Run an unprefixed instruction, whose opcode has already been fetched.
+ */
+static uint32_t z80_execute (z80_t *z80, uint8_t op)
+{
+    uint8_t y = (op >> 3) & 7;
+
+    /* LD r,r' */
+    if (op >= 0x40 && op < 0x80 && op != 0x76)
+    {
+        uint8_t *dst = reg8 (z80, y);
+        uint8_t *src = reg8 (z80, op & 7);
+
+        if (src == NULL)
+        {
+            *dst = read8 (z80, z80->hl.w);
+            return 7;
+        }
+        else if (dst == NULL)
+        {
+            write8 (z80, z80->hl.w, *src);
+            return 7;
+        }
+
+        *dst = *src;
+        return 4;
+    }
+
+    /* 8-bit arithmetic and logic */
+    if (op >= 0x80 && op < 0xc0)
+    {
+        uint8_t *src = reg8 (z80, op & 7);
+
+        if (src == NULL)
+        {
+            alu8 (z80, y, read8 (z80, z80->hl.w));
+            return 7;
+        }
+
+        alu8 (z80, y, *src);
+        return 4;
+    }
+
+    switch (op)
+    {
+        case 0x00: /* NOP */
+            return 4;
+
+        case 0x01: case 0x11: case 0x21: case 0x31: /* LD rr,nn */
+            *reg16 (z80, &z80->hl, op >> 4) = fetch16 (z80);
+            return 10;
+
+        case 0x02: /* LD (BC),A */
+            write8 (z80, z80->bc.w, z80->af.h);
+            return 7;
+
+        case 0x12: /* LD (DE),A */
+            write8 (z80, z80->de.w, z80->af.h);
+            return 7;
+
+        case 0x0a: /* LD A,(BC) */
+            z80->af.h = read8 (z80, z80->bc.w);
+            return 7;
+
+        case 0x1a: /* LD A,(DE) */
+            z80->af.h = read8 (z80, z80->de.w);
+            return 7;
+
+        case 0x03: case 0x13: case 0x23: case 0x33: /* INC rr */
+            (*reg16 (z80, &z80->hl, op >> 4))++;
+            return 6;
+
+        case 0x0b: case 0x1b: case 0x2b: case 0x3b: /* DEC rr */
+            (*reg16 (z80, &z80->hl, op >> 4))--;
+            return 6;
+
+        case 0x09: case 0x19: case 0x29: case 0x39: /* ADD HL,rr */
+            z80->hl.w = add16 (z80, z80->hl.w, *reg16 (z80, &z80->hl, op >> 4));
+            return 11;
+
+        case 0x04: case 0x0c: case 0x14: case 0x1c: case 0x24: case 0x2c: case 0x3c: /* INC r */
+        {
+            uint8_t *reg = reg8 (z80, y);
+            *reg = inc8 (z80, *reg);
+            return 4;
+        }
+
+        case 0x05: case 0x0d: case 0x15: case 0x1d: case 0x25: case 0x2d: case 0x3d: /* DEC r */
+        {
+            uint8_t *reg = reg8 (z80, y);
+            *reg = dec8 (z80, *reg);
+            return 4;
+        }
+
+        case 0x34: /* INC (HL) */
+            write8 (z80, z80->hl.w, inc8 (z80, read8 (z80, z80->hl.w)));
+            return 11;
+
+        case 0x35: /* DEC (HL) */
+            write8 (z80, z80->hl.w, dec8 (z80, read8 (z80, z80->hl.w)));
+            return 11;
+
+        case 0x06: case 0x0e: case 0x16: case 0x1e: case 0x26: case 0x2e: case 0x3e: /* LD r,n */
+            *reg8 (z80, y) = fetch8 (z80);
+            return 7;
+
+        case 0x36: /* LD (HL),n */
+            write8 (z80, z80->hl.w, fetch8 (z80));
+            return 10;
+
+        case 0x07: /* RLCA */
+        case 0x0f: /* RRCA */
+        case 0x17: /* RLA */
+        case 0x1f: /* RRA */
+        {
+            /* As the CB rotates, but leaving S, Z, and P/V unchanged */
+            uint8_t flags = z80->af.l & (Z80_FLAG_S | Z80_FLAG_Z | Z80_FLAG_PV);
+            z80->af.h = rotate (z80, y, z80->af.h);
+            z80->af.l = flags | (z80->af.l & (Z80_FLAG_X | Z80_FLAG_Y | Z80_FLAG_C));
+            return 4;
+        }
+
+        case 0x08: /* EX AF,AF' */
+        {
+            uint16_t value = z80->af.w;
+            z80->af.w = z80->af_alt;
+            z80->af_alt = value;
+            return 4;
+        }
+
+        case 0x10: /* DJNZ */
+        {
+            int8_t offset = fetch8 (z80);
+            if (--z80->bc.h != 0)
+            {
+                z80->pc += offset;
+                return 13;
+            }
+            return 8;
+        }
+
+        case 0x18: /* JR */
+        {
+            int8_t offset = fetch8 (z80);
+            z80->pc += offset;
+            return 12;
+        }
+
+        case 0x20: case 0x28: case 0x30: case 0x38: /* JR cc */
+        {
+            int8_t offset = fetch8 (z80);
+            if (condition (z80, y - 4))
+            {
+                z80->pc += offset;
+                return 12;
+            }
+            return 7;
+        }
+
+        case 0x22: /* LD (nn),HL */
+            write16 (z80, fetch16 (z80), z80->hl.w);
+            return 16;
+
+        case 0x2a: /* LD HL,(nn) */
+            z80->hl.w = read16 (z80, fetch16 (z80));
+            return 16;
+
+        case 0x32: /* LD (nn),A */
+            write8 (z80, fetch16 (z80), z80->af.h);
+            return 13;
+
+        case 0x3a: /* LD A,(nn) */
+            z80->af.h = read8 (z80, fetch16 (z80));
+            return 13;
+
+        case 0x27: /* DAA */
+            daa (z80);
+            return 4;
+
+        case 0x2f: /* CPL */
+            z80->af.h = ~z80->af.h;
+            z80->af.l = (z80->af.l & (Z80_FLAG_S | Z80_FLAG_Z | Z80_FLAG_PV | Z80_FLAG_C)) |
+                        Z80_FLAG_H | Z80_FLAG_N | (z80->af.h & (Z80_FLAG_X | Z80_FLAG_Y));
+            return 4;
+
+        case 0x37: /* SCF */
+            z80->af.l = (z80->af.l & (Z80_FLAG_S | Z80_FLAG_Z | Z80_FLAG_PV)) |
+                        (z80->af.h & (Z80_FLAG_X | Z80_FLAG_Y)) | Z80_FLAG_C;
+            return 4;
+
+        case 0x3f: /* CCF */
+            z80->af.l = ((z80->af.l & (Z80_FLAG_S | Z80_FLAG_Z | Z80_FLAG_PV | Z80_FLAG_C)) |
+                         ((z80->af.l & Z80_FLAG_C) << 4) | (z80->af.h & (Z80_FLAG_X | Z80_FLAG_Y))) ^ Z80_FLAG_C;
+            return 4;
+
+        case 0x76: /* HALT */
+            z80->halted = true;
+            return 4;
+
+        case 0xc0: case 0xc8: case 0xd0: case 0xd8: case 0xe0: case 0xe8: case 0xf0: case 0xf8: /* RET cc */
+            if (condition (z80, y))
+            {
+                z80->pc = pop16 (z80);
+                return 11;
+            }
+            return 5;
+
+        case 0xc9: /* RET */
+            z80->pc = pop16 (z80);
+            return 10;
+
+        case 0xc1: case 0xd1: case 0xe1: /* POP rr */
+            *reg16 (z80, &z80->hl, (op >> 4) & 3) = pop16 (z80);
+            return 10;
+
+        case 0xf1: /* POP AF */
+            z80->af.w = pop16 (z80);
+            return 10;
+
+        case 0xc5: case 0xd5: case 0xe5: /* PUSH rr */
+            push16 (z80, *reg16 (z80, &z80->hl, (op >> 4) & 3));
+            return 11;
+
+        case 0xf5: /* PUSH AF */
+            push16 (z80, z80->af.w);
+            return 11;
+
+        case 0xc2: case 0xca: case 0xd2: case 0xda: case 0xe2: case 0xea: case 0xf2: case 0xfa: /* JP cc,nn */
+        {
+            uint16_t addr = fetch16 (z80);
+            if (condition (z80, y))
+            {
+                z80->pc = addr;
+            }
+            return 10;
+        }
+
+        case 0xc3: /* JP nn */
+            z80->pc = fetch16 (z80);
+            return 10;
+
+        case 0xc4: case 0xcc: case 0xd4: case 0xdc: case 0xe4: case 0xec: case 0xf4: case 0xfc: /* CALL cc,nn */
+        {
+            uint16_t addr = fetch16 (z80);
+            if (condition (z80, y))
+            {
+                push16 (z80, z80->pc);
+                z80->pc = addr;
+                return 17;
+            }
+            return 10;
+        }
+
+        case 0xcd: /* CALL nn */
+        {
+            uint16_t addr = fetch16 (z80);
+            push16 (z80, z80->pc);
+            z80->pc = addr;
+            return 17;
+        }
+
+        case 0xc6: case 0xce: case 0xd6: case 0xde: case 0xe6: case 0xee: case 0xf6: case 0xfe: /* ALU n */
+            alu8 (z80, y, fetch8 (z80));
+            return 7;
+
+        case 0xc7: case 0xcf: case 0xd7: case 0xdf: case 0xe7: case 0xef: case 0xf7: case 0xff: /* RST */
+            push16 (z80, z80->pc);
+            z80->pc = y << 3;
+            return 11;
+
+        case 0xcb:
+            return z80_execute_cb (z80);
+
+        case 0xd3: /* OUT (n),A */
+            z80->port_write (z80->context, (z80->af.h << 8) | fetch8 (z80), z80->af.h);
+            return 11;
+
+        case 0xdb: /* IN A,(n) */
+            z80->af.h = z80->port_read (z80->context, (z80->af.h << 8) | fetch8 (z80));
+            return 11;
+
+        case 0xd9: /* EXX */
+        {
+            uint16_t value;
+            value = z80->bc.w; z80->bc.w = z80->bc_alt; z80->bc_alt = value;
+            value = z80->de.w; z80->de.w = z80->de_alt; z80->de_alt = value;
+            value = z80->hl.w; z80->hl.w = z80->hl_alt; z80->hl_alt = value;
+            return 4;
+        }
+
+        case 0xdd:
+            return z80_execute_index (z80, &z80->ix);
+
+        case 0xfd:
+            return z80_execute_index (z80, &z80->iy);
+
+        case 0xed:
+            return z80_execute_ed (z80);
+
+        case 0xe3: /* EX (SP),HL */
+        {
+            uint16_t value = read16 (z80, z80->sp);
+            write16 (z80, z80->sp, z80->hl.w);
+            z80->hl.w = value;
+            return 19;
+        }
+
+        case 0xe9: /* JP (HL) */
+            z80->pc = z80->hl.w;
+            return 4;
+
+        case 0xeb: /* EX DE,HL */
+        {
+            uint16_t value = z80->de.w;
+            z80->de.w = z80->hl.w;
+            z80->hl.w = value;
+            return 4;
+        }
+
+        case 0xf3: /* DI */
+            z80->iff1 = false;
+            z80->iff2 = false;
+            return 4;
+
+        case 0xf9: /* LD SP,HL */
+            z80->sp = z80->hl.w;
+            return 6;
+
+        default: /* EI */
+            z80->iff1 = true;
+            z80->iff2 = true;
+            z80->ei_delay = true;
+            return 4;
+    }
+}
+
+
+/*
+ * Reset the CPU.
+ * Memory maps and callbacks are left unchanged.
+ */
+void z80_reset (z80_t *z80)
+{
+    if (!tables_ready)
+    {
+        z80_tables_init ();
+    }
+
+    z80->af.w = 0xffff;
+    z80->bc.w = 0x0000;
+    z80->de.w = 0x0000;
+    z80->hl.w = 0x0000;
+    z80->ix.w = 0xffff;
+    z80->iy.w = 0xffff;
+    z80->sp = 0xffff;
+    z80->pc = 0x0000;
+    z80->af_alt = 0xffff;
+    z80->bc_alt = 0x0000;
+    z80->de_alt = 0x0000;
+    z80->hl_alt = 0x0000;
+    z80->i = 0;
+    z80->r = 0;
+
+    z80->iff1 = false;
+    z80->iff2 = false;
+    z80->im = 0;
+    z80->halted = false;
+    z80->ei_delay = false;
+    z80->irq = false;
+    z80->nmi = false;
+
+    z80->cycles = 0;
+    z80->interrupts = 0;
+}
+
+
+/*
+ * Raise the non-maskable interrupt.
+ */
+void z80_nmi (z80_t *z80)
+{
+    z80->nmi = true;
+}
+
+
+/*
+ * Run a single instruction, or accept a pending interrupt.
+ * Returns the number of T-states taken.
+ */
+uint32_t z80_step (z80_t *z80)
+{
+    uint32_t cycles;
+
+    if (z80->nmi)
+    {
+        z80->nmi = false;
+        z80->halted = false;
+        z80->iff1 = false;
+        refresh (z80);
+        push16 (z80, z80->pc);
+        z80->pc = 0x0066;
+        z80->interrupts++;
+        cycles = 11;
+    }
+    else if (z80->irq && z80->iff1 && !z80->ei_delay)
+    {
+        z80->halted = false;
+        z80->iff1 = false;
+        z80->iff2 = false;
+        refresh (z80);
+        push16 (z80, z80->pc);
+        z80->interrupts++;
+
+        if (z80->im == 2)
+        {
+            /* The data bus floats high, giving a vector of 0xff */
+            z80->pc = read16 (z80, (z80->i << 8) | 0xff);
+            cycles = 19;
+        }
+        else
+        {
+            /* In mode 0, the floating bus reads as RST 38h */
+            z80->pc = 0x0038;
+            cycles = 13;
+        }
+    }
+    else
+    {
+        z80->ei_delay = false;
+
+        if (z80->halted)
+        {
+            refresh (z80);
+            cycles = 4;
+        }
+        else
+        {
+            uint8_t op = fetch8 (z80);
+            refresh (z80);
+            cycles = z80_execute (z80, op);
+        }
+    }
+
+    z80->cycles += cycles;
+    return cycles;
+}
+
+
+/*
+ * Run until the total cycle count reaches the given value.
+ */
+void z80_run (z80_t *z80, uint64_t until)
+{
+    if (z80->trace != NULL)
+    {
+        while (z80->cycles < until)
+        {
+            z80_step (z80);
+            z80->trace (z80->trace_context, z80);
+        }
+        return;
+    }
+
+    while (z80->cycles < until)
+    {
+        z80_step (z80);
+    }
+}
+
+
+/*
+ * Read a byte through the memory map, without side effects.
+ */
+uint8_t z80_peek (const z80_t *z80, uint16_t addr)
+{
+    return read8 (z80, addr);
+}
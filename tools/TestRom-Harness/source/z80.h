@@ -0,0 +1,92 @@
+/*
+ * TestRom-Harness
+ * A Z80 core for running the test ROM on the host.
+ *
+ * JoppyFurr 2024
+ */
+
+/* Flag bits */
+#define Z80_FLAG_C  0x01
+#define Z80_FLAG_N  0x02
+#define Z80_FLAG_PV 0x04
+#define Z80_FLAG_X  0x08
+#define Z80_FLAG_H  0x10
+#define Z80_FLAG_Y  0x20
+#define Z80_FLAG_Z  0x40
+#define Z80_FLAG_S  0x80
+
+/* Memory is mapped in 1 KiB pages, the granularity of the Sega mapper's fixed first page. */
+#define Z80_PAGE_SHIFT  10
+#define Z80_PAGE_SIZE   (1 << Z80_PAGE_SHIFT)
+#define Z80_PAGE_COUNT  (0x10000 >> Z80_PAGE_SHIFT)
+
+/* Register pairs. Assumes a little-endian host. */
+typedef union z80_pair_u {
+    uint16_t w;
+    struct {
+        uint8_t l;
+        uint8_t h;
+    };
+} z80_pair_t;
+
+typedef struct z80_s {
+
+    /* Registers */
+    z80_pair_t af;
+    z80_pair_t bc;
+    z80_pair_t de;
+    z80_pair_t hl;
+    z80_pair_t ix;
+    z80_pair_t iy;
+    uint16_t sp;
+    uint16_t pc;
+    uint16_t af_alt;
+    uint16_t bc_alt;
+    uint16_t de_alt;
+    uint16_t hl_alt;
+    uint8_t i;
+    uint8_t r;
+
+    /* Interrupt state */
+    bool iff1;
+    bool iff2;
+    uint8_t im;
+    bool halted;
+    bool ei_delay;
+    bool irq;
+    bool nmi;
+
+    /* Total T-states run, and interrupts accepted */
+    uint64_t cycles;
+    uint64_t interrupts;
+
+    /* Memory. Pages without a write mapping are passed to memory_write. */
+    const uint8_t *read_map [Z80_PAGE_COUNT];
+    uint8_t *write_map [Z80_PAGE_COUNT];
+
+    /* Callbacks */
+    void *context;
+    void (*memory_write) (void *context, uint16_t addr, uint8_t value);
+    uint8_t (*port_read) (void *context, uint16_t port);
+    void (*port_write) (void *context, uint16_t port, uint8_t value);
+
+    /* Optional, called by z80_run after each instruction or interrupt */
+    void *trace_context;
+    void (*trace) (void *trace_context, const struct z80_s *z80);
+
+} z80_t;
+
+/* Reset the CPU. Memory maps and callbacks are left unchanged. */
+void z80_reset (z80_t *z80);
+
+/* Raise the non-maskable interrupt. */
+void z80_nmi (z80_t *z80);
+
+/* Run a single instruction, or accept a pending interrupt. Returns the number of T-states taken. */
+uint32_t z80_step (z80_t *z80);
+
+/* Run until the total cycle count reaches the given value. */
+void z80_run (z80_t *z80, uint64_t until);
+
+/* Read a byte through the memory map, without side effects. */
+uint8_t z80_peek (const z80_t *z80, uint16_t addr);